@@ -71,7 +71,6 @@ void init_udp_config(UDPConfig *config) {
 int load_udp_config(UDPConfig *config, const char *filename) {
     FILE *file = fopen(filename, "r");
     if (file == NULL) {
-        printf("Configuration file %s not found, using default settings.\n", filename);
         return 0;
     }
     
@@ -0,0 +1,209 @@
+/**
+ * ASCII Symbol Text
+ */
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ascii.h"
+
+#define FAST_LIMIT 9007199254740992.0  // 2^53: scaled values below are exact integers
+#define PARSE_MAX_DIGITS 19            // Digits that always fit a uint64_t
+#define PARSE_MAX_FRACTION 22          // Largest exact power of ten in a double
+#define PARSE_FALLBACK_CHARS 64        // Longest number handed to strtof()
+
+static const double pow10_double[PARSE_MAX_FRACTION + 1] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+static const uint32_t pow10_int[ASCII_MAX_DECIMALS + 1] = {
+    1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000
+};
+
+static const char digit_pairs[201] =
+    "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+    "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+    "8081828384858687888990919293949596979899";
+
+/**
+ * Write an unsigned integer without leading zeros
+ */
+static size_t write_uint(uint64_t v, char *out) {
+    char buf[20];
+    char *p = buf + sizeof(buf);
+
+    while (v >= 100) {
+        p -= 2;
+        memcpy(p, digit_pairs + 2 * (v % 100), 2);
+        v /= 100;
+    }
+    if (v >= 10) {
+        p -= 2;
+        memcpy(p, digit_pairs + 2 * v, 2);
+    } else {
+        *--p = (char)('0' + v);
+    }
+
+    size_t n = buf + sizeof(buf) - p;
+    memcpy(out, p, n);
+    return n;
+}
+
+/**
+ * Write exactly count digits, with leading zeros
+ */
+static void write_fixed(uint32_t v, int count, char *out) {
+    int i = count;
+    for (; i >= 2; i -= 2) {
+        memcpy(out + i - 2, digit_pairs + 2 * (v % 100), 2);
+        v /= 100;
+    }
+    if (i == 1) {
+        out[0] = (char)('0' + v);
+    }
+}
+
+size_t ascii_format_float(float x, int decimals, char *out) {
+    double v = fabs((double)x) * pow10_double[decimals];
+
+    if (!(v < FAST_LIMIT)) {
+        return (size_t)snprintf(out, ASCII_FLOAT_CHARS, "%.*f", decimals, x);
+    }
+
+    char *p = out;
+    if (signbit(x)) {
+        *p++ = '-';
+    }
+    uint64_t n = (uint64_t)llrint(v);
+    uint64_t whole = n / pow10_int[decimals];
+    p += write_uint(whole, p);
+    if (decimals > 0) {
+        *p++ = '.';
+        write_fixed((uint32_t)(n - whole * pow10_int[decimals]), decimals, p);
+        p += decimals;
+    }
+    return p - out;
+}
+
+size_t ascii_format_symbols(const float *iq, size_t symbols, int decimals, size_t align,
+                            char *out, size_t cap, size_t *len) {
+    char tmp[ASCII_SYMBOL_CHARS];
+    size_t used = 0, aligned = 0, aligned_used = 0;
+    size_t i;
+
+    if (align == 0) {
+        align = 1;
+    }
+    for (i = 0; i < symbols; i++) {
+        // Write straight into the buffer while even the longest symbol fits
+        char *p = cap - used >= ASCII_SYMBOL_CHARS ? out + used : tmp;
+        size_t n = 0;
+        if (i > 0) {
+            p[n++] = ',';
+        }
+        p[n++] = '(';
+        n += ascii_format_float(iq[2*i], decimals, p + n);
+        p[n++] = ',';
+        n += ascii_format_float(iq[2*i + 1], decimals, p + n);
+        p[n++] = ')';
+        if (p == tmp) {
+            if (n > cap - used) {
+                break;
+            }
+            memcpy(out + used, tmp, n);
+        }
+        used += n;
+        if ((i + 1) % align == 0) {
+            aligned = i + 1;
+            aligned_used = used;
+        }
+    }
+    if (i < symbols && aligned > 0) {
+        i = aligned;
+        used = aligned_used;
+    }
+    *len = used;
+    return i;
+}
+
+static inline const char *skip_space(const char *p, const char *end) {
+    while (p < end && (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r')) {
+        p++;
+    }
+    return p;
+}
+
+static inline int is_digit(char c) {
+    return (unsigned)(c - '0') < 10;
+}
+
+/**
+ * Read one number
+ *
+ * @return Position after the number, or NULL if there is none
+ */
+static const char *parse_float(const char *p, const char *end, float *x) {
+    const char *start = p;
+    uint64_t mantissa = 0;
+    int digits = 0, fraction = 0, negative = 0;
+
+    if (p < end && (*p == '-' || *p == '+')) {
+        negative = *p == '-';
+        p++;
+    }
+    for (; p < end && is_digit(*p); p++, digits++) {
+        mantissa = mantissa * 10 + (*p - '0');
+    }
+    if (p < end && *p == '.') {
+        for (p++; p < end && is_digit(*p); p++, digits++, fraction++) {
+            mantissa = mantissa * 10 + (*p - '0');
+        }
+    }
+
+    // A mantissa of at most 2^53 over an exact power of ten is one correctly
+    // rounded division; only the conversion to float rounds again
+    if (digits > 0 && digits <= PARSE_MAX_DIGITS && fraction <= PARSE_MAX_FRACTION
+        && mantissa <= (uint64_t)FAST_LIMIT && (p == end || (*p != 'e' && *p != 'E'))) {
+        double v = (double)mantissa / pow10_double[fraction];
+        *x = (float)(negative ? -v : v);
+        return p;
+    }
+
+    char buf[PARSE_FALLBACK_CHARS + 1];
+    size_t n = end - start < PARSE_FALLBACK_CHARS ? (size_t)(end - start) : PARSE_FALLBACK_CHARS;
+    char *stop;
+    memcpy(buf, start, n);
+    buf[n] = '\0';
+    *x = strtof(buf, &stop);
+    return stop == buf ? NULL : start + (stop - buf);
+}
+
+long ascii_parse_symbols(const char *text, size_t len, float *iq, size_t max_symbols) {
+    const char *p = skip_space(text, text + len);
+    const char *end = text + len;
+    size_t n = 0;
+
+    while (p < end && *p != '\0') {
+        if (n == max_symbols || *p != '(') {
+            return -1;
+        }
+        p = parse_float(skip_space(p + 1, end), end, &iq[2*n]);
+        if (p == NULL || (p = skip_space(p, end)) == end || *p != ',') {
+            return -1;
+        }
+        p = parse_float(skip_space(p + 1, end), end, &iq[2*n + 1]);
+        if (p == NULL || (p = skip_space(p, end)) == end || *p != ')') {
+            return -1;
+        }
+        n++;
+        p = skip_space(p + 1, end);
+        if (p < end && *p == ',') {
+            p = skip_space(p + 1, end);
+        }
+    }
+    return (long)n;
+}
@@ -0,0 +1,74 @@
+/**
+ * ASCII Symbol Text
+ *
+ * Formats and parses the text form of I/Q symbols used by udp_ascii and
+ * its legacy consumers:
+ *
+ *   (0.712345,-0.698765),(-0.701234,0.723456),...
+ *
+ * Numbers are written like printf("%.*f") in the C locale, digit for
+ * digit, but with integer arithmetic instead of printf's general
+ * conversion: the value is scaled by 10^decimals in double precision,
+ * which is exact enough that rounding to the nearest integer (ties to
+ * even) gives the correctly rounded result printf gives. Values of 2^53 /
+ * 10^decimals and above, infinities and NaNs fall back to snprintf().
+ *
+ * The parser reads the same text, with optional white space around the
+ * tokens, and converts plain decimals of up to 19 digits with a single
+ * division; anything else (exponents, longer numbers, "inf", "nan") goes
+ * through strtof().
+ */
+
+#ifndef QPSK_ASCII_H
+#define QPSK_ASCII_H
+
+#include <stddef.h>
+
+#define ASCII_MAX_DECIMALS 9         // Most digits after the decimal point
+#define ASCII_DEFAULT_DECIMALS 6     // Digits of "%f"
+#define ASCII_FLOAT_CHARS 56         // Longest number written, FLT_MAX with 9 decimals included
+#define ASCII_SYMBOL_CHARS (2 * ASCII_FLOAT_CHARS + 4) // Longest "(re,im)," written
+
+/**
+ * Write one number with a fixed number of decimals
+ *
+ * @param x         Value
+ * @param decimals  Digits after the decimal point, 0..ASCII_MAX_DECIMALS
+ * @param out       Room for ASCII_FLOAT_CHARS characters (not terminated)
+ * @return Characters written
+ */
+size_t ascii_format_float(float x, int decimals, char *out);
+
+/**
+ * Write as many whole symbols as fit in a buffer
+ *
+ * Symbols are separated by commas; the text does not end with one. When
+ * not all symbols fit, the number written is rounded down to a multiple
+ * of align (if at least align fit), so that a sender splitting a long
+ * stream across datagrams can keep each one a whole number of bit-source
+ * bytes.
+ *
+ * @param iq        Samples (interleaved I/Q)
+ * @param symbols   Number of symbols available
+ * @param decimals  Digits after the decimal point
+ * @param align     Granularity of partial writes in symbols (1 for none)
+ * @param out       Text buffer (not terminated)
+ * @param cap       Size of out in bytes
+ * @param len       Characters written
+ * @return Symbols written
+ */
+size_t ascii_format_symbols(const float *iq, size_t symbols, int decimals, size_t align,
+                            char *out, size_t cap, size_t *len);
+
+/**
+ * Read symbols written by ascii_format_symbols()
+ *
+ * @param text         Text (need not be terminated)
+ * @param len          Length of the text
+ * @param iq           Samples (interleaved I/Q)
+ * @param max_symbols  Room in iq in symbols
+ * @return Symbols read, or -1 if the text is malformed or holds more than max_symbols
+ */
+long ascii_parse_symbols(const char *text, size_t len, float *iq, size_t max_symbols);
+
+#endif /* QPSK_ASCII_H */
@@ -0,0 +1,161 @@
+/**
+ * Additive White Gaussian Noise Channel
+ *
+ * Ziggurat tables follow Marsaglia & Tsang, "The Ziggurat Method for
+ * Generating Random Variables" (2000), with 128 layers. A 64-bit draw
+ * supplies both the signed 32-bit abscissa and the 7-bit layer index.
+ */
+
+#include <math.h>
+
+#include "awgn.h"
+
+#define ZIG_LAYERS 128
+#define ZIG_R 3.442619855899          // Start of the tail
+#define ZIG_V 9.91256303526217e-3     // Area of each layer
+
+static uint32_t zig_k[ZIG_LAYERS];
+static double zig_w[ZIG_LAYERS];
+static double zig_f[ZIG_LAYERS];
+
+/**
+ * Build the Ziggurat tables once at program start
+ */
+__attribute__((constructor))
+static void zig_setup(void) {
+    const double m1 = 2147483648.0;   // 2^31
+    double dn = ZIG_R, tn = dn;
+    double q = ZIG_V / exp(-0.5 * dn * dn);
+
+    zig_k[0] = (uint32_t)((dn / q) * m1);
+    zig_k[1] = 0;
+    zig_w[0] = q / m1;
+    zig_w[ZIG_LAYERS - 1] = dn / m1;
+    zig_f[0] = 1.0;
+    zig_f[ZIG_LAYERS - 1] = exp(-0.5 * dn * dn);
+
+    for (int i = ZIG_LAYERS - 2; i >= 1; i--) {
+        dn = sqrt(-2.0 * log(ZIG_V / dn + exp(-0.5 * dn * dn)));
+        zig_k[i + 1] = (uint32_t)((dn / tn) * m1);
+        tn = dn;
+        zig_f[i] = exp(-0.5 * dn * dn);
+        zig_w[i] = dn / m1;
+    }
+}
+
+static inline uint32_t abs32(int32_t x) {
+    return x < 0 ? 0u - (uint32_t)x : (uint32_t)x;
+}
+
+/**
+ * Rejection path, taken for roughly 1% of samples
+ */
+static double zig_slow(Rng *rng, int32_t hz, uint32_t iz) {
+    for (;;) {
+        double x = hz * zig_w[iz];
+
+        // Base layer: sample from the tail beyond ZIG_R
+        if (iz == 0) {
+            double y;
+            do {
+                x = -log(rng_uniform_open(rng)) / ZIG_R;
+                y = -log(rng_uniform_open(rng));
+            } while (y + y < x * x);
+            return hz > 0 ? ZIG_R + x : -ZIG_R - x;
+        }
+
+        // Wedge between layers: accept against the true density
+        if (zig_f[iz] + rng_uniform(rng) * (zig_f[iz - 1] - zig_f[iz]) < exp(-0.5 * x * x)) {
+            return x;
+        }
+
+        uint64_t r = rng_next(rng);
+        hz = (int32_t)(r >> 32);
+        iz = r & (ZIG_LAYERS - 1);
+        if (abs32(hz) < zig_k[iz]) {
+            return hz * zig_w[iz];
+        }
+    }
+}
+
+static inline double zig_normal(Rng *rng) {
+    uint64_t r = rng_next(rng);
+    int32_t hz = (int32_t)(r >> 32);
+    uint32_t iz = r & (ZIG_LAYERS - 1);
+
+    if (abs32(hz) < zig_k[iz]) {
+        return hz * zig_w[iz];
+    }
+    return zig_slow(rng, hz, iz);
+}
+
+double awgn_gaussian(Rng *rng) {
+    return zig_normal(rng);
+}
+
+double awgn_sigma_from_esn0_db(double esn0_db) {
+    double n0 = pow(10.0, -esn0_db / 10.0);
+    return sqrt(n0 / 2.0);
+}
+
+double awgn_ebn0_to_esn0_db(double ebn0_db, int bits_per_symbol) {
+    return ebn0_db + 10.0 * log10((double)bits_per_symbol);
+}
+
+double awgn_sigma_from_ebn0_db(double ebn0_db, int bits_per_symbol) {
+    return awgn_sigma_from_esn0_db(awgn_ebn0_to_esn0_db(ebn0_db, bits_per_symbol));
+}
+
+void awgn_init(Awgn *channel, uint64_t seed, double esn0_db) {
+    rng_seed(&channel->rng, seed);
+    awgn_set_esn0_db(channel, esn0_db);
+}
+
+void awgn_set_esn0_db(Awgn *channel, double esn0_db) {
+    channel->sigma = awgn_sigma_from_esn0_db(esn0_db);
+}
+
+void awgn_set_ebn0_db(Awgn *channel, double ebn0_db) {
+    channel->sigma = awgn_sigma_from_ebn0_db(ebn0_db, QPSK_BITS_PER_SYMBOL);
+}
+
+void awgn_fill(Awgn *channel, float *out, size_t count) {
+    Rng rng = channel->rng;   // Local copy keeps the state in registers
+    double sigma = channel->sigma;
+
+    for (size_t i = 0; i < count; i++) {
+        out[i] = (float)(sigma * zig_normal(&rng));
+    }
+    channel->rng = rng;
+}
+
+void awgn_add(Awgn *channel, float *samples, size_t count) {
+    Rng rng = channel->rng;
+    double sigma = channel->sigma;
+
+    for (size_t i = 0; i < count; i++) {
+        samples[i] += (float)(sigma * zig_normal(&rng));
+    }
+    channel->rng = rng;
+}
+
+void awgn_add_double(Awgn *channel, double *samples, size_t count) {
+    Rng rng = channel->rng;
+    double sigma = channel->sigma;
+
+    for (size_t i = 0; i < count; i++) {
+        samples[i] += sigma * zig_normal(&rng);
+    }
+    channel->rng = rng;
+}
+
+void awgn_add_complex(Awgn *channel, Complex *symbols, size_t count) {
+    Rng rng = channel->rng;
+    double sigma = channel->sigma;
+
+    for (size_t i = 0; i < count; i++) {
+        symbols[i].real += sigma * zig_normal(&rng);
+        symbols[i].imag += sigma * zig_normal(&rng);
+    }
+    channel->rng = rng;
+}
@@ -0,0 +1,109 @@
+/**
+ * Additive White Gaussian Noise Channel
+ *
+ * Generates zero-mean Gaussian noise with the Ziggurat method (Marsaglia &
+ * Tsang) on top of the xoshiro256** generator: about 99% of samples cost
+ * one 64-bit draw, a table lookup and a multiply, with no log/sqrt.
+ *
+ * The noise level is set from Es/N0 or Eb/N0 in dB for unit-energy symbols
+ * (Es = 1, as produced by qpsk_map). Complex noise of variance N0 is split
+ * evenly, so each of I and Q gets standard deviation sqrt(N0 / 2).
+ *
+ * Each Awgn owns its generator, so independent channels can run on
+ * different threads without locking.
+ */
+
+#ifndef QPSK_AWGN_H
+#define QPSK_AWGN_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "rng.h"
+#include "qpsk_map.h"
+
+#define QPSK_BITS_PER_SYMBOL 2
+
+/**
+ * Noise generator state
+ */
+typedef struct {
+    Rng rng;        // Private random stream
+    double sigma;   // Standard deviation per real component
+} Awgn;
+
+/**
+ * Per-component standard deviation for a given Es/N0 (unit symbol energy)
+ *
+ * @param esn0_db  Symbol energy to noise density ratio in dB
+ */
+double awgn_sigma_from_esn0_db(double esn0_db);
+
+/**
+ * Per-component standard deviation for a given Eb/N0 (unit symbol energy)
+ *
+ * @param ebn0_db          Bit energy to noise density ratio in dB
+ * @param bits_per_symbol  Bits carried by each symbol (2 for QPSK)
+ */
+double awgn_sigma_from_ebn0_db(double ebn0_db, int bits_per_symbol);
+
+/**
+ * Convert Eb/N0 to Es/N0 in dB
+ */
+double awgn_ebn0_to_esn0_db(double ebn0_db, int bits_per_symbol);
+
+/**
+ * Initialize a noise generator
+ *
+ * @param channel  Generator to initialize
+ * @param seed     Seed for the private random stream
+ * @param esn0_db  Initial Es/N0 in dB
+ */
+void awgn_init(Awgn *channel, uint64_t seed, double esn0_db);
+
+/**
+ * Change the noise level to a given Es/N0 in dB
+ */
+void awgn_set_esn0_db(Awgn *channel, double esn0_db);
+
+/**
+ * Change the noise level to a given Eb/N0 in dB for QPSK
+ */
+void awgn_set_ebn0_db(Awgn *channel, double ebn0_db);
+
+/**
+ * Draw one standard normal sample (zero mean, unit variance)
+ *
+ * @param rng  Random stream to draw from
+ */
+double awgn_gaussian(Rng *rng);
+
+/**
+ * Fill a buffer with noise samples of the channel's standard deviation
+ *
+ * @param channel  Noise generator
+ * @param out      Output samples
+ * @param count    Number of samples
+ */
+void awgn_fill(Awgn *channel, float *out, size_t count);
+
+/**
+ * Add noise to a block of float samples (interleaved I/Q or a single plane)
+ *
+ * @param channel  Noise generator
+ * @param samples  Samples, modified in place
+ * @param count    Number of floats
+ */
+void awgn_add(Awgn *channel, float *samples, size_t count);
+
+/**
+ * Add noise to a block of double samples
+ */
+void awgn_add_double(Awgn *channel, double *samples, size_t count);
+
+/**
+ * Add noise to both parts of a block of complex symbols
+ */
+void awgn_add_complex(Awgn *channel, Complex *symbols, size_t count);
+
+#endif /* QPSK_AWGN_H */
@@ -0,0 +1,168 @@
+/**
+ * Bit and Symbol Error Rate Accounting
+ */
+
+#include <string.h>
+
+#include "ber.h"
+
+#define MAX_FRAME_BYTES 4096  // Bytes compared per chunk of a frame
+
+void ber_init(BerCounter *ber, BitSourceType type, uint64_t seed) {
+    memset(ber, 0, sizeof(*ber));
+    bitsrc_init(&ber->ref, type, seed);
+    ber->self_sync = (type != BITSRC_RANDOM);
+    ber->locked = !ber->self_sync;
+}
+
+void ber_restart(BerCounter *ber, BitSourceType type, uint64_t seed) {
+    BerCounter kept = *ber;
+
+    ber_init(ber, type, seed);
+    ber->bits = kept.bits;
+    ber->bit_errors = kept.bit_errors;
+    ber->symbols = kept.symbols;
+    ber->symbol_errors = kept.symbol_errors;
+    ber->resyncs = kept.resyncs;
+}
+
+/**
+ * Shift the bits of a frame into the receive history; padding bits of a
+ * partial last byte were never sent, so the history restarts after them
+ */
+static void track_history(BerCounter *ber, const uint8_t *rx, size_t symbols) {
+    size_t full = symbols / 4;
+
+    for (size_t i = 0; i < full; i++) {
+        ber->rx_history = (ber->rx_history << 8) | rx[i];
+    }
+    ber->rx_history_bits += 8 * (int)(full < 8 ? full : 8);
+
+    int tail = 2 * (int)(symbols & 3);
+    if (tail > 0) {
+        ber->rx_history = (ber->rx_history << tail) | (rx[full] >> (8 - tail));
+        ber->rx_history_bits += tail;
+    }
+    if (ber->rx_history_bits > 64) {
+        ber->rx_history_bits = 64;
+    }
+}
+
+/**
+ * Compare bytes and add bit and symbol error counts
+ */
+static void count_errors(const uint8_t *rx, const uint8_t *ref, size_t bytes, uint8_t last_mask,
+                         unsigned long long *bit_errors, unsigned long long *symbol_errors) {
+    size_t i = 0;
+
+    for (; i + 8 <= bytes; i += 8) {
+        uint64_t a, b;
+        memcpy(&a, rx + i, sizeof(a));
+        memcpy(&b, ref + i, sizeof(b));
+        uint64_t d = a ^ b;
+        if (i + 8 == bytes) {
+            d &= ~0ULL >> 8 | (uint64_t)last_mask << 56;
+        }
+        *bit_errors += __builtin_popcountll(d);
+        *symbol_errors += __builtin_popcountll((d | d >> 1) & 0x5555555555555555ULL);
+    }
+    for (; i < bytes; i++) {
+        unsigned d = rx[i] ^ ref[i];
+        if (i + 1 == bytes) {
+            d &= last_mask;
+        }
+        *bit_errors += __builtin_popcount(d);
+        *symbol_errors += __builtin_popcount((d | d >> 1) & 0x55);
+    }
+}
+
+/**
+ * Check the lock once a window is complete
+ *
+ * A window that passes is held back until the next one passes too, so that
+ * a window which only partly overlaps a loss of alignment is discarded along
+ * with the failing window after it. Discarded windows were compared against
+ * a misaligned reference and say nothing about the link.
+ */
+static void judge_window(BerCounter *ber) {
+    if (ber->window.bit_errors * 4 > ber->window.bits) {
+        memset(&ber->held, 0, sizeof(ber->held));
+        ber->locked = 0;
+        ber->resyncs++;
+        ber->rx_history_bits = 0;
+    } else {
+        ber->bits += ber->held.bits;
+        ber->bit_errors += ber->held.bit_errors;
+        ber->symbols += ber->held.symbols;
+        ber->symbol_errors += ber->held.symbol_errors;
+        ber->held = ber->window;
+    }
+    memset(&ber->window, 0, sizeof(ber->window));
+}
+
+void ber_update(BerCounter *ber, const uint8_t *rx, size_t symbols) {
+    uint8_t ref[MAX_FRAME_BYTES];
+    size_t bytes = (symbols + 3) / 4;
+
+    if (!ber->locked) {
+        // Lock as soon as enough contiguous bits were seen; the reference
+        // then skips the unsent padding at the end of this frame
+        track_history(ber, rx, symbols);
+        if (ber->rx_history_bits >= bitsrc_sync_bits(&ber->ref)) {
+            bitsrc_sync(&ber->ref, ber->rx_history, (int)(8 * bytes - 2 * symbols));
+            ber->locked = 1;
+        } else if (symbols & 3) {
+            ber->rx_history_bits = 0;
+        }
+        return;
+    }
+
+    unsigned long long bit_errors = 0, symbol_errors = 0;
+    for (size_t done = 0; done < bytes; ) {
+        size_t n = bytes - done < MAX_FRAME_BYTES ? bytes - done : MAX_FRAME_BYTES;
+        int last = (done + n == bytes);
+        uint8_t last_mask = (last && (symbols & 3)) ? (uint8_t)(0xFF << (8 - 2 * (symbols & 3))) : 0xFF;
+
+        bitsrc_fill_bytes(&ber->ref, ref, n);
+        count_errors(rx + done, ref, n, last_mask, &bit_errors, &symbol_errors);
+        done += n;
+    }
+    if (!ber->self_sync) {
+        ber->bits += 2 * symbols;
+        ber->bit_errors += bit_errors;
+        ber->symbols += symbols;
+        ber->symbol_errors += symbol_errors;
+        return;
+    }
+
+    ber->window.bits += 2 * symbols;
+    ber->window.bit_errors += bit_errors;
+    ber->window.symbols += symbols;
+    ber->window.symbol_errors += symbol_errors;
+    if (ber->window.bits >= BER_WINDOW_BITS) {
+        judge_window(ber);
+    }
+}
+
+void ber_skip(BerCounter *ber, unsigned long long frames, size_t symbols) {
+    uint8_t discard[MAX_FRAME_BYTES];
+    unsigned long long bytes = frames * ((symbols + 3) / 4);
+
+    if (!ber->locked) {
+        ber->rx_history_bits = 0;
+        return;
+    }
+    while (bytes > 0) {
+        size_t n = bytes < MAX_FRAME_BYTES ? (size_t)bytes : MAX_FRAME_BYTES;
+        bitsrc_fill_bytes(&ber->ref, discard, n);
+        bytes -= n;
+    }
+}
+
+double ber_bit_rate(const BerCounter *ber) {
+    return ber->bits ? (double)ber->bit_errors / ber->bits : 0.0;
+}
+
+double ber_symbol_rate(const BerCounter *ber) {
+    return ber->symbols ? (double)ber->symbol_errors / ber->symbols : 0.0;
+}
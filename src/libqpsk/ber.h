@@ -0,0 +1,103 @@
+/**
+ * Bit and Symbol Error Rate Accounting
+ *
+ * Compares demapped frames against a local copy of the transmitted bit
+ * stream. Each frame consumes (symbols + 3) / 4 bytes of the stream, the
+ * same amount the transmitters draw from their bit source per frame.
+ *
+ *   - random: the reference is the same seeded generator, so frames must
+ *     arrive in order, and lost frames must be reported with ber_skip()
+ *     (e.g. from sequence numbers) to stay aligned
+ *   - PRBS: the counter locks onto the received bits themselves (the last
+ *     n bits of a PRBS-n determine the rest) and drops lock when more than
+ *     25% of the bits in a window of whole frames are wrong, e.g. after a
+ *     lost datagram, then locks again. Windows are only added to the totals
+ *     once they and the window after them pass, so misaligned comparisons
+ *     are not counted. This assumes the link BER is well below 25%.
+ */
+
+#ifndef QPSK_BER_H
+#define QPSK_BER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "bitsrc.h"
+
+#define BER_WINDOW_BITS 64  // PRBS bits compared before judging the lock
+
+/**
+ * Error counts over a stretch of frames
+ */
+typedef struct {
+    unsigned long long bits;
+    unsigned long long bit_errors;
+    unsigned long long symbols;
+    unsigned long long symbol_errors;
+} BerWindow;
+
+/**
+ * Running error counts
+ */
+typedef struct {
+    BitSource ref;                          // Local copy of the transmitted stream
+    int self_sync;                          // Non-zero for PRBS sources
+    int locked;                             // Counting errors against ref
+    uint64_t rx_history;                    // Recent received bits, newest in bit 0
+    int rx_history_bits;
+    unsigned long long bits;                // Totals over all accepted frames
+    unsigned long long bit_errors;
+    unsigned long long symbols;
+    unsigned long long symbol_errors;
+    unsigned long long resyncs;             // Times the PRBS lock was lost
+    BerWindow window;                       // PRBS window being compared
+    BerWindow held;                         // Passed window awaiting the next one
+} BerCounter;
+
+/**
+ * Initialize a counter for a transmitter using the given bit source
+ *
+ * @param ber   Counter to initialize
+ * @param type  Transmitter bit source
+ * @param seed  Transmitter seed (random) or start state (PRBS, not needed to lock)
+ */
+void ber_init(BerCounter *ber, BitSourceType type, uint64_t seed);
+
+/**
+ * Start the reference over for a transmitter that restarted its bit
+ * source, keeping the totals counted so far
+ */
+void ber_restart(BerCounter *ber, BitSourceType type, uint64_t seed);
+
+/**
+ * Count the errors in one received frame
+ *
+ * @param ber      Counter
+ * @param rx       Hard decisions, four symbols per byte
+ * @param symbols  Symbols in the frame
+ */
+void ber_update(BerCounter *ber, const uint8_t *rx, size_t symbols);
+
+/**
+ * Advance past frames that were sent but never received
+ *
+ * The reference skips the bits of the missing frames, so a locked counter
+ * stays aligned; an unlocked PRBS counter restarts its search.
+ *
+ * @param ber      Counter
+ * @param frames   Number of missing frames
+ * @param symbols  Symbols in each missing frame
+ */
+void ber_skip(BerCounter *ber, unsigned long long frames, size_t symbols);
+
+/**
+ * Bit error rate so far (0 before any bits were compared)
+ */
+double ber_bit_rate(const BerCounter *ber);
+
+/**
+ * Symbol error rate so far (0 before any symbols were compared)
+ */
+double ber_symbol_rate(const BerCounter *ber);
+
+#endif /* QPSK_BER_H */
@@ -0,0 +1,262 @@
+/**
+ * Monte Carlo BER Simulation
+ */
+
+#include <math.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "awgn.h"
+#include "bersim.h"
+#include "conv.h"
+#include "qpsk_demap.h"
+#include "qpsk_map.h"
+
+#define BLOCK_WORDS (BERSIM_BLOCK_SYMBOLS / 32)        // 32 symbols per 64-bit word
+#define CHUNK_BLOCKS (BERSIM_CHUNK_SYMBOLS / BERSIM_BLOCK_SYMBOLS)
+#define SYMBOL_LOW_BITS 0x5555555555555555ULL          // Low bit of every symbol's pair
+
+/**
+ * Totals shared by the workers of one point
+ */
+typedef struct {
+    atomic_ullong bits;
+    atomic_ullong bit_errors;
+    atomic_ullong symbols;
+    atomic_ullong symbol_errors;
+    atomic_int stop;
+    unsigned long long target_errors;
+    unsigned long long max_bits;
+    ConvRate code;
+    size_t info_bits;                       // Data bits per block
+} Shared;
+
+/**
+ * State of one worker thread
+ */
+typedef struct {
+    Shared *shared;
+    Rng bits;                               // Data bit stream
+    Awgn channel;                           // Noise, with its own stream
+    uint64_t tx[BLOCK_WORDS];               // Transmitted bits
+    uint64_t rx[BLOCK_WORDS];               // Hard decisions
+    float iq[2 * BERSIM_BLOCK_SYMBOLS];
+    uint64_t info[BLOCK_WORDS];             // Data bits of a codeword
+    uint64_t decoded[BLOCK_WORDS];          // Decoder output
+    int8_t llr[2 * BERSIM_BLOCK_SYMBOLS];
+    ConvDecoder decoder;
+    double decode_seconds;
+} Worker;
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/**
+ * Count the bits that differ in two packed bit strings
+ */
+static unsigned long long count_errors(const uint8_t *a, const uint8_t *b, size_t bits) {
+    unsigned long long errors = 0;
+    for (size_t i = 0; i < bits / 8; i++) {
+        errors += __builtin_popcount(a[i] ^ b[i]);
+    }
+    return errors;
+}
+
+/**
+ * Send one block of random symbols through the channel and count the errors
+ */
+static void run_block(Worker *w, unsigned long long *bit_errors, unsigned long long *symbol_errors) {
+    const Shared *shared = w->shared;
+
+    if (shared->code != CONV_NONE) {
+        for (size_t i = 0; i < (shared->info_bits + 63) / 64; i++) {
+            w->info[i] = rng_next(&w->bits);
+        }
+        conv_encode(shared->code, (const uint8_t *)w->info, shared->info_bits, (uint8_t *)w->tx,
+                    QPSK_BITS_PER_SYMBOL * BERSIM_BLOCK_SYMBOLS);
+    } else {
+        for (int i = 0; i < BLOCK_WORDS; i++) {
+            w->tx[i] = rng_next(&w->bits);
+        }
+    }
+    qpsk_map_packed((const uint8_t *)w->tx, BERSIM_BLOCK_SYMBOLS, w->iq);
+    awgn_add(&w->channel, w->iq, 2 * BERSIM_BLOCK_SYMBOLS);
+    qpsk_demap_hard(w->iq, BERSIM_BLOCK_SYMBOLS, (uint8_t *)w->rx);
+    if (shared->code != CONV_NONE) {
+        double start = now_seconds();
+        qpsk_demap_llr_int8(w->iq, BERSIM_BLOCK_SYMBOLS, CONV_LLR_SCALE, w->llr);
+        conv_decode(&w->decoder, shared->code, w->llr, shared->info_bits, (uint8_t *)w->decoded);
+        w->decode_seconds += now_seconds() - start;
+    }
+
+    // Both bits of a symbol sit in one aligned pair of bit positions
+    unsigned long long be = 0, se = 0;
+    for (int i = 0; i < BLOCK_WORDS; i++) {
+        uint64_t x = w->tx[i] ^ w->rx[i];
+        be += __builtin_popcountll(x);
+        se += __builtin_popcountll((x | (x >> 1)) & SYMBOL_LOW_BITS);
+    }
+    if (shared->code != CONV_NONE) {
+        be = count_errors((const uint8_t *)w->info, (const uint8_t *)w->decoded, shared->info_bits);
+    }
+    *bit_errors += be;
+    *symbol_errors += se;
+}
+
+static void *worker_main(void *arg) {
+    Worker *w = arg;
+    Shared *shared = w->shared;
+
+    while (!atomic_load_explicit(&shared->stop, memory_order_relaxed)) {
+        unsigned long long be = 0, se = 0;
+        for (int i = 0; i < CHUNK_BLOCKS; i++) {
+            run_block(w, &be, &se);
+        }
+
+        const unsigned long long symbols = BERSIM_CHUNK_SYMBOLS;
+        const unsigned long long bits = CHUNK_BLOCKS * (unsigned long long)shared->info_bits;
+        atomic_fetch_add_explicit(&shared->symbols, symbols, memory_order_relaxed);
+        atomic_fetch_add_explicit(&shared->symbol_errors, se, memory_order_relaxed);
+        unsigned long long total_errors =
+            atomic_fetch_add_explicit(&shared->bit_errors, be, memory_order_relaxed) + be;
+        unsigned long long total_bits =
+            atomic_fetch_add_explicit(&shared->bits, bits, memory_order_relaxed) + bits;
+        if (total_errors >= shared->target_errors || total_bits >= shared->max_bits) {
+            atomic_store_explicit(&shared->stop, 1, memory_order_relaxed);
+        }
+    }
+    return NULL;
+}
+
+void bersim_defaults(BerSimConfig *config) {
+    config->threads = 0;
+    config->target_errors = 1000;
+    config->max_bits = 10000000000ULL;
+    config->seed = 1;
+    config->code = CONV_NONE;
+}
+
+int bersim_run(const BerSimConfig *config, double ebn0_db, BerSimPoint *point) {
+    int threads = config->threads;
+    if (threads <= 0) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = cpus > 0 ? (int)cpus : 1;
+    }
+    if (threads > BERSIM_MAX_THREADS) {
+        threads = BERSIM_MAX_THREADS;
+    }
+
+    Worker *workers = calloc(threads, sizeof(Worker));
+    pthread_t *ids = calloc(threads, sizeof(pthread_t));
+    if (workers == NULL || ids == NULL) {
+        free(workers);
+        free(ids);
+        return -1;
+    }
+
+    Shared shared;
+    atomic_init(&shared.bits, 0);
+    atomic_init(&shared.bit_errors, 0);
+    atomic_init(&shared.symbols, 0);
+    atomic_init(&shared.symbol_errors, 0);
+    atomic_init(&shared.stop, 0);
+    shared.target_errors = config->target_errors;
+    shared.max_bits = config->max_bits;
+    shared.code = config->code;
+    shared.info_bits = config->code != CONV_NONE
+                     ? conv_info_bits(config->code, QPSK_BITS_PER_SYMBOL * BERSIM_BLOCK_SYMBOLS)
+                     : QPSK_BITS_PER_SYMBOL * BERSIM_BLOCK_SYMBOLS;
+
+    // Two non-overlapping streams per thread, one for bits and one for noise
+    Rng stream;
+    rng_seed(&stream, config->seed);
+    int ready = 0;
+    for (int t = 0; t < threads; t++, ready++) {
+        if (config->code != CONV_NONE && conv_decoder_init(&workers[t].decoder, shared.info_bits) < 0) {
+            break;
+        }
+        workers[t].shared = &shared;
+        workers[t].bits = stream;
+        rng_jump(&stream);
+        awgn_init(&workers[t].channel, 0, bersim_esn0_db(config->code, ebn0_db));
+        workers[t].channel.rng = stream;
+        rng_jump(&stream);
+    }
+
+    // Pick the kernels before the workers make their first calls
+    qpsk_map_isa();
+    qpsk_demap_isa();
+    conv_isa();
+
+    double start = now_seconds();
+    int started = 0;
+    for (int t = 0; t < ready; t++) {
+        if (pthread_create(&ids[started], NULL, worker_main, &workers[t]) == 0) {
+            started++;
+        }
+    }
+    for (int t = 0; t < started; t++) {
+        pthread_join(ids[t], NULL);
+    }
+
+    memset(point, 0, sizeof(*point));
+    point->ebn0_db = ebn0_db;
+    point->bits = atomic_load(&shared.bits);
+    point->bit_errors = atomic_load(&shared.bit_errors);
+    point->symbols = atomic_load(&shared.symbols);
+    point->symbol_errors = atomic_load(&shared.symbol_errors);
+    point->seconds = now_seconds() - start;
+    for (int t = 0; t < ready; t++) {
+        point->decode_seconds += workers[t].decode_seconds;
+        if (config->code != CONV_NONE) {
+            conv_decoder_free(&workers[t].decoder);
+        }
+    }
+
+    free(workers);
+    free(ids);
+    return started > 0 ? 0 : -1;
+}
+
+double bersim_esn0_db(ConvRate code, double ebn0_db) {
+    if (code == CONV_NONE) {
+        return awgn_ebn0_to_esn0_db(ebn0_db, QPSK_BITS_PER_SYMBOL);
+    }
+    size_t info_bits = conv_info_bits(code, QPSK_BITS_PER_SYMBOL * BERSIM_BLOCK_SYMBOLS);
+    return ebn0_db + 10.0 * log10((double)info_bits / BERSIM_BLOCK_SYMBOLS);
+}
+
+double bersim_qpsk_ber(double ebn0_db) {
+    return 0.5 * erfc(sqrt(pow(10.0, ebn0_db / 10.0)));
+}
+
+double bersim_qpsk_ser(double ebn0_db) {
+    double q = bersim_qpsk_ber(ebn0_db);
+    return 2.0 * q - q * q;
+}
+
+void bersim_interval(unsigned long long errors, unsigned long long trials, double z,
+                     double *lo, double *hi) {
+    if (trials == 0) {
+        *lo = 0.0;
+        *hi = 1.0;
+        return;
+    }
+
+    double n = (double)trials;
+    double p = (double)errors / n;
+    double z2 = z * z;
+    double denom = 1.0 + z2 / n;
+    double center = (p + z2 / (2.0 * n)) / denom;
+    double half = z * sqrt(p * (1.0 - p) / n + z2 / (4.0 * n * n)) / denom;
+
+    *lo = center - half > 0.0 ? center - half : 0.0;
+    *hi = center + half < 1.0 ? center + half : 1.0;
+}
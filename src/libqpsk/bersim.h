@@ -0,0 +1,110 @@
+/**
+ * Monte Carlo BER Simulation
+ *
+ * Measures the bit and symbol error rates of QPSK in AWGN at one Eb/N0 by
+ * brute force: random packed bits are mapped with qpsk_map_packed(), noise
+ * is added with the Ziggurat channel of awgn.h and the hard decisions of
+ * qpsk_demap_hard() are compared with the transmitted bits word by word.
+ *
+ * Trials run on several threads. Every thread draws its bits and its
+ * noise from its own xoshiro256** stream, split from the point's seed with
+ * rng_jump(), so no two threads share random numbers and none take locks.
+ * Threads add their counts to the shared totals every BERSIM_CHUNK_SYMBOLS
+ * symbols, and the point stops once the totals reach the target number of
+ * bit errors or the bit limit. Counts from the chunks in flight when the
+ * target is reached are kept, so a point may run slightly past either
+ * limit; which thread contributes them depends on scheduling, so results
+ * of multithreaded runs vary within their confidence intervals.
+ *
+ * With a convolutional code (see conv.h) every block carries one codeword
+ * of as many data bits as BERSIM_BLOCK_SYMBOLS symbols hold, the symbols
+ * get the noise of the Eb/N0 per data bit, and the data bits come from
+ * the soft-decision Viterbi decoder. Bit errors are then counted after
+ * decoding and symbol errors on the channel, before it; the time the
+ * workers spent decoding is measured as well.
+ */
+
+#ifndef QPSK_BERSIM_H
+#define QPSK_BERSIM_H
+
+#include <stdint.h>
+
+#include "conv.h"
+
+#define BERSIM_BLOCK_SYMBOLS 4096     // Symbols mapped, noised and demapped at a time
+#define BERSIM_CHUNK_SYMBOLS 65536    // Symbols between updates of the shared totals
+#define BERSIM_MAX_THREADS 256
+
+/**
+ * Stopping rule and resources of a simulation
+ */
+typedef struct {
+    int threads;                         // Worker threads, 0 for one per online CPU
+    unsigned long long target_errors;    // Stop a point after this many bit errors
+    unsigned long long max_bits;         // ... or after this many bits
+    uint64_t seed;                       // Seed of the point's random streams
+    ConvRate code;                       // Code of the data bits, CONV_NONE for none
+} BerSimConfig;
+
+/**
+ * Counts at one Eb/N0
+ */
+typedef struct {
+    double ebn0_db;
+    unsigned long long bits;
+    unsigned long long bit_errors;
+    unsigned long long symbols;
+    unsigned long long symbol_errors;
+    double seconds;                      // Wall-clock time
+    double decode_seconds;               // Time the workers spent decoding, summed
+} BerSimPoint;
+
+/**
+ * Fill a configuration with the defaults
+ *
+ * One thread per CPU, 1000 bit errors or 10^10 bits per point, seed 1,
+ * uncoded.
+ */
+void bersim_defaults(BerSimConfig *config);
+
+/**
+ * Simulate one Eb/N0 point
+ *
+ * @param config   Stopping rule, threads and seed
+ * @param ebn0_db  Bit energy to noise density ratio in dB
+ * @param point    Counts, rates and time
+ * @return 0 on success, -1 if no worker thread could be started
+ */
+int bersim_run(const BerSimConfig *config, double ebn0_db, BerSimPoint *point);
+
+/**
+ * Es/N0 of the channel symbols at an Eb/N0 per data bit
+ */
+double bersim_esn0_db(ConvRate code, double ebn0_db);
+
+/**
+ * Theoretical QPSK bit error rate in AWGN, Q(sqrt(2 Eb/N0))
+ */
+double bersim_qpsk_ber(double ebn0_db);
+
+/**
+ * Theoretical QPSK symbol error rate in AWGN, 2 Q(x) - Q(x)^2 with x = sqrt(2 Eb/N0)
+ */
+double bersim_qpsk_ser(double ebn0_db);
+
+/**
+ * Wilson score interval of an error rate
+ *
+ * Stays inside [0, 1] and gives a useful upper bound when no errors were
+ * seen, unlike the normal approximation.
+ *
+ * @param errors  Observed errors
+ * @param trials  Observed trials (bits or symbols)
+ * @param z       Standard normal quantile, e.g. 1.96 for 95%
+ * @param lo      Lower bound
+ * @param hi      Upper bound
+ */
+void bersim_interval(unsigned long long errors, unsigned long long trials, double z,
+                     double *lo, double *hi);
+
+#endif /* QPSK_BERSIM_H */
@@ -0,0 +1,315 @@
+/**
+ * Block-Floating-Point Sample Compression
+ *
+ * The exponent of a block comes straight from the float exponent bits of
+ * its largest magnitude, so no logarithms are needed: a peak in
+ * [2^(k-1), 2^k) gets e = k - (W - 1), which scales it into
+ * [2^(W-2), 2^(W-1)). Scaling by 2^-e is exact, and rounding may only
+ * reach 2^(W-1), which is clamped like any other overflow. Exponents are
+ * limited to -126..126 so that both 2^e and 2^-e are normal floats.
+ */
+
+#include <math.h>
+#include <pthread.h>
+#include <string.h>
+
+#include "bfp.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define QPSK_X86 1
+#endif
+
+#define EXP_MIN -126          // Smallest block exponent
+#define EXP_MAX 126           // Largest block exponent
+
+typedef int (*QuantizeFn)(const float *in, int block, int bits, int32_t *q);
+typedef void (*PackFn)(const int32_t *q, int count, int bits, uint8_t *out);
+typedef void (*UnpackFn)(const uint8_t *in, int block, int bits, float scale, float *out);
+
+static QpskIsa bfp_isa_used = QPSK_ISA_SCALAR;
+static QuantizeFn quantize_fn;
+static PackFn pack_fn;
+static UnpackFn unpack_fn;
+
+/**
+ * Exact power of two for exponents in EXP_MIN..EXP_MAX
+ */
+static inline float pow2(int e) {
+    uint32_t u = (uint32_t)(e + 127) << 23;
+    float f;
+    memcpy(&f, &u, sizeof(f));
+    return f;
+}
+
+/**
+ * Shared exponent of a block with the given largest magnitude
+ */
+static inline int block_exponent(float peak, int bits) {
+    uint32_t u;
+    memcpy(&u, &peak, sizeof(u));
+    int biased = (int)((u >> 23) & 0xFF);
+    if (biased == 0) {
+        return EXP_MIN;
+    }
+    int e = biased - 126 - (bits - 1);
+    return e < EXP_MIN ? EXP_MIN : (e > EXP_MAX ? EXP_MAX : e);
+}
+
+static inline float mantissa_limit(int bits) {
+    return (float)((1 << (bits - 1)) - 1);
+}
+
+/**
+ * Write mantissas of a given width, least significant bit first
+ */
+static void pack_bits(const int32_t *q, int count, int bits, uint8_t *out) {
+    uint32_t mask = (1u << bits) - 1;
+    uint64_t acc = 0;
+    int n = 0;
+
+    for (int i = 0; i < count; i++) {
+        acc |= (uint64_t)((uint32_t)q[i] & mask) << n;
+        n += bits;
+        while (n >= 8) {
+            *out++ = (uint8_t)acc;
+            acc >>= 8;
+            n -= 8;
+        }
+    }
+}
+
+static int quantize_scalar(const float *in, int block, int bits, int32_t *q) {
+    float peak = 0;
+    for (int i = 0; i < block; i++) {
+        float a = fabsf(in[i]);
+        peak = a > peak ? a : peak;
+    }
+
+    int e = block_exponent(peak, bits);
+    float k = pow2(-e);
+    float limit = mantissa_limit(bits);
+    for (int i = 0; i < block; i++) {
+        float x = in[i] * k;
+        x = x > limit ? limit : (x < -limit ? -limit : x);
+        q[i] = (int32_t)lrintf(x);
+    }
+    return e;
+}
+
+static void unpack_scalar(const uint8_t *in, int block, int bits, float scale, float *out) {
+    uint64_t acc = 0;
+    int n = 0;
+
+    for (int i = 0; i < block; i++) {
+        while (n < bits) {
+            acc |= (uint64_t)*in++ << n;
+            n += 8;
+        }
+        int32_t v = (int32_t)((uint32_t)acc << (32 - bits)) >> (32 - bits);
+        acc >>= bits;
+        n -= bits;
+        out[i] = (float)v * scale;
+    }
+}
+
+#ifdef QPSK_X86
+
+__attribute__((target("sse2")))
+static int quantize_sse2(const float *in, int block, int bits, int32_t *q) {
+    const __m128 magnitude = _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+    __m128 peak = _mm_setzero_ps();
+    for (int i = 0; i < block; i += 4) {
+        peak = _mm_max_ps(_mm_and_ps(_mm_loadu_ps(in + i), magnitude), peak);
+    }
+    peak = _mm_max_ps(peak, _mm_shuffle_ps(peak, peak, _MM_SHUFFLE(1, 0, 3, 2)));
+    peak = _mm_max_ps(peak, _mm_shuffle_ps(peak, peak, _MM_SHUFFLE(2, 3, 0, 1)));
+
+    int e = block_exponent(_mm_cvtss_f32(peak), bits);
+    const __m128 k = _mm_set1_ps(pow2(-e));
+    const __m128 hi = _mm_set1_ps(mantissa_limit(bits));
+    const __m128 lo = _mm_set1_ps(-mantissa_limit(bits));
+    for (int i = 0; i < block; i += 4) {
+        __m128 x = _mm_mul_ps(_mm_loadu_ps(in + i), k);
+        x = _mm_max_ps(_mm_min_ps(x, hi), lo);
+        _mm_storeu_si128((__m128i *)(q + i), _mm_cvtps_epi32(x));
+    }
+    return e;
+}
+
+__attribute__((target("avx2")))
+static int quantize_avx2(const float *in, int block, int bits, int32_t *q) {
+    const __m256 magnitude = _mm256_castsi256_ps(_mm256_set1_epi32(0x7FFFFFFF));
+    __m256 peak = _mm256_setzero_ps();
+    for (int i = 0; i < block; i += 8) {
+        peak = _mm256_max_ps(_mm256_and_ps(_mm256_loadu_ps(in + i), magnitude), peak);
+    }
+    __m128 p = _mm_max_ps(_mm256_castps256_ps128(peak), _mm256_extractf128_ps(peak, 1));
+    p = _mm_max_ps(p, _mm_shuffle_ps(p, p, _MM_SHUFFLE(1, 0, 3, 2)));
+    p = _mm_max_ps(p, _mm_shuffle_ps(p, p, _MM_SHUFFLE(2, 3, 0, 1)));
+
+    int e = block_exponent(_mm_cvtss_f32(p), bits);
+    const __m256 k = _mm256_set1_ps(pow2(-e));
+    const __m256 hi = _mm256_set1_ps(mantissa_limit(bits));
+    const __m256 lo = _mm256_set1_ps(-mantissa_limit(bits));
+    for (int i = 0; i < block; i += 8) {
+        __m256 x = _mm256_mul_ps(_mm256_loadu_ps(in + i), k);
+        x = _mm256_max_ps(_mm256_min_ps(x, hi), lo);
+        _mm256_storeu_si256((__m256i *)(q + i), _mm256_cvtps_epi32(x));
+    }
+    return e;
+}
+
+/*
+ * Eight mantissas of W bits span exactly W bytes. Packing merges
+ * neighbouring lanes into 2W-bit pairs and the pairs into 4W-bit quads,
+ * which are joined into W bytes outside the vector unit (x86 is
+ * little-endian, so the low eight bytes are stored as one word).
+ */
+
+__attribute__((target("avx2")))
+static void pack_avx2(const int32_t *q, int count, int bits, uint8_t *out) {
+    const __m256i mask = _mm256_set1_epi32((1 << bits) - 1);
+    const __m256i pair_mask = _mm256_set1_epi64x(((int64_t)1 << 2*bits) - 1);
+    const __m256i quad_shift = _mm256_setr_epi64x(0, 2*bits, 0, 2*bits);
+    const int half = 4 * bits;
+
+    for (int i = 0; i < count; i += 8, out += bits) {
+        __m256i v = _mm256_and_si256(_mm256_loadu_si256((const __m256i *)(q + i)), mask);
+        v = _mm256_and_si256(_mm256_or_si256(v, _mm256_srli_epi64(v, 32 - bits)), pair_mask);
+        v = _mm256_sllv_epi64(v, quad_shift);
+        v = _mm256_or_si256(v, _mm256_bsrli_epi128(v, 8));
+
+        uint64_t a, b;
+        _mm_storel_epi64((__m128i *)&a, _mm256_castsi256_si128(v));
+        _mm_storel_epi64((__m128i *)&b, _mm256_extracti128_si256(v, 1));
+        uint64_t lo = half < 64 ? a | b << half : a;
+        uint64_t hi = half < 64 ? b >> (64 - half) : b;
+        if (bits >= 8) {
+            memcpy(out, &lo, sizeof(lo));
+            for (int k = 8; k < bits; k++, hi >>= 8) {
+                out[k] = (uint8_t)hi;
+            }
+        } else {
+            for (int k = 0; k < bits; k++, lo >>= 8) {
+                out[k] = (uint8_t)lo;
+            }
+        }
+    }
+}
+
+/*
+ * Unpacking works the other way round. Each lane gathers the
+ * 32-bit word starting at the byte holding its first bit, shifts its field
+ * to the top and shifts it back down arithmetically to sign-extend it. The
+ * gathers read up to three bytes past the block, so the caller keeps the
+ * last block of a buffer on the scalar path.
+ */
+
+__attribute__((target("avx2")))
+static void unpack_avx2(const uint8_t *in, int block, int bits, float scale, float *out) {
+    const __m256i lane = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    const __m256i bit = _mm256_mullo_epi32(lane, _mm256_set1_epi32(bits));
+    const __m256i byte = _mm256_srli_epi32(bit, 3);
+    const __m256i up = _mm256_sub_epi32(_mm256_set1_epi32(32 - bits), _mm256_and_si256(bit, _mm256_set1_epi32(7)));
+    const __m128i down = _mm_cvtsi32_si128(32 - bits);
+    const __m256 k = _mm256_set1_ps(scale);
+
+    for (int i = 0; i < block; i += 8) {
+        __m256i v = _mm256_i32gather_epi32((const int *)(in + (size_t)i / 8 * bits), byte, 1);
+        v = _mm256_sra_epi32(_mm256_sllv_epi32(v, up), down);
+        _mm256_storeu_ps(out + i, _mm256_mul_ps(_mm256_cvtepi32_ps(v), k));
+    }
+}
+
+#endif /* QPSK_X86 */
+
+/**
+ * Point the dispatch table at the kernels for one instruction set
+ */
+static void select_isa(QpskIsa isa) {
+    quantize_fn = quantize_scalar;
+    pack_fn = pack_bits;
+    unpack_fn = unpack_scalar;
+    bfp_isa_used = QPSK_ISA_SCALAR;
+#ifdef QPSK_X86
+    if (isa == QPSK_ISA_AVX2) {
+        quantize_fn = quantize_avx2;
+        pack_fn = pack_avx2;
+        unpack_fn = unpack_avx2;
+        bfp_isa_used = isa;
+    } else if (isa == QPSK_ISA_SSE2) {
+        quantize_fn = quantize_sse2;
+        bfp_isa_used = isa;
+    }
+#endif
+}
+
+static pthread_once_t dispatch_once = PTHREAD_ONCE_INIT;
+
+static void select_cpu(void) {
+    select_isa(qpsk_cpu_isa());
+}
+
+static inline void ensure_dispatch(void) {
+    pthread_once(&dispatch_once, select_cpu);
+}
+
+int bfp_valid(int bits, int block) {
+    return bits >= BFP_MIN_BITS && bits <= BFP_MAX_BITS
+        && block >= 8 && block <= BFP_MAX_BLOCK && block % 8 == 0;
+}
+
+size_t bfp_bytes(int bits, int block, size_t count) {
+    size_t blocks = (count + block - 1) / block;
+    return blocks * (1 + (size_t)block * bits / 8);
+}
+
+void bfp_encode(const float *in, size_t count, int bits, int block, uint8_t *out) {
+    int32_t q[BFP_MAX_BLOCK];
+    size_t block_bytes = 1 + (size_t)block * bits / 8;
+    size_t full = count / block;
+
+    ensure_dispatch();
+    for (size_t b = 0; b < full; b++, out += block_bytes) {
+        out[0] = (uint8_t)(int8_t)quantize_fn(in + b * block, block, bits, q);
+        pack_fn(q, block, bits, out + 1);
+    }
+
+    size_t rest = count - full * block;
+    if (rest > 0) {
+        float pad[BFP_MAX_BLOCK] = { 0 };
+        memcpy(pad, in + full * block, rest * sizeof(float));
+        out[0] = (uint8_t)(int8_t)quantize_fn(pad, block, bits, q);
+        pack_fn(q, block, bits, out + 1);
+    }
+}
+
+void bfp_decode(const uint8_t *in, size_t count, int bits, int block, float *out) {
+    size_t block_bytes = 1 + (size_t)block * bits / 8;
+    size_t blocks = (count + block - 1) / block;
+
+    ensure_dispatch();
+    for (size_t b = 0; b < blocks; b++, in += block_bytes) {
+        int e = (int8_t)in[0];
+        float scale = pow2(e < EXP_MIN ? EXP_MIN : (e > EXP_MAX ? EXP_MAX : e));
+        if (b + 1 < blocks) {
+            unpack_fn(in + 1, block, bits, scale, out + b * block);
+        } else {
+            float last[BFP_MAX_BLOCK];
+            unpack_scalar(in + 1, block, bits, scale, last);
+            memcpy(out + b * block, last, (count - b * block) * sizeof(float));
+        }
+    }
+}
+
+QpskIsa bfp_isa(void) {
+    ensure_dispatch();
+    return bfp_isa_used;
+}
+
+QpskIsa bfp_set_isa(QpskIsa isa) {
+    ensure_dispatch();
+    select_isa(qpsk_cpu_clamp_isa(isa));
+    return bfp_isa_used;
+}
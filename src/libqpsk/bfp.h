@@ -0,0 +1,87 @@
+/**
+ * Block-Floating-Point Sample Compression
+ *
+ * Splits interleaved I/Q samples into blocks of N samples that share one
+ * exponent. Each block is stored as
+ *
+ *   1 byte           exponent e (signed)
+ *   N * W bits       mantissas q, two's complement, least significant bit first
+ *
+ * and decodes to q * 2^e. The exponent is the smallest one for which the
+ * largest magnitude in the block fits W bits, so every block keeps about
+ * W - 1 significant bits regardless of its level: noisy samples that SC8
+ * would quantize coarsely or clip keep their precision, and a block of
+ * 16 samples with 8-bit mantissas takes 17 bytes instead of 64 as float32.
+ * N is a multiple of 8, so every block ends on a byte boundary; a partial
+ * last block is padded with zeros.
+ *
+ * The float side (block maximum, scaling, rounding, clamping) runs in
+ * AVX2 or SSE2; mantissas are packed with a 64-bit shift register and
+ * unpacked with AVX2 gathers. All kernels give exactly the scalar results.
+ */
+
+#ifndef QPSK_BFP_H
+#define QPSK_BFP_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "cpu.h"
+
+#define BFP_MIN_BITS 2          // Narrowest mantissa
+#define BFP_MAX_BITS 16         // Widest mantissa
+#define BFP_MAX_BLOCK 64        // Longest block in samples
+#define BFP_DEFAULT_BITS 8
+#define BFP_DEFAULT_BLOCK 16
+
+/**
+ * Check a mantissa width and block length
+ *
+ * @return 1 if W is BFP_MIN_BITS..BFP_MAX_BITS and N a multiple of 8 up to BFP_MAX_BLOCK
+ */
+int bfp_valid(int bits, int block);
+
+/**
+ * Encoded size of a number of samples
+ *
+ * @param bits   Mantissa width W
+ * @param block  Samples per block N
+ * @param count  Number of samples
+ */
+size_t bfp_bytes(int bits, int block, size_t count);
+
+/**
+ * Compress float samples
+ *
+ * @param in     Samples (interleaved I/Q)
+ * @param count  Number of samples
+ * @param bits   Mantissa width W
+ * @param block  Samples per block N
+ * @param out    bfp_bytes(bits, block, count) bytes
+ */
+void bfp_encode(const float *in, size_t count, int bits, int block, uint8_t *out);
+
+/**
+ * Expand compressed samples
+ *
+ * @param in     bfp_bytes(bits, block, count) bytes
+ * @param count  Number of samples
+ * @param bits   Mantissa width W, as encoded
+ * @param block  Samples per block N, as encoded
+ * @param out    Samples
+ */
+void bfp_decode(const uint8_t *in, size_t count, int bits, int block, float *out);
+
+/**
+ * Instruction set used by the codec (detected on first use)
+ */
+QpskIsa bfp_isa(void);
+
+/**
+ * Override the detected instruction set (clamped to what the CPU supports)
+ *
+ * @return The instruction set actually selected
+ */
+QpskIsa bfp_set_isa(QpskIsa isa);
+
+#endif /* QPSK_BFP_H */
@@ -0,0 +1,193 @@
+/**
+ * Packed Bit Source
+ */
+
+#include <string.h>
+
+#include "bitsrc.h"
+
+static const struct {
+    const char *name;
+    int order;
+    int tap;
+} source_info[] = {
+    [BITSRC_RANDOM] = { "random", 0,  0  },
+    [BITSRC_PRBS7]  = { "prbs7",  7,  6  },
+    [BITSRC_PRBS15] = { "prbs15", 15, 14 },
+    [BITSRC_PRBS23] = { "prbs23", 23, 18 },
+    [BITSRC_PRBS31] = { "prbs31", 31, 28 },
+};
+
+#define SOURCE_TYPES (sizeof(source_info) / sizeof(source_info[0]))
+
+void bitsrc_init(BitSource *src, BitSourceType type, uint64_t seed) {
+    memset(src, 0, sizeof(*src));
+    src->type = type;
+
+    if (type == BITSRC_RANDOM) {
+        rng_seed(&src->rng, seed);
+        return;
+    }
+
+    int n = source_info[type].order, m = source_info[type].tap;
+    uint64_t mask = (1ULL << n) - 1;
+    uint64_t state = (seed & mask) ? (seed & mask) : mask;
+
+    // Widest squared recurrence whose history still fits in 64 bits
+    src->span = n;
+    src->step = m;
+    while (src->span * 2 <= 64) {
+        src->span *= 2;
+        src->step *= 2;
+    }
+
+    // Run the plain LFSR for the first span bits to fill the history; they
+    // are also the first bits of output
+    uint64_t bits = 0;
+    for (int k = 0; k < src->span; k++) {
+        uint64_t b = ((state >> (n - 1)) ^ (state >> (m - 1))) & 1;
+        state = ((state << 1) | b) & mask;
+        bits = (bits << 1) | b;
+    }
+    src->history = bits;
+    src->carry = bits;
+    src->carry_bits = src->span;
+}
+
+/**
+ * Next step bits of the PRBS, first bit in the most significant position
+ *
+ * With the newest bit of the history in bit 0, s[k-span+t] sits at bit
+ * span-1-t, so shifting by span-step and by 0 lines up step new bits at once.
+ */
+static inline uint64_t prbs_chunk(BitSource *src) {
+    int n = src->span, m = src->step;
+    uint64_t h = src->history;
+    uint64_t x = ((h >> (n - m)) ^ h) & ((1ULL << m) - 1);
+    src->history = (h << m) | x;
+    return x;
+}
+
+static uint64_t prbs_next_word(BitSource *src) {
+    int m = src->step;
+    uint64_t word = src->carry;
+    int have = src->carry_bits;
+
+    while (have + m <= 64) {
+        word = (word << m) | prbs_chunk(src);
+        have += m;
+    }
+
+    int need = 64 - have;
+    if (need == 0) {
+        src->carry = 0;
+        src->carry_bits = 0;
+        return word;
+    }
+    uint64_t x = prbs_chunk(src);
+    src->carry_bits = m - need;
+    src->carry = x & ((1ULL << src->carry_bits) - 1);
+    return (word << need) | (x >> src->carry_bits);
+}
+
+static inline uint64_t next_word(BitSource *src) {
+    return src->type == BITSRC_RANDOM ? rng_next(&src->rng) : prbs_next_word(src);
+}
+
+static inline void store_be64(uint8_t *out, uint64_t w) {
+    w = __builtin_bswap64(w);
+    memcpy(out, &w, sizeof(w));
+}
+
+void bitsrc_fill_words(BitSource *src, uint64_t *words, size_t count) {
+    size_t i = 0;
+
+    // Realign behind bytes left over from a previous bitsrc_fill_bytes()
+    if (src->spare_bits > 0) {
+        for (; i < count; i++) {
+            uint64_t w = next_word(src);
+            words[i] = src->spare | (w >> src->spare_bits);
+            src->spare = w << (64 - src->spare_bits);
+        }
+        return;
+    }
+
+    if (src->type == BITSRC_RANDOM) {
+        Rng rng = src->rng;
+        for (; i < count; i++) {
+            words[i] = rng_next(&rng);
+        }
+        src->rng = rng;
+    } else {
+        for (; i < count; i++) {
+            words[i] = prbs_next_word(src);
+        }
+    }
+}
+
+void bitsrc_fill_bytes(BitSource *src, uint8_t *bytes, size_t count) {
+    while (count > 0 && src->spare_bits > 0) {
+        *bytes++ = (uint8_t)(src->spare >> 56);
+        src->spare <<= 8;
+        src->spare_bits -= 8;
+        count--;
+    }
+
+    if (src->type == BITSRC_RANDOM) {
+        Rng rng = src->rng;
+        for (; count >= 8; count -= 8, bytes += 8) {
+            store_be64(bytes, rng_next(&rng));
+        }
+        src->rng = rng;
+    } else {
+        for (; count >= 8; count -= 8, bytes += 8) {
+            store_be64(bytes, prbs_next_word(src));
+        }
+    }
+
+    if (count > 0) {
+        uint64_t w = next_word(src);
+        for (size_t i = 0; i < count; i++) {
+            bytes[i] = (uint8_t)(w >> (56 - 8*i));
+        }
+        src->spare = w << (8 * count);
+        src->spare_bits = 64 - 8 * (int)count;
+    }
+}
+
+int bitsrc_sync_bits(const BitSource *src) {
+    return source_info[src->type].order;
+}
+
+void bitsrc_sync(BitSource *src, uint64_t history, int skip) {
+    if (src->type == BITSRC_RANDOM) {
+        return;
+    }
+
+    // The register of the plain LFSR holds the last n bits, newest in bit 0,
+    // so restarting from them continues the observed stream
+    int n = source_info[src->type].order;
+    bitsrc_init(src, src->type, history & ((1ULL << n) - 1));
+    src->carry_bits -= skip;
+    src->carry &= (1ULL << src->carry_bits) - 1;
+}
+
+void bitsrc_unpack(const uint8_t *packed, size_t bits, int *out) {
+    for (size_t i = 0; i < bits; i++) {
+        out[i] = (packed[i >> 3] >> (7 - (i & 7))) & 1;
+    }
+}
+
+int bitsrc_parse_type(const char *name, BitSourceType *type) {
+    for (size_t i = 0; i < SOURCE_TYPES; i++) {
+        if (strcmp(name, source_info[i].name) == 0) {
+            *type = (BitSourceType)i;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+const char *bitsrc_type_name(BitSourceType type) {
+    return (size_t)type < SOURCE_TYPES ? source_info[type].name : "unknown";
+}
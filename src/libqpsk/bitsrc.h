@@ -0,0 +1,121 @@
+/**
+ * Packed Bit Source
+ *
+ * Produces the data bits at the front of every pipeline as packed 64-bit
+ * words or bytes, most significant bit first, into caller buffers of any
+ * size. Two kinds of source are available:
+ *
+ *   - random: uniform bits from xoshiro256**, 64 bits per generator call
+ *   - PRBS-7/15/23/31: maximal-length LFSR test sequences for BER testing,
+ *     s[k] = s[k-n] ^ s[k-m] for the polynomials x^7+x^6+1, x^15+x^14+1,
+ *     x^23+x^18+1 and x^31+x^28+1 (non-inverted)
+ *
+ * Squaring the polynomial over GF(2) shows the sequence also obeys
+ * s[k] = s[k-2^j n] ^ s[k-2^j m], so the generator picks the largest j that
+ * fits a 64-bit history and produces 2^j m bits (36 to 56) per word
+ * operation instead of one bit per step. Successive calls continue the same stream
+ * regardless of how the output is split between calls, so a receiver that
+ * builds an identical source reproduces the transmitted bits exactly.
+ */
+
+#ifndef QPSK_BITSRC_H
+#define QPSK_BITSRC_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "rng.h"
+
+/**
+ * Kinds of bit source
+ */
+typedef enum {
+    BITSRC_RANDOM,
+    BITSRC_PRBS7,
+    BITSRC_PRBS15,
+    BITSRC_PRBS23,
+    BITSRC_PRBS31
+} BitSourceType;
+
+/**
+ * Bit source state
+ */
+typedef struct {
+    BitSourceType type;
+    Rng rng;              // Generator for BITSRC_RANDOM
+    uint64_t history;     // Most recent PRBS bits, newest in bit 0
+    int span;             // Long recurrence tap 2^j n
+    int step;             // Short recurrence tap 2^j m (bits produced per step)
+    uint64_t carry;       // PRBS bits produced but not yet returned (right-aligned)
+    int carry_bits;
+    uint64_t spare;       // Unread part of the last word (left-aligned)
+    int spare_bits;
+} BitSource;
+
+/**
+ * Initialize a bit source
+ *
+ * @param src   Source to initialize
+ * @param type  Kind of source
+ * @param seed  Generator seed (random) or initial register state (PRBS; 0 selects all ones)
+ */
+void bitsrc_init(BitSource *src, BitSourceType type, uint64_t seed);
+
+/**
+ * Fill 64-bit words with the next bits of the stream (first bit in bit 63)
+ *
+ * @param src    Bit source
+ * @param words  Output words
+ * @param count  Number of words
+ */
+void bitsrc_fill_words(BitSource *src, uint64_t *words, size_t count);
+
+/**
+ * Fill bytes with the next bits of the stream (first bit in bit 7)
+ *
+ * @param src    Bit source
+ * @param bytes  Output bytes
+ * @param count  Number of bytes
+ */
+void bitsrc_fill_bytes(BitSource *src, uint8_t *bytes, size_t count);
+
+/**
+ * Number of consecutive stream bits bitsrc_sync() needs (the PRBS order, 0 for random)
+ */
+int bitsrc_sync_bits(const BitSource *src);
+
+/**
+ * Realign a PRBS source to a stream observed elsewhere
+ *
+ * After the call the source continues from the bit that follows the given
+ * history, so a receiver can lock onto a PRBS without knowing its start
+ * state. Has no effect on random sources.
+ *
+ * @param src      PRBS source
+ * @param history  The last bitsrc_sync_bits() bits of the stream, newest in bit 0
+ * @param skip     Further stream bits (less than 8) to drop before the next output
+ */
+void bitsrc_sync(BitSource *src, uint64_t history, int skip);
+
+/**
+ * Expand packed bits into one int (0 or 1) per bit
+ *
+ * @param packed  Packed input, most significant bit of each byte first
+ * @param bits    Number of bits to expand
+ * @param out     Output array of bits
+ */
+void bitsrc_unpack(const uint8_t *packed, size_t bits, int *out);
+
+/**
+ * Look up a source type by name ("random", "prbs7", "prbs15", "prbs23", "prbs31")
+ *
+ * @return 1 if the name is known, 0 otherwise
+ */
+int bitsrc_parse_type(const char *name, BitSourceType *type);
+
+/**
+ * Printable name of a source type
+ */
+const char *bitsrc_type_name(BitSourceType type);
+
+#endif /* QPSK_BITSRC_H */
@@ -0,0 +1,431 @@
+/**
+ * Carrier Phase and Frequency
+ *
+ * Within a group the Costas loop turns symbol k back by its phase plus k
+ * times its frequency. Only the phase takes a sin/cos per group; the small
+ * turn by k times the frequency comes from its Taylor series, whose error
+ * stays below 1e-3 radians up to CARRIER_MAX_FREQUENCY.
+ *
+ * The SIMD kernels hold I and Q of a symbol in neighbouring lanes. A
+ * quantity of the symbol computed in both lanes (|y|^4, Re(y^4), the
+ * squared phase error) is summed over all lanes and halved.
+ */
+
+#include <math.h>
+#include <pthread.h>
+#include <string.h>
+
+#include "carrier.h"
+#include "simd_complex.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define QPSK_X86 1
+#endif
+
+#define COSTAS_DAMPING 0.7071         // Loop damping factor
+#define COSTAS_DETECTOR_GAIN M_SQRT2  // Error per radian of a unit-energy symbol
+#define COSTAS_LOCK_METRIC 0.2        // Lock metric above which the loop counts as locked
+#define COSTAS_UNLOCK_METRIC 0.1      // Lock metric below which it loses the lock
+
+typedef void (*RotateFn)(float *x, size_t count, const float *ramp, float c, float s);
+typedef void (*CostasFn)(CostasLoop *loop, float *x, size_t count, float *sums);
+
+static QpskIsa carrier_isa_used = QPSK_ISA_SCALAR;
+static RotateFn rotate_fn;
+static CostasFn costas_fn;
+
+static uint16_t encode_table[4][256];   // Coded byte and last quadrant per quadrant and byte
+static uint16_t decode_table[4][256];
+
+/**
+ * Quadrant of a constellation index, and the index of a quadrant
+ */
+static inline unsigned quadrant_of(unsigned index) {
+    return index ^ (index >> 1);
+}
+
+/**
+ * Build the differential coding tables once at program start
+ */
+__attribute__((constructor))
+static void diff_setup(void) {
+    for (unsigned q = 0; q < 4; q++) {
+        for (unsigned b = 0; b < 256; b++) {
+            unsigned enc = 0, dec = 0, eq = q, dq = q;
+            for (int k = 0; k < 4; k++) {
+                unsigned index = (b >> (6 - 2 * k)) & 3;
+                eq = (eq + quadrant_of(index)) & 3;
+                enc |= quadrant_of(eq) << (6 - 2 * k);
+                dec |= quadrant_of((quadrant_of(index) - dq) & 3) << (6 - 2 * k);
+                dq = quadrant_of(index);
+            }
+            encode_table[q][b] = (uint16_t)(enc | eq << 8);
+            decode_table[q][b] = (uint16_t)(dec | dq << 8);
+        }
+    }
+}
+
+/**
+ * Keep a phase within [-pi, pi]
+ */
+static inline double wrap(double phase) {
+    return remainder(phase, 2.0 * M_PI);
+}
+
+/**
+ * Move the loop on after a group of count symbols whose errors add up to e
+ */
+static inline void steer(CostasLoop *loop, float e, size_t count) {
+    double limit = 2.0 * M_PI * CARRIER_MAX_FREQUENCY * 2.0;
+
+    loop->phase = wrap(loop->phase + count * loop->frequency + loop->k1 * e);
+    loop->frequency += loop->k2 * e;
+    if (fabs(loop->frequency) > limit) {
+        loop->frequency = copysign(limit, loop->frequency);
+    }
+}
+
+static void rotate_scalar(float *x, size_t count, const float *ramp, float c, float s) {
+    for (size_t k = 0; k < count; k++, x += 2) {
+        float pr = ramp[2*k] * c - ramp[2*k + 1] * s;
+        float pi = ramp[2*k] * s + ramp[2*k + 1] * c;
+        float i = x[0], q = x[1];
+        x[0] = i * pr - q * pi;
+        x[1] = i * pi + q * pr;
+    }
+}
+
+/**
+ * Turn one group back and compare it with the decisions
+ *
+ * @param sums  -Re(y^4), |y|^4 and the squared phase error sines, added to
+ * @return Sum of the phase errors
+ */
+static float group_scalar(float *x, size_t count, double phase, double frequency, float *sums) {
+    float zr = (float)cos(phase), zi = (float)-sin(phase);
+    float e = 0.0f;
+
+    for (size_t k = 0; k < count; k++, x += 2) {
+        float a = (float)(k * frequency), a2 = a * a;
+        float rr = 1.0f - 0.5f * a2, ri = a * (a2 * (1.0f / 6.0f) - 1.0f);
+        float pr = rr * zr - ri * zi, pi = rr * zi + ri * zr;
+        float i = x[0] * pr - x[1] * pi;
+        float q = x[0] * pi + x[1] * pr;
+        x[0] = i;
+        x[1] = q;
+
+        float d = (i < 0.0f ? -q : q) - (q < 0.0f ? -i : i);
+        float ii = i * i, qq = q * q, p2 = ii + qq;
+        e += d;
+        sums[0] += 4.0f * ii * qq - (ii - qq) * (ii - qq);
+        sums[1] += p2 * p2;
+        sums[2] += d * d / (2.0f * p2 + 1e-30f);
+    }
+    return e;
+}
+
+static void costas_scalar(CostasLoop *loop, float *x, size_t count, float *sums) {
+    for (size_t i = 0; i < count; i += COSTAS_GROUP) {
+        size_t n = count - i < COSTAS_GROUP ? count - i : COSTAS_GROUP;
+        steer(loop, group_scalar(x + 2*i, n, loop->phase, loop->frequency, sums), n);
+    }
+}
+
+#ifdef QPSK_X86
+
+__attribute__((target("sse2")))
+static inline float hsum_sse2(__m128 v) {
+    v = _mm_add_ps(v, _mm_movehl_ps(v, v));
+    v = _mm_add_ss(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 1, 1, 1)));
+    return _mm_cvtss_f32(v);
+}
+
+__attribute__((target("sse2")))
+static void rotate_sse2(float *x, size_t count, const float *ramp, float c, float s) {
+    const __m128 base = _mm_setr_ps(c, s, c, s);
+    size_t k = 0;
+    for (; k + 2 <= count; k += 2) {
+        __m128 p = cmul_sse2(_mm_loadu_ps(ramp + 2*k), base);
+        _mm_storeu_ps(x + 2*k, cmul_sse2(_mm_loadu_ps(x + 2*k), p));
+    }
+    rotate_scalar(x + 2*k, count - k, ramp + 2*k, c, s);
+}
+
+__attribute__((target("sse2")))
+static void costas_sse2(CostasLoop *loop, float *x, size_t count, float *sums) {
+    const __m128 sign = _mm_set1_ps(-0.0f);
+    const __m128 alternate = _mm_setr_ps(1.0f, -1.0f, 1.0f, -1.0f);
+    const __m128 even = _mm_castsi128_ps(_mm_setr_epi32(-1, 0, -1, 0));
+    const __m128 one = _mm_set1_ps(1.0f), half = _mm_set1_ps(0.5f), sixth = _mm_set1_ps(1.0f / 6.0f);
+    const __m128 two = _mm_set1_ps(2.0f), four = _mm_set1_ps(4.0f), tiny = _mm_set1_ps(1e-30f);
+    __m128 quartic = _mm_setzero_ps(), magnitude = _mm_setzero_ps(), error = _mm_setzero_ps();
+    size_t i = 0;
+
+    for (; i + COSTAS_GROUP <= count; i += COSTAS_GROUP) {
+        float zr = (float)cos(loop->phase), zi = (float)-sin(loop->phase);
+        __m128 z = _mm_setr_ps(zr, zi, zr, zi);
+        __m128 w = _mm_set1_ps((float)loop->frequency);
+        __m128 e = _mm_setzero_ps();
+        for (int h = 0; h < COSTAS_GROUP; h += 2) {
+            float *p = x + 2 * (i + h);
+            __m128 a = _mm_mul_ps(_mm_setr_ps(h, h, h + 1, h + 1), w);
+            __m128 a2 = _mm_mul_ps(a, a);
+            __m128 rr = _mm_sub_ps(one, _mm_mul_ps(a2, half));
+            __m128 ri = _mm_mul_ps(a, _mm_sub_ps(_mm_mul_ps(a2, sixth), one));
+            __m128 r = _mm_or_ps(_mm_and_ps(even, rr), _mm_andnot_ps(even, ri));
+            __m128 y = cmul_sse2(_mm_loadu_ps(p), cmul_sse2(r, z));
+            _mm_storeu_ps(p, y);
+
+            // sign(I) Q and sign(Q) I, then I^2, Q^2 and their swap
+            __m128 ys = _mm_shuffle_ps(y, y, _MM_SHUFFLE(2, 3, 0, 1));
+            __m128 t = _mm_xor_ps(ys, _mm_and_ps(y, sign));
+            __m128 d = _mm_sub_ps(t, _mm_shuffle_ps(t, t, _MM_SHUFFLE(2, 3, 0, 1)));
+            __m128 sq = _mm_mul_ps(y, y);
+            __m128 sqs = _mm_shuffle_ps(sq, sq, _MM_SHUFFLE(2, 3, 0, 1));
+            __m128 p2 = _mm_add_ps(sq, sqs);
+            __m128 diff = _mm_sub_ps(sq, sqs);
+            e = _mm_add_ps(e, _mm_mul_ps(t, alternate));
+            quartic = _mm_add_ps(quartic, _mm_sub_ps(_mm_mul_ps(four, _mm_mul_ps(sq, sqs)),
+                                                     _mm_mul_ps(diff, diff)));
+            magnitude = _mm_add_ps(magnitude, _mm_mul_ps(p2, p2));
+            error = _mm_add_ps(error, _mm_div_ps(_mm_mul_ps(d, d), _mm_add_ps(_mm_mul_ps(two, p2), tiny)));
+        }
+        steer(loop, hsum_sse2(e), COSTAS_GROUP);
+    }
+    sums[0] += 0.5f * hsum_sse2(quartic);
+    sums[1] += 0.5f * hsum_sse2(magnitude);
+    sums[2] += 0.5f * hsum_sse2(error);
+    costas_scalar(loop, x + 2*i, count - i, sums);
+}
+
+__attribute__((target("avx2")))
+static inline float hsum_avx2(__m256 v) {
+    __m128 s = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+    s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+    s = _mm_add_ss(s, _mm_shuffle_ps(s, s, _MM_SHUFFLE(1, 1, 1, 1)));
+    return _mm_cvtss_f32(s);
+}
+
+__attribute__((target("avx2")))
+static void rotate_avx2(float *x, size_t count, const float *ramp, float c, float s) {
+    const __m256 base = _mm256_setr_ps(c, s, c, s, c, s, c, s);
+    size_t k = 0;
+    for (; k + 4 <= count; k += 4) {
+        __m256 p = cmul_avx2(_mm256_loadu_ps(ramp + 2*k), base);
+        _mm256_storeu_ps(x + 2*k, cmul_avx2(_mm256_loadu_ps(x + 2*k), p));
+    }
+    rotate_scalar(x + 2*k, count - k, ramp + 2*k, c, s);
+}
+
+__attribute__((target("avx2")))
+static void costas_avx2(CostasLoop *loop, float *x, size_t count, float *sums) {
+    const __m256 sign = _mm256_set1_ps(-0.0f);
+    const __m256 alternate = _mm256_setr_ps(1.0f, -1.0f, 1.0f, -1.0f, 1.0f, -1.0f, 1.0f, -1.0f);
+    const __m256 one = _mm256_set1_ps(1.0f), half = _mm256_set1_ps(0.5f);
+    const __m256 sixth = _mm256_set1_ps(1.0f / 6.0f), two = _mm256_set1_ps(2.0f);
+    const __m256 four = _mm256_set1_ps(4.0f), tiny = _mm256_set1_ps(1e-30f);
+    __m256 quartic = _mm256_setzero_ps(), magnitude = _mm256_setzero_ps(), error = _mm256_setzero_ps();
+    size_t i = 0;
+
+    for (; i + COSTAS_GROUP <= count; i += COSTAS_GROUP) {
+        float zr = (float)cos(loop->phase), zi = (float)-sin(loop->phase);
+        __m256 z = _mm256_setr_ps(zr, zi, zr, zi, zr, zi, zr, zi);
+        __m256 w = _mm256_set1_ps((float)loop->frequency);
+        __m256 e = _mm256_setzero_ps();
+        for (int h = 0; h < COSTAS_GROUP; h += 4) {
+            float *p = x + 2 * (i + h);
+            __m256 a = _mm256_mul_ps(_mm256_setr_ps(h, h, h + 1, h + 1, h + 2, h + 2, h + 3, h + 3), w);
+            __m256 a2 = _mm256_mul_ps(a, a);
+            __m256 rr = _mm256_sub_ps(one, _mm256_mul_ps(a2, half));
+            __m256 ri = _mm256_mul_ps(a, _mm256_sub_ps(_mm256_mul_ps(a2, sixth), one));
+            __m256 r = _mm256_blend_ps(rr, ri, 0xAA);
+            __m256 y = cmul_avx2(_mm256_loadu_ps(p), cmul_avx2(r, z));
+            _mm256_storeu_ps(p, y);
+
+            __m256 ys = _mm256_permute_ps(y, _MM_SHUFFLE(2, 3, 0, 1));
+            __m256 t = _mm256_xor_ps(ys, _mm256_and_ps(y, sign));
+            __m256 d = _mm256_sub_ps(t, _mm256_permute_ps(t, _MM_SHUFFLE(2, 3, 0, 1)));
+            __m256 sq = _mm256_mul_ps(y, y);
+            __m256 sqs = _mm256_permute_ps(sq, _MM_SHUFFLE(2, 3, 0, 1));
+            __m256 p2 = _mm256_add_ps(sq, sqs);
+            __m256 diff = _mm256_sub_ps(sq, sqs);
+            e = _mm256_add_ps(e, _mm256_mul_ps(t, alternate));
+            quartic = _mm256_add_ps(quartic, _mm256_sub_ps(_mm256_mul_ps(four, _mm256_mul_ps(sq, sqs)),
+                                                           _mm256_mul_ps(diff, diff)));
+            magnitude = _mm256_add_ps(magnitude, _mm256_mul_ps(p2, p2));
+            error = _mm256_add_ps(error, _mm256_div_ps(_mm256_mul_ps(d, d),
+                                                       _mm256_add_ps(_mm256_mul_ps(two, p2), tiny)));
+        }
+        steer(loop, hsum_avx2(e), COSTAS_GROUP);
+    }
+    sums[0] += 0.5f * hsum_avx2(quartic);
+    sums[1] += 0.5f * hsum_avx2(magnitude);
+    sums[2] += 0.5f * hsum_avx2(error);
+    costas_scalar(loop, x + 2*i, count - i, sums);
+}
+
+#endif /* QPSK_X86 */
+
+/**
+ * Point the dispatch table at the kernels for one instruction set
+ */
+static void select_isa(QpskIsa isa) {
+    rotate_fn = rotate_scalar;
+    costas_fn = costas_scalar;
+    carrier_isa_used = QPSK_ISA_SCALAR;
+#ifdef QPSK_X86
+    if (isa == QPSK_ISA_AVX2) {
+        rotate_fn = rotate_avx2;
+        costas_fn = costas_avx2;
+        carrier_isa_used = isa;
+    } else if (isa == QPSK_ISA_SSE2) {
+        rotate_fn = rotate_sse2;
+        costas_fn = costas_sse2;
+        carrier_isa_used = isa;
+    }
+#endif
+}
+
+static pthread_once_t dispatch_once = PTHREAD_ONCE_INIT;
+
+static void select_cpu(void) {
+    select_isa(qpsk_cpu_isa());
+}
+
+static inline void ensure_dispatch(void) {
+    pthread_once(&dispatch_once, select_cpu);
+}
+
+void nco_init(Nco *n, double phase, double frequency) {
+    n->phase = wrap(phase * M_PI / 180.0);
+    n->step = 2.0 * M_PI * frequency;
+    for (int k = 0; k < NCO_CHUNK; k++) {
+        n->ramp[2*k] = (float)cos(k * n->step);
+        n->ramp[2*k + 1] = (float)sin(k * n->step);
+    }
+}
+
+void nco_rotate(Nco *n, float *iq, size_t count) {
+    ensure_dispatch();
+    for (size_t i = 0; i < count; i += NCO_CHUNK) {
+        size_t m = count - i < NCO_CHUNK ? count - i : NCO_CHUNK;
+        rotate_fn(iq + 2*i, m, n->ramp, (float)cos(n->phase), (float)sin(n->phase));
+        n->phase = wrap(n->phase + m * n->step);
+    }
+}
+
+int costas_init(CostasLoop *c, double bandwidth) {
+    memset(c, 0, sizeof(*c));
+    if (bandwidth <= 0.0 || bandwidth > COSTAS_MAX_BANDWIDTH) {
+        return -1;
+    }
+
+    // Standard second-order loop updated once per symbol
+    double theta = bandwidth / (COSTAS_DAMPING + 0.25 / COSTAS_DAMPING);
+    double d = 1.0 + 2.0 * COSTAS_DAMPING * theta + theta * theta;
+    c->bandwidth = bandwidth;
+    c->k1 = 4.0 * COSTAS_DAMPING * theta / d / COSTAS_DETECTOR_GAIN;
+    c->k2 = 4.0 * theta * theta / d / COSTAS_DETECTOR_GAIN;
+    return 0;
+}
+
+void costas_process(CostasLoop *c, float *iq, size_t count, CarrierStats *stats) {
+    float sums[3] = { 0.0f, 0.0f, 0.0f };
+
+    ensure_dispatch();
+    costas_fn(c, iq, count, sums);
+
+    CarrierStats block = { sums[0], sums[1], sums[2], count };
+    if (stats != NULL) {
+        carrier_stats_add(stats, &block);
+    }
+    carrier_stats_add(&c->window, &block);
+    if (c->window.symbols >= COSTAS_LOCK_SYMBOLS) {
+        double metric = carrier_lock_metric(&c->window);
+        if (c->locked && metric < COSTAS_UNLOCK_METRIC) {
+            c->locked = 0;
+            c->unlocks++;
+        } else if (!c->locked && metric > COSTAS_LOCK_METRIC) {
+            c->locked = 1;
+        }
+        memset(&c->window, 0, sizeof(c->window));
+    }
+}
+
+void costas_skip(CostasLoop *c, unsigned long long symbols) {
+    c->phase = wrap(c->phase + fmod(symbols * c->frequency, 2.0 * M_PI));
+}
+
+double costas_frequency(const CostasLoop *c) {
+    return c->frequency / (2.0 * M_PI);
+}
+
+void carrier_stats_add(CarrierStats *total, const CarrierStats *part) {
+    total->quartic += part->quartic;
+    total->magnitude += part->magnitude;
+    total->error += part->error;
+    total->symbols += part->symbols;
+}
+
+double carrier_lock_metric(const CarrierStats *stats) {
+    return stats->magnitude > 0.0 ? stats->quartic / stats->magnitude : 0.0;
+}
+
+double carrier_phase_error(const CarrierStats *stats) {
+    if (stats->symbols == 0) {
+        return 0.0;
+    }
+    double s = sqrt(stats->error / stats->symbols);
+    return asin(s < 1.0 ? s : 1.0) * 180.0 / M_PI;
+}
+
+QpskIsa carrier_isa(void) {
+    ensure_dispatch();
+    return carrier_isa_used;
+}
+
+QpskIsa carrier_set_isa(QpskIsa isa) {
+    ensure_dispatch();
+    select_isa(qpsk_cpu_clamp_isa(isa));
+    return carrier_isa_used;
+}
+
+void diff_init(DiffCoder *d) {
+    d->quadrant = 0;
+}
+
+void diff_encode(DiffCoder *d, uint8_t *packed, size_t symbols) {
+    unsigned q = (unsigned)d->quadrant;
+    size_t bytes = symbols / 4;
+
+    for (size_t b = 0; b < bytes; b++) {
+        uint16_t v = encode_table[q][packed[b]];
+        packed[b] = (uint8_t)v;
+        q = v >> 8;
+    }
+    for (size_t k = 0; k < symbols % 4; k++) {
+        int shift = 6 - 2 * (int)k;
+        q = (q + quadrant_of((packed[bytes] >> shift) & 3)) & 3;
+        packed[bytes] = (uint8_t)((packed[bytes] & ~(3 << shift)) | quadrant_of(q) << shift);
+    }
+    d->quadrant = (int)q;
+}
+
+void diff_decode(DiffCoder *d, uint8_t *packed, size_t symbols) {
+    unsigned q = (unsigned)d->quadrant;
+    size_t bytes = symbols / 4;
+
+    for (size_t b = 0; b < bytes; b++) {
+        uint16_t v = decode_table[q][packed[b]];
+        packed[b] = (uint8_t)v;
+        q = v >> 8;
+    }
+    for (size_t k = 0; k < symbols % 4; k++) {
+        int shift = 6 - 2 * (int)k;
+        unsigned r = quadrant_of((packed[bytes] >> shift) & 3);
+        packed[bytes] = (uint8_t)((packed[bytes] & ~(3 << shift)) | quadrant_of((r - q) & 3) << shift);
+        q = r;
+    }
+    d->quadrant = (int)q;
+}
@@ -0,0 +1,184 @@
+/**
+ * Carrier Phase and Frequency
+ *
+ * A receiver whose oscillator is not locked to the transmitter's sees the
+ * constellation turned by a phase that grows with the frequency offset:
+ *
+ *   - Nco: numerically controlled oscillator that turns a stream by a
+ *     fixed phase plus a fixed step per sample, to impair a channel. The
+ *     phasors come from a table of the first NCO_CHUNK steps times one
+ *     sin/cos per chunk, so no sample costs a sin or cos and rounding never
+ *     builds up; the rotation runs on AVX2 or SSE2 when the CPU has them.
+ *   - CostasLoop: decision-directed QPSK Costas loop. It turns the
+ *     symbols back, compares each with the nearest constellation point
+ *     (sign(I) Q - sign(Q) I, proportional to the phase error) and steers
+ *     its phase and frequency with a second-order loop. The symbols are
+ *     turned and compared COSTAS_GROUP at a time with SIMD and the loop
+ *     follows once per group, which delays it by a few symbols, far less
+ *     than a loop of up to COSTAS_MAX_BANDWIDTH takes to respond. A lock
+ *     detector compares the fourth power of the symbols, which points the
+ *     same way for all four points when the phase is right, with their
+ *     magnitude over windows of COSTAS_LOCK_SYMBOLS.
+ *   - DiffCoder: differential coding of packed bits. The loop can settle
+ *     at any of the four quarter turns that map QPSK onto itself; sending
+ *     the change of quadrant from one symbol to the next instead of the
+ *     quadrant makes the bits independent of which one it picks, at the
+ *     cost of about twice the bit errors.
+ *
+ * Frequencies are in cycles per sample (Nco) or per symbol (CostasLoop).
+ */
+
+#ifndef QPSK_CARRIER_H
+#define QPSK_CARRIER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "cpu.h"
+
+#define NCO_CHUNK 64                      // Samples turned per sin/cos
+#define CARRIER_MAX_FREQUENCY 0.01        // Largest offset in cycles per symbol
+#define COSTAS_GROUP 8                    // Symbols per loop update
+#define COSTAS_LOCK_SYMBOLS 1024          // Symbols per lock decision
+#define COSTAS_DEFAULT_BANDWIDTH 0.005    // Loop noise bandwidth relative to the symbol rate
+#define COSTAS_MAX_BANDWIDTH 0.02         // Wider loops respond within a few groups
+
+/**
+ * Oscillator state
+ */
+typedef struct {
+    double phase;                         // Phase of the next sample in radians
+    double step;                          // Phase added per sample in radians
+    float ramp[2 * NCO_CHUNK];            // e^(j k step) for k = 0..NCO_CHUNK - 1, interleaved
+} Nco;
+
+/**
+ * Set up an oscillator
+ *
+ * @param n          Oscillator to initialize
+ * @param phase      Phase of the first sample in degrees
+ * @param frequency  Cycles per sample
+ */
+void nco_init(Nco *n, double phase, double frequency);
+
+/**
+ * Turn a block of samples by the oscillator's phase, in place
+ *
+ * @param n      Oscillator, advanced by count samples
+ * @param iq     count samples, interleaved I/Q
+ * @param count  Number of samples
+ */
+void nco_rotate(Nco *n, float *iq, size_t count);
+
+/**
+ * Quality of the loop's output over a stretch of symbols
+ */
+typedef struct {
+    double quartic;                       // Sum of -Re(y^4), |y|^4 when the phase is right
+    double magnitude;                     // Sum of |y|^4
+    double error;                         // Sum of the squared sine of the phase errors
+    unsigned long long symbols;
+} CarrierStats;
+
+/**
+ * Costas loop state
+ */
+typedef struct {
+    double bandwidth;                     // Loop noise bandwidth relative to the symbol rate
+    double k1;                            // Proportional gain, radians per unit of error
+    double k2;                            // Integral gain
+    double phase;                         // Phase taken off the next symbol in radians
+    double frequency;                     // Radians per symbol
+    int locked;                           // Non-zero while the lock detector says locked
+    unsigned long long unlocks;           // Times the lock was lost
+    CarrierStats window;                  // Symbols since the last lock decision
+} CostasLoop;
+
+/**
+ * Set up the loop for unit-energy symbols
+ *
+ * @param c          Loop to initialize
+ * @param bandwidth  Loop noise bandwidth relative to the symbol rate
+ *                   (0 < bandwidth <= COSTAS_MAX_BANDWIDTH)
+ * @return 0 on success, -1 on an invalid bandwidth
+ */
+int costas_init(CostasLoop *c, double bandwidth);
+
+/**
+ * Take the carrier phase off a block of symbols, in place
+ *
+ * @param c        Loop
+ * @param iq       count symbols, interleaved I/Q
+ * @param count    Number of symbols
+ * @param stats    Statistics to add the block's output to, or NULL
+ */
+void costas_process(CostasLoop *c, float *iq, size_t count, CarrierStats *stats);
+
+/**
+ * Advance over symbols that were sent but never received, at the
+ * estimated frequency
+ */
+void costas_skip(CostasLoop *c, unsigned long long symbols);
+
+/**
+ * Estimated frequency offset in cycles per symbol
+ */
+double costas_frequency(const CostasLoop *c);
+
+/**
+ * Add one set of statistics to another
+ */
+void carrier_stats_add(CarrierStats *total, const CarrierStats *part);
+
+/**
+ * Lock metric: near 1 for a steady phase (less at a low Es/N0), near 0
+ * for a turning one
+ */
+double carrier_lock_metric(const CarrierStats *stats);
+
+/**
+ * RMS phase error in degrees, noise included
+ */
+double carrier_phase_error(const CarrierStats *stats);
+
+/**
+ * Instruction set used by the oscillator and the loop (detected on first use)
+ */
+QpskIsa carrier_isa(void);
+
+/**
+ * Override the detected instruction set (clamped to what the CPU supports)
+ *
+ * @return The instruction set actually selected
+ */
+QpskIsa carrier_set_isa(QpskIsa isa);
+
+/**
+ * Differential coder state
+ */
+typedef struct {
+    int quadrant;                         // Quadrant of the last symbol, counter-clockwise from the first
+} DiffCoder;
+
+/**
+ * Start a coder at the first quadrant
+ */
+void diff_init(DiffCoder *d);
+
+/**
+ * Replace each symbol's bits by those of the previous quadrant turned by
+ * the symbol's quadrant, in place
+ *
+ * @param d        Coder, continuing from the last symbol it coded
+ * @param packed   Bits, four symbols per byte as in qpsk_map.h
+ * @param symbols  Number of symbols
+ */
+void diff_encode(DiffCoder *d, uint8_t *packed, size_t symbols);
+
+/**
+ * Undo diff_encode(), in place; a quarter turn of every symbol changes
+ * only the first decoded symbol
+ */
+void diff_decode(DiffCoder *d, uint8_t *packed, size_t symbols);
+
+#endif /* QPSK_CARRIER_H */
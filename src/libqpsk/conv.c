@@ -0,0 +1,342 @@
+/**
+ * Convolutional Code and Viterbi Decoder
+ *
+ * The state is the last six data bits, newest in bit 0. Data bit b in
+ * state s forms the register (s << 1) | b, whose parities under the two
+ * generators are the outputs, and leads to state ((s << 1) | b) & 63. So
+ * new states 2i and 2i + 1 both come from old states i and i + 32, a
+ * butterfly; and since both generators tap the newest and the oldest bit,
+ * flipping either flips both outputs. One branch metric M(i) per
+ * butterfly is enough:
+ *
+ *   new[2i]     = min(old[i] + M(i), old[i + 32] - M(i))
+ *   new[2i + 1] = min(old[i] - M(i), old[i + 32] + M(i))
+ *
+ * with M(i) the sum of the two LLRs, each negated where the output of
+ * the 0 branch of state i is a 0 bit. The 32 butterflies are independent,
+ * so the SIMD kernels compute 16 or 8 at a time and interleave the new
+ * even and odd states back into state order. The metrics grow by at most
+ * 254 per step and stay within a few thousand of each other, so they are
+ * brought back to state 0's every 16 steps and never leave 16 bits.
+ *
+ * The shuffles that interleave the states are what limits the kernels, so
+ * nothing else is shuffled: each step's LLRs are stored as 16-bit pairs
+ * that broadcast straight from memory, and the decisions are kept as the
+ * byte masks of the 16-bit comparisons, two bits per state. Bit
+ * 2 (i % 16) of word 2 (i / 16) + b of a step is set when new state
+ * 2i + b came from old state i + 32. The traceback starts from state 0,
+ * where the tail left the encoder, and reads each data bit from bit 0 of
+ * the state.
+ */
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "conv.h"
+#include "qpsk_map.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define QPSK_X86 1
+#endif
+
+#define START_PENALTY 8192                // Metric of the states a codeword cannot start in
+#define RENORM_MASK 15                    // Steps between metric renormalizations, less one
+
+/**
+ * Puncturing pattern: which outputs of each step in a period are sent
+ */
+typedef struct {
+    int period;                           // Steps per period
+    int kept;                             // Outputs sent per period
+    uint8_t keep[6];                      // Output A, output B of every step
+} Puncture;
+
+static const Puncture punctures[] = {
+    [CONV_1_2] = { 1, 2, { 1, 1 } },
+    [CONV_2_3] = { 2, 3, { 1, 1, 0, 1 } },
+    [CONV_3_4] = { 3, 4, { 1, 1, 0, 1, 1, 0 } },
+};
+
+static const char *rate_names[] = { "none", "1/2", "2/3", "3/4" };
+
+typedef void (*AcsFn)(const ConvDecoder *d, size_t steps);
+
+static QpskIsa conv_isa_used = QPSK_ISA_SCALAR;
+static AcsFn acs_fn;
+
+/**
+ * Whether new state 2i + b of a step came from old state i + 32
+ */
+static inline unsigned decision(const uint32_t *words, unsigned i, unsigned b) {
+    return (words[2 * (i >> 4) + b] >> (2 * (i & 15))) & 1;
+}
+
+static void acs_scalar(const ConvDecoder *d, size_t steps) {
+    int16_t metric[CONV_STATES], next[CONV_STATES];
+
+    metric[0] = 0;
+    for (int s = 1; s < CONV_STATES; s++) {
+        metric[s] = START_PENALTY;
+    }
+    for (size_t t = 0; t < steps; t++) {
+        int l0 = (int16_t)d->pairs[2 * t], l1 = (int16_t)d->pairs[2 * t + 1];
+        uint32_t *words = d->decisions + 4 * t;
+        memset(words, 0, 4 * sizeof(uint32_t));
+        for (int i = 0; i < CONV_STATES / 2; i++) {
+            int m = ((l0 ^ d->negate[0][i]) - d->negate[0][i]) + ((l1 ^ d->negate[1][i]) - d->negate[1][i]);
+            int a0 = metric[i] + m, b0 = metric[i + 32] - m;
+            int a1 = metric[i] - m, b1 = metric[i + 32] + m;
+            next[2 * i] = (int16_t)(a0 > b0 ? b0 : a0);
+            next[2 * i + 1] = (int16_t)(a1 > b1 ? b1 : a1);
+            words[2 * (i >> 4)] |= (uint32_t)(a0 > b0) << (2 * (i & 15));
+            words[2 * (i >> 4) + 1] |= (uint32_t)(a1 > b1) << (2 * (i & 15));
+        }
+        int base = (t & RENORM_MASK) == RENORM_MASK ? next[0] : 0;
+        for (int s = 0; s < CONV_STATES; s++) {
+            metric[s] = (int16_t)(next[s] - base);
+        }
+    }
+}
+
+#ifdef QPSK_X86
+
+__attribute__((target("sse2")))
+static void acs_sse2(const ConvDecoder *d, size_t steps) {
+    __m128i metric[8], next[8], n0[4], n1[4];
+
+    for (int k = 0; k < 4; k++) {
+        n0[k] = _mm_loadu_si128((const __m128i *)(d->negate[0] + 8 * k));
+        n1[k] = _mm_loadu_si128((const __m128i *)(d->negate[1] + 8 * k));
+    }
+    for (int k = 0; k < 8; k++) {
+        metric[k] = _mm_set1_epi16(START_PENALTY);
+    }
+    metric[0] = _mm_insert_epi16(metric[0], 0, 0);
+
+    for (size_t t = 0; t < steps; t++) {
+        __m128i l0 = _mm_set1_epi32((int)d->pairs[2 * t]);
+        __m128i l1 = _mm_set1_epi32((int)d->pairs[2 * t + 1]);
+        uint16_t taken[8];
+        // Butterflies 8k to 8k + 7 give new states 16k to 16k + 15
+        for (int k = 0; k < 4; k++) {
+            __m128i m = _mm_add_epi16(_mm_sub_epi16(_mm_xor_si128(l0, n0[k]), n0[k]),
+                                      _mm_sub_epi16(_mm_xor_si128(l1, n1[k]), n1[k]));
+            __m128i a0 = _mm_add_epi16(metric[k], m), b0 = _mm_sub_epi16(metric[k + 4], m);
+            __m128i a1 = _mm_sub_epi16(metric[k], m), b1 = _mm_add_epi16(metric[k + 4], m);
+            __m128i even = _mm_min_epi16(a0, b0), odd = _mm_min_epi16(a1, b1);
+            next[2 * k] = _mm_unpacklo_epi16(even, odd);
+            next[2 * k + 1] = _mm_unpackhi_epi16(even, odd);
+            taken[4 * (k >> 1) + (k & 1)] = (uint16_t)_mm_movemask_epi8(_mm_cmpgt_epi16(a0, b0));
+            taken[4 * (k >> 1) + 2 + (k & 1)] = (uint16_t)_mm_movemask_epi8(_mm_cmpgt_epi16(a1, b1));
+        }
+        if ((t & RENORM_MASK) == RENORM_MASK) {
+            __m128i base = _mm_shuffle_epi32(_mm_shufflelo_epi16(next[0], 0), 0);
+            for (int k = 0; k < 8; k++) {
+                next[k] = _mm_sub_epi16(next[k], base);
+            }
+        }
+        for (int k = 0; k < 8; k++) {
+            metric[k] = next[k];
+        }
+        memcpy(d->decisions + 4 * t, taken, sizeof(taken));
+    }
+}
+
+__attribute__((target("avx2")))
+static void acs_avx2(const ConvDecoder *d, size_t steps) {
+    __m256i metric[4], next[4], n0[2], n1[2];
+
+    for (int g = 0; g < 2; g++) {
+        n0[g] = _mm256_loadu_si256((const __m256i *)(d->negate[0] + 16 * g));
+        n1[g] = _mm256_loadu_si256((const __m256i *)(d->negate[1] + 16 * g));
+    }
+    for (int g = 0; g < 4; g++) {
+        metric[g] = _mm256_set1_epi16(START_PENALTY);
+    }
+    metric[0] = _mm256_insert_epi16(metric[0], 0, 0);
+
+    for (size_t t = 0; t < steps; t++) {
+        __m256i l0 = _mm256_set1_epi32((int)d->pairs[2 * t]);
+        __m256i l1 = _mm256_set1_epi32((int)d->pairs[2 * t + 1]);
+        uint32_t *words = d->decisions + 4 * t;
+        // Butterflies 16g to 16g + 15 give new states 32g to 32g + 31; the
+        // unpacks work within 128-bit lanes, so the lanes are swapped back
+        for (int g = 0; g < 2; g++) {
+            __m256i m = _mm256_add_epi16(_mm256_sub_epi16(_mm256_xor_si256(l0, n0[g]), n0[g]),
+                                         _mm256_sub_epi16(_mm256_xor_si256(l1, n1[g]), n1[g]));
+            __m256i a0 = _mm256_add_epi16(metric[g], m), b0 = _mm256_sub_epi16(metric[g + 2], m);
+            __m256i a1 = _mm256_sub_epi16(metric[g], m), b1 = _mm256_add_epi16(metric[g + 2], m);
+            __m256i even = _mm256_min_epi16(a0, b0), odd = _mm256_min_epi16(a1, b1);
+            __m256i lo = _mm256_unpacklo_epi16(even, odd), hi = _mm256_unpackhi_epi16(even, odd);
+            next[2 * g] = _mm256_permute2x128_si256(lo, hi, 0x20);
+            next[2 * g + 1] = _mm256_permute2x128_si256(lo, hi, 0x31);
+            words[2 * g] = (uint32_t)_mm256_movemask_epi8(_mm256_cmpgt_epi16(a0, b0));
+            words[2 * g + 1] = (uint32_t)_mm256_movemask_epi8(_mm256_cmpgt_epi16(a1, b1));
+        }
+        if ((t & RENORM_MASK) == RENORM_MASK) {
+            __m256i base = _mm256_broadcastw_epi16(_mm256_castsi256_si128(next[0]));
+            for (int g = 0; g < 4; g++) {
+                next[g] = _mm256_sub_epi16(next[g], base);
+            }
+        }
+        for (int g = 0; g < 4; g++) {
+            metric[g] = next[g];
+        }
+    }
+}
+
+#endif /* QPSK_X86 */
+
+static void select_isa(QpskIsa isa) {
+    acs_fn = acs_scalar;
+    conv_isa_used = QPSK_ISA_SCALAR;
+#ifdef QPSK_X86
+    if (isa == QPSK_ISA_AVX2) {
+        acs_fn = acs_avx2;
+        conv_isa_used = isa;
+    } else if (isa == QPSK_ISA_SSE2) {
+        acs_fn = acs_sse2;
+        conv_isa_used = isa;
+    }
+#endif
+}
+
+static pthread_once_t dispatch_once = PTHREAD_ONCE_INIT;
+
+static void select_cpu(void) {
+    select_isa(qpsk_cpu_isa());
+}
+
+static inline void ensure_dispatch(void) {
+    pthread_once(&dispatch_once, select_cpu);
+}
+
+int conv_parse_rate(const char *text, ConvRate *rate) {
+    for (int r = CONV_NONE; r <= CONV_3_4; r++) {
+        if (strcmp(text, rate_names[r]) == 0) {
+            *rate = (ConvRate)r;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+const char *conv_rate_name(ConvRate rate) {
+    return rate >= CONV_NONE && rate <= CONV_3_4 ? rate_names[rate] : "unknown";
+}
+
+size_t conv_coded_bits(ConvRate rate, size_t info_bits) {
+    const Puncture *p = &punctures[rate];
+    size_t steps = info_bits + CONV_TAIL;
+    size_t bits = steps / p->period * p->kept;
+
+    for (size_t i = 0; i < 2 * (steps % p->period); i++) {
+        bits += p->keep[i];
+    }
+    return bits;
+}
+
+size_t conv_info_bits(ConvRate rate, size_t coded_bits) {
+    const Puncture *p = &punctures[rate];
+    size_t bits = (coded_bits * p->period / p->kept + 8) & ~(size_t)7;
+
+    while (bits > 0 && conv_coded_bits(rate, bits) > coded_bits) {
+        bits -= 8;
+    }
+    return bits;
+}
+
+void conv_encode(ConvRate rate, const uint8_t *info, size_t info_bits, uint8_t *coded, size_t coded_bits) {
+    const Puncture *p = &punctures[rate];
+    unsigned reg = 0;
+    size_t out = 0;
+    int phase = 0;
+
+    memset(coded, 0, (coded_bits + 7) / 8);
+    for (size_t t = 0; t < info_bits + CONV_TAIL; t++) {
+        int b = t < info_bits ? qpsk_packed_bit(info, t) : 0;
+        reg = ((reg << 1) | (unsigned)b) & 0x7f;
+        int c[2] = { __builtin_parity(reg & CONV_POLY_A), __builtin_parity(reg & CONV_POLY_B) };
+        for (int j = 0; j < 2; j++) {
+            if (p->keep[2 * phase + j]) {
+                if (c[j]) {
+                    coded[out >> 3] |= (uint8_t)(0x80 >> (out & 7));
+                }
+                out++;
+            }
+        }
+        if (++phase == p->period) {
+            phase = 0;
+        }
+    }
+}
+
+int conv_decoder_init(ConvDecoder *d, size_t max_info_bits) {
+    memset(d, 0, sizeof(*d));
+    d->max_info_bits = max_info_bits;
+    d->pairs = malloc(2 * (max_info_bits + CONV_TAIL) * sizeof(uint32_t));
+    d->decisions = malloc(4 * (max_info_bits + CONV_TAIL) * sizeof(uint32_t));
+    if (d->pairs == NULL || d->decisions == NULL) {
+        conv_decoder_free(d);
+        return -1;
+    }
+    for (int i = 0; i < CONV_STATES / 2; i++) {
+        d->negate[0][i] = __builtin_parity((unsigned)(i << 1) & CONV_POLY_A) ? 0 : -1;
+        d->negate[1][i] = __builtin_parity((unsigned)(i << 1) & CONV_POLY_B) ? 0 : -1;
+    }
+    return 0;
+}
+
+void conv_decoder_free(ConvDecoder *d) {
+    free(d->pairs);
+    free(d->decisions);
+    d->pairs = NULL;
+    d->decisions = NULL;
+}
+
+int conv_decode(ConvDecoder *d, ConvRate rate, const int8_t *llr, size_t info_bits, uint8_t *info) {
+    const Puncture *p = &punctures[rate];
+    size_t steps = info_bits + CONV_TAIL;
+    int phase = 0;
+
+    if (info_bits > d->max_info_bits) {
+        return -1;
+    }
+    ensure_dispatch();
+
+    // Punctured outputs count as erasures, which favour neither bit
+    for (size_t t = 0; t < steps; t++) {
+        for (int j = 0; j < 2; j++) {
+            uint16_t l = p->keep[2 * phase + j] ? (uint16_t)*llr++ : 0;
+            d->pairs[2 * t + j] = l * 0x00010001u;
+        }
+        if (++phase == p->period) {
+            phase = 0;
+        }
+    }
+    acs_fn(d, steps);
+
+    memset(info, 0, (info_bits + 7) / 8);
+    unsigned s = 0;
+    for (size_t t = steps; t-- > 0; ) {
+        unsigned i = s >> 1, b = s & 1;
+        if (b && t < info_bits) {
+            info[t >> 3] |= (uint8_t)(0x80 >> (t & 7));
+        }
+        s = i | decision(d->decisions + 4 * t, i, b) << 5;
+    }
+    return 0;
+}
+
+QpskIsa conv_isa(void) {
+    ensure_dispatch();
+    return conv_isa_used;
+}
+
+QpskIsa conv_set_isa(QpskIsa isa) {
+    ensure_dispatch();
+    select_isa(qpsk_cpu_clamp_isa(isa));
+    return conv_isa_used;
+}
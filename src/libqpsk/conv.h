@@ -0,0 +1,132 @@
+/**
+ * Convolutional Code and Viterbi Decoder
+ *
+ * The rate 1/2, constraint length 7 code with generators 171 and 133
+ * (octal) used by most satellite and WLAN links, punctured to 2/3 or 3/4
+ * with the patterns of DVB-S (X 10 / Y 11 and X 101 / Y 110). Every frame
+ * is one codeword: its data bits are followed by CONV_TAIL zeros that
+ * bring the encoder back to state 0, so frames decode on their own and a
+ * lost frame costs nothing but its bits.
+ *
+ *   - conv_encode(): turns packed data bits into packed coded bits, in
+ *     the bit order the QPSK mapper reads them.
+ *   - conv_decode(): soft-decision Viterbi decoder over int8 LLRs as
+ *     qpsk_demap_llr_int8() writes them, with punctured bits as erasures
+ *     (LLR 0). The 64 path metrics are 16-bit integers; the add-compare-
+ *     select step of all of them runs on 16 (AVX2) or 8 (SSE2) states per
+ *     instruction when the CPU has them, and leaves one decision bit per
+ *     state and step for the traceback from state 0.
+ *
+ * The decoder only compares sums of LLRs, so it is blind to their scale;
+ * CONV_LLR_SCALE maps unit-energy symbols to well inside the int8 range.
+ * Every instruction set gives exactly the same decisions.
+ */
+
+#ifndef QPSK_CONV_H
+#define QPSK_CONV_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "cpu.h"
+
+#define CONV_K 7                          // Constraint length
+#define CONV_STATES 64                    // Encoder states, 2^(K - 1)
+#define CONV_TAIL 6                       // Zero bits that terminate a codeword
+#define CONV_POLY_A 0171                  // Generator of the first output, newest bit in bit 0
+#define CONV_POLY_B 0133                  // Generator of the second output
+#define CONV_LLR_SCALE 45.0f              // int8 LLR per unit of a sample: 1/sqrt(2) becomes 32
+
+/**
+ * Code rates; the values are those of the frame flags (see frame.h)
+ */
+typedef enum {
+    CONV_NONE = 0,                        // Uncoded
+    CONV_1_2 = 1,
+    CONV_2_3 = 2,
+    CONV_3_4 = 3
+} ConvRate;
+
+/**
+ * Read a rate: "none", "1/2", "2/3" or "3/4"
+ *
+ * @return 1 if the text names a rate, 0 otherwise
+ */
+int conv_parse_rate(const char *text, ConvRate *rate);
+
+/**
+ * Printable name of a rate
+ */
+const char *conv_rate_name(ConvRate rate);
+
+/**
+ * Coded bits of a codeword, tail included
+ */
+size_t conv_coded_bits(ConvRate rate, size_t info_bits);
+
+/**
+ * Most data bits, a multiple of 8, whose codeword fits in coded_bits
+ *
+ * @return Data bits, 0 if not even one byte fits
+ */
+size_t conv_info_bits(ConvRate rate, size_t coded_bits);
+
+/**
+ * Encode one codeword
+ *
+ * @param rate        Code rate (not CONV_NONE)
+ * @param info        info_bits data bits, packed, most significant first
+ * @param info_bits   Number of data bits
+ * @param coded       Output, coded_bits bits packed the same way; the bits
+ *                    after the codeword are zero
+ * @param coded_bits  At least conv_coded_bits(rate, info_bits)
+ */
+void conv_encode(ConvRate rate, const uint8_t *info, size_t info_bits, uint8_t *coded, size_t coded_bits);
+
+/**
+ * Decoder state: room for the codewords of up to max_info_bits data bits
+ */
+typedef struct {
+    size_t max_info_bits;
+    int16_t negate[2][CONV_STATES / 2];   // -1 where output A or B of state i's 0 branch is a 0 bit
+    uint32_t *pairs;                      // LLRs of both outputs of every step, twice in 16 bits; erasures 0
+    uint32_t *decisions;                  // Survivor decisions, four words per step
+} ConvDecoder;
+
+/**
+ * Allocate a decoder
+ *
+ * @return 0 on success, -1 if out of memory
+ */
+int conv_decoder_init(ConvDecoder *d, size_t max_info_bits);
+
+/**
+ * Release the buffers of a decoder
+ */
+void conv_decoder_free(ConvDecoder *d);
+
+/**
+ * Decode one codeword
+ *
+ * @param d          Decoder
+ * @param rate       Code rate (not CONV_NONE)
+ * @param llr        conv_coded_bits(rate, info_bits) LLRs, positive for a 0 bit
+ * @param info_bits  Number of data bits (up to max_info_bits)
+ * @param info       Output, (info_bits + 7) / 8 bytes of packed data bits
+ * @return 0 on success, -1 if the codeword is too long for the decoder
+ */
+int conv_decode(ConvDecoder *d, ConvRate rate, const int8_t *llr, size_t info_bits, uint8_t *info);
+
+/**
+ * Instruction set used by the decoder (detected on first use)
+ */
+QpskIsa conv_isa(void);
+
+/**
+ * Override the detected instruction set (clamped to what the CPU supports)
+ *
+ * @return The instruction set actually selected
+ */
+QpskIsa conv_set_isa(QpskIsa isa);
+
+#endif /* QPSK_CONV_H */
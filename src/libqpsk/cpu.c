@@ -0,0 +1,43 @@
+/**
+ * CPU Feature Detection
+ */
+
+#include <string.h>
+
+#include "cpu.h"
+
+QpskIsa qpsk_cpu_isa(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return QPSK_ISA_AVX2;
+    }
+    if (__builtin_cpu_supports("sse2")) {
+        return QPSK_ISA_SSE2;
+    }
+#endif
+    return QPSK_ISA_SCALAR;
+}
+
+QpskIsa qpsk_cpu_clamp_isa(QpskIsa isa) {
+    QpskIsa best = qpsk_cpu_isa();
+    return isa > best ? best : isa;
+}
+
+const char *qpsk_isa_name(QpskIsa isa) {
+    switch (isa) {
+    case QPSK_ISA_AVX2: return "avx2";
+    case QPSK_ISA_SSE2: return "sse2";
+    default:            return "scalar";
+    }
+}
+
+int qpsk_parse_isa(const char *name, QpskIsa *isa) {
+    for (int i = QPSK_ISA_SCALAR; i <= QPSK_ISA_AVX2; i++) {
+        if (strcmp(name, qpsk_isa_name((QpskIsa)i)) == 0) {
+            *isa = (QpskIsa)i;
+            return 1;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,44 @@
+/**
+ * CPU Feature Detection
+ *
+ * Runtime detection of the SIMD instruction sets used by the vectorized
+ * kernels in the library. Kernels are compiled with per-function target
+ * attributes, so the library runs on any x86-64 CPU and picks the best
+ * implementation when first used.
+ */
+
+#ifndef QPSK_CPU_H
+#define QPSK_CPU_H
+
+/**
+ * Instruction sets a kernel may be dispatched to, in increasing order
+ */
+typedef enum {
+    QPSK_ISA_SCALAR,
+    QPSK_ISA_SSE2,
+    QPSK_ISA_AVX2
+} QpskIsa;
+
+/**
+ * Best instruction set supported by the running CPU
+ */
+QpskIsa qpsk_cpu_isa(void);
+
+/**
+ * Clamp a requested instruction set to what the running CPU supports
+ */
+QpskIsa qpsk_cpu_clamp_isa(QpskIsa isa);
+
+/**
+ * Printable name of an instruction set
+ */
+const char *qpsk_isa_name(QpskIsa isa);
+
+/**
+ * Read an instruction set name: "scalar", "sse2" or "avx2"
+ *
+ * @return 1 if the name is known, 0 otherwise
+ */
+int qpsk_parse_isa(const char *name, QpskIsa *isa);
+
+#endif /* QPSK_CPU_H */
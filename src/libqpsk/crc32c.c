@@ -0,0 +1,232 @@
+/**
+ * CRC32C (Castagnoli) Checksums
+ *
+ * The kernels work on the bare register, without the initial value and
+ * final XOR, which crc32c_update() applies around them. The CRC is linear,
+ * so a buffer A B C can be split into three lanes whose registers start
+ * from the running one (A) and from zero (B, C):
+ *
+ *   crc(A B C) = crc(A) x^(8 |BC|) + crc(B) x^(8 |C|) + crc(C)   mod P
+ *
+ * in the reflected bit order of the register. A carry-less product of a
+ * register and the constant x^(8n - 33) mod P is 64 bits long, and the
+ * crc32 instruction over those 64 bits multiplies by the remaining x^33
+ * and reduces modulo P, so both shifts cost one multiplication each and
+ * a single crc32 instruction. The constants are computed once, from the
+ * lane lengths, with a bitwise multiplication modulo P.
+ */
+
+#include <pthread.h>
+#include <string.h>
+
+#include "crc32c.h"
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#define QPSK_X86 1
+#endif
+
+#define POLY 0x82F63B78u                  // Reflected Castagnoli polynomial
+#define LONG_LANE 256                     // Bytes per lane of the rounds over long buffers
+#define SHORT_LANE 64                     // Bytes per lane of the rounds over what is left
+
+typedef uint32_t (*CrcFn)(uint32_t crc, const uint8_t *p, size_t len);
+
+static uint32_t table[8][256];            // Slicing-by-8: table[k][b] is b followed by k zero bytes
+static uint32_t shift_long[2];            // x^(8n - 33) mod P for n = 2 and 1 long lanes
+static uint32_t shift_short[2];           // ... and short lanes
+static Crc32cImpl impl_used = CRC32C_SLICE8;
+static CrcFn crc_fn;
+
+/**
+ * a(x) b(x) mod P, both reflected
+ */
+static uint32_t multiply_mod(uint32_t a, uint32_t b) {
+    uint32_t product = 0;
+
+    for (uint32_t m = 1u << 31; m != 0; m >>= 1) {
+        if (a & m) {
+            product ^= b;
+        }
+        b = (b & 1) ? (b >> 1) ^ POLY : b >> 1;
+    }
+    return product;
+}
+
+/**
+ * x^n mod P, reflected
+ */
+static uint32_t power_mod(unsigned n) {
+    uint32_t result = 1u << 31, base = 1u << 30;
+
+    for (; n != 0; n >>= 1) {
+        if (n & 1) {
+            result = multiply_mod(result, base);
+        }
+        base = multiply_mod(base, base);
+    }
+    return result;
+}
+
+static void init_tables(void) {
+    for (unsigned b = 0; b < 256; b++) {
+        uint32_t crc = b;
+        for (int i = 0; i < 8; i++) {
+            crc = (crc & 1) ? (crc >> 1) ^ POLY : crc >> 1;
+        }
+        table[0][b] = crc;
+    }
+    for (unsigned b = 0; b < 256; b++) {
+        for (int k = 1; k < 8; k++) {
+            table[k][b] = (table[k - 1][b] >> 8) ^ table[0][table[k - 1][b] & 0xFF];
+        }
+    }
+    for (int k = 0; k < 2; k++) {
+        shift_long[k] = power_mod(8 * LONG_LANE * (2 - k) - 33);
+        shift_short[k] = power_mod(8 * SHORT_LANE * (2 - k) - 33);
+    }
+}
+
+static uint32_t crc_slice8(uint32_t crc, const uint8_t *p, size_t len) {
+    for (; len >= 8; p += 8, len -= 8) {
+        crc ^= p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+        crc = table[7][crc & 0xFF] ^ table[6][(crc >> 8) & 0xFF] ^ table[5][(crc >> 16) & 0xFF] ^
+              table[4][crc >> 24] ^ table[3][p[4]] ^ table[2][p[5]] ^ table[1][p[6]] ^ table[0][p[7]];
+    }
+    for (; len > 0; p++, len--) {
+        crc = (crc >> 8) ^ table[0][(crc ^ *p) & 0xFF];
+    }
+    return crc;
+}
+
+#ifdef QPSK_X86
+
+__attribute__((target("sse4.2")))
+static inline uint64_t crc_words(uint64_t crc, const uint8_t *p, size_t words) {
+    for (size_t i = 0; i < words; i++) {
+        uint64_t w;
+        memcpy(&w, p + 8 * i, sizeof(w));
+        crc = _mm_crc32_u64(crc, w);
+    }
+    return crc;
+}
+
+__attribute__((target("sse4.2")))
+static uint32_t crc_sse42(uint32_t crc, const uint8_t *p, size_t len) {
+    uint64_t c = crc_words(crc, p, len / 8);
+
+    p += len & ~(size_t)7;
+    for (len &= 7; len > 0; p++, len--) {
+        c = _mm_crc32_u8((uint32_t)c, *p);
+    }
+    return (uint32_t)c;
+}
+
+/**
+ * Rounds of three lanes of lane bytes, joined with the shifts for 2 and 1
+ * lanes
+ */
+__attribute__((target("sse4.2,pclmul")))
+static inline uint64_t crc_rounds(uint64_t crc, const uint8_t **pp, size_t *len, size_t lane,
+                                  const uint32_t *shift) {
+    const uint8_t *p = *pp;
+    __m128i k2 = _mm_cvtsi32_si128((int)shift[0]);
+    __m128i k1 = _mm_cvtsi32_si128((int)shift[1]);
+
+    for (; *len >= 3 * lane; p += 3 * lane, *len -= 3 * lane) {
+        uint64_t a = crc, b = 0, c = 0;
+        for (size_t i = 0; i < lane; i += 8) {
+            uint64_t wa, wb, wc;
+            memcpy(&wa, p + i, sizeof(wa));
+            memcpy(&wb, p + lane + i, sizeof(wb));
+            memcpy(&wc, p + 2 * lane + i, sizeof(wc));
+            a = _mm_crc32_u64(a, wa);
+            b = _mm_crc32_u64(b, wb);
+            c = _mm_crc32_u64(c, wc);
+        }
+        __m128i shifted = _mm_xor_si128(_mm_clmulepi64_si128(_mm_cvtsi32_si128((int)a), k2, 0),
+                                        _mm_clmulepi64_si128(_mm_cvtsi32_si128((int)b), k1, 0));
+        crc = _mm_crc32_u64(0, (uint64_t)_mm_cvtsi128_si64(shifted)) ^ c;
+    }
+    *pp = p;
+    return crc;
+}
+
+__attribute__((target("sse4.2,pclmul")))
+static uint32_t crc_clmul(uint32_t crc, const uint8_t *p, size_t len) {
+    uint64_t c = crc;
+
+    c = crc_rounds(c, &p, &len, LONG_LANE, shift_long);
+    c = crc_rounds(c, &p, &len, SHORT_LANE, shift_short);
+    return crc_sse42((uint32_t)c, p, len);
+}
+
+#endif /* QPSK_X86 */
+
+/**
+ * Best implementation the running CPU supports
+ */
+static Crc32cImpl cpu_impl(void) {
+#ifdef QPSK_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("sse4.2")) {
+        return __builtin_cpu_supports("pclmul") ? CRC32C_CLMUL : CRC32C_SSE42;
+    }
+#endif
+    return CRC32C_SLICE8;
+}
+
+static void select_impl(Crc32cImpl impl) {
+    crc_fn = crc_slice8;
+    impl_used = CRC32C_SLICE8;
+#ifdef QPSK_X86
+    if (impl == CRC32C_CLMUL) {
+        crc_fn = crc_clmul;
+        impl_used = impl;
+    } else if (impl == CRC32C_SSE42) {
+        crc_fn = crc_sse42;
+        impl_used = impl;
+    }
+#endif
+}
+
+static pthread_once_t dispatch_once = PTHREAD_ONCE_INIT;
+
+static void select_cpu(void) {
+    init_tables();
+    select_impl(cpu_impl());
+}
+
+static inline void ensure_dispatch(void) {
+    pthread_once(&dispatch_once, select_cpu);
+}
+
+uint32_t crc32c_update(uint32_t crc, const void *data, size_t len) {
+    ensure_dispatch();
+    return ~crc_fn(~crc, data, len);
+}
+
+uint32_t crc32c(const void *data, size_t len) {
+    return crc32c_update(0, data, len);
+}
+
+Crc32cImpl crc32c_impl(void) {
+    ensure_dispatch();
+    return impl_used;
+}
+
+Crc32cImpl crc32c_set_impl(Crc32cImpl impl) {
+    Crc32cImpl best = cpu_impl();
+
+    ensure_dispatch();
+    select_impl(impl < best ? impl : best);
+    return impl_used;
+}
+
+const char *crc32c_impl_name(Crc32cImpl impl) {
+    switch (impl) {
+    case CRC32C_CLMUL: return "sse4.2+pclmul";
+    case CRC32C_SSE42: return "sse4.2";
+    default:           return "slicing-by-8";
+    }
+}
@@ -0,0 +1,65 @@
+/**
+ * CRC32C (Castagnoli) Checksums
+ *
+ * The CRC of iSCSI, ext4 and SCTP (reflected polynomial 0x82F63B78,
+ * initial value and final XOR 0xFFFFFFFF), which detects every error of up
+ * to three bits in a jumbo frame and any burst of up to 32. x86 CPUs
+ * compute it in hardware, so it costs far less than a byte's worth of
+ * cycles per byte and can protect every frame:
+ *
+ *   - CRC32C_CLMUL: the SSE4.2 crc32 instruction on three independent
+ *     streams at once, which hides its three-cycle latency, joined with a
+ *     carry-less multiplication (PCLMULQDQ) per round.
+ *   - CRC32C_SSE42: the crc32 instruction, eight bytes at a time.
+ *   - CRC32C_SLICE8: slicing-by-8 tables, on any CPU.
+ *
+ * All give the same CRC; the best one the CPU supports is picked on first
+ * use.
+ */
+
+#ifndef QPSK_CRC32C_H
+#define QPSK_CRC32C_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define CRC32C_BYTES 4                    // Size of a CRC on the wire
+
+/**
+ * Implementations, in increasing order of speed
+ */
+typedef enum {
+    CRC32C_SLICE8,
+    CRC32C_SSE42,
+    CRC32C_CLMUL
+} Crc32cImpl;
+
+/**
+ * CRC32C of a buffer
+ */
+uint32_t crc32c(const void *data, size_t len);
+
+/**
+ * Extend a CRC32C over more data: crc32c_update(crc32c(a), b) is the CRC
+ * of a followed by b, and crc32c_update(0, b) that of b alone
+ */
+uint32_t crc32c_update(uint32_t crc, const void *data, size_t len);
+
+/**
+ * Implementation in use (detected on first use)
+ */
+Crc32cImpl crc32c_impl(void);
+
+/**
+ * Override the detected implementation (clamped to what the CPU supports)
+ *
+ * @return The implementation actually selected
+ */
+Crc32cImpl crc32c_set_impl(Crc32cImpl impl);
+
+/**
+ * Printable name of an implementation
+ */
+const char *crc32c_impl_name(Crc32cImpl impl);
+
+#endif /* QPSK_CRC32C_H */
@@ -0,0 +1,309 @@
+/**
+ * Adaptive Equalizer
+ *
+ * For an output y = sum w_i x_i both rules move the weights against the
+ * gradient of their cost, w_i -= step * e * conj(x_i), with the error
+ * e = y (|y|^2 - R) for CMA (R = 1 for unit-energy QPSK) and e = y - d for
+ * LMS with d the nearest constellation point.
+ *
+ * The inputs of a pass follow the last taps - 1 of the one before in a
+ * stage, so the inputs of every output lie contiguous, oldest first. The
+ * outputs of EQ_BLOCK symbols are computed with the same weights, which
+ * then take the summed gradient of all of them (block LMS): the outputs
+ * do not wait for each other's update, so the kernels overlap them, at
+ * the cost of a slightly slower adaptation for the same step. The SIMD
+ * kernels read the weights and inputs a whole vector at a time; the
+ * weights past the last tap are masked out of the update and stay zero,
+ * so the extra lanes add nothing.
+ */
+
+#include <math.h>
+#include <pthread.h>
+#include <string.h>
+
+#include "equalizer.h"
+#include "simd_complex.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define QPSK_X86 1
+#endif
+
+typedef void (*EqFn)(Equalizer *e, const float *x, size_t symbols, float *out, double *error);
+
+static QpskIsa eq_isa_used = QPSK_ISA_SCALAR;
+static EqFn eq_fn;
+
+/**
+ * Error of an output under the current rule, times the step, and the mode
+ * decision at the end of each window
+ *
+ * @param y      Output
+ * @param g      Scaled error to take (times conj(x)) off the weights
+ * @param error  Squared distance of the output to its decision, added to
+ */
+static inline void steer(Equalizer *e, const float *y, float *g, double *error) {
+    float er = y[0] - copysignf((float)M_SQRT1_2, y[0]);
+    float ei = y[1] - copysignf((float)M_SQRT1_2, y[1]);
+    float distance = er * er + ei * ei;
+    float dispersion = y[0] * y[0] + y[1] * y[1] - 1.0f;
+
+    // Each rule judges its own error: CMA how far the outputs are off the
+    // circle, LMS how far they are from the decisions
+    if (e->mode == EQ_LMS) {
+        g[0] = e->step * er;
+        g[1] = e->step * ei;
+        e->window_error += distance;
+    } else {
+        float modulus = 0.5f * e->step * dispersion;
+        g[0] = modulus * y[0];
+        g[1] = modulus * y[1];
+        e->window_error += dispersion * dispersion;
+    }
+    if (++e->window_count == EQ_WINDOW) {
+        double mean = e->window_error / EQ_WINDOW;
+        if (e->mode == EQ_CMA ? mean < EQ_CMA_CONVERGED : mean > EQ_LMS_DIVERGED) {
+            e->mode = e->mode == EQ_CMA ? EQ_LMS : EQ_CMA;
+            e->switches++;
+        }
+        e->window_error = 0.0;
+        e->window_count = 0;
+    }
+    *error += distance;
+}
+
+static void eq_scalar(Equalizer *e, const float *x, size_t symbols, float *out, double *error) {
+    const size_t stride = 2 * (size_t)e->sps;
+    float *w = e->weights;
+
+    for (size_t j = 0; j < symbols; j += EQ_BLOCK) {
+        int block = symbols - j < EQ_BLOCK ? (int)(symbols - j) : EQ_BLOCK;
+        const float *xb = x + j * stride;
+        float g[2 * EQ_BLOCK];
+        for (int b = 0; b < block; b++) {
+            const float *xs = xb + b * stride;
+            float y[2] = { 0.0f, 0.0f };
+            for (int i = 0; i < e->taps; i++) {
+                y[0] += w[2*i] * xs[2*i] - w[2*i + 1] * xs[2*i + 1];
+                y[1] += w[2*i] * xs[2*i + 1] + w[2*i + 1] * xs[2*i];
+            }
+            steer(e, y, g + 2*b, error);
+            out[2 * (j + b)] = y[0];
+            out[2 * (j + b) + 1] = y[1];
+        }
+        // w -= g * conj(x), summed over the block
+        for (int b = 0; b < block; b++) {
+            const float *xs = xb + b * stride;
+            for (int i = 0; i < e->taps; i++) {
+                w[2*i] -= g[2*b] * xs[2*i] + g[2*b + 1] * xs[2*i + 1];
+                w[2*i + 1] -= g[2*b + 1] * xs[2*i] - g[2*b] * xs[2*i + 1];
+            }
+        }
+    }
+}
+
+#ifdef QPSK_X86
+
+__attribute__((target("sse2")))
+static void eq_sse2(Equalizer *e, const float *x, size_t symbols, float *out, double *error) {
+    const __m128 conj = _mm_setr_ps(0.0f, -0.0f, 0.0f, -0.0f);
+    const size_t stride = 2 * (size_t)e->sps;
+    const int pairs = (e->taps + 1) / 2;
+    const __m128 tail = e->taps % 2 ? _mm_castsi128_ps(_mm_setr_epi32(-1, -1, 0, 0))
+                                    : _mm_castsi128_ps(_mm_set1_epi32(-1));
+    float *w = e->weights;
+
+    for (size_t j = 0; j < symbols; j += EQ_BLOCK) {
+        int block = symbols - j < EQ_BLOCK ? (int)(symbols - j) : EQ_BLOCK;
+        const float *xb = x + j * stride;
+        __m128 acc[EQ_BLOCK];
+        float g[2 * EQ_BLOCK];
+        for (int b = 0; b < EQ_BLOCK; b++) {
+            acc[b] = _mm_setzero_ps();
+        }
+        for (int i = 0; i < pairs; i++) {
+            __m128 wv = _mm_loadu_ps(w + 4*i);
+            for (int b = 0; b < block; b++) {
+                acc[b] = _mm_add_ps(acc[b], cmul_sse2(wv, _mm_loadu_ps(xb + b * stride + 4*i)));
+            }
+        }
+        for (int b = 0; b < block; b++) {
+            __m128 s = _mm_add_ps(acc[b], _mm_movehl_ps(acc[b], acc[b]));
+            float y[2] = { _mm_cvtss_f32(s), _mm_cvtss_f32(_mm_shuffle_ps(s, s, _MM_SHUFFLE(1, 1, 1, 1))) };
+            steer(e, y, g + 2*b, error);
+            out[2 * (j + b)] = y[0];
+            out[2 * (j + b) + 1] = y[1];
+        }
+        for (int i = 0; i < pairs; i++) {
+            __m128 d = _mm_setzero_ps();
+            for (int b = 0; b < block; b++) {
+                __m128 gv = _mm_setr_ps(g[2*b], g[2*b + 1], g[2*b], g[2*b + 1]);
+                d = _mm_add_ps(d, cmul_sse2(_mm_xor_ps(_mm_loadu_ps(xb + b * stride + 4*i), conj), gv));
+            }
+            if (i == pairs - 1) {
+                d = _mm_and_ps(d, tail);
+            }
+            _mm_storeu_ps(w + 4*i, _mm_sub_ps(_mm_loadu_ps(w + 4*i), d));
+        }
+    }
+}
+
+__attribute__((target("avx2")))
+static void eq_avx2(Equalizer *e, const float *x, size_t symbols, float *out, double *error) {
+    const __m256 conj = _mm256_setr_ps(0.0f, -0.0f, 0.0f, -0.0f, 0.0f, -0.0f, 0.0f, -0.0f);
+    const size_t stride = 2 * (size_t)e->sps;
+    const int quads = (e->taps + 3) / 4;
+    const int spare = 4 * quads - e->taps;
+    const __m256 tail = _mm256_castsi256_ps(_mm256_setr_epi32(-1, -1, -(spare < 3), -(spare < 3),
+                                                              -(spare < 2), -(spare < 2), -(spare < 1), -(spare < 1)));
+    float *w = e->weights;
+
+    for (size_t j = 0; j < symbols; j += EQ_BLOCK) {
+        int block = symbols - j < EQ_BLOCK ? (int)(symbols - j) : EQ_BLOCK;
+        const float *xb = x + j * stride;
+        __m256 acc[EQ_BLOCK];
+        float g[2 * EQ_BLOCK];
+        for (int b = 0; b < EQ_BLOCK; b++) {
+            acc[b] = _mm256_setzero_ps();
+        }
+        for (int i = 0; i < quads; i++) {
+            __m256 wv = _mm256_loadu_ps(w + 8*i);
+            for (int b = 0; b < block; b++) {
+                acc[b] = _mm256_add_ps(acc[b], cmul_avx2(wv, _mm256_loadu_ps(xb + b * stride + 8*i)));
+            }
+        }
+        for (int b = 0; b < block; b++) {
+            __m128 s = _mm_add_ps(_mm256_castps256_ps128(acc[b]), _mm256_extractf128_ps(acc[b], 1));
+            s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+            float y[2] = { _mm_cvtss_f32(s), _mm_cvtss_f32(_mm_shuffle_ps(s, s, _MM_SHUFFLE(1, 1, 1, 1))) };
+            steer(e, y, g + 2*b, error);
+            out[2 * (j + b)] = y[0];
+            out[2 * (j + b) + 1] = y[1];
+        }
+        for (int i = 0; i < quads; i++) {
+            __m256 d = _mm256_setzero_ps();
+            for (int b = 0; b < block; b++) {
+                __m256 gv = _mm256_setr_ps(g[2*b], g[2*b + 1], g[2*b], g[2*b + 1],
+                                           g[2*b], g[2*b + 1], g[2*b], g[2*b + 1]);
+                d = _mm256_add_ps(d, cmul_avx2(_mm256_xor_ps(_mm256_loadu_ps(xb + b * stride + 8*i), conj), gv));
+            }
+            if (i == quads - 1) {
+                d = _mm256_and_ps(d, tail);
+            }
+            _mm256_storeu_ps(w + 8*i, _mm256_sub_ps(_mm256_loadu_ps(w + 8*i), d));
+        }
+    }
+}
+
+#endif /* QPSK_X86 */
+
+/**
+ * Point the dispatch table at the kernel for one instruction set
+ */
+static void select_isa(QpskIsa isa) {
+    eq_fn = eq_scalar;
+    eq_isa_used = QPSK_ISA_SCALAR;
+#ifdef QPSK_X86
+    if (isa == QPSK_ISA_AVX2) {
+        eq_fn = eq_avx2;
+        eq_isa_used = isa;
+    } else if (isa == QPSK_ISA_SSE2) {
+        eq_fn = eq_sse2;
+        eq_isa_used = isa;
+    }
+#endif
+}
+
+static pthread_once_t dispatch_once = PTHREAD_ONCE_INIT;
+
+static void select_cpu(void) {
+    select_isa(qpsk_cpu_isa());
+}
+
+static inline void ensure_dispatch(void) {
+    pthread_once(&dispatch_once, select_cpu);
+}
+
+int eq_init(Equalizer *e, int taps, int sps, double step) {
+    memset(e, 0, sizeof(*e));
+    if ((sps != 1 && sps != 2) || taps < sps || taps > EQ_MAX_TAPS || !(step > 0.0) || step > EQ_MAX_STEP) {
+        return -1;
+    }
+    e->taps = taps;
+    e->sps = sps;
+    e->step = (float)step;
+    e->mode = EQ_CMA;
+
+    // The spike sits on the first input of the output's symbol, as near
+    // the middle of the filter as that allows
+    e->delay = ((taps - 1) / 2 - (sps - 1)) / sps;
+    if (e->delay < 0) {
+        e->delay = 0;
+    }
+    e->weights[2 * (taps - 1 - e->delay * sps - (sps - 1))] = 1.0f;
+    return 0;
+}
+
+void eq_restart(Equalizer *e) {
+    memset(e->stage, 0, sizeof(e->stage));
+    e->phase = 0;
+}
+
+size_t eq_process(Equalizer *e, const float *in, size_t count, float *out, EqStats *stats) {
+    const int keep = e->taps - 1;
+    float *fresh = e->stage + 2 * keep;
+    double error = 0.0;
+    size_t n = 0;
+
+    ensure_dispatch();
+    for (size_t done = 0; done < count; ) {
+        size_t m = count - done < EQ_CHUNK ? count - done : EQ_CHUNK;
+        memcpy(fresh, in + 2 * done, 2 * m * sizeof(float));
+
+        // The symbol ending at input c of the chunk has its inputs from
+        // slot c of the stage on
+        size_t first = (size_t)(e->sps - 1 - e->phase);
+        if (first < m) {
+            size_t symbols = (m - 1 - first) / e->sps + 1;
+            eq_fn(e, e->stage + 2 * first, symbols, out + 2 * n, &error);
+            n += symbols;
+        }
+        e->phase = (int)((e->phase + m) % e->sps);
+        memmove(e->stage, e->stage + 2 * m, 2 * keep * sizeof(float));
+        done += m;
+    }
+    if (stats != NULL) {
+        EqStats block = { (double)n, error, n };
+        eq_stats_add(stats, &block);
+    }
+    return n;
+}
+
+const char *eq_mode_name(EqMode mode) {
+    return mode == EQ_LMS ? "LMS" : "CMA";
+}
+
+void eq_stats_add(EqStats *total, const EqStats *part) {
+    total->signal += part->signal;
+    total->error += part->error;
+    total->symbols += part->symbols;
+}
+
+double eq_mer_db(const EqStats *stats) {
+    return stats->error > 0.0 ? 10.0 * log10(stats->signal / stats->error) : INFINITY;
+}
+
+double eq_evm_percent(const EqStats *stats) {
+    return stats->signal > 0.0 ? 100.0 * sqrt(stats->error / stats->signal) : 0.0;
+}
+
+QpskIsa eq_isa(void) {
+    ensure_dispatch();
+    return eq_isa_used;
+}
+
+QpskIsa eq_set_isa(QpskIsa isa) {
+    ensure_dispatch();
+    select_isa(qpsk_cpu_clamp_isa(isa));
+    return eq_isa_used;
+}
@@ -0,0 +1,145 @@
+/**
+ * Adaptive Equalizer
+ *
+ * A multipath channel smears each symbol over its neighbours, which no
+ * single-tap decision can undo. The equalizer is an FIR filter over the
+ * last taps inputs whose weights adapt to invert the channel:
+ *
+ *   - Fractionally spaced: fed two samples per symbol (or one), it gives
+ *     one output per symbol, so it also corrects a fixed sampling delay
+ *     and is far less sensitive to where the symbol instants fall than a
+ *     filter of one tap per symbol.
+ *   - Blind acquisition: the constant modulus algorithm (CMA) steers the
+ *     outputs towards the circle of the constellation, which needs neither
+ *     decisions nor the carrier phase.
+ *   - Tracking: once CMA has converged (the mean of (|y|^2 - 1)^2 falls
+ *     below EQ_CMA_CONVERGED over EQ_WINDOW outputs) it switches to
+ *     decision-directed LMS, which also takes out the phase turn CMA
+ *     leaves and settles at a lower error; it falls back to CMA when the
+ *     mean squared distance to the decisions rises above EQ_LMS_DIVERGED.
+ *
+ * The weights start as a single tap in the middle of the filter. The
+ * output of a symbol comes delay symbols after the symbol enters, so the
+ * filter has inputs on both sides of it. The filter and the weight update
+ * run on AVX2 or SSE2 when the CPU has them. The statistics give the
+ * modulation error ratio (MER) and error vector magnitude (EVM) of the
+ * outputs against the nearest constellation points.
+ */
+
+#ifndef QPSK_EQUALIZER_H
+#define QPSK_EQUALIZER_H
+
+#include <stddef.h>
+
+#include "cpu.h"
+
+#define EQ_MAX_TAPS 64                    // Longest filter
+#define EQ_DEFAULT_TAPS 12
+#define EQ_DEFAULT_STEP 0.004             // Adaptation step for unit-energy inputs
+#define EQ_MAX_STEP 0.05
+#define EQ_BLOCK 4                        // Outputs per weight update
+#define EQ_CHUNK 256                      // Inputs filtered per pass
+#define EQ_WINDOW 256                     // Outputs per mode decision
+#define EQ_CMA_CONVERGED 0.25             // CMA dispersion to switch to LMS below (Es/N0 of about 9 dB)
+#define EQ_LMS_DIVERGED 0.5               // Mean squared decision error to fall back to CMA above
+
+/**
+ * Adaptation rule
+ */
+typedef enum {
+    EQ_CMA,                               // Constant modulus, blind
+    EQ_LMS                                // Decision-directed least mean squares
+} EqMode;
+
+/**
+ * Quality of the outputs over a stretch of symbols
+ */
+typedef struct {
+    double signal;                        // Summed energy of the nearest constellation points
+    double error;                         // Summed squared distance to them
+    unsigned long long symbols;
+} EqStats;
+
+/**
+ * Equalizer state
+ */
+typedef struct {
+    int taps;                             // Filter length in inputs
+    int sps;                              // Inputs per symbol, 1 or 2
+    int delay;                            // Symbols from an input symbol to its output
+    float step;                           // LMS step; CMA takes half of it
+    EqMode mode;
+    unsigned long long switches;          // Changes of mode
+    float weights[2 * EQ_MAX_TAPS];       // Oldest input first, interleaved I/Q; zero past the last tap
+    float stage[2 * (EQ_MAX_TAPS + EQ_CHUNK + 4)]; // Last taps - 1 inputs, then those of a pass
+    int phase;                            // Inputs of the current symbol so far
+    double window_error;                  // Error of the current rule since the last mode decision
+    int window_count;
+} Equalizer;
+
+/**
+ * Set up an equalizer with a centre spike
+ *
+ * @param e     Equalizer to initialize
+ * @param taps  Filter length in inputs (sps to EQ_MAX_TAPS)
+ * @param sps   Inputs per symbol: 2 for a fractionally spaced filter, 1
+ * @param step  Adaptation step (0 < step <= EQ_MAX_STEP)
+ * @return 0 on success, -1 on invalid parameters
+ */
+int eq_init(Equalizer *e, int taps, int sps, double step);
+
+/**
+ * Clear the inputs after a gap, keeping the adapted weights
+ *
+ * The first delay outputs after a restart belong to no input symbol.
+ */
+void eq_restart(Equalizer *e);
+
+/**
+ * Equalize a block of inputs
+ *
+ * Output k is written after input k * sps + sps - 1 is read, so out may
+ * be in.
+ *
+ * @param e      Equalizer
+ * @param in     count inputs, interleaved I/Q
+ * @param count  Number of inputs
+ * @param out    Room for count / sps + 1 symbols, interleaved I/Q
+ * @param stats  Statistics to add the outputs to, or NULL
+ * @return Number of symbols written
+ */
+size_t eq_process(Equalizer *e, const float *in, size_t count, float *out, EqStats *stats);
+
+/**
+ * Printable name of an adaptation rule
+ */
+const char *eq_mode_name(EqMode mode);
+
+/**
+ * Add one set of statistics to another
+ */
+void eq_stats_add(EqStats *total, const EqStats *part);
+
+/**
+ * Modulation error ratio in dB
+ */
+double eq_mer_db(const EqStats *stats);
+
+/**
+ * RMS error vector magnitude in percent of the constellation's RMS
+ */
+double eq_evm_percent(const EqStats *stats);
+
+/**
+ * Instruction set used by the filter (detected on first use)
+ */
+QpskIsa eq_isa(void);
+
+/**
+ * Override the detected instruction set (clamped to what the CPU supports)
+ *
+ * @return The instruction set actually selected
+ */
+QpskIsa eq_set_isa(QpskIsa isa);
+
+#endif /* QPSK_EQUALIZER_H */
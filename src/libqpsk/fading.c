@@ -0,0 +1,306 @@
+/**
+ * Multipath Fading Channel
+ *
+ * The sum-of-sinusoids model follows Zheng and Xiao, "Simulation Models
+ * With Correct Statistical Properties for Rayleigh Fading Channels"
+ * (2003): with theta uniform per path, cosine n of either component has
+ * the Doppler shift fd cos(alpha_n) (I) or fd sin(alpha_n) (Q), where
+ * alpha_n = (2 pi n - pi + theta) / (4 M), and a uniform phase of its own.
+ *
+ * Within a pass the gain of a path moves on by its slope each sample; the
+ * SIMD kernels hold the gains of four or two consecutive samples and add
+ * four or two slopes after each step.
+ */
+
+#include <math.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "fading.h"
+#include "rng.h"
+#include "simd_complex.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define QPSK_X86 1
+#endif
+
+#define FADING_MAX_TURN 0.1          // Largest turn of a cosine between updates in radians
+#define FADING_MAX_INTERVAL 64       // Longest time between updates in samples
+#define FADING_RESYNC 1024           // Updates between exact evaluations of the cosines
+
+typedef void (*TapFn)(float *out, const float *in, size_t count, const float *gain, const float *slope);
+
+static QpskIsa fading_isa_used = QPSK_ISA_SCALAR;
+static TapFn tap_fn;
+
+/**
+ * Named profiles
+ */
+static const struct {
+    const char *name;
+    const char *paths;
+} profiles[] = {
+    { "flat",    "0:0" },
+    { "two-ray", "0:0,2:-3" },
+    { "urban",   "0:0,1:-1,2:-3,4:-6,7:-10,12:-15" },
+};
+
+#define PROFILES (sizeof(profiles) / sizeof(profiles[0]))
+
+/**
+ * Read delay:power_db pairs
+ */
+static int parse_paths(const char *text, FadingProfile *profile) {
+    const char *p = text;
+    int paths = 0;
+
+    while (paths < FADING_MAX_PATHS) {
+        char *end;
+        long delay = strtol(p, &end, 10);
+        if (end == p || *end != ':') {
+            return 0;
+        }
+        p = end + 1;
+        double power = strtod(p, &end);
+        if (end == p || (*end != ',' && *end != '\0')) {
+            return 0;
+        }
+        if (delay < 0 || delay > FADING_MAX_DELAY || (paths == 0 && delay != 0) ||
+            (paths > 0 && delay <= profile->delay[paths - 1]) ||
+            power < -100.0 || power > 100.0) {
+            return 0;
+        }
+        profile->delay[paths] = (int)delay;
+        profile->power_db[paths] = power;
+        paths++;
+        if (*end == '\0') {
+            profile->paths = paths;
+            return 1;
+        }
+        p = end + 1;
+    }
+    return 0;
+}
+
+int fading_parse_profile(const char *text, FadingProfile *profile) {
+    for (size_t i = 0; i < PROFILES; i++) {
+        if (strcmp(text, profiles[i].name) == 0) {
+            return parse_paths(profiles[i].paths, profile);
+        }
+    }
+    return parse_paths(text, profile);
+}
+
+/**
+ * Gain of a path from the current phases of its cosines
+ */
+static void path_gain(const FadingPath *p, float *gain) {
+    double re = 0.0, im = 0.0;
+    for (int n = 0; n < FADING_SINUSOIDS; n++) {
+        re += p->rotor[2*n];
+        im += p->rotor[2 * (FADING_SINUSOIDS + n)];
+    }
+    double scale = p->diffuse / sqrt((double)FADING_SINUSOIDS);
+    gain[0] = (float)(p->amplitude * (p->los[0] + scale * re));
+    gain[1] = (float)(p->amplitude * (p->los[1] + scale * im));
+}
+
+/**
+ * Move every cosine on to the next update and interpolate towards it
+ */
+static void advance(Fading *f) {
+    f->updates++;
+    for (int t = 0; t < f->paths; t++) {
+        FadingPath *p = &f->path[t];
+        for (int n = 0; n < 2 * FADING_SINUSOIDS; n++) {
+            double *r = p->rotor + 2*n;
+            if (f->updates % FADING_RESYNC == 0) {
+                double phase = p->theta[n] + fmod(p->omega[n] * (double)f->updates, 2.0 * M_PI);
+                r[0] = cos(phase);
+                r[1] = sin(phase);
+            } else {
+                double re = r[0] * p->step[2*n] - r[1] * p->step[2*n + 1];
+                r[1] = r[0] * p->step[2*n + 1] + r[1] * p->step[2*n];
+                r[0] = re;
+            }
+        }
+        p->gain[0] = p->next[0];
+        p->gain[1] = p->next[1];
+        path_gain(p, p->next);
+        p->slope[0] = (p->next[0] - p->gain[0]) / f->interval;
+        p->slope[1] = (p->next[1] - p->gain[1]) / f->interval;
+    }
+}
+
+static void tap_scalar(float *out, const float *in, size_t count, const float *gain, const float *slope) {
+    for (size_t k = 0; k < count; k++) {
+        float gr = gain[0] + k * slope[0], gi = gain[1] + k * slope[1];
+        out[2*k] += in[2*k] * gr - in[2*k + 1] * gi;
+        out[2*k + 1] += in[2*k] * gi + in[2*k + 1] * gr;
+    }
+}
+
+#ifdef QPSK_X86
+
+__attribute__((target("sse2")))
+static void tap_sse2(float *out, const float *in, size_t count, const float *gain, const float *slope) {
+    __m128 g = _mm_setr_ps(gain[0], gain[1], gain[0] + slope[0], gain[1] + slope[1]);
+    const __m128 step = _mm_setr_ps(2.0f * slope[0], 2.0f * slope[1], 2.0f * slope[0], 2.0f * slope[1]);
+    size_t k = 0;
+    for (; k + 2 <= count; k += 2) {
+        __m128 y = _mm_add_ps(_mm_loadu_ps(out + 2*k), cmul_sse2(_mm_loadu_ps(in + 2*k), g));
+        _mm_storeu_ps(out + 2*k, y);
+        g = _mm_add_ps(g, step);
+    }
+    float rest[2] = { gain[0] + k * slope[0], gain[1] + k * slope[1] };
+    tap_scalar(out + 2*k, in + 2*k, count - k, rest, slope);
+}
+
+__attribute__((target("avx2")))
+static void tap_avx2(float *out, const float *in, size_t count, const float *gain, const float *slope) {
+    __m256 g = _mm256_setr_ps(gain[0], gain[1], gain[0] + slope[0], gain[1] + slope[1],
+                              gain[0] + 2.0f * slope[0], gain[1] + 2.0f * slope[1],
+                              gain[0] + 3.0f * slope[0], gain[1] + 3.0f * slope[1]);
+    const __m256 step = _mm256_setr_ps(4.0f * slope[0], 4.0f * slope[1], 4.0f * slope[0], 4.0f * slope[1],
+                                       4.0f * slope[0], 4.0f * slope[1], 4.0f * slope[0], 4.0f * slope[1]);
+    size_t k = 0;
+    for (; k + 4 <= count; k += 4) {
+        __m256 y = _mm256_add_ps(_mm256_loadu_ps(out + 2*k), cmul_avx2(_mm256_loadu_ps(in + 2*k), g));
+        _mm256_storeu_ps(out + 2*k, y);
+        g = _mm256_add_ps(g, step);
+    }
+    float rest[2] = { gain[0] + k * slope[0], gain[1] + k * slope[1] };
+    tap_scalar(out + 2*k, in + 2*k, count - k, rest, slope);
+}
+
+#endif /* QPSK_X86 */
+
+/**
+ * Point the dispatch table at the kernel for one instruction set
+ */
+static void select_isa(QpskIsa isa) {
+    tap_fn = tap_scalar;
+    fading_isa_used = QPSK_ISA_SCALAR;
+#ifdef QPSK_X86
+    if (isa == QPSK_ISA_AVX2) {
+        tap_fn = tap_avx2;
+        fading_isa_used = isa;
+    } else if (isa == QPSK_ISA_SSE2) {
+        tap_fn = tap_sse2;
+        fading_isa_used = isa;
+    }
+#endif
+}
+
+static pthread_once_t dispatch_once = PTHREAD_ONCE_INIT;
+
+static void select_cpu(void) {
+    select_isa(qpsk_cpu_isa());
+}
+
+static inline void ensure_dispatch(void) {
+    pthread_once(&dispatch_once, select_cpu);
+}
+
+int fading_init(Fading *f, const FadingProfile *profile, double doppler, double k_factor, uint64_t seed) {
+    memset(f, 0, sizeof(*f));
+    if (profile->paths < 1 || profile->paths > FADING_MAX_PATHS || !(doppler >= 0.0) ||
+        doppler > FADING_MAX_DOPPLER || !(k_factor >= 0.0)) {
+        return -1;
+    }
+    double total = 0.0;
+    for (int t = 0; t < profile->paths; t++) {
+        if (profile->delay[t] < 0 || profile->delay[t] > FADING_MAX_DELAY ||
+            (t > 0 && profile->delay[t] <= profile->delay[t - 1])) {
+            return -1;
+        }
+        total += pow(10.0, profile->power_db[t] / 10.0);
+    }
+
+    // Update often enough that linear interpolation follows the cosines
+    f->interval = FADING_MAX_INTERVAL;
+    if (doppler > 0.0) {
+        double interval = floor(FADING_MAX_TURN / (2.0 * M_PI * doppler));
+        f->interval = interval < 1.0 ? 1 : interval < FADING_MAX_INTERVAL ? (int)interval : FADING_MAX_INTERVAL;
+    }
+    f->paths = profile->paths;
+    f->doppler = doppler;
+    f->k_factor = k_factor;
+    f->history_len = profile->delay[profile->paths - 1];
+
+    Rng rng;
+    rng_seed(&rng, seed);
+    for (int t = 0; t < f->paths; t++) {
+        FadingPath *p = &f->path[t];
+        p->delay = profile->delay[t];
+        p->amplitude = sqrt(pow(10.0, profile->power_db[t] / 10.0) / total);
+        p->diffuse = 1.0;
+        if (t == 0 && k_factor > 0.0) {
+            double phase = 2.0 * M_PI * rng_uniform(&rng);
+            p->los[0] = sqrt(k_factor / (k_factor + 1.0)) * cos(phase);
+            p->los[1] = sqrt(k_factor / (k_factor + 1.0)) * sin(phase);
+            p->diffuse = sqrt(1.0 / (k_factor + 1.0));
+        }
+
+        double theta = M_PI * (2.0 * rng_uniform(&rng) - 1.0);
+        for (int n = 0; n < FADING_SINUSOIDS; n++) {
+            double alpha = (2.0 * M_PI * (n + 1) - M_PI + theta) / (4.0 * FADING_SINUSOIDS);
+            p->omega[n] = 2.0 * M_PI * doppler * cos(alpha) * f->interval;
+            p->omega[FADING_SINUSOIDS + n] = 2.0 * M_PI * doppler * sin(alpha) * f->interval;
+        }
+        for (int n = 0; n < 2 * FADING_SINUSOIDS; n++) {
+            p->theta[n] = M_PI * (2.0 * rng_uniform(&rng) - 1.0);
+            p->rotor[2*n] = cos(p->theta[n]);
+            p->rotor[2*n + 1] = sin(p->theta[n]);
+            p->step[2*n] = cos(p->omega[n]);
+            p->step[2*n + 1] = sin(p->omega[n]);
+        }
+        path_gain(p, p->next);
+    }
+    // The first update interpolates from the gains at time 0 to the next ones
+    advance(f);
+    return 0;
+}
+
+void fading_process(Fading *f, float *iq, size_t count) {
+    float *in = f->stage + 2 * f->history_len;
+
+    ensure_dispatch();
+    for (size_t done = 0; done < count; ) {
+        size_t n = count - done < FADING_CHUNK ? count - done : FADING_CHUNK;
+        float *out = iq + 2 * done;
+        memcpy(in, out, 2 * n * sizeof(float));
+        memset(out, 0, 2 * n * sizeof(float));
+
+        // Sum the delayed paths, one update of the gains at a time
+        for (size_t k = 0; k < n; ) {
+            size_t m = n - k < (size_t)(f->interval - f->position) ? n - k : (size_t)(f->interval - f->position);
+            for (int t = 0; t < f->paths; t++) {
+                const FadingPath *p = &f->path[t];
+                float gain[2] = { p->gain[0] + f->position * p->slope[0], p->gain[1] + f->position * p->slope[1] };
+                tap_fn(out + 2*k, in + 2*k - 2 * p->delay, m, gain, p->slope);
+            }
+            k += m;
+            f->position += (int)m;
+            if (f->position == f->interval) {
+                f->position = 0;
+                advance(f);
+            }
+        }
+        memmove(f->stage, f->stage + 2*n, 2 * f->history_len * sizeof(float));
+        done += n;
+    }
+}
+
+QpskIsa fading_isa(void) {
+    ensure_dispatch();
+    return fading_isa_used;
+}
+
+QpskIsa fading_set_isa(QpskIsa isa) {
+    ensure_dispatch();
+    select_isa(qpsk_cpu_clamp_isa(isa));
+    return fading_isa_used;
+}
@@ -0,0 +1,131 @@
+/**
+ * Multipath Fading Channel
+ *
+ * Passes a stream through a tap-delay line whose taps fade: each path of
+ * the power-delay profile arrives some samples late with its share of the
+ * power, and its gain is a complex Gaussian process with the Jakes Doppler
+ * spectrum (Rayleigh fading), optionally plus a steady line of sight on
+ * the first path (Rician fading with factor K).
+ *
+ *   - Each fading gain is the sum-of-sinusoids model of Zheng and Xiao:
+ *     FADING_SINUSOIDS cosines per real component, with Doppler shifts and
+ *     phases drawn from the channel's own generator (rng.h), so a seed
+ *     gives the same channel every run. The cosines are turned on by one
+ *     complex multiply per update instead of evaluated, and recomputed
+ *     exactly now and then so rounding never builds up.
+ *   - The gains are updated every few samples, often enough that the
+ *     Doppler turns them by at most about 0.1 radians, and interpolated
+ *     linearly in between.
+ *   - The tap-delay line adds each path's delayed samples times its
+ *     interpolated gain, four (AVX2) or two (SSE2) complex samples per
+ *     instruction when the CPU has them.
+ *
+ * The path powers are scaled to add up to 1, so the mean received energy
+ * per symbol stays that of the input and an Es/N0 set with awgn.h is the
+ * mean Es/N0 over the fades. The line keeps the last samples of each call,
+ * so a stream can be fed in blocks of any length.
+ */
+
+#ifndef QPSK_FADING_H
+#define QPSK_FADING_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "cpu.h"
+
+#define FADING_MAX_PATHS 8                // Paths in a power-delay profile
+#define FADING_MAX_DELAY 64               // Longest path delay in samples
+#define FADING_SINUSOIDS 8                // Cosines per real component of a gain
+#define FADING_MAX_DOPPLER 0.01           // Largest Doppler shift in cycles per sample
+#define FADING_CHUNK 256                  // Samples filtered per pass
+
+/**
+ * Power-delay profile
+ */
+typedef struct {
+    int paths;                            // Number of paths
+    int delay[FADING_MAX_PATHS];          // Delay of each path in samples, the first one 0
+    double power_db[FADING_MAX_PATHS];    // Mean power of each path relative to the others
+} FadingProfile;
+
+/**
+ * Look up a profile by name ("flat", "two-ray", "urban") or read it as
+ * delay:power_db pairs separated by commas, e.g. "0:0,1:-3,4:-9"
+ *
+ * Delays are in samples of the stream, which are symbols unless the
+ * stream is pulse shaped. They must start at 0, increase and stay within
+ * FADING_MAX_DELAY.
+ *
+ * @return 1 if the text describes a valid profile, 0 otherwise
+ */
+int fading_parse_profile(const char *text, FadingProfile *profile);
+
+/**
+ * One faded path of the channel
+ */
+typedef struct {
+    int delay;                            // Samples behind the input
+    double amplitude;                     // Root of the path's share of the power
+    double los[2];                        // Line of sight part of the gain (first path, Rician)
+    double diffuse;                       // Weight of the fading part of the gain
+    double omega[2 * FADING_SINUSOIDS];   // Turn of each cosine per update in radians, I then Q
+    double theta[2 * FADING_SINUSOIDS];   // Phase of each cosine at the first update
+    double rotor[4 * FADING_SINUSOIDS];   // Current e^(j phase) of each cosine, interleaved
+    double step[4 * FADING_SINUSOIDS];    // e^(j omega) of each cosine, interleaved
+    float gain[2];                        // Gain at the start of the current update
+    float slope[2];                       // Change of the gain per sample
+    float next[2];                        // Gain at the next update
+} FadingPath;
+
+/**
+ * Channel state
+ */
+typedef struct {
+    int paths;
+    FadingPath path[FADING_MAX_PATHS];
+    double doppler;                       // Largest Doppler shift in cycles per sample
+    double k_factor;                      // Power of the line of sight over the fading part, 0 for Rayleigh
+    int interval;                         // Samples between gain updates
+    int position;                         // Samples of the current update done
+    unsigned long long updates;           // Gain updates since initialization
+    int history_len;                      // Past inputs kept between calls, the longest delay
+    float stage[2 * (FADING_MAX_DELAY + FADING_CHUNK)]; // Past inputs, then those of a pass
+} Fading;
+
+/**
+ * Set up a channel
+ *
+ * @param f         Channel to initialize
+ * @param profile   Power-delay profile
+ * @param doppler   Largest Doppler shift in cycles per sample
+ *                  (0 <= doppler <= FADING_MAX_DOPPLER; 0 freezes the gains)
+ * @param k_factor  Rician factor of the first path as a power ratio, 0 for
+ *                  Rayleigh fading on every path
+ * @param seed      Seed for the Doppler shifts and phases
+ * @return 0 on success, -1 on invalid parameters
+ */
+int fading_init(Fading *f, const FadingProfile *profile, double doppler, double k_factor, uint64_t seed);
+
+/**
+ * Pass a block of samples through the channel, in place
+ *
+ * @param f      Channel
+ * @param iq     count samples, interleaved I/Q
+ * @param count  Number of samples
+ */
+void fading_process(Fading *f, float *iq, size_t count);
+
+/**
+ * Instruction set used by the tap-delay line (detected on first use)
+ */
+QpskIsa fading_isa(void);
+
+/**
+ * Override the detected instruction set (clamped to what the CPU supports)
+ *
+ * @return The instruction set actually selected
+ */
+QpskIsa fading_set_isa(QpskIsa isa);
+
+#endif /* QPSK_FADING_H */
@@ -0,0 +1,117 @@
+/**
+ * Per-Flow Sequence Accounting
+ */
+
+#include <string.h>
+
+#include "flow.h"
+
+static inline uint64_t window_bit(uint32_t sequence) {
+    return 1ULL << (sequence % 64);
+}
+
+static inline uint64_t *window_word(Flow *flow, uint32_t sequence) {
+    return &flow->seen[(sequence % FLOW_WINDOW) / 64];
+}
+
+static void add_counts(FlowCounts *total, const FlowCounts *part) {
+    total->frames += part->frames;
+    total->lost += part->lost;
+    total->reordered += part->reordered;
+    total->duplicated += part->duplicated;
+    total->corrupt += part->corrupt;
+}
+
+void flow_table_init(FlowTable *table) {
+    memset(table, 0, sizeof(*table));
+}
+
+Flow *flow_lookup(FlowTable *table, uint64_t key) {
+    Flow *flow = NULL;
+
+    table->clock++;
+    for (int i = 0; i < table->count; i++) {
+        if (table->flows[i].key == key) {
+            flow = &table->flows[i];
+            break;
+        }
+    }
+    if (flow == NULL) {
+        if (table->count < FLOW_MAX) {
+            flow = &table->flows[table->count++];
+        } else {
+            flow = &table->flows[0];
+            for (int i = 1; i < FLOW_MAX; i++) {
+                if (table->flows[i].last_used < flow->last_used) {
+                    flow = &table->flows[i];
+                }
+            }
+            add_counts(&table->retired, &flow->counts);
+            table->evicted++;
+        }
+        memset(flow, 0, sizeof(*flow));
+        flow->key = key;
+    }
+    flow->last_used = table->clock;
+    return flow;
+}
+
+FlowVerdict flow_track(Flow *flow, uint32_t sequence, int start, uint32_t *gap) {
+    int32_t ahead = (int32_t)(sequence - flow->next);
+
+    flow->counts.frames++;
+    *gap = 0;
+    if (!flow->started || start) {
+        memset(flow->seen, 0, sizeof(flow->seen));
+        flow->started = 1;
+        flow->next = sequence;
+        ahead = 0;
+    }
+    if (ahead >= 0) {
+        // The numbers skipped leave the window unseen
+        if (ahead >= FLOW_WINDOW) {
+            memset(flow->seen, 0, sizeof(flow->seen));
+        } else {
+            for (uint32_t s = flow->next; s != sequence; s++) {
+                *window_word(flow, s) &= ~window_bit(s);
+            }
+        }
+        *window_word(flow, sequence) |= window_bit(sequence);
+        flow->next = sequence + 1;
+        flow->counts.lost += (uint32_t)ahead;
+        *gap = (uint32_t)ahead;
+        return FLOW_NEXT;
+    }
+    if (-ahead <= FLOW_WINDOW) {
+        uint64_t *word = window_word(flow, sequence);
+        if (*word & window_bit(sequence)) {
+            flow->counts.duplicated++;
+            return FLOW_DUPLICATE;
+        }
+        *word |= window_bit(sequence);
+    }
+    flow->counts.reordered++;
+    if (flow->counts.lost > 0) {
+        flow->counts.lost--;
+    }
+    return FLOW_REORDERED;
+}
+
+void flow_corrupt(Flow *flow) {
+    flow->counts.corrupt++;
+}
+
+void flow_table_counts(const FlowTable *table, FlowCounts *total) {
+    *total = table->retired;
+    for (int i = 0; i < table->count; i++) {
+        add_counts(total, &table->flows[i].counts);
+    }
+}
+
+void flow_counts_diff(const FlowCounts *now, const FlowCounts *before, FlowCounts *diff) {
+    diff->frames = now->frames - before->frames;
+    diff->lost = now->lost > before->lost ? now->lost - before->lost : 0;
+    diff->reordered = now->reordered - before->reordered;
+    diff->duplicated = now->duplicated - before->duplicated;
+    diff->corrupt = now->corrupt - before->corrupt;
+}
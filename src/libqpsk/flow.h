@@ -0,0 +1,116 @@
+/**
+ * Per-Flow Sequence Accounting
+ *
+ * Tells apart what happened to the frames of each sender from their
+ * sequence numbers (see frame.h). A flow remembers the newest sequence
+ * number and which of the FLOW_WINDOW before it arrived, so a frame is
+ * one of:
+ *
+ *   - next: at or ahead of the expected number; the numbers it skipped
+ *     count as lost for now.
+ *   - reordered: behind it but never seen, i.e. one of those counted as
+ *     lost, which it no longer is.
+ *   - duplicate: behind it and seen before.
+ *
+ * Frames more than FLOW_WINDOW behind cannot be checked for duplicates
+ * and count as reordered. A frame flagged as the first of a stream starts
+ * the flow afresh. Datagrams whose CRC does not match (see frame.h) count
+ * as corrupt against the flow of their sender, and take no part in the
+ * sequence, since their sequence number cannot be trusted.
+ *
+ * Flows are told apart by a key, the sender's address and port; a table
+ * holds up to FLOW_MAX of them and reuses the one idle longest when a new
+ * sender appears.
+ */
+
+#ifndef QPSK_FLOW_H
+#define QPSK_FLOW_H
+
+#include <stdint.h>
+
+#define FLOW_WINDOW 1024                  // Sequence numbers remembered behind the newest
+#define FLOW_MAX 16                       // Flows tracked at once
+
+/**
+ * What a received frame was
+ */
+typedef enum {
+    FLOW_NEXT,                            // In order, possibly after lost frames
+    FLOW_REORDERED,                       // Late, but the first copy
+    FLOW_DUPLICATE                        // Seen before
+} FlowVerdict;
+
+/**
+ * Frame counts of a flow, or of all of them
+ */
+typedef struct {
+    unsigned long long frames;            // Frames with a valid CRC (or none)
+    unsigned long long lost;              // Sequence numbers skipped and not (yet) received
+    unsigned long long reordered;
+    unsigned long long duplicated;
+    unsigned long long corrupt;           // Datagrams whose CRC did not match
+} FlowCounts;
+
+/**
+ * State of one flow
+ */
+typedef struct {
+    uint64_t key;                         // Sender address and port
+    int started;                          // Non-zero once a frame was sequenced
+    uint32_t next;                        // One past the newest sequence number
+    uint64_t seen[FLOW_WINDOW / 64];      // Sequence numbers received, by number modulo the window
+    unsigned long long last_used;         // Table clock at the last frame
+    FlowCounts counts;
+} Flow;
+
+/**
+ * Flows of all senders
+ */
+typedef struct {
+    Flow flows[FLOW_MAX];
+    int count;                            // Flows in use
+    unsigned long long clock;             // Frames looked up so far
+    unsigned long long evicted;           // Flows dropped to make room
+    FlowCounts retired;                   // Their counts, which stay in the totals
+} FlowTable;
+
+/**
+ * Start with no flows
+ */
+void flow_table_init(FlowTable *table);
+
+/**
+ * Flow of a sender, created (or taking over the longest idle one) if new
+ */
+Flow *flow_lookup(FlowTable *table, uint64_t key);
+
+/**
+ * Account a frame with a valid CRC
+ *
+ * @param flow      Flow of the sender
+ * @param sequence  Sequence number of the frame
+ * @param start     Non-zero if the frame is flagged as the first of a stream
+ * @param gap       For FLOW_NEXT, set to the sequence numbers skipped
+ * @return What the frame was
+ */
+FlowVerdict flow_track(Flow *flow, uint32_t sequence, int start, uint32_t *gap);
+
+/**
+ * Account a datagram whose CRC did not match
+ */
+void flow_corrupt(Flow *flow);
+
+/**
+ * Counts summed over all flows
+ */
+void flow_table_counts(const FlowTable *table, FlowCounts *total);
+
+/**
+ * Counts that happened between two snapshots
+ *
+ * Late frames take back losses, so the lost count of an interval is the
+ * net increase, or 0.
+ */
+void flow_counts_diff(const FlowCounts *now, const FlowCounts *before, FlowCounts *diff);
+
+#endif /* QPSK_FLOW_H */
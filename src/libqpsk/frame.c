@@ -0,0 +1,245 @@
+/**
+ * Compact Frame Format
+ */
+
+#include <math.h>
+#include <string.h>
+#include <time.h>
+
+#include "bfp.h"
+#include "crc32c.h"
+#include "frame.h"
+#include "sample.h"
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+#define FRAME_BIG_ENDIAN 1
+#endif
+
+#define FRAME_V1_HEADER_BYTES 24   // Version 1 headers end before the format parameters
+#define ROLLOFF_UNITS 10000.0f     // Roll-off field steps per 1.0
+
+static const uint8_t frame_magic[4] = { 'Q', 'P', 'S', 'K' };
+
+static inline void put16(uint8_t *p, unsigned v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+}
+
+static inline void put32(uint8_t *p, uint32_t v) {
+    put16(p, v & 0xFFFF);
+    put16(p + 2, v >> 16);
+}
+
+static inline unsigned get16(const uint8_t *p) {
+    return p[0] | (unsigned)p[1] << 8;
+}
+
+static inline uint32_t get32(const uint8_t *p) {
+    return get16(p) | (uint32_t)get16(p + 2) << 16;
+}
+
+size_t frame_symbol_bytes(FrameFormat format) {
+    switch (format) {
+    case FRAME_FORMAT_F32:  return 2 * sizeof(float);
+    case FRAME_FORMAT_SC16: return 2 * sizeof(int16_t);
+    case FRAME_FORMAT_SC8:  return 2 * sizeof(int8_t);
+    case FRAME_FORMAT_BFP:  return 0;
+    }
+    return 0;
+}
+
+static inline int shaped(const FrameHeader *hdr) {
+    return hdr->samples_per_symbol > 1;
+}
+
+size_t frame_samples(const FrameHeader *hdr) {
+    return hdr->symbols * (shaped(hdr) ? (size_t)hdr->samples_per_symbol : 1);
+}
+
+size_t frame_header_bytes(const FrameHeader *hdr) {
+    return shaped(hdr) ? FRAME_SHAPED_HEADER_BYTES : FRAME_HEADER_BYTES;
+}
+
+size_t frame_payload_bytes(const FrameHeader *hdr) {
+    if (hdr->format == FRAME_FORMAT_BFP) {
+        return bfp_bytes(hdr->bfp_bits, hdr->bfp_block, 2 * frame_samples(hdr));
+    }
+    return frame_samples(hdr) * frame_symbol_bytes(hdr->format);
+}
+
+size_t frame_trailer_bytes(const FrameHeader *hdr) {
+    return (hdr->flags & FRAME_FLAG_CRC) ? CRC32C_BYTES : 0;
+}
+
+size_t frame_bytes(const FrameHeader *hdr) {
+    return frame_header_bytes(hdr) + frame_payload_bytes(hdr) + frame_trailer_bytes(hdr);
+}
+
+size_t frame_max_symbols(const FrameHeader *hdr, int mtu) {
+    long room = (long)mtu - FRAME_IP_UDP_OVERHEAD;
+    long header = (long)(frame_header_bytes(hdr) + frame_trailer_bytes(hdr));
+    size_t sps = shaped(hdr) ? (size_t)hdr->samples_per_symbol : 1;
+    size_t samples;
+
+    if (room > FRAME_MAX_BYTES) {
+        room = FRAME_MAX_BYTES;
+    }
+    if (room <= header) {
+        return 0;
+    }
+    if (hdr->format == FRAME_FORMAT_BFP) {
+        // Whole blocks only; a partial last block takes as much room
+        size_t block_bytes = bfp_bytes(hdr->bfp_bits, hdr->bfp_block, 1);
+        samples = (room - header) / block_bytes * hdr->bfp_block / 2;
+    } else {
+        size_t per_sample = frame_symbol_bytes(hdr->format);
+        if (per_sample == 0) {
+            return 0;
+        }
+        samples = (room - header) / per_sample;
+    }
+    if (samples > FRAME_MAX_SAMPLES) {
+        samples = FRAME_MAX_SAMPLES;
+    }
+    return samples / sps < FRAME_MAX_SYMBOLS ? samples / sps : FRAME_MAX_SYMBOLS;
+}
+
+void frame_write_header(uint8_t *frame, const FrameHeader *hdr) {
+    memcpy(frame, frame_magic, sizeof(frame_magic));
+    frame[4] = FRAME_VERSION;
+    frame[5] = (uint8_t)hdr->format;
+    put16(frame + 6, hdr->flags);
+    put32(frame + 8, hdr->sequence);
+    put16(frame + 12, (unsigned)hdr->symbols);
+    put16(frame + 14, (unsigned)frame_header_bytes(hdr));
+    put32(frame + 16, (uint32_t)hdr->timestamp_ns);
+    put32(frame + 20, (uint32_t)(hdr->timestamp_ns >> 32));
+
+    if (hdr->format == FRAME_FORMAT_BFP) {
+        frame[24] = (uint8_t)hdr->bfp_bits;
+        frame[25] = (uint8_t)hdr->bfp_block;
+        put16(frame + 26, 0);
+    } else {
+        uint32_t scale;
+        memcpy(&scale, &hdr->scale, sizeof(scale));
+        put32(frame + 24, scale);
+    }
+    if (shaped(hdr)) {
+        frame[28] = (uint8_t)hdr->samples_per_symbol;
+        frame[29] = (uint8_t)hdr->pulse_span;
+        put16(frame + 30, (unsigned)lrintf(hdr->rolloff * ROLLOFF_UNITS));
+    }
+}
+
+int frame_parse_header(const uint8_t *data, size_t len, FrameHeader *hdr) {
+    if (len < FRAME_V1_HEADER_BYTES || memcmp(data, frame_magic, sizeof(frame_magic)) != 0) {
+        return 0;
+    }
+
+    hdr->version = data[4];
+    hdr->format = (FrameFormat)data[5];
+    hdr->flags = get16(data + 6);
+    hdr->sequence = get32(data + 8);
+    hdr->symbols = get16(data + 12);
+    hdr->header_bytes = get16(data + 14);
+    hdr->timestamp_ns = get32(data + 16) | (uint64_t)get32(data + 20) << 32;
+    hdr->scale = 1.0f;
+    hdr->bfp_bits = 0;
+    hdr->bfp_block = 0;
+    hdr->samples_per_symbol = 1;
+    hdr->pulse_span = 0;
+    hdr->rolloff = 0.0f;
+    int has_params = hdr->header_bytes >= FRAME_HEADER_BYTES && len >= FRAME_HEADER_BYTES;
+    if (hdr->format == FRAME_FORMAT_BFP) {
+        if (!has_params) {
+            return 0;
+        }
+        hdr->bfp_bits = data[24];
+        hdr->bfp_block = data[25];
+        if (!bfp_valid(hdr->bfp_bits, hdr->bfp_block)) {
+            return 0;
+        }
+    } else if (has_params) {
+        uint32_t scale = get32(data + 24);
+        memcpy(&hdr->scale, &scale, sizeof(scale));
+    }
+    if (hdr->version >= 3 && hdr->header_bytes >= FRAME_SHAPED_HEADER_BYTES
+        && len >= FRAME_SHAPED_HEADER_BYTES) {
+        hdr->samples_per_symbol = data[28];
+        hdr->pulse_span = data[29];
+        hdr->rolloff = get16(data + 30) / ROLLOFF_UNITS;
+    }
+
+    // Payloads start on a 4-byte boundary so samples can be read in place
+    return hdr->version >= 1
+        && (frame_symbol_bytes(hdr->format) > 0 || hdr->format == FRAME_FORMAT_BFP)
+        && hdr->header_bytes >= FRAME_V1_HEADER_BYTES && hdr->header_bytes % 4 == 0
+        && isfinite(hdr->scale) && hdr->scale > 0
+        && hdr->symbols >= 1 && hdr->samples_per_symbol >= 1 && frame_samples(hdr) <= FRAME_MAX_SAMPLES
+        && len == hdr->header_bytes + frame_payload_bytes(hdr) + frame_trailer_bytes(hdr);
+}
+
+void frame_seal(uint8_t *frame, const FrameHeader *hdr) {
+    if (hdr->flags & FRAME_FLAG_CRC) {
+        size_t covered = frame_header_bytes(hdr) + frame_payload_bytes(hdr);
+        put32(frame + covered, crc32c(frame, covered));
+    }
+}
+
+int frame_check(const uint8_t *data, const FrameHeader *hdr) {
+    if (!(hdr->flags & FRAME_FLAG_CRC)) {
+        return 1;
+    }
+    size_t covered = hdr->header_bytes + frame_payload_bytes(hdr);
+    return crc32c(data, covered) == get32(data + covered);
+}
+
+void frame_encode_payload(const FrameHeader *hdr, const float *iq, uint8_t *payload) {
+    if (hdr->format == FRAME_FORMAT_BFP) {
+        bfp_encode(iq, 2 * frame_samples(hdr), hdr->bfp_bits, hdr->bfp_block, payload);
+    } else {
+        sample_encode(hdr->format, iq, 2 * frame_samples(hdr), hdr->scale, payload);
+    }
+}
+
+void frame_decode_payload(const FrameHeader *hdr, const uint8_t *payload, float *iq) {
+    if (hdr->format == FRAME_FORMAT_BFP) {
+        bfp_decode(payload, 2 * frame_samples(hdr), hdr->bfp_bits, hdr->bfp_block, iq);
+    } else {
+        sample_decode(hdr->format, payload, 2 * frame_samples(hdr), hdr->scale, iq);
+    }
+}
+
+void frame_put_f32(float *samples, size_t count) {
+#ifdef FRAME_BIG_ENDIAN
+    for (size_t i = 0; i < count; i++) {
+        uint32_t v;
+        memcpy(&v, samples + i, sizeof(v));
+        v = __builtin_bswap32(v);
+        memcpy(samples + i, &v, sizeof(v));
+    }
+#else
+    (void)samples;
+    (void)count;
+#endif
+}
+
+const float *frame_get_f32(const uint8_t *payload, size_t count, float *scratch) {
+#ifdef FRAME_BIG_ENDIAN
+    for (size_t i = 0; i < count; i++) {
+        uint32_t v = get32(payload + 4*i);
+        memcpy(scratch + i, &v, sizeof(v));
+    }
+    return scratch;
+#else
+    (void)count;
+    (void)scratch;
+    return (const float *)payload;
+#endif
+}
+
+uint64_t frame_timestamp_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
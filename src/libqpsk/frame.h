@@ -0,0 +1,212 @@
+/**
+ * Compact Frame Format
+ *
+ * A self-describing datagram layout for streamed symbols: a small header
+ * followed by densely packed samples, instead of the 3072-byte padded
+ * layout (256 zeros, 256 real parts, 256 imaginary parts) of which a
+ * 20-symbol frame uses 160 bytes. All fields are little-endian:
+ *
+ *   offset  size  field
+ *        0     4  magic "QPSK"
+ *        4     1  version (3)
+ *        5     1  sample format
+ *        6     2  flags
+ *        8     4  sequence number, per stream, wrapping
+ *       12     2  symbols in the frame
+ *       14     2  header length in bytes (offset of the payload)
+ *       16     8  send time, nanoseconds since the Unix epoch
+ *       24     4  format parameters (version 2):
+ *                   SC16, SC8  sample scale, integer units per 1.0 (float)
+ *                   BFP        mantissa bits (1), block samples (1), zero (2)
+ *       28     4  pulse shape (version 3, only in shaped frames): samples
+ *                 per symbol (1), span in symbols (1), roll-off in 1/10000 (2)
+ *   28, 32        payload: I0, Q0, I1, Q1, ... in the sample format
+ *   end - 4     4  CRC32C of everything before it (only with flag 0x0010)
+ *
+ * Flags: 0x0001 marks the first frame of a stream, 0x0002 differentially
+ * coded bits; bits 2-3 give the rate of the convolutional code that
+ * protects the frame's bits (see conv.h), 0 for none. A coded frame's
+ * symbols carry one codeword of the most whole data bytes that fit.
+ * 0x0010 appends a CRC32C (see crc32c.h) of the header and payload, so a
+ * receiver can tell a corrupted frame from a good one before trusting its
+ * sequence number.
+ *
+ * Frames of pulse-shaped samples (see rrc.h) carry sps samples per symbol,
+ * consecutive pieces of one continuously filtered stream; the symbol field
+ * still counts symbols. Unshaped frames leave the pulse shape out.
+ *
+ * Receivers skip to the payload using the header length, so later versions
+ * may append fields; version 1 headers end before the parameters, and the
+ * scale then counts as 1. Headers without a pulse shape mean one sample
+ * per symbol. The legacy layout starts with zeros and can never
+ * be mistaken for a compact frame. See sample.h for the fixed-size sample
+ * formats and bfp.h for block floating point.
+ */
+
+#ifndef QPSK_FRAME_H
+#define QPSK_FRAME_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define FRAME_VERSION 3
+#define FRAME_HEADER_BYTES 28      // Header length of unshaped frames
+#define FRAME_SHAPED_HEADER_BYTES 32 // Header length of pulse-shaped frames
+#define FRAME_MAX_BYTES 65507      // Largest UDP payload over IPv4
+#define FRAME_MAX_SYMBOLS 65535    // Limit of the symbol count field
+#define FRAME_MAX_SAMPLES 65535    // Most complex samples in a frame
+#define FRAME_DEFAULT_MTU 1500     // Ethernet
+#define FRAME_IP_UDP_OVERHEAD 28   // IPv4 and UDP headers inside the MTU
+
+#define FRAME_FLAG_START 0x0001    // First frame after the transmitter started its bit source
+#define FRAME_FLAG_DIFFERENTIAL 0x0002 // Symbols carry differentially coded bits (see carrier.h)
+#define FRAME_FLAG_CODE 0x000C     // Convolutional code rate (see conv.h), 0 if uncoded
+#define FRAME_CODE_SHIFT 2         // Position of the code rate in the flags
+#define FRAME_FLAG_CRC 0x0010      // A CRC32C trailer follows the payload
+
+/**
+ * Sample formats of the payload
+ */
+typedef enum {
+    FRAME_FORMAT_F32 = 1,          // 32-bit IEEE floats
+    FRAME_FORMAT_SC16 = 2,         // 16-bit signed integers, scaled
+    FRAME_FORMAT_SC8 = 3,          // 8-bit signed integers, scaled
+    FRAME_FORMAT_BFP = 4           // Block floating point
+} FrameFormat;
+
+/**
+ * Decoded frame header
+ */
+typedef struct {
+    int version;
+    FrameFormat format;
+    unsigned flags;
+    uint32_t sequence;
+    size_t symbols;
+    size_t header_bytes;           // Offset of the payload
+    uint64_t timestamp_ns;
+    float scale;                   // Integer units per 1.0 of sample value (SC16, SC8)
+    int bfp_bits;                  // Mantissa width (BFP)
+    int bfp_block;                 // Samples per shared exponent (BFP)
+    int samples_per_symbol;        // 1 for unshaped frames
+    int pulse_span;                // Root-raised-cosine span in symbols (shaped frames)
+    float rolloff;                 // Root-raised-cosine roll-off (shaped frames)
+} FrameHeader;
+
+/**
+ * Payload bytes per symbol in a fixed-size sample format
+ *
+ * @return 0 for BFP, whose size depends on its parameters, or an unknown format
+ */
+size_t frame_symbol_bytes(FrameFormat format);
+
+/**
+ * Complex samples in the frame a header describes
+ */
+size_t frame_samples(const FrameHeader *hdr);
+
+/**
+ * Header length written by this version for a header (whether it is shaped)
+ */
+size_t frame_header_bytes(const FrameHeader *hdr);
+
+/**
+ * Payload size of the frame a header describes
+ */
+size_t frame_payload_bytes(const FrameHeader *hdr);
+
+/**
+ * Bytes after the payload: the CRC when flagged, otherwise none
+ */
+size_t frame_trailer_bytes(const FrameHeader *hdr);
+
+/**
+ * Datagram size of a frame written by this version
+ */
+size_t frame_bytes(const FrameHeader *hdr);
+
+/**
+ * Most symbols per frame that fit in one datagram without fragmentation
+ *
+ * @param hdr  Format, format parameters and samples per symbol (the
+ *             symbol count is ignored)
+ * @param mtu  Path MTU in bytes, including the IPv4 and UDP headers
+ * @return Symbols per frame, 0 if not even one symbol fits
+ */
+size_t frame_max_symbols(const FrameHeader *hdr, int mtu);
+
+/**
+ * Write a header to the start of a frame
+ *
+ * The version and header length fields are always those of this version;
+ * the corresponding members of hdr are ignored. The pulse shape is written
+ * when hdr has more than one sample per symbol.
+ */
+void frame_write_header(uint8_t *frame, const FrameHeader *hdr);
+
+/**
+ * Decode and validate the header of a received datagram
+ *
+ * @param data  Datagram
+ * @param len   Datagram length
+ * @param hdr   Decoded header
+ * @return 1 for a compact frame of at least one symbol whose length matches
+ *         its header, 0 otherwise
+ */
+int frame_parse_header(const uint8_t *data, size_t len, FrameHeader *hdr);
+
+/**
+ * Append the CRC trailer to a frame whose header and payload are written
+ *
+ * Does nothing unless hdr has FRAME_FLAG_CRC.
+ */
+void frame_seal(uint8_t *frame, const FrameHeader *hdr);
+
+/**
+ * Check the CRC trailer of a frame accepted by frame_parse_header()
+ *
+ * @return 1 if the CRC matches or the frame has none, 0 if it is corrupt
+ */
+int frame_check(const uint8_t *data, const FrameHeader *hdr);
+
+/**
+ * Convert float samples into the payload of a frame
+ *
+ * @param hdr      Format, parameters and symbol count
+ * @param iq       2 * frame_samples(hdr) samples (interleaved I/Q)
+ * @param payload  frame_payload_bytes(hdr) bytes
+ */
+void frame_encode_payload(const FrameHeader *hdr, const float *iq, uint8_t *payload);
+
+/**
+ * Convert the payload of a received frame back to float samples
+ *
+ * @param hdr      Header returned by frame_parse_header()
+ * @param payload  Payload bytes
+ * @param iq       Room for 2 * frame_samples(hdr) samples
+ */
+void frame_decode_payload(const FrameHeader *hdr, const uint8_t *payload, float *iq);
+
+/**
+ * Put float samples written in host order into wire (little-endian) order
+ *
+ * Does nothing on little-endian hosts.
+ */
+void frame_put_f32(float *samples, size_t count);
+
+/**
+ * Float samples of a received F32 payload in host order
+ *
+ * @param payload  Payload bytes
+ * @param count    Number of floats
+ * @param scratch  Room for count floats, used only on big-endian hosts
+ * @return payload itself on little-endian hosts, scratch otherwise
+ */
+const float *frame_get_f32(const uint8_t *payload, size_t count, float *scratch);
+
+/**
+ * Current time in nanoseconds since the Unix epoch, for the timestamp field
+ */
+uint64_t frame_timestamp_ns(void);
+
+#endif /* QPSK_FRAME_H */
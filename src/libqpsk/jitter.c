@@ -0,0 +1,179 @@
+/**
+ * Jitter and Reorder Buffer
+ *
+ * The ring holds at least twice the window, so frames ahead of a missing
+ * one by up to the window and a little beyond always find their slot free
+ * and the slot of a number is simply sequence & mask.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "jitter.h"
+
+int jitter_init(JitterBuffer *jb, uint32_t window, double max_delay) {
+    uint32_t size = 1;
+
+    memset(jb, 0, sizeof(*jb));
+    if (window < 1 || window > JITTER_MAX_WINDOW || !(max_delay >= 0)) {
+        return -1;
+    }
+    while (size < 2 * window) {
+        size <<= 1;
+    }
+    jb->slots = calloc(size, sizeof(*jb->slots));
+    jb->depths = calloc((size_t)size + 1, sizeof(*jb->depths));
+    if (jb->slots == NULL || jb->depths == NULL) {
+        jitter_free(jb);
+        return -1;
+    }
+    jb->mask = size - 1;
+    jb->window = window;
+    jb->max_delay = max_delay;
+    jb->missing_since = -1.0;
+    return 0;
+}
+
+void jitter_free(JitterBuffer *jb) {
+    if (jb->slots != NULL) {
+        for (uint32_t k = 0; k <= jb->mask; k++) {
+            free(jb->slots[k].data);
+        }
+    }
+    free(jb->slots);
+    free(jb->depths);
+    jb->slots = NULL;
+    jb->depths = NULL;
+}
+
+/**
+ * Drop every frame held, keeping the copies' memory
+ */
+static void drop_held(JitterBuffer *jb) {
+    if (jb->held > 0) {
+        for (uint32_t k = 0; k <= jb->mask; k++) {
+            jb->slots[k].held = 0;
+        }
+        jb->dropped += jb->held;
+        jb->held = 0;
+    }
+    jb->missing_since = -1.0;
+}
+
+void jitter_restart(JitterBuffer *jb) {
+    drop_held(jb);
+    jb->started = 0;
+    jb->jump = 0;
+}
+
+JitterInsert jitter_insert(JitterBuffer *jb, uint32_t sequence, const uint8_t *data, size_t length) {
+    if (!jb->started) {
+        jb->head = sequence;
+        jb->end = sequence;
+        jb->started = 1;
+    }
+
+    int32_t ahead = (int32_t)(sequence - jb->head);
+    if (ahead < 0) {
+        jb->late++;
+        return JITTER_LATE;
+    }
+    if ((uint32_t)ahead > jb->mask) {
+        // Too far ahead to wait for the numbers in between
+        drop_held(jb);
+        jb->jump += (uint32_t)ahead;
+        jb->head = sequence;
+        jb->end = sequence;
+        jb->restarts++;
+    }
+
+    JitterSlot *slot = &jb->slots[sequence & jb->mask];
+    if (slot->held) {
+        jb->duplicates++;
+        return JITTER_DUPLICATE;
+    }
+    if (length > slot->capacity) {
+        uint8_t *grown = realloc(slot->data, length);
+        if (grown == NULL) {
+            return JITTER_ERROR;
+        }
+        slot->data = grown;
+        slot->capacity = length;
+    }
+    memcpy(slot->data, data, length);
+    slot->sequence = sequence;
+    slot->length = length;
+    slot->held = 1;
+
+    jb->held++;
+    jb->stored++;
+    if ((int32_t)(sequence - jb->end) >= 0) {
+        jb->end = sequence + 1;
+    }
+    jb->depths[jb->held]++;
+    return JITTER_STORED;
+}
+
+JitterKind jitter_next(JitterBuffer *jb, double now, JitterOut *out) {
+    out->kind = JITTER_NONE;
+    out->data = NULL;
+    out->length = 0;
+
+    if (jb->jump > 0) {
+        out->kind = JITTER_GAP;
+        out->sequence = jb->head - jb->jump;
+        out->count = jb->jump;
+        jb->gaps += jb->jump;
+        jb->jump = 0;
+        return out->kind;
+    }
+    if (jb->held == 0) {
+        return out->kind;
+    }
+
+    JitterSlot *slot = &jb->slots[jb->head & jb->mask];
+    if (slot->held && slot->sequence == jb->head) {
+        slot->held = 0;
+        jb->held--;
+        jb->released++;
+        jb->missing_since = -1.0;
+        out->kind = JITTER_FRAME;
+        out->sequence = jb->head++;
+        out->count = 1;
+        out->data = slot->data;
+        out->length = slot->length;
+        return out->kind;
+    }
+
+    // The head is missing and later frames wait for it; the clock runs
+    // until a frame comes out again, so a run of missing frames shares
+    // one max_delay
+    if (jb->missing_since < 0) {
+        jb->missing_since = now;
+    }
+    if (jb->end - 1 - jb->head > jb->window || now - jb->missing_since >= jb->max_delay) {
+        out->kind = JITTER_GAP;
+        out->sequence = jb->head++;
+        out->count = 1;
+        jb->gaps++;
+    }
+    return out->kind;
+}
+
+uint32_t jitter_depth_percentile(const JitterBuffer *jb, double p) {
+    unsigned long long total = 0, sum = 0;
+
+    for (uint32_t n = 0; n <= jb->mask + 1; n++) {
+        total += jb->depths[n];
+    }
+    if (total == 0) {
+        return 0;
+    }
+    for (uint32_t n = 0; n <= jb->mask + 1; n++) {
+        sum += jb->depths[n];
+        if (sum >= p * total) {
+            return n;
+        }
+    }
+    return jb->mask + 1;
+}
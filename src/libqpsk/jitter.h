@@ -0,0 +1,144 @@
+/**
+ * Jitter and Reorder Buffer
+ *
+ * Puts the frames of one stream back in sequence order. Frames are copied
+ * into a power-of-two ring of slots indexed by their sequence number, so
+ * storing one and handing out the next are constant-time. A missing frame
+ * holds back the ones after it until it arrives or the buffer gives up on
+ * it, whichever comes first:
+ *
+ *   - the newest frame is more than window frames ahead of it, or
+ *   - it has been missing for max_delay seconds while later frames waited.
+ *
+ * A frame given up on comes out as a gap in its place, so the consumer
+ * sees every sequence number exactly once and can fill the hole (zeros,
+ * or erasures for a decoder) to keep the stream continuous. Frames that
+ * arrive after their number went out, as a frame or a gap, are late and
+ * dropped; the window trades this loss against the delay the buffer adds.
+ *
+ * A frame so far ahead that it does not fit the ring (a long outage, or a
+ * sender that restarted) restarts the buffer at its number: the frames
+ * still held are dropped and the numbers in between come out as one gap.
+ *
+ * The depth (frames held) after every insertion is kept in a histogram,
+ * so its percentiles show how much of the window the stream needs.
+ */
+
+#ifndef QPSK_JITTER_H
+#define QPSK_JITTER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define JITTER_MAX_WINDOW 4096             // Largest window in frames
+
+/**
+ * What jitter_next() handed out
+ */
+typedef enum {
+    JITTER_NONE,                           // Nothing ready yet
+    JITTER_FRAME,                          // The next frame in order
+    JITTER_GAP                             // Frames given up on
+} JitterKind;
+
+/**
+ * Outcome of jitter_insert()
+ */
+typedef enum {
+    JITTER_STORED,                         // Held until its turn
+    JITTER_LATE,                           // Its number already went out; dropped
+    JITTER_DUPLICATE,                      // Already held; dropped
+    JITTER_ERROR                           // No memory for the copy; dropped
+} JitterInsert;
+
+/**
+ * Frame or gap handed out
+ */
+typedef struct {
+    JitterKind kind;
+    uint32_t sequence;                     // Number of the frame, or the first of the gap
+    uint32_t count;                        // Frames in the gap (1 for a frame)
+    const uint8_t *data;                   // Frame bytes, valid until the next insertion
+    size_t length;
+} JitterOut;
+
+/**
+ * One frame's place in the ring
+ */
+typedef struct {
+    uint32_t sequence;
+    int held;                              // Non-zero while holding that frame
+    size_t length;
+    size_t capacity;                       // Bytes allocated at data, grown on demand
+    uint8_t *data;
+} JitterSlot;
+
+/**
+ * Buffer state and counters
+ */
+typedef struct {
+    JitterSlot *slots;
+    uint32_t mask;                         // Ring size - 1
+    uint32_t window;                       // Frames a missing one may hold back
+    double max_delay;                      // Seconds a missing one may hold them back
+    int started;                           // Non-zero after the first frame
+    uint32_t head;                         // Next number to hand out
+    uint32_t end;                          // One past the newest number stored
+    uint32_t held;                         // Frames in the ring
+    double missing_since;                  // When the head was found missing, < 0 if not
+    uint32_t jump;                         // Numbers of a restart still to hand out as a gap
+    unsigned long long *depths;            // depths[n]: insertions that left n frames held
+    unsigned long long stored;             // Frames stored
+    unsigned long long released;           // Frames handed out
+    unsigned long long gaps;               // Numbers handed out as gaps
+    unsigned long long late;               // Frames dropped as late
+    unsigned long long duplicates;         // Frames dropped as already held
+    unsigned long long dropped;            // Frames held when the buffer restarted
+    unsigned long long restarts;
+} JitterBuffer;
+
+/**
+ * Set up an empty buffer
+ *
+ * @param window     Frames a missing frame may hold back (1 to JITTER_MAX_WINDOW)
+ * @param max_delay  Seconds a missing frame may hold them back
+ * @return 0 on success, -1 on invalid arguments or allocation failure
+ */
+int jitter_init(JitterBuffer *jb, uint32_t window, double max_delay);
+
+/**
+ * Release the ring and the frame copies
+ */
+void jitter_free(JitterBuffer *jb);
+
+/**
+ * Start over at the next frame stored, dropping the frames held (e.g.
+ * when the sender flags the start of a new stream)
+ */
+void jitter_restart(JitterBuffer *jb);
+
+/**
+ * Copy a frame into the buffer
+ *
+ * @param sequence  Sequence number of the frame
+ * @param data      Frame bytes
+ * @param length    Bytes at data
+ * @return Whether it was stored or why not
+ */
+JitterInsert jitter_insert(JitterBuffer *jb, uint32_t sequence, const uint8_t *data, size_t length);
+
+/**
+ * Hand out the next frame in order, or a gap once its frame is given up on
+ *
+ * @param now  Current time in seconds, on the clock of max_delay
+ * @param out  Set to the frame or gap
+ * @return out->kind; JITTER_NONE while waiting
+ */
+JitterKind jitter_next(JitterBuffer *jb, double now, JitterOut *out);
+
+/**
+ * Depth not exceeded by a share p (0 to 1) of the insertions so far
+ */
+uint32_t jitter_depth_percentile(const JitterBuffer *jb, double p);
+
+#endif /* QPSK_JITTER_H */
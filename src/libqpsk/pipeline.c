@@ -0,0 +1,302 @@
+/**
+ * Staged Processing Pipeline
+ */
+
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "pipeline.h"
+
+#define SPIN_LIMIT 64     // Polls before a waiting thread starts yielding
+
+static unsigned long long now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (unsigned long long)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/**
+ * Add to a counter only its own thread writes; a plain load and store is
+ * enough and avoids a locked instruction
+ */
+static inline void bump(atomic_ullong *counter, unsigned long long v) {
+    atomic_store_explicit(counter,
+                          atomic_load_explicit(counter, memory_order_relaxed) + v,
+                          memory_order_relaxed);
+}
+
+static inline void backoff(int spins) {
+    if (spins < SPIN_LIMIT) {
+#if defined(__x86_64__) || defined(__i386__)
+        __builtin_ia32_pause();
+#endif
+    } else {
+        sched_yield();
+    }
+}
+
+static inline int aborted(Pipeline *pipe) {
+    return atomic_load_explicit(&pipe->abort, memory_order_relaxed);
+}
+
+/**
+ * Handle of the next input block of a stage, waiting for it if needed
+ *
+ * The first stage waits for a free slot of the pool, the others for the
+ * ring from the stage before them.
+ *
+ * @return 1 with *handle set, or 0 when the stream ended or the pipeline aborted
+ */
+static int wait_input(Pipeline *pipe, int stage, uint32_t *handle) {
+    SpscRing *ring = stage > 0 ? &pipe->ring[stage - 1] : &pipe->pool.free;
+    PipelineCounters *c = &pipe->counters[stage];
+    const uint32_t *h = spsc_front(ring);
+
+    if (h == NULL) {
+        unsigned long long start = now_ns();
+        bump(&c->input_stalls, 1);
+        for (int spins = 0; (h = spsc_front(ring)) == NULL; spins++) {
+            if ((stage > 0 && spsc_finished(ring)) || aborted(pipe)) {
+                break;
+            }
+            backoff(spins);
+        }
+        bump(&c->input_wait_ns, now_ns() - start);
+    }
+    if (h == NULL) {
+        return 0;
+    }
+    if (stage > 0) {
+        bump(&c->occupancy, spsc_occupancy(ring));
+    }
+    *handle = *h;
+    spsc_release(ring);
+    return 1;
+}
+
+/**
+ * Pass a handle to the next thread, waiting for room if needed
+ *
+ * @return 1 on success, 0 when the pipeline aborted
+ */
+static int wait_output(Pipeline *pipe, int stage, uint32_t handle) {
+    SpscRing *ring = &pipe->ring[stage];
+    PipelineCounters *c = &pipe->counters[stage];
+    uint32_t *h = spsc_reserve(ring);
+
+    if (h == NULL) {
+        unsigned long long start = now_ns();
+        bump(&c->output_stalls, 1);
+        for (int spins = 0; (h = spsc_reserve(ring)) == NULL; spins++) {
+            if (aborted(pipe)) {
+                return 0;
+            }
+            backoff(spins);
+        }
+        bump(&c->output_wait_ns, now_ns() - start);
+    }
+    *h = handle;
+    spsc_publish(ring);
+    return 1;
+}
+
+static void fail(Pipeline *pipe, int stage) {
+    int none = -1;
+    atomic_compare_exchange_strong(&pipe->failed, &none, stage);
+    atomic_store(&pipe->abort, 1);
+}
+
+/**
+ * Thread running one group of stages until its input ends
+ */
+static void *thread_main(void *arg) {
+    Pipeline *pipe = ((PipelineThread *)arg)->pipe;
+    int thread = ((PipelineThread *)arg)->thread;
+    int first = pipe->first[thread];
+    int last = pipe->first[thread + 1] - 1;
+    uint32_t handle;
+
+    while (wait_input(pipe, first, &handle)) {
+        void *block = pool_slot(&pipe->pool, handle);
+        int s, r = 1;
+        for (s = first; s <= last && r > 0; s++) {
+            unsigned long long start = now_ns();
+            r = pipe->stage[s].run(pipe->stage[s].ctx, block);
+            bump(&pipe->counters[s].busy_ns, now_ns() - start);
+            if (r > 0) {
+                bump(&pipe->counters[s].blocks, 1);
+            }
+        }
+
+        if (r > 0 && last < pipe->stages - 1) {
+            if (!wait_output(pipe, last, handle)) {
+                break;
+            }
+            continue;
+        }
+        // Blocks leave the pipeline after the last stage or when a stage
+        // ends the stream; the last thread is the only one giving back
+        if (last == pipe->stages - 1) {
+            pool_give(&pipe->pool, handle);
+        }
+        if (r < 0) {
+            fail(pipe, s - 1);
+        }
+        if (r <= 0) {
+            // Only the first stage may end the stream; stop the stages
+            // upstream of any other one
+            if (s - 1 > 0) {
+                atomic_store(&pipe->abort, 1);
+            }
+            break;
+        }
+    }
+
+    if (last < pipe->stages - 1) {
+        spsc_close(&pipe->ring[last]);
+    }
+    atomic_fetch_sub(&pipe->running, 1);
+    return NULL;
+}
+
+int pipeline_init(Pipeline *pipe, const PipelineStage *stages, int count, int threads, size_t depth,
+                  size_t block_bytes, int huge) {
+    memset(pipe, 0, sizeof(*pipe));
+    if (count < 2 || count > PIPELINE_MAX_STAGES || depth < 1) {
+        return -1;
+    }
+    if (threads < 1) {
+        threads = 1;
+    }
+    if (threads > count) {
+        threads = count;
+    }
+
+    pipe->stages = count;
+    pipe->threads = threads;
+    memcpy(pipe->stage, stages, count * sizeof(*stages));
+    for (int t = 0; t <= threads; t++) {
+        pipe->first[t] = t * count / threads;
+    }
+    for (int t = 0; t < PIPELINE_MAX_STAGES; t++) {
+        pipe->cpu[t] = -1;
+    }
+    for (int s = 0; s < count; s++) {
+        atomic_init(&pipe->counters[s].blocks, 0);
+        atomic_init(&pipe->counters[s].busy_ns, 0);
+        atomic_init(&pipe->counters[s].input_stalls, 0);
+        atomic_init(&pipe->counters[s].input_wait_ns, 0);
+        atomic_init(&pipe->counters[s].output_stalls, 0);
+        atomic_init(&pipe->counters[s].output_wait_ns, 0);
+        atomic_init(&pipe->counters[s].occupancy, 0);
+    }
+    atomic_init(&pipe->running, 0);
+    atomic_init(&pipe->abort, 0);
+    atomic_init(&pipe->failed, -1);
+
+    size_t ring_depth = depth;
+    for (int t = 0; t + 1 < threads; t++) {
+        SpscRing *ring = &pipe->ring[pipe->first[t + 1] - 1];
+        if (spsc_init(ring, depth, sizeof(uint32_t)) < 0) {
+            pipeline_free(pipe);
+            return -1;
+        }
+        ring_depth = spsc_depth(ring);
+    }
+
+    // Enough blocks to fill every ring with one more in the hands of each thread
+    if (pool_init(&pipe->pool, (uint32_t)((threads - 1) * ring_depth + threads), block_bytes, huge) < 0) {
+        pipeline_free(pipe);
+        return -1;
+    }
+    return 0;
+}
+
+int pipeline_start(Pipeline *pipe, const int *cpus, int ncpus) {
+    atomic_store(&pipe->running, pipe->threads);
+    for (int t = 0; t < pipe->threads; t++) {
+        pipe->args[t].pipe = pipe;
+        pipe->args[t].thread = t;
+
+        // Pin through the creation attributes, so a thread never runs unpinned
+        int status = EINVAL;
+        if (cpus != NULL && t < ncpus && cpus[t] >= 0 && cpus[t] < CPU_SETSIZE) {
+            pthread_attr_t attr;
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            CPU_SET(cpus[t], &set);
+            pthread_attr_init(&attr);
+            pthread_attr_setaffinity_np(&attr, sizeof(set), &set);
+            status = pthread_create(&pipe->ids[t], &attr, thread_main, &pipe->args[t]);
+            pthread_attr_destroy(&attr);
+            if (status == 0) {
+                pipe->cpu[t] = cpus[t];
+            }
+        }
+        if (status != 0) {
+            status = pthread_create(&pipe->ids[t], NULL, thread_main, &pipe->args[t]);
+        }
+        if (status != 0) {
+            atomic_fetch_sub(&pipe->running, pipe->threads - t);
+            atomic_store(&pipe->abort, 1);
+            errno = status;
+            return -1;
+        }
+        pipe->started++;
+    }
+    return 0;
+}
+
+int pipeline_running(Pipeline *pipe) {
+    return atomic_load(&pipe->running) > 0;
+}
+
+int pipeline_join(Pipeline *pipe) {
+    for (int t = 0; t < pipe->started; t++) {
+        pthread_join(pipe->ids[t], NULL);
+    }
+    pipe->started = 0;
+    return atomic_load(&pipe->failed) < 0 ? 0 : -1;
+}
+
+void pipeline_free(Pipeline *pipe) {
+    for (int s = 0; s < PIPELINE_MAX_STAGES; s++) {
+        spsc_free(&pipe->ring[s]);
+    }
+    pool_free(&pipe->pool);
+}
+
+int pipeline_thread_of(const Pipeline *pipe, int stage) {
+    int t = 0;
+    while (t + 1 < pipe->threads && stage >= pipe->first[t + 1]) {
+        t++;
+    }
+    return t;
+}
+
+void pipeline_stats(Pipeline *pipe, int stage, PipelineStageStats *stats) {
+    PipelineCounters *c = &pipe->counters[stage];
+    int ring = stage > 0 && pipe->ring[stage - 1].blocks != NULL;
+
+    stats->blocks = atomic_load_explicit(&c->blocks, memory_order_relaxed);
+    stats->busy = atomic_load_explicit(&c->busy_ns, memory_order_relaxed) * 1e-9;
+    stats->input_stalls = atomic_load_explicit(&c->input_stalls, memory_order_relaxed);
+    stats->input_wait = atomic_load_explicit(&c->input_wait_ns, memory_order_relaxed) * 1e-9;
+    stats->output_stalls = atomic_load_explicit(&c->output_stalls, memory_order_relaxed);
+    stats->output_wait = atomic_load_explicit(&c->output_wait_ns, memory_order_relaxed) * 1e-9;
+    stats->occupancy = stats->blocks > 0
+        ? (double)atomic_load_explicit(&c->occupancy, memory_order_relaxed) / stats->blocks : 0.0;
+    stats->depth = ring ? spsc_depth(&pipe->ring[stage - 1]) : 0;
+}
+
+size_t pipeline_occupancy(Pipeline *pipe, int stage) {
+    if (stage == 0 || pipe->ring[stage - 1].blocks == NULL) {
+        return 0;
+    }
+    return spsc_occupancy(&pipe->ring[stage - 1]);
+}
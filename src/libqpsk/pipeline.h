@@ -0,0 +1,176 @@
+/**
+ * Staged Processing Pipeline
+ *
+ * Runs a chain of stages over fixed-size blocks that every stage works on
+ * in place:
+ *
+ *   pool -> stage 0 -> ring -> stage 1 -> ring -> ... -> stage n-1 -> pool
+ *
+ * Blocks are slots of a pool (see pool.h). The first stage fills a free
+ * slot, every later stage reads and updates the same slot, and the last
+ * one gives it back to the pool; only the slot's handle moves between
+ * stages, so the data is never copied and nothing is allocated while the
+ * pipeline runs.
+ *
+ * The stages are split into contiguous groups, one thread per group,
+ * optionally pinned to a CPU. Groups pass handles through the lock-free
+ * rings of spsc.h. A slow stage fills the ring in front of it and holds
+ * back everything upstream (backpressure), and once every slot is in use
+ * the first stage waits for one to come back, so memory use is fixed.
+ *
+ * A thread that finds its input ring empty or its output ring full spins
+ * briefly and then yields the CPU until the ring changes. Every stage
+ * counts the blocks it processed, the time it spent in its function, how
+ * often and how long it waited on either ring, and how full its input
+ * ring was, so the stage that limits the throughput is the one that is
+ * busy while the others wait.
+ */
+
+#ifndef QPSK_PIPELINE_H
+#define QPSK_PIPELINE_H
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stddef.h>
+
+#include "pool.h"
+#include "spsc.h"
+
+#define PIPELINE_MAX_STAGES 8
+#define PIPELINE_DEFAULT_DEPTH 8     // Blocks per ring
+
+/**
+ * Process one block in place
+ *
+ * @param ctx    The stage's context
+ * @param block  Pool slot (its previous contents for the first stage)
+ * @return 1 when the block was processed, 0 when the first stage has no
+ *         more blocks, -1 on an error that stops the whole pipeline
+ */
+typedef int (*PipelineFn)(void *ctx, void *block);
+
+/**
+ * Description of a stage
+ */
+typedef struct {
+    const char *name;
+    PipelineFn run;
+    void *ctx;
+} PipelineStage;
+
+/**
+ * Counters of a stage, written by its thread only
+ */
+typedef struct {
+    atomic_ullong blocks;
+    atomic_ullong busy_ns;          // Time spent in the stage function
+    atomic_ullong input_stalls;     // Times the input ring (or the pool) was empty
+    atomic_ullong input_wait_ns;
+    atomic_ullong output_stalls;    // Times the output ring was full
+    atomic_ullong output_wait_ns;
+    atomic_ullong occupancy;        // Input ring occupancy summed over the blocks taken
+} PipelineCounters;
+
+/**
+ * Snapshot of a stage's counters
+ */
+typedef struct {
+    unsigned long long blocks;
+    double busy;                    // Seconds in the stage function
+    unsigned long long input_stalls;
+    double input_wait;              // Seconds waiting for input (a free slot for the first stage)
+    unsigned long long output_stalls;
+    double output_wait;             // Seconds waiting for room in the output ring
+    double occupancy;               // Mean input ring occupancy in blocks (0 without a ring)
+    size_t depth;                   // Input ring depth (0 without a ring)
+} PipelineStageStats;
+
+typedef struct Pipeline Pipeline;
+
+/**
+ * Argument of a pipeline thread
+ */
+typedef struct {
+    Pipeline *pipe;
+    int thread;
+} PipelineThread;
+
+/**
+ * Pipeline state
+ */
+struct Pipeline {
+    int stages;
+    int threads;
+    PipelineStage stage[PIPELINE_MAX_STAGES];
+    int first[PIPELINE_MAX_STAGES + 1];     // First stage of each thread, then stages
+    int cpu[PIPELINE_MAX_STAGES];           // CPU each thread is pinned to, -1 for none
+    FramePool pool;                         // Blocks
+    SpscRing ring[PIPELINE_MAX_STAGES];     // Handles from stage i when stage i + 1 is on another thread
+    PipelineCounters counters[PIPELINE_MAX_STAGES];
+    pthread_t ids[PIPELINE_MAX_STAGES];
+    PipelineThread args[PIPELINE_MAX_STAGES];
+    int started;                            // Threads started
+    atomic_int running;                     // Threads not yet finished
+    atomic_int abort;                       // Set on an error to stop every thread
+    atomic_int failed;                      // Stage that returned -1, or -1
+};
+
+/**
+ * Set up a pipeline, its rings and a pool of blocks that fills every ring
+ * with one more block in the hands of each thread
+ *
+ * @param pipe         Pipeline to initialize
+ * @param stages       Stages in order (2 to PIPELINE_MAX_STAGES)
+ * @param count        Number of stages
+ * @param threads      Threads to spread the stages over (clamped to 1..count)
+ * @param depth        Handles per ring (rounded up to a power of two)
+ * @param block_bytes  Size of every block
+ * @param huge         Non-zero to back the pool with huge pages if possible
+ * @return 0 on success, -1 on invalid arguments or allocation failure
+ */
+int pipeline_init(Pipeline *pipe, const PipelineStage *stages, int count, int threads, size_t depth,
+                  size_t block_bytes, int huge);
+
+/**
+ * Start the threads
+ *
+ * @param cpus   CPU for each thread, -1 to leave it unpinned (NULL for none)
+ * @param ncpus  Entries in cpus; threads beyond them are not pinned
+ * @return 0 on success, -1 if a thread cannot be created (the others stop;
+ *         pipeline_join() still has to be called)
+ */
+int pipeline_start(Pipeline *pipe, const int *cpus, int ncpus);
+
+/**
+ * Whether any thread is still running
+ */
+int pipeline_running(Pipeline *pipe);
+
+/**
+ * Wait for every thread to finish
+ *
+ * @return 0 if the first stage ended the stream, -1 if a stage failed
+ */
+int pipeline_join(Pipeline *pipe);
+
+/**
+ * Release the rings and the pool
+ */
+void pipeline_free(Pipeline *pipe);
+
+/**
+ * Thread running a stage
+ */
+int pipeline_thread_of(const Pipeline *pipe, int stage);
+
+/**
+ * Snapshot of a stage's counters (callable while the pipeline runs)
+ */
+void pipeline_stats(Pipeline *pipe, int stage, PipelineStageStats *stats);
+
+/**
+ * Blocks currently waiting in front of a stage (0 without a ring)
+ */
+size_t pipeline_occupancy(Pipeline *pipe, int stage);
+
+#endif /* QPSK_PIPELINE_H */
@@ -0,0 +1,76 @@
+/**
+ * Pool of Fixed-Size Buffers
+ */
+
+#define _GNU_SOURCE
+
+#include <string.h>
+#include <sys/mman.h>
+
+#include "pool.h"
+
+static const char *backing_names[] = {
+    [POOL_PAGES]                  = "pages",
+    [POOL_HUGE_PAGES]             = "huge pages",
+    [POOL_TRANSPARENT_HUGE_PAGES] = "transparent huge pages",
+};
+
+int pool_init(FramePool *pool, uint32_t slots, size_t slot_bytes, int huge) {
+    memset(pool, 0, sizeof(*pool));
+    if (slots == 0) {
+        return -1;
+    }
+    pool->slots = slots;
+    pool->slot_bytes = (slot_bytes + SPSC_CACHE_LINE - 1) & ~(size_t)(SPSC_CACHE_LINE - 1);
+    if (pool->slot_bytes == 0) {
+        pool->slot_bytes = SPSC_CACHE_LINE;
+    }
+    size_t bytes = (size_t)slots * pool->slot_bytes;
+
+    void *base = MAP_FAILED;
+    pool->backing = POOL_PAGES;
+    if (huge) {
+        pool->map_bytes = (bytes + POOL_HUGE_PAGE - 1) & ~(size_t)(POOL_HUGE_PAGE - 1);
+        base = mmap(NULL, pool->map_bytes, PROT_READ | PROT_WRITE,
+                    MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | MAP_POPULATE, -1, 0);
+        pool->backing = POOL_HUGE_PAGES;
+    }
+    if (base == MAP_FAILED) {
+        // No reserved huge pages: ask for transparent ones before the
+        // pages are touched, then fault them in
+        pool->map_bytes = bytes;
+        base = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (base == MAP_FAILED) {
+            return -1;
+        }
+        pool->backing = POOL_PAGES;
+        if (huge && madvise(base, bytes, MADV_HUGEPAGE) == 0) {
+            pool->backing = POOL_TRANSPARENT_HUGE_PAGES;
+        }
+        madvise(base, bytes, MADV_WILLNEED);
+        memset(base, 0, bytes);
+    }
+    pool->base = base;
+
+    if (spsc_init(&pool->free, slots, sizeof(uint32_t)) < 0) {
+        pool_free(pool);
+        return -1;
+    }
+    for (uint32_t h = 0; h < slots; h++) {
+        pool_give(pool, h);
+    }
+    return 0;
+}
+
+void pool_free(FramePool *pool) {
+    if (pool->base != NULL) {
+        munmap(pool->base, pool->map_bytes);
+        pool->base = NULL;
+    }
+    spsc_free(&pool->free);
+}
+
+const char *pool_backing_name(PoolBacking backing) {
+    return (size_t)backing < sizeof(backing_names) / sizeof(backing_names[0])
+        ? backing_names[backing] : "unknown";
+}
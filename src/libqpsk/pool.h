@@ -0,0 +1,101 @@
+/**
+ * Pool of Fixed-Size Buffers
+ *
+ * Preallocates a number of equally sized slots in one mapping, each
+ * starting on a cache line, and hands them out by handle (the slot
+ * number) instead of by allocation. Threads pass handles to each other;
+ * the bytes are never copied and nothing is allocated once the pool is
+ * set up.
+ *
+ * Free handles sit in a ring of spsc.h, so one thread may take slots and
+ * another give them back without locks, e.g. the first and the last stage
+ * of a pipeline. The mapping is prefaulted and zero-filled. It can be
+ * backed by explicit huge pages (MAP_HUGETLB, if the system has reserved
+ * some) or, failing that, by transparent huge pages, which saves TLB
+ * misses when the pool is large.
+ */
+
+#ifndef QPSK_POOL_H
+#define QPSK_POOL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "spsc.h"
+
+#define POOL_HUGE_PAGE (2u << 20)    // Huge page size assumed for rounding
+
+/**
+ * Memory behind a pool
+ */
+typedef enum {
+    POOL_PAGES,                  // Ordinary pages
+    POOL_HUGE_PAGES,             // Explicit huge pages
+    POOL_TRANSPARENT_HUGE_PAGES  // Ordinary mapping advised to use huge pages
+} PoolBacking;
+
+/**
+ * Pool state
+ */
+typedef struct {
+    uint8_t *base;               // First slot
+    size_t map_bytes;            // Length of the mapping
+    size_t slot_bytes;           // Slot size, a multiple of the cache line
+    uint32_t slots;
+    PoolBacking backing;
+    SpscRing free;               // Handles of free slots
+} FramePool;
+
+/**
+ * Map a pool, all slots free
+ *
+ * @param pool        Pool to initialize
+ * @param slots       Number of slots
+ * @param slot_bytes  Minimum size of each slot
+ * @param huge        Non-zero to back the pool with huge pages if possible
+ * @return 0 on success, -1 if the memory cannot be mapped
+ */
+int pool_init(FramePool *pool, uint32_t slots, size_t slot_bytes, int huge);
+
+/**
+ * Unmap the pool
+ */
+void pool_free(FramePool *pool);
+
+/**
+ * Address of a slot
+ */
+static inline void *pool_slot(const FramePool *pool, uint32_t handle) {
+    return pool->base + (size_t)handle * pool->slot_bytes;
+}
+
+/**
+ * Take a free slot (the taking thread only)
+ *
+ * @return 1 with *handle set, or 0 if every slot is in use
+ */
+static inline int pool_take(FramePool *pool, uint32_t *handle) {
+    const uint32_t *h = spsc_front(&pool->free);
+    if (h == NULL) {
+        return 0;
+    }
+    *handle = *h;
+    spsc_release(&pool->free);
+    return 1;
+}
+
+/**
+ * Give a slot back (the returning thread only)
+ */
+static inline void pool_give(FramePool *pool, uint32_t handle) {
+    // The ring holds every handle, so it always has room
+    *(uint32_t *)spsc_reserve(&pool->free) = handle;
+    spsc_publish(&pool->free);
+}
+
+/**
+ * Printable name of a backing
+ */
+const char *pool_backing_name(PoolBacking backing);
+
+#endif /* QPSK_POOL_H */
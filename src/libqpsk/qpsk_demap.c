@@ -0,0 +1,635 @@
+/**
+ * QPSK Demapping
+ *
+ * The SIMD kernels collect the sign bits of eight floats with movemask and
+ * rearrange them into the packed bit order with small bit tricks:
+ *
+ *   planar:      4 I signs and 4 Q signs are spread to bits 6,4,2,0 and 7,5,3,1
+ *   interleaved: the signs of I0,Q0,...,I3,Q3 arrive as lanes 0..7 and only
+ *                the order of the 2-bit pairs needs reversing
+ *
+ * The LLR kernels only scale and reorder (Q before I within each symbol);
+ * the int8 variants clamp in float before converting, so large values
+ * saturate instead of wrapping, and round to nearest like lrintf().
+ */
+
+#include <math.h>
+#include <pthread.h>
+#include <string.h>
+
+#include "qpsk_demap.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define QPSK_X86 1
+#endif
+
+typedef void (*PlanarFn)(const float *in_I, const float *in_Q, size_t symbols, uint8_t *packed);
+typedef void (*InterleavedFn)(const float *in_iq, size_t symbols, uint8_t *packed);
+typedef void (*LlrPlanarFn)(const float *in_I, const float *in_Q, size_t symbols, float scale, float *llr);
+typedef void (*LlrFn)(const float *in_iq, size_t symbols, float scale, float *llr);
+typedef void (*Llr8PlanarFn)(const float *in_I, const float *in_Q, size_t symbols, float scale, int8_t *llr);
+typedef void (*Llr8Fn)(const float *in_iq, size_t symbols, float scale, int8_t *llr);
+typedef void (*MomentsFn)(const float *in_I, const float *in_Q, size_t symbols, double *m2, double *m4);
+typedef void (*MomentsIqFn)(const float *in_iq, size_t symbols, double *m2, double *m4);
+
+#define LLR_MAX 127.0f        // Symmetric int8 saturation limit
+#define MOMENT_CHUNK 1024     // Symbols summed in float before adding to the double totals
+#define SNR_MIN_LINEAR 1e-3   // -30 dB, lowest Es/N0 the estimator reports
+#define SNR_MAX_LINEAR 1e6    // +60 dB, highest Es/N0 the estimator reports
+
+static QpskIsa demap_isa = QPSK_ISA_SCALAR;
+static PlanarFn planar_fn;
+static InterleavedFn interleaved_fn;
+static LlrPlanarFn llr_planar_fn;
+static LlrFn llr_fn;
+static Llr8PlanarFn llr8_planar_fn;
+static Llr8Fn llr8_fn;
+static MomentsFn moments_fn;
+static MomentsIqFn moments_iq_fn;
+
+/**
+ * Move bit k of a 4-bit value to bit 6 - 2k
+ */
+static inline unsigned spread4(unsigned x) {
+    return ((x & 1) << 6) | ((x & 2) << 3) | ((x & 4) >> 0) | ((x & 8) >> 3);
+}
+
+/**
+ * Reverse the order of the four 2-bit pairs in a byte
+ */
+static inline unsigned reverse_pairs(unsigned x) {
+    x = ((x & 0x33) << 2) | ((x >> 2) & 0x33);
+    return ((x & 0x0F) << 4) | (x >> 4);
+}
+
+static inline unsigned sign_bit(float x) {
+    uint32_t u;
+    memcpy(&u, &x, sizeof(u));
+    return u >> 31;
+}
+
+/**
+ * Scalar demapping of symbols [first, symbols); assumes the output byte
+ * holding symbol 'first' has not been started
+ */
+static void planar_tail(const float *in_I, const float *in_Q, size_t first, size_t symbols, uint8_t *packed) {
+    for (size_t j = first; j < symbols; j++) {
+        unsigned shift = 6 - 2 * (j & 3);
+        unsigned bits = (sign_bit(in_Q[j]) << 1) | sign_bit(in_I[j]);
+        if ((j & 3) == 0) {
+            packed[j >> 2] = 0;
+        }
+        packed[j >> 2] |= (uint8_t)(bits << shift);
+    }
+}
+
+static void interleaved_tail(const float *in_iq, size_t first, size_t symbols, uint8_t *packed) {
+    for (size_t j = first; j < symbols; j++) {
+        unsigned shift = 6 - 2 * (j & 3);
+        unsigned bits = (sign_bit(in_iq[2*j + 1]) << 1) | sign_bit(in_iq[2*j]);
+        if ((j & 3) == 0) {
+            packed[j >> 2] = 0;
+        }
+        packed[j >> 2] |= (uint8_t)(bits << shift);
+    }
+}
+
+static void planar_scalar(const float *in_I, const float *in_Q, size_t symbols, uint8_t *packed) {
+    planar_tail(in_I, in_Q, 0, symbols, packed);
+}
+
+static void interleaved_scalar(const float *in_iq, size_t symbols, uint8_t *packed) {
+    interleaved_tail(in_iq, 0, symbols, packed);
+}
+
+static inline int8_t quantize(float x) {
+    x = x > LLR_MAX ? LLR_MAX : (x < -LLR_MAX ? -LLR_MAX : x);
+    return (int8_t)lrintf(x);
+}
+
+/*
+ * Scalar LLR and moment kernels for symbols [first, symbols)
+ */
+
+static void llr_planar_tail(const float *in_I, const float *in_Q, size_t first, size_t symbols,
+                            float scale, float *llr) {
+    for (size_t j = first; j < symbols; j++) {
+        llr[2*j] = scale * in_Q[j];
+        llr[2*j + 1] = scale * in_I[j];
+    }
+}
+
+static void llr_tail(const float *in_iq, size_t first, size_t symbols, float scale, float *llr) {
+    for (size_t j = first; j < symbols; j++) {
+        llr[2*j] = scale * in_iq[2*j + 1];
+        llr[2*j + 1] = scale * in_iq[2*j];
+    }
+}
+
+static void llr8_planar_tail(const float *in_I, const float *in_Q, size_t first, size_t symbols,
+                             float scale, int8_t *llr) {
+    for (size_t j = first; j < symbols; j++) {
+        llr[2*j] = quantize(scale * in_Q[j]);
+        llr[2*j + 1] = quantize(scale * in_I[j]);
+    }
+}
+
+static void llr8_tail(const float *in_iq, size_t first, size_t symbols, float scale, int8_t *llr) {
+    for (size_t j = first; j < symbols; j++) {
+        llr[2*j] = quantize(scale * in_iq[2*j + 1]);
+        llr[2*j + 1] = quantize(scale * in_iq[2*j]);
+    }
+}
+
+static void moments_tail(const float *in_I, const float *in_Q, size_t first, size_t symbols,
+                         double *m2, double *m4) {
+    for (size_t j = first; j < symbols; j++) {
+        double p = (double)in_I[j] * in_I[j] + (double)in_Q[j] * in_Q[j];
+        *m2 += p;
+        *m4 += p * p;
+    }
+}
+
+static void moments_iq_tail(const float *in_iq, size_t first, size_t symbols, double *m2, double *m4) {
+    for (size_t j = first; j < symbols; j++) {
+        double p = (double)in_iq[2*j] * in_iq[2*j] + (double)in_iq[2*j + 1] * in_iq[2*j + 1];
+        *m2 += p;
+        *m4 += p * p;
+    }
+}
+
+static void llr_planar_scalar(const float *in_I, const float *in_Q, size_t symbols, float scale, float *llr) {
+    llr_planar_tail(in_I, in_Q, 0, symbols, scale, llr);
+}
+
+static void llr_scalar(const float *in_iq, size_t symbols, float scale, float *llr) {
+    llr_tail(in_iq, 0, symbols, scale, llr);
+}
+
+static void llr8_planar_scalar(const float *in_I, const float *in_Q, size_t symbols, float scale, int8_t *llr) {
+    llr8_planar_tail(in_I, in_Q, 0, symbols, scale, llr);
+}
+
+static void llr8_scalar(const float *in_iq, size_t symbols, float scale, int8_t *llr) {
+    llr8_tail(in_iq, 0, symbols, scale, llr);
+}
+
+static void moments_scalar(const float *in_I, const float *in_Q, size_t symbols, double *m2, double *m4) {
+    moments_tail(in_I, in_Q, 0, symbols, m2, m4);
+}
+
+static void moments_iq_scalar(const float *in_iq, size_t symbols, double *m2, double *m4) {
+    moments_iq_tail(in_iq, 0, symbols, m2, m4);
+}
+
+#ifdef QPSK_X86
+
+__attribute__((target("sse2")))
+static void planar_sse2(const float *in_I, const float *in_Q, size_t symbols, uint8_t *packed) {
+    size_t j = 0;
+
+    for (; j + 4 <= symbols; j += 4) {
+        unsigned mi = (unsigned)_mm_movemask_ps(_mm_loadu_ps(in_I + j));
+        unsigned mq = (unsigned)_mm_movemask_ps(_mm_loadu_ps(in_Q + j));
+        packed[j >> 2] = (uint8_t)((spread4(mq) << 1) | spread4(mi));
+    }
+    planar_tail(in_I, in_Q, j, symbols, packed);
+}
+
+__attribute__((target("sse2")))
+static void interleaved_sse2(const float *in_iq, size_t symbols, uint8_t *packed) {
+    size_t j = 0;
+
+    for (; j + 4 <= symbols; j += 4) {
+        unsigned lo = (unsigned)_mm_movemask_ps(_mm_loadu_ps(in_iq + 2*j));
+        unsigned hi = (unsigned)_mm_movemask_ps(_mm_loadu_ps(in_iq + 2*j + 4));
+        packed[j >> 2] = (uint8_t)reverse_pairs(lo | (hi << 4));
+    }
+    interleaved_tail(in_iq, j, symbols, packed);
+}
+
+__attribute__((target("sse2")))
+static inline __m128i sse2_quantize(__m128 x) {
+    const __m128 max = _mm_set1_ps(LLR_MAX);
+    x = _mm_min_ps(_mm_max_ps(x, _mm_sub_ps(_mm_setzero_ps(), max)), max);
+    return _mm_cvtps_epi32(x);
+}
+
+__attribute__((target("sse2")))
+static void llr_planar_sse2(const float *in_I, const float *in_Q, size_t symbols, float scale, float *llr) {
+    const __m128 k = _mm_set1_ps(scale);
+    size_t j = 0;
+
+    for (; j + 4 <= symbols; j += 4) {
+        __m128 i = _mm_mul_ps(_mm_loadu_ps(in_I + j), k);
+        __m128 q = _mm_mul_ps(_mm_loadu_ps(in_Q + j), k);
+        _mm_storeu_ps(llr + 2*j, _mm_unpacklo_ps(q, i));
+        _mm_storeu_ps(llr + 2*j + 4, _mm_unpackhi_ps(q, i));
+    }
+    llr_planar_tail(in_I, in_Q, j, symbols, scale, llr);
+}
+
+__attribute__((target("sse2")))
+static void llr_sse2(const float *in_iq, size_t symbols, float scale, float *llr) {
+    const __m128 k = _mm_set1_ps(scale);
+    size_t j = 0;
+
+    for (; j + 2 <= symbols; j += 2) {
+        __m128 x = _mm_mul_ps(_mm_loadu_ps(in_iq + 2*j), k);
+        _mm_storeu_ps(llr + 2*j, _mm_shuffle_ps(x, x, _MM_SHUFFLE(2, 3, 0, 1)));
+    }
+    llr_tail(in_iq, j, symbols, scale, llr);
+}
+
+__attribute__((target("sse2")))
+static void llr8_planar_sse2(const float *in_I, const float *in_Q, size_t symbols, float scale, int8_t *llr) {
+    const __m128 k = _mm_set1_ps(scale);
+    size_t j = 0;
+
+    for (; j + 8 <= symbols; j += 8) {
+        __m128 i0 = _mm_mul_ps(_mm_loadu_ps(in_I + j), k);
+        __m128 q0 = _mm_mul_ps(_mm_loadu_ps(in_Q + j), k);
+        __m128 i1 = _mm_mul_ps(_mm_loadu_ps(in_I + j + 4), k);
+        __m128 q1 = _mm_mul_ps(_mm_loadu_ps(in_Q + j + 4), k);
+        __m128i a = _mm_packs_epi32(sse2_quantize(_mm_unpacklo_ps(q0, i0)),
+                                    sse2_quantize(_mm_unpackhi_ps(q0, i0)));
+        __m128i b = _mm_packs_epi32(sse2_quantize(_mm_unpacklo_ps(q1, i1)),
+                                    sse2_quantize(_mm_unpackhi_ps(q1, i1)));
+        _mm_storeu_si128((__m128i *)(llr + 2*j), _mm_packs_epi16(a, b));
+    }
+    llr8_planar_tail(in_I, in_Q, j, symbols, scale, llr);
+}
+
+__attribute__((target("sse2")))
+static void llr8_sse2(const float *in_iq, size_t symbols, float scale, int8_t *llr) {
+    const __m128 k = _mm_set1_ps(scale);
+    __m128i v[4];
+    size_t j = 0;
+
+    for (; j + 8 <= symbols; j += 8) {
+        for (int t = 0; t < 4; t++) {
+            __m128 x = _mm_mul_ps(_mm_loadu_ps(in_iq + 2*j + 4*t), k);
+            v[t] = sse2_quantize(_mm_shuffle_ps(x, x, _MM_SHUFFLE(2, 3, 0, 1)));
+        }
+        __m128i a = _mm_packs_epi32(v[0], v[1]);
+        __m128i b = _mm_packs_epi32(v[2], v[3]);
+        _mm_storeu_si128((__m128i *)(llr + 2*j), _mm_packs_epi16(a, b));
+    }
+    llr8_tail(in_iq, j, symbols, scale, llr);
+}
+
+__attribute__((target("sse2")))
+static void moments_sse2(const float *in_I, const float *in_Q, size_t symbols, double *m2, double *m4) {
+    size_t j = 0;
+
+    while (j + 4 <= symbols) {
+        size_t end = j + MOMENT_CHUNK < symbols ? j + MOMENT_CHUNK : symbols;
+        __m128 s2 = _mm_setzero_ps(), s4 = _mm_setzero_ps();
+        for (; j + 4 <= end; j += 4) {
+            __m128 i = _mm_loadu_ps(in_I + j);
+            __m128 q = _mm_loadu_ps(in_Q + j);
+            __m128 p = _mm_add_ps(_mm_mul_ps(i, i), _mm_mul_ps(q, q));
+            s2 = _mm_add_ps(s2, p);
+            s4 = _mm_add_ps(s4, _mm_mul_ps(p, p));
+        }
+        float t2[4], t4[4];
+        _mm_storeu_ps(t2, s2);
+        _mm_storeu_ps(t4, s4);
+        *m2 += (double)t2[0] + t2[1] + t2[2] + t2[3];
+        *m4 += (double)t4[0] + t4[1] + t4[2] + t4[3];
+    }
+    moments_tail(in_I, in_Q, j, symbols, m2, m4);
+}
+
+/*
+ * Interleaved moments square two vectors of I/Q pairs and add the even and
+ * odd lanes; the order of the resulting |r|^2 values does not matter.
+ */
+
+__attribute__((target("sse2")))
+static void moments_iq_sse2(const float *in_iq, size_t symbols, double *m2, double *m4) {
+    size_t j = 0;
+
+    while (j + 4 <= symbols) {
+        size_t end = j + MOMENT_CHUNK < symbols ? j + MOMENT_CHUNK : symbols;
+        __m128 s2 = _mm_setzero_ps(), s4 = _mm_setzero_ps();
+        for (; j + 4 <= end; j += 4) {
+            __m128 a = _mm_loadu_ps(in_iq + 2*j);
+            __m128 b = _mm_loadu_ps(in_iq + 2*j + 4);
+            a = _mm_mul_ps(a, a);
+            b = _mm_mul_ps(b, b);
+            __m128 p = _mm_add_ps(_mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0)),
+                                  _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1)));
+            s2 = _mm_add_ps(s2, p);
+            s4 = _mm_add_ps(s4, _mm_mul_ps(p, p));
+        }
+        float t2[4], t4[4];
+        _mm_storeu_ps(t2, s2);
+        _mm_storeu_ps(t4, s4);
+        *m2 += (double)t2[0] + t2[1] + t2[2] + t2[3];
+        *m4 += (double)t4[0] + t4[1] + t4[2] + t4[3];
+    }
+    moments_iq_tail(in_iq, j, symbols, m2, m4);
+}
+
+__attribute__((target("avx2")))
+static void planar_avx2(const float *in_I, const float *in_Q, size_t symbols, uint8_t *packed) {
+    size_t j = 0;
+
+    for (; j + 8 <= symbols; j += 8) {
+        unsigned mi = (unsigned)_mm256_movemask_ps(_mm256_loadu_ps(in_I + j));
+        unsigned mq = (unsigned)_mm256_movemask_ps(_mm256_loadu_ps(in_Q + j));
+        packed[j >> 2] = (uint8_t)((spread4(mq & 15) << 1) | spread4(mi & 15));
+        packed[(j >> 2) + 1] = (uint8_t)((spread4(mq >> 4) << 1) | spread4(mi >> 4));
+    }
+    planar_tail(in_I, in_Q, j, symbols, packed);
+}
+
+__attribute__((target("avx2")))
+static void interleaved_avx2(const float *in_iq, size_t symbols, uint8_t *packed) {
+    size_t j = 0;
+
+    for (; j + 8 <= symbols; j += 8) {
+        unsigned lo = (unsigned)_mm256_movemask_ps(_mm256_loadu_ps(in_iq + 2*j));
+        unsigned hi = (unsigned)_mm256_movemask_ps(_mm256_loadu_ps(in_iq + 2*j + 8));
+        packed[j >> 2] = (uint8_t)reverse_pairs(lo);
+        packed[(j >> 2) + 1] = (uint8_t)reverse_pairs(hi);
+    }
+    interleaved_tail(in_iq, j, symbols, packed);
+}
+
+__attribute__((target("avx2")))
+static inline __m256i avx2_quantize(__m256 x) {
+    const __m256 max = _mm256_set1_ps(LLR_MAX);
+    x = _mm256_min_ps(_mm256_max_ps(x, _mm256_sub_ps(_mm256_setzero_ps(), max)), max);
+    return _mm256_cvtps_epi32(x);
+}
+
+/**
+ * Interleave eight Q and eight I values into Q0,I0,...,Q3,I3 and Q4,I4,...,Q7,I7
+ */
+__attribute__((target("avx2")))
+static inline void avx2_zip(__m256 q, __m256 i, __m256 *lo, __m256 *hi) {
+    __m256 a = _mm256_unpacklo_ps(q, i);
+    __m256 b = _mm256_unpackhi_ps(q, i);
+    *lo = _mm256_permute2f128_ps(a, b, 0x20);
+    *hi = _mm256_permute2f128_ps(a, b, 0x31);
+}
+
+/**
+ * Pack 32 int32 LLRs into bytes in order; packs works per 128-bit lane, so
+ * the 4-byte groups are put back in order with one cross-lane permute
+ */
+__attribute__((target("avx2")))
+static inline void avx2_store8(int8_t *out, __m256i a, __m256i b, __m256i c, __m256i d) {
+    const __m256i order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+    __m256i v = _mm256_packs_epi16(_mm256_packs_epi32(a, b), _mm256_packs_epi32(c, d));
+    _mm256_storeu_si256((__m256i *)out, _mm256_permutevar8x32_epi32(v, order));
+}
+
+__attribute__((target("avx2")))
+static void llr_planar_avx2(const float *in_I, const float *in_Q, size_t symbols, float scale, float *llr) {
+    const __m256 k = _mm256_set1_ps(scale);
+    size_t j = 0;
+
+    for (; j + 8 <= symbols; j += 8) {
+        __m256 lo, hi;
+        avx2_zip(_mm256_mul_ps(_mm256_loadu_ps(in_Q + j), k),
+                 _mm256_mul_ps(_mm256_loadu_ps(in_I + j), k), &lo, &hi);
+        _mm256_storeu_ps(llr + 2*j, lo);
+        _mm256_storeu_ps(llr + 2*j + 8, hi);
+    }
+    llr_planar_tail(in_I, in_Q, j, symbols, scale, llr);
+}
+
+__attribute__((target("avx2")))
+static void llr_avx2(const float *in_iq, size_t symbols, float scale, float *llr) {
+    const __m256 k = _mm256_set1_ps(scale);
+    size_t j = 0;
+
+    for (; j + 4 <= symbols; j += 4) {
+        __m256 x = _mm256_mul_ps(_mm256_loadu_ps(in_iq + 2*j), k);
+        _mm256_storeu_ps(llr + 2*j, _mm256_permute_ps(x, _MM_SHUFFLE(2, 3, 0, 1)));
+    }
+    llr_tail(in_iq, j, symbols, scale, llr);
+}
+
+__attribute__((target("avx2")))
+static void llr8_planar_avx2(const float *in_I, const float *in_Q, size_t symbols, float scale, int8_t *llr) {
+    const __m256 k = _mm256_set1_ps(scale);
+    size_t j = 0;
+
+    for (; j + 16 <= symbols; j += 16) {
+        __m256 a, b, c, d;
+        avx2_zip(_mm256_mul_ps(_mm256_loadu_ps(in_Q + j), k),
+                 _mm256_mul_ps(_mm256_loadu_ps(in_I + j), k), &a, &b);
+        avx2_zip(_mm256_mul_ps(_mm256_loadu_ps(in_Q + j + 8), k),
+                 _mm256_mul_ps(_mm256_loadu_ps(in_I + j + 8), k), &c, &d);
+        avx2_store8(llr + 2*j, avx2_quantize(a), avx2_quantize(b),
+                    avx2_quantize(c), avx2_quantize(d));
+    }
+    llr8_planar_tail(in_I, in_Q, j, symbols, scale, llr);
+}
+
+__attribute__((target("avx2")))
+static void llr8_avx2(const float *in_iq, size_t symbols, float scale, int8_t *llr) {
+    const __m256 k = _mm256_set1_ps(scale);
+    __m256i v[4];
+    size_t j = 0;
+
+    for (; j + 16 <= symbols; j += 16) {
+        for (int t = 0; t < 4; t++) {
+            __m256 x = _mm256_mul_ps(_mm256_loadu_ps(in_iq + 2*j + 8*t), k);
+            v[t] = avx2_quantize(_mm256_permute_ps(x, _MM_SHUFFLE(2, 3, 0, 1)));
+        }
+        avx2_store8(llr + 2*j, v[0], v[1], v[2], v[3]);
+    }
+    llr8_tail(in_iq, j, symbols, scale, llr);
+}
+
+__attribute__((target("avx2")))
+static void moments_avx2(const float *in_I, const float *in_Q, size_t symbols, double *m2, double *m4) {
+    size_t j = 0;
+
+    while (j + 8 <= symbols) {
+        size_t end = j + MOMENT_CHUNK < symbols ? j + MOMENT_CHUNK : symbols;
+        __m256 s2 = _mm256_setzero_ps(), s4 = _mm256_setzero_ps();
+        for (; j + 8 <= end; j += 8) {
+            __m256 i = _mm256_loadu_ps(in_I + j);
+            __m256 q = _mm256_loadu_ps(in_Q + j);
+            __m256 p = _mm256_add_ps(_mm256_mul_ps(i, i), _mm256_mul_ps(q, q));
+            s2 = _mm256_add_ps(s2, p);
+            s4 = _mm256_add_ps(s4, _mm256_mul_ps(p, p));
+        }
+        float t2[8], t4[8];
+        _mm256_storeu_ps(t2, s2);
+        _mm256_storeu_ps(t4, s4);
+        for (int t = 0; t < 8; t++) {
+            *m2 += t2[t];
+            *m4 += t4[t];
+        }
+    }
+    moments_tail(in_I, in_Q, j, symbols, m2, m4);
+}
+
+__attribute__((target("avx2")))
+static void moments_iq_avx2(const float *in_iq, size_t symbols, double *m2, double *m4) {
+    size_t j = 0;
+
+    while (j + 8 <= symbols) {
+        size_t end = j + MOMENT_CHUNK < symbols ? j + MOMENT_CHUNK : symbols;
+        __m256 s2 = _mm256_setzero_ps(), s4 = _mm256_setzero_ps();
+        for (; j + 8 <= end; j += 8) {
+            __m256 a = _mm256_loadu_ps(in_iq + 2*j);
+            __m256 b = _mm256_loadu_ps(in_iq + 2*j + 8);
+            a = _mm256_mul_ps(a, a);
+            b = _mm256_mul_ps(b, b);
+            __m256 p = _mm256_add_ps(_mm256_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0)),
+                                     _mm256_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1)));
+            s2 = _mm256_add_ps(s2, p);
+            s4 = _mm256_add_ps(s4, _mm256_mul_ps(p, p));
+        }
+        float t2[8], t4[8];
+        _mm256_storeu_ps(t2, s2);
+        _mm256_storeu_ps(t4, s4);
+        for (int t = 0; t < 8; t++) {
+            *m2 += t2[t];
+            *m4 += t4[t];
+        }
+    }
+    moments_iq_tail(in_iq, j, symbols, m2, m4);
+}
+
+#endif /* QPSK_X86 */
+
+static void select_isa(QpskIsa isa) {
+    planar_fn = planar_scalar;
+    interleaved_fn = interleaved_scalar;
+    llr_planar_fn = llr_planar_scalar;
+    llr_fn = llr_scalar;
+    llr8_planar_fn = llr8_planar_scalar;
+    llr8_fn = llr8_scalar;
+    moments_fn = moments_scalar;
+    moments_iq_fn = moments_iq_scalar;
+    demap_isa = QPSK_ISA_SCALAR;
+#ifdef QPSK_X86
+    if (isa == QPSK_ISA_AVX2) {
+        planar_fn = planar_avx2;
+        interleaved_fn = interleaved_avx2;
+        llr_planar_fn = llr_planar_avx2;
+        llr_fn = llr_avx2;
+        llr8_planar_fn = llr8_planar_avx2;
+        llr8_fn = llr8_avx2;
+        moments_fn = moments_avx2;
+        moments_iq_fn = moments_iq_avx2;
+        demap_isa = isa;
+    } else if (isa == QPSK_ISA_SSE2) {
+        planar_fn = planar_sse2;
+        interleaved_fn = interleaved_sse2;
+        llr_planar_fn = llr_planar_sse2;
+        llr_fn = llr_sse2;
+        llr8_planar_fn = llr8_planar_sse2;
+        llr8_fn = llr8_sse2;
+        moments_fn = moments_sse2;
+        moments_iq_fn = moments_iq_sse2;
+        demap_isa = isa;
+    }
+#endif
+}
+
+static pthread_once_t dispatch_once = PTHREAD_ONCE_INIT;
+
+static void select_cpu(void) {
+    select_isa(qpsk_cpu_isa());
+}
+
+static inline void ensure_dispatch(void) {
+    pthread_once(&dispatch_once, select_cpu);
+}
+
+void qpsk_demap_hard_planar(const float *in_I, const float *in_Q, size_t symbols, uint8_t *packed) {
+    ensure_dispatch();
+    planar_fn(in_I, in_Q, symbols, packed);
+}
+
+void qpsk_demap_hard(const float *in_iq, size_t symbols, uint8_t *packed) {
+    ensure_dispatch();
+    interleaved_fn(in_iq, symbols, packed);
+}
+
+float qpsk_llr_scale(double signal_power, double noise_var) {
+    // Per-component amplitude a = sqrt(Es / 2)
+    return (float)(4.0 * sqrt(signal_power / 2.0) / noise_var);
+}
+
+void qpsk_demap_llr_planar(const float *in_I, const float *in_Q, size_t symbols, float scale, float *llr) {
+    ensure_dispatch();
+    llr_planar_fn(in_I, in_Q, symbols, scale, llr);
+}
+
+void qpsk_demap_llr(const float *in_iq, size_t symbols, float scale, float *llr) {
+    ensure_dispatch();
+    llr_fn(in_iq, symbols, scale, llr);
+}
+
+void qpsk_demap_llr_int8_planar(const float *in_I, const float *in_Q, size_t symbols, float scale, int8_t *llr) {
+    ensure_dispatch();
+    llr8_planar_fn(in_I, in_Q, symbols, scale, llr);
+}
+
+void qpsk_demap_llr_int8(const float *in_iq, size_t symbols, float scale, int8_t *llr) {
+    ensure_dispatch();
+    llr8_fn(in_iq, symbols, scale, llr);
+}
+
+void qpsk_moments_add(QpskMoments *mom, const float *in_I, const float *in_Q, size_t symbols) {
+    ensure_dispatch();
+    moments_fn(in_I, in_Q, symbols, &mom->m2, &mom->m4);
+    mom->symbols += symbols;
+}
+
+void qpsk_moments_add_iq(QpskMoments *mom, const float *in_iq, size_t symbols) {
+    ensure_dispatch();
+    moments_iq_fn(in_iq, symbols, &mom->m2, &mom->m4);
+    mom->symbols += symbols;
+}
+
+QpskSnr qpsk_snr_from_moments(const QpskMoments *mom) {
+    QpskSnr est = { 0, 0, 0 };
+    if (mom->symbols == 0 || mom->m2 <= 0) {
+        return est;
+    }
+
+    double m2 = mom->m2 / mom->symbols;
+    double m4 = mom->m4 / mom->symbols;
+    double d = 2*m2*m2 - m4;
+    double s = d > 0 ? sqrt(d) : 0;
+
+    // S / (M2 - S) = r  <=>  S = M2 r / (1 + r)
+    double s_min = m2 * SNR_MIN_LINEAR / (1.0 + SNR_MIN_LINEAR);
+    double s_max = m2 * SNR_MAX_LINEAR / (1.0 + SNR_MAX_LINEAR);
+    s = s < s_min ? s_min : (s > s_max ? s_max : s);
+
+    est.signal_power = s;
+    est.noise_var = m2 - s;
+    est.esn0_db = 10.0 * log10(est.signal_power / est.noise_var);
+    return est;
+}
+
+QpskSnr qpsk_estimate_snr(const float *in_I, const float *in_Q, size_t symbols) {
+    QpskMoments mom = { 0, 0, 0 };
+    qpsk_moments_add(&mom, in_I, in_Q, symbols);
+    return qpsk_snr_from_moments(&mom);
+}
+
+QpskIsa qpsk_demap_isa(void) {
+    ensure_dispatch();
+    return demap_isa;
+}
+
+QpskIsa qpsk_demap_set_isa(QpskIsa isa) {
+    ensure_dispatch();
+    select_isa(qpsk_cpu_clamp_isa(isa));
+    return demap_isa;
+}
@@ -0,0 +1,153 @@
+/**
+ * QPSK Demapping
+ *
+ * Inverse of the Gray mapping in qpsk_map.h. Because bit1 only flips the
+ * sign of Q and bit2 only flips the sign of I, the hard decision for each
+ * bit is just the sign of one component:
+ *
+ *   bit1 = (Q < 0), bit2 = (I < 0)
+ *
+ * Decisions are written as packed bytes in the same layout the packed
+ * mappers read (four symbols per byte, most significant bits first). The
+ * kernels use AVX2 or SSE2 sign masks when available.
+ *
+ * Soft decisions are log-likelihood ratios, LLR = ln P(bit = 0) / P(bit = 1),
+ * positive for a 0 bit. With the same Gray mapping and Gaussian noise of
+ * variance N0 / 2 per component the exact LLRs of both bits are linear:
+ *
+ *   LLR(bit1) = 4a Q / N0,  LLR(bit2) = 4a I / N0
+ *
+ * where a is the per-component amplitude (1/√2 for unit-energy symbols).
+ * They are written two per symbol in bit order, bit1 then bit2, as floats
+ * or as saturated int8. The Es/N0 needed for the scale can be estimated
+ * from the received block itself with the M2M4 moment estimator.
+ */
+
+#ifndef QPSK_DEMAP_H
+#define QPSK_DEMAP_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "cpu.h"
+
+/**
+ * Hard-decision demapping of separate real and imaginary arrays
+ *
+ * @param in_I     Received real parts
+ * @param in_Q     Received imaginary parts
+ * @param symbols  Number of symbols
+ * @param packed   Output bits, (symbols + 3) / 4 bytes; unused low bits of
+ *                 the last byte are cleared
+ */
+void qpsk_demap_hard_planar(const float *in_I, const float *in_Q, size_t symbols, uint8_t *packed);
+
+/**
+ * Hard-decision demapping of interleaved I0,Q0,I1,Q1,... samples
+ *
+ * @param in_iq    Received samples, 2 * symbols floats
+ * @param symbols  Number of symbols
+ * @param packed   Output bits, (symbols + 3) / 4 bytes
+ */
+void qpsk_demap_hard(const float *in_iq, size_t symbols, uint8_t *packed);
+
+/**
+ * LLR scale factor 4a / N0 for a signal power (Es) and noise variance (N0)
+ *
+ * @param signal_power  Received symbol energy, 1 for the transmitters' symbols
+ * @param noise_var     Complex noise variance N0 (I and Q each get N0 / 2)
+ */
+float qpsk_llr_scale(double signal_power, double noise_var);
+
+/**
+ * Float LLRs from separate real and imaginary arrays
+ *
+ * @param in_I     Received real parts
+ * @param in_Q     Received imaginary parts
+ * @param symbols  Number of symbols
+ * @param scale    Scale factor from qpsk_llr_scale()
+ * @param llr      Output, 2 * symbols values: bit1, bit2 of each symbol
+ */
+void qpsk_demap_llr_planar(const float *in_I, const float *in_Q, size_t symbols, float scale, float *llr);
+
+/**
+ * Float LLRs from interleaved I0,Q0,I1,Q1,... samples
+ */
+void qpsk_demap_llr(const float *in_iq, size_t symbols, float scale, float *llr);
+
+/**
+ * Saturated int8 LLRs from separate real and imaginary arrays
+ *
+ * Values are round(LLR * steps) clamped to [-127, 127], so the range stays
+ * symmetric for decoders that negate LLRs.
+ *
+ * @param in_I     Received real parts
+ * @param in_Q     Received imaginary parts
+ * @param symbols  Number of symbols
+ * @param scale    Scale factor from qpsk_llr_scale() times steps per unit LLR
+ * @param llr      Output, 2 * symbols values: bit1, bit2 of each symbol
+ */
+void qpsk_demap_llr_int8_planar(const float *in_I, const float *in_Q, size_t symbols, float scale, int8_t *llr);
+
+/**
+ * Saturated int8 LLRs from interleaved I0,Q0,I1,Q1,... samples
+ */
+void qpsk_demap_llr_int8(const float *in_iq, size_t symbols, float scale, int8_t *llr);
+
+/**
+ * Running second and fourth moments of |r| over received symbols
+ */
+typedef struct {
+    double m2;                  // Sum of |r|^2
+    double m4;                  // Sum of |r|^4
+    unsigned long long symbols;
+} QpskMoments;
+
+/**
+ * Signal and noise estimate
+ */
+typedef struct {
+    double signal_power;        // Es
+    double noise_var;           // N0
+    double esn0_db;             // 10 log10(Es / N0)
+} QpskSnr;
+
+/**
+ * Add a block of received symbols to the moments (start from all zeros)
+ */
+void qpsk_moments_add(QpskMoments *mom, const float *in_I, const float *in_Q, size_t symbols);
+
+/**
+ * Add a block of interleaved I/Q symbols to the moments
+ */
+void qpsk_moments_add_iq(QpskMoments *mom, const float *in_iq, size_t symbols);
+
+/**
+ * M2M4 estimate of Es and N0 for a constant-modulus signal in complex AWGN
+ *
+ * Uses E|r|^2 = S + N and E|r|^4 = S^2 + 4SN + 2N^2, which gives
+ * S = sqrt(2 M2^2 - M4) and N = M2 - S without making decisions, so it
+ * stays unbiased at low SNR where decision-directed estimates break down.
+ * Sampling noise in short blocks can push 2 M2^2 - M4 below zero, so the
+ * result is clamped to Es/N0 between -30 and +60 dB.
+ */
+QpskSnr qpsk_snr_from_moments(const QpskMoments *mom);
+
+/**
+ * Estimate Es and N0 over one block of received symbols
+ */
+QpskSnr qpsk_estimate_snr(const float *in_I, const float *in_Q, size_t symbols);
+
+/**
+ * Instruction set used by the demappers (detected on first use)
+ */
+QpskIsa qpsk_demap_isa(void);
+
+/**
+ * Override the detected instruction set (clamped to what the CPU supports)
+ *
+ * @return The instruction set actually selected
+ */
+QpskIsa qpsk_demap_set_isa(QpskIsa isa);
+
+#endif /* QPSK_DEMAP_H */
@@ -0,0 +1,35 @@
+/**
+ * QPSK Symbol Mapping
+ *
+ * Table-driven implementation of the Gray-coded QPSK mapping.
+ */
+
+#include "qpsk_map.h"
+
+const Complex qpsk_constellation[4] = {
+    {  QPSK_AMPLITUDE,  QPSK_AMPLITUDE },  // 00
+    { -QPSK_AMPLITUDE,  QPSK_AMPLITUDE },  // 01
+    {  QPSK_AMPLITUDE, -QPSK_AMPLITUDE },  // 10
+    { -QPSK_AMPLITUDE, -QPSK_AMPLITUDE },  // 11
+};
+
+/**
+ * Constellation index for the bit pair starting at bits[0]
+ */
+static inline unsigned symbol_index(const int *bits) {
+    return ((unsigned)(bits[0] & 1) << 1) | (unsigned)(bits[1] & 1);
+}
+
+void qpsk_modulate(const int *bits, size_t symbols, double *out_I, double *out_Q) {
+    for (size_t j = 0; j < symbols; j++) {
+        const Complex *point = &qpsk_constellation[symbol_index(bits + 2*j)];
+        out_I[j] = point->real;
+        out_Q[j] = point->imag;
+    }
+}
+
+void qpsk_modulate_complex(const int *bits, size_t symbols, Complex *out) {
+    for (size_t j = 0; j < symbols; j++) {
+        out[j] = qpsk_constellation[symbol_index(bits + 2*j)];
+    }
+}
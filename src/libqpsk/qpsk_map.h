@@ -0,0 +1,106 @@
+/**
+ * QPSK Symbol Mapping
+ *
+ * Shared bit-to-symbol mapping used by every program in the project.
+ * Pairs of bits are mapped with Gray coding to minimize bit errors:
+ *
+ *   00 -> (+1/√2, +1/√2)  | First quadrant
+ *   01 -> (-1/√2, +1/√2)  | Second quadrant
+ *   10 -> (+1/√2, -1/√2)  | Fourth quadrant
+ *   11 -> (-1/√2, -1/√2)  | Third quadrant
+ *
+ * The mapping is a table lookup indexed by (bit1 << 1) | bit2, so there is
+ * no branching per symbol. All functions work on caller-provided buffers of
+ * any length.
+ *
+ * Packed input holds four symbols per byte, most significant bits first:
+ * symbol k of a byte uses bit (7 - 2k) as bit1 and bit (6 - 2k) as bit2.
+ * The packed mappers use AVX2 or SSE2 when the CPU supports them, selected
+ * once at runtime, and produce exactly the same floats as the table.
+ */
+
+#ifndef QPSK_MAP_H
+#define QPSK_MAP_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "cpu.h"
+
+#define QPSK_AMPLITUDE 0.70710678118654752440  // 1/√2, unit symbol energy
+
+/**
+ * Structure to represent a complex number with real and imaginary parts
+ */
+typedef struct {
+    double real;
+    double imag;
+} Complex;
+
+/**
+ * Constellation points indexed by (bit1 << 1) | bit2
+ */
+extern const Complex qpsk_constellation[4];
+
+/**
+ * Map pairs of bits to QPSK symbols with separate real and imaginary outputs
+ *
+ * @param bits     Input bits (0 or 1), two per symbol
+ * @param symbols  Number of symbols to produce (reads 2 * symbols bits)
+ * @param out_I    Output array of real parts
+ * @param out_Q    Output array of imaginary parts
+ */
+void qpsk_modulate(const int *bits, size_t symbols, double *out_I, double *out_Q);
+
+/**
+ * Map pairs of bits to QPSK symbols as complex numbers
+ *
+ * @param bits     Input bits (0 or 1), two per symbol
+ * @param symbols  Number of symbols to produce (reads 2 * symbols bits)
+ * @param out      Output array of symbols
+ */
+void qpsk_modulate_complex(const int *bits, size_t symbols, Complex *out);
+
+/**
+ * Read bit i (0-based, most significant bit of each byte first) of a packed stream
+ */
+static inline int qpsk_packed_bit(const uint8_t *packed, size_t i) {
+    return (packed[i >> 3] >> (7 - (i & 7))) & 1;
+}
+
+/**
+ * Map packed bits to interleaved float samples I0,Q0,I1,Q1,...
+ *
+ * @param packed   Input bytes, four symbols per byte
+ * @param symbols  Number of symbols to produce (reads (symbols + 3) / 4 bytes)
+ * @param out_iq   Output array of 2 * symbols floats
+ */
+void qpsk_map_packed(const uint8_t *packed, size_t symbols, float *out_iq);
+
+/**
+ * Map packed bits to separate float arrays of real and imaginary parts
+ *
+ * @param packed   Input bytes, four symbols per byte
+ * @param symbols  Number of symbols to produce (reads (symbols + 3) / 4 bytes)
+ * @param out_I    Output array of real parts
+ * @param out_Q    Output array of imaginary parts
+ */
+void qpsk_map_packed_planar(const uint8_t *packed, size_t symbols, float *out_I, float *out_Q);
+
+/**
+ * Instruction set used by the packed mappers (detected on first use)
+ */
+QpskIsa qpsk_map_isa(void);
+
+/**
+ * Override the detected instruction set, e.g. to compare implementations
+ *
+ * Requests for an instruction set the CPU lacks fall back to the best one
+ * available.
+ *
+ * @param isa  Instruction set to use from now on
+ * @return The instruction set actually selected
+ */
+QpskIsa qpsk_map_set_isa(QpskIsa isa);
+
+#endif /* QPSK_MAP_H */
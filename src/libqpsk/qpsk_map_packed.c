@@ -0,0 +1,249 @@
+/**
+ * Packed-Bit QPSK Mapping
+ *
+ * Maps a packed bit stream (four symbols per byte) to float I/Q samples.
+ * The SIMD kernels never branch on data: each output float is the constant
+ * 1/√2 with its sign bit taken directly from the corresponding input bit,
+ * which is why they agree bit for bit with the scalar table lookup.
+ *
+ * Input bit positions per output float:
+ *   interleaved I0,Q0,I1,Q1,I2,Q2,I3,Q3 <- bits 6,7,4,5,2,3,0,1
+ *   planar      I0..I3 <- bits 6,4,2,0   Q0..Q3 <- bits 7,5,3,1
+ */
+
+#include <pthread.h>
+#include <string.h>
+
+#include "qpsk_map.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define QPSK_X86 1
+#endif
+
+#define AMP ((float)QPSK_AMPLITUDE)
+
+typedef void (*MapFn)(const uint8_t *packed, size_t symbols, float *out_iq);
+typedef void (*PlanarFn)(const uint8_t *packed, size_t symbols, float *out_I, float *out_Q);
+
+static const float lut_I[4] = { AMP, -AMP,  AMP, -AMP };
+static const float lut_Q[4] = { AMP,  AMP, -AMP, -AMP };
+
+static QpskIsa map_isa = QPSK_ISA_SCALAR;
+static MapFn map_fn;
+static PlanarFn planar_fn;
+
+/**
+ * Constellation index of symbol j in a packed stream
+ */
+static inline unsigned packed_index(const uint8_t *packed, size_t j) {
+    return (packed[j >> 2] >> (6 - 2 * (j & 3))) & 3;
+}
+
+/**
+ * Scalar mapping of symbols [first, symbols) to interleaved output
+ */
+static void map_tail(const uint8_t *packed, size_t first, size_t symbols, float *out_iq) {
+    for (size_t j = first; j < symbols; j++) {
+        unsigned idx = packed_index(packed, j);
+        out_iq[2*j] = lut_I[idx];
+        out_iq[2*j + 1] = lut_Q[idx];
+    }
+}
+
+/**
+ * Scalar mapping of symbols [first, symbols) to planar output
+ */
+static void planar_tail(const uint8_t *packed, size_t first, size_t symbols, float *out_I, float *out_Q) {
+    for (size_t j = first; j < symbols; j++) {
+        unsigned idx = packed_index(packed, j);
+        out_I[j] = lut_I[idx];
+        out_Q[j] = lut_Q[idx];
+    }
+}
+
+static void map_scalar(const uint8_t *packed, size_t symbols, float *out_iq) {
+    map_tail(packed, 0, symbols, out_iq);
+}
+
+static void planar_scalar(const uint8_t *packed, size_t symbols, float *out_I, float *out_Q) {
+    planar_tail(packed, 0, symbols, out_I, out_Q);
+}
+
+#ifdef QPSK_X86
+
+/*
+ * SSE2 has no per-lane variable shift, so each lane tests its bit with a
+ * mask and turns the comparison result into a sign bit. Four input bytes
+ * are broadcast at once and the masks are moved up by 8 bits per byte.
+ */
+
+__attribute__((target("sse2")))
+static inline __m128 sse2_signed(__m128i word, __m128i mask) {
+    const __m128i sign = _mm_set1_epi32((int)0x80000000u);
+    __m128i hit = _mm_cmpeq_epi32(_mm_and_si128(word, mask), mask);
+    return _mm_or_ps(_mm_set1_ps(AMP), _mm_castsi128_ps(_mm_and_si128(hit, sign)));
+}
+
+__attribute__((target("sse2")))
+static void map_sse2(const uint8_t *packed, size_t symbols, float *out_iq) {
+    const __m128i lo = _mm_setr_epi32(1 << 6, 1 << 7, 1 << 4, 1 << 5);
+    const __m128i hi = _mm_setr_epi32(1 << 2, 1 << 3, 1 << 0, 1 << 1);
+    size_t bytes = symbols / 4, b = 0;
+
+    for (; b + 4 <= bytes; b += 4) {
+        uint32_t w;
+        memcpy(&w, packed + b, sizeof(w));
+        __m128i v = _mm_set1_epi32((int)w);
+        float *out = out_iq + 8*b;
+        for (int k = 0; k < 4; k++) {
+            _mm_storeu_ps(out + 8*k, sse2_signed(v, lo));
+            _mm_storeu_ps(out + 8*k + 4, sse2_signed(v, hi));
+            v = _mm_srli_epi32(v, 8);
+        }
+    }
+    for (; b < bytes; b++) {
+        __m128i v = _mm_set1_epi32(packed[b]);
+        _mm_storeu_ps(out_iq + 8*b, sse2_signed(v, lo));
+        _mm_storeu_ps(out_iq + 8*b + 4, sse2_signed(v, hi));
+    }
+    map_tail(packed, bytes * 4, symbols, out_iq);
+}
+
+__attribute__((target("sse2")))
+static void planar_sse2(const uint8_t *packed, size_t symbols, float *out_I, float *out_Q) {
+    const __m128i mask_I = _mm_setr_epi32(1 << 6, 1 << 4, 1 << 2, 1 << 0);
+    const __m128i mask_Q = _mm_setr_epi32(1 << 7, 1 << 5, 1 << 3, 1 << 1);
+    size_t bytes = symbols / 4, b = 0;
+
+    for (; b + 4 <= bytes; b += 4) {
+        uint32_t w;
+        memcpy(&w, packed + b, sizeof(w));
+        __m128i v = _mm_set1_epi32((int)w);
+        for (int k = 0; k < 4; k++) {
+            _mm_storeu_ps(out_I + 4*(b + k), sse2_signed(v, mask_I));
+            _mm_storeu_ps(out_Q + 4*(b + k), sse2_signed(v, mask_Q));
+            v = _mm_srli_epi32(v, 8);
+        }
+    }
+    for (; b < bytes; b++) {
+        __m128i v = _mm_set1_epi32(packed[b]);
+        _mm_storeu_ps(out_I + 4*b, sse2_signed(v, mask_I));
+        _mm_storeu_ps(out_Q + 4*b, sse2_signed(v, mask_Q));
+    }
+    planar_tail(packed, bytes * 4, symbols, out_I, out_Q);
+}
+
+/*
+ * AVX2 shifts every lane left so that its input bit lands in the float
+ * sign position (bit 31), then merges it with the 1/√2 magnitude.
+ */
+
+__attribute__((target("avx2")))
+static inline __m256 avx2_signed(__m256i word, __m256i shift) {
+    const __m256i sign = _mm256_set1_epi32((int)0x80000000u);
+    __m256i bit = _mm256_and_si256(_mm256_sllv_epi32(word, shift), sign);
+    return _mm256_or_ps(_mm256_set1_ps(AMP), _mm256_castsi256_ps(bit));
+}
+
+__attribute__((target("avx2")))
+static void map_avx2(const uint8_t *packed, size_t symbols, float *out_iq) {
+    // Shift = 31 - bit position, bit positions 6,7,4,5,2,3,0,1
+    const __m256i shift = _mm256_setr_epi32(25, 24, 27, 26, 29, 28, 31, 30);
+    const __m256i byte_step = _mm256_set1_epi32(8);
+    size_t bytes = symbols / 4, b = 0;
+
+    for (; b + 4 <= bytes; b += 4) {
+        uint32_t w;
+        memcpy(&w, packed + b, sizeof(w));
+        __m256i v = _mm256_set1_epi32((int)w);
+        __m256i s1 = _mm256_sub_epi32(shift, byte_step);
+        __m256i s2 = _mm256_sub_epi32(s1, byte_step);
+        __m256i s3 = _mm256_sub_epi32(s2, byte_step);
+        float *out = out_iq + 8*b;
+        _mm256_storeu_ps(out, avx2_signed(v, shift));
+        _mm256_storeu_ps(out + 8, avx2_signed(v, s1));
+        _mm256_storeu_ps(out + 16, avx2_signed(v, s2));
+        _mm256_storeu_ps(out + 24, avx2_signed(v, s3));
+    }
+    for (; b < bytes; b++) {
+        _mm256_storeu_ps(out_iq + 8*b, avx2_signed(_mm256_set1_epi32(packed[b]), shift));
+    }
+    map_tail(packed, bytes * 4, symbols, out_iq);
+}
+
+__attribute__((target("avx2")))
+static void planar_avx2(const uint8_t *packed, size_t symbols, float *out_I, float *out_Q) {
+    // Two bytes per vector: bit positions 6,4,2,0 then 14,12,10,8 (I) and 7,5,3,1 then 15,13,11,9 (Q)
+    const __m256i shift_I = _mm256_setr_epi32(25, 27, 29, 31, 17, 19, 21, 23);
+    const __m256i shift_Q = _mm256_setr_epi32(24, 26, 28, 30, 16, 18, 20, 22);
+    const __m256i pair_step = _mm256_set1_epi32(16);
+    size_t bytes = symbols / 4, b = 0;
+
+    for (; b + 4 <= bytes; b += 4) {
+        uint32_t w;
+        memcpy(&w, packed + b, sizeof(w));
+        __m256i v = _mm256_set1_epi32((int)w);
+        size_t j = 4*b;
+        _mm256_storeu_ps(out_I + j, avx2_signed(v, shift_I));
+        _mm256_storeu_ps(out_Q + j, avx2_signed(v, shift_Q));
+        _mm256_storeu_ps(out_I + j + 8, avx2_signed(v, _mm256_sub_epi32(shift_I, pair_step)));
+        _mm256_storeu_ps(out_Q + j + 8, avx2_signed(v, _mm256_sub_epi32(shift_Q, pair_step)));
+    }
+    planar_tail(packed, b * 4, symbols, out_I, out_Q);
+}
+
+#endif /* QPSK_X86 */
+
+/**
+ * Point the dispatch table at the kernels for one instruction set
+ */
+static void select_isa(QpskIsa isa) {
+    map_fn = map_scalar;
+    planar_fn = planar_scalar;
+    map_isa = QPSK_ISA_SCALAR;
+#ifdef QPSK_X86
+    if (isa == QPSK_ISA_AVX2) {
+        map_fn = map_avx2;
+        planar_fn = planar_avx2;
+        map_isa = isa;
+    } else if (isa == QPSK_ISA_SSE2) {
+        map_fn = map_sse2;
+        planar_fn = planar_sse2;
+        map_isa = isa;
+    }
+#endif
+}
+
+static pthread_once_t dispatch_once = PTHREAD_ONCE_INIT;
+
+static void select_cpu(void) {
+    select_isa(qpsk_cpu_isa());
+}
+
+// Threads may make their first calls at the same time; pthread_once has
+// them all wait until every pointer is set
+static inline void ensure_dispatch(void) {
+    pthread_once(&dispatch_once, select_cpu);
+}
+
+void qpsk_map_packed(const uint8_t *packed, size_t symbols, float *out_iq) {
+    ensure_dispatch();
+    map_fn(packed, symbols, out_iq);
+}
+
+void qpsk_map_packed_planar(const uint8_t *packed, size_t symbols, float *out_I, float *out_Q) {
+    ensure_dispatch();
+    planar_fn(packed, symbols, out_I, out_Q);
+}
+
+QpskIsa qpsk_map_isa(void) {
+    ensure_dispatch();
+    return map_isa;
+}
+
+QpskIsa qpsk_map_set_isa(QpskIsa isa) {
+    ensure_dispatch();
+    select_isa(qpsk_cpu_clamp_isa(isa));
+    return map_isa;
+}
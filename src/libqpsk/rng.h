@@ -0,0 +1,73 @@
+/**
+ * Pseudo-Random Number Generator
+ *
+ * xoshiro256** (Blackman & Vigna): 256 bits of state, 64 random bits per
+ * call in a handful of instructions and a period of 2^256 - 1. Unlike
+ * rand() every generator owns its state, so threads never contend on a
+ * shared lock; rng_jump() splits one seed into non-overlapping streams.
+ */
+
+#ifndef QPSK_RNG_H
+#define QPSK_RNG_H
+
+#include <stdint.h>
+
+/**
+ * Generator state (must not be all zero; use rng_seed())
+ */
+typedef struct {
+    uint64_t s[4];
+} Rng;
+
+/**
+ * Initialize the generator from a 64-bit seed
+ *
+ * @param rng   Generator to initialize
+ * @param seed  Any value, including 0
+ */
+void rng_seed(Rng *rng, uint64_t seed);
+
+/**
+ * Advance the generator by 2^128 steps
+ *
+ * Calling this k times on copies of one seeded generator gives k streams
+ * that cannot overlap in practice, e.g. one per thread.
+ */
+void rng_jump(Rng *rng);
+
+static inline uint64_t rng_rotl(uint64_t x, int k) {
+    return (x << k) | (x >> (64 - k));
+}
+
+/**
+ * Next 64 random bits
+ */
+static inline uint64_t rng_next(Rng *rng) {
+    uint64_t *s = rng->s;
+    uint64_t result = rng_rotl(s[1] * 5, 7) * 9;
+    uint64_t t = s[1] << 17;
+
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = rng_rotl(s[3], 45);
+    return result;
+}
+
+/**
+ * Uniform double in [0, 1)
+ */
+static inline double rng_uniform(Rng *rng) {
+    return (rng_next(rng) >> 11) * 0x1.0p-53;
+}
+
+/**
+ * Uniform double in (0, 1), safe to pass to log()
+ */
+static inline double rng_uniform_open(Rng *rng) {
+    return ((rng_next(rng) >> 11) + 0.5) * 0x1.0p-53;
+}
+
+#endif /* QPSK_RNG_H */
@@ -0,0 +1,326 @@
+/**
+ * Root-Raised-Cosine Pulse Shaping
+ *
+ * Both filters see their input as one stream made of the history followed
+ * by the new samples. Outputs whose window starts in the history are
+ * computed from a staging copy of the history and the first few inputs;
+ * all later windows lie inside the caller's buffer and are read in place,
+ * so only about one pulse length is copied per call.
+ */
+
+#include <math.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "rrc.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define QPSK_X86 1
+#endif
+
+typedef void (*InterpFn)(const float *x, size_t count, const float *bank, int taps, int sps, float *out);
+typedef void (*DecimFn)(const float *x, size_t count, int step, const float *coef, int window, float *out);
+
+static QpskIsa rrc_isa_used = QPSK_ISA_SCALAR;
+static InterpFn interp_fn;
+static DecimFn decim_fn;
+
+/**
+ * Root-raised-cosine impulse response at t symbol periods from its centre
+ */
+static double rrc_pulse(double t, double beta) {
+    if (fabs(t) < 1e-9) {
+        return 1.0 - beta + 4.0 * beta / M_PI;
+    }
+    if (fabs(fabs(t) - 1.0 / (4.0 * beta)) < 1e-9) {
+        return beta / sqrt(2.0) * ((1.0 + 2.0 / M_PI) * sin(M_PI / (4.0 * beta))
+                                   + (1.0 - 2.0 / M_PI) * cos(M_PI / (4.0 * beta)));
+    }
+    double x = 4.0 * beta * t;
+    return (sin(M_PI * t * (1.0 - beta)) + x * cos(M_PI * t * (1.0 + beta)))
+         / (M_PI * t * (1.0 - x * x));
+}
+
+/**
+ * Interpolate: output phase p of symbol k is the dot product of branch p
+ * with the taps symbols of the window starting at x + 2k
+ */
+static void interp_scalar(const float *x, size_t count, const float *bank, int taps, int sps, float *out) {
+    for (size_t k = 0; k < count; k++, x += 2) {
+        for (int p = 0; p < sps; p++, out += 2) {
+            const float *b = bank + (size_t)p * taps;
+            float i = 0.0f, q = 0.0f;
+            for (int j = 0; j < taps; j++) {
+                i += x[2*j] * b[j];
+                q += x[2*j + 1] * b[j];
+            }
+            out[0] = i;
+            out[1] = q;
+        }
+    }
+}
+
+/**
+ * Matched filter: output j is the dot product of the taps with the window
+ * starting at x + 2 * j * step
+ */
+static void decim_scalar(const float *x, size_t count, int step, const float *coef, int window, float *out) {
+    for (size_t j = 0; j < count; j++, x += 2 * (size_t)step, out += 2) {
+        float i = 0.0f, q = 0.0f;
+        for (int m = 0; m < window; m++) {
+            i += x[2*m] * coef[2*m];
+            q += x[2*m + 1] * coef[2*m + 1];
+        }
+        out[0] = i;
+        out[1] = q;
+    }
+}
+
+#ifdef QPSK_X86
+
+__attribute__((target("sse2")))
+static void interp_sse2(const float *x, size_t count, const float *bank, int taps, int sps, float *out) {
+    size_t k = 0;
+    for (; k + 2 <= count; k += 2) {
+        for (int p = 0; p < sps; p++) {
+            const float *b = bank + (size_t)p * taps;
+            __m128 acc = _mm_setzero_ps();
+            for (int j = 0; j < taps; j++) {
+                acc = _mm_add_ps(acc, _mm_mul_ps(_mm_loadu_ps(x + 2 * (k + j)), _mm_set1_ps(b[j])));
+            }
+            _mm_storel_pi((__m64 *)(out + 2 * (k * sps + p)), acc);
+            _mm_storeh_pi((__m64 *)(out + 2 * ((k + 1) * sps + p)), acc);
+        }
+    }
+    interp_scalar(x + 2*k, count - k, bank, taps, sps, out + 2 * k * sps);
+}
+
+__attribute__((target("sse2")))
+static void decim_sse2(const float *x, size_t count, int step, const float *coef, int window, float *out) {
+    for (size_t j = 0; j < count; j++, x += 2 * (size_t)step, out += 2) {
+        __m128 a = _mm_setzero_ps(), b = _mm_setzero_ps();
+        for (int m = 0; m < window; m += 4) {
+            a = _mm_add_ps(a, _mm_mul_ps(_mm_loadu_ps(x + 2*m), _mm_load_ps(coef + 2*m)));
+            b = _mm_add_ps(b, _mm_mul_ps(_mm_loadu_ps(x + 2*m + 4), _mm_load_ps(coef + 2*m + 4)));
+        }
+        a = _mm_add_ps(a, b);
+        a = _mm_add_ps(a, _mm_movehl_ps(a, a));
+        _mm_storel_pi((__m64 *)out, a);
+    }
+}
+
+__attribute__((target("avx2")))
+static void interp_avx2(const float *x, size_t count, const float *bank, int taps, int sps, float *out) {
+    size_t k = 0;
+    for (; k + 4 <= count; k += 4) {
+        for (int p = 0; p < sps; p++) {
+            const float *b = bank + (size_t)p * taps;
+            __m256 acc = _mm256_setzero_ps();
+            for (int j = 0; j < taps; j++) {
+                acc = _mm256_add_ps(acc, _mm256_mul_ps(_mm256_loadu_ps(x + 2 * (k + j)),
+                                                       _mm256_set1_ps(b[j])));
+            }
+            __m128 lo = _mm256_castps256_ps128(acc);
+            __m128 hi = _mm256_extractf128_ps(acc, 1);
+            _mm_storel_pi((__m64 *)(out + 2 * (k * sps + p)), lo);
+            _mm_storeh_pi((__m64 *)(out + 2 * ((k + 1) * sps + p)), lo);
+            _mm_storel_pi((__m64 *)(out + 2 * ((k + 2) * sps + p)), hi);
+            _mm_storeh_pi((__m64 *)(out + 2 * ((k + 3) * sps + p)), hi);
+        }
+    }
+    interp_scalar(x + 2*k, count - k, bank, taps, sps, out + 2 * k * sps);
+}
+
+__attribute__((target("avx2")))
+static void decim_avx2(const float *x, size_t count, int step, const float *coef, int window, float *out) {
+    for (size_t j = 0; j < count; j++, x += 2 * (size_t)step, out += 2) {
+        __m256 acc = _mm256_setzero_ps();
+        for (int m = 0; m < window; m += 4) {
+            acc = _mm256_add_ps(acc, _mm256_mul_ps(_mm256_loadu_ps(x + 2*m), _mm256_load_ps(coef + 2*m)));
+        }
+        __m128 s = _mm_add_ps(_mm256_castps256_ps128(acc), _mm256_extractf128_ps(acc, 1));
+        s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+        _mm_storel_pi((__m64 *)out, s);
+    }
+}
+
+#endif /* QPSK_X86 */
+
+/**
+ * Point the dispatch table at the kernels for one instruction set
+ */
+static void select_isa(QpskIsa isa) {
+    interp_fn = interp_scalar;
+    decim_fn = decim_scalar;
+    rrc_isa_used = QPSK_ISA_SCALAR;
+#ifdef QPSK_X86
+    if (isa == QPSK_ISA_AVX2) {
+        interp_fn = interp_avx2;
+        decim_fn = decim_avx2;
+        rrc_isa_used = isa;
+    } else if (isa == QPSK_ISA_SSE2) {
+        interp_fn = interp_sse2;
+        decim_fn = decim_sse2;
+        rrc_isa_used = isa;
+    }
+#endif
+}
+
+static pthread_once_t dispatch_once = PTHREAD_ONCE_INIT;
+
+static void select_cpu(void) {
+    select_isa(qpsk_cpu_isa());
+}
+
+static inline void ensure_dispatch(void) {
+    pthread_once(&dispatch_once, select_cpu);
+}
+
+/**
+ * Keep the newest len complex values of the history followed by count inputs
+ */
+static void update_history(float *history, int len, const float *in, size_t count) {
+    if (count >= (size_t)len) {
+        memcpy(history, in + 2 * (count - len), 2 * len * sizeof(float));
+    } else {
+        memmove(history, history + 2 * count, 2 * (len - count) * sizeof(float));
+        memcpy(history + 2 * (len - count), in, 2 * count * sizeof(float));
+    }
+}
+
+int rrc_valid(int sps, int span, double rolloff) {
+    return sps >= 2 && sps <= RRC_MAX_SPS && span >= 2 && span <= RRC_MAX_SPAN && span % 2 == 0
+        && rolloff > 0.0 && rolloff <= 1.0;
+}
+
+int rrc_init(RrcFilter *f, int sps, int span, double rolloff) {
+    memset(f, 0, sizeof(*f));
+    if (!rrc_valid(sps, span, rolloff)) {
+        return -1;
+    }
+
+    // Unit-energy pulse of span * sps + 1 taps centred on tap span * sps / 2
+    int taps = span * sps + 1;
+    double h[RRC_MAX_SPAN * RRC_MAX_SPS + 1];
+    double energy = 0.0;
+    for (int n = 0; n < taps; n++) {
+        h[n] = rrc_pulse((double)(n - taps / 2) / sps, rolloff);
+        energy += h[n] * h[n];
+    }
+    for (int n = 0; n < taps; n++) {
+        h[n] /= sqrt(energy);
+    }
+
+    f->sps = sps;
+    f->span = span;
+    f->rolloff = rolloff;
+    f->branch_taps = span + 1;
+    f->window = (taps + 3) & ~3;
+    f->history_len = f->window - 1;
+    f->bank = aligned_alloc(64, ((size_t)sps * f->branch_taps * sizeof(float) + 63) & ~(size_t)63);
+    f->coef = aligned_alloc(64, ((size_t)2 * f->window * sizeof(float) + 63) & ~(size_t)63);
+    f->history = malloc(2 * (size_t)f->history_len * sizeof(float));
+    f->stage = malloc(4 * (size_t)f->history_len * sizeof(float));
+    if (f->bank == NULL || f->coef == NULL || f->history == NULL || f->stage == NULL) {
+        rrc_free(f);
+        return -1;
+    }
+
+    // Branch p holds taps p, p + sps, ... with the tap of the oldest symbol first
+    for (int p = 0; p < sps; p++) {
+        for (int i = 0; i < f->branch_taps; i++) {
+            int n = (f->branch_taps - 1 - i) * sps + p;
+            f->bank[p * f->branch_taps + i] = n < taps ? (float)h[n] : 0.0f;
+        }
+    }
+    // The matched filter pads with zeros in front, on the oldest samples
+    for (int m = 0; m < f->window; m++) {
+        int n = f->window - 1 - m;
+        float c = n < taps ? (float)h[n] : 0.0f;
+        f->coef[2*m] = c;
+        f->coef[2*m + 1] = c;
+    }
+    rrc_reset(f);
+    return 0;
+}
+
+void rrc_free(RrcFilter *f) {
+    free(f->bank);
+    free(f->coef);
+    free(f->history);
+    free(f->stage);
+    f->bank = NULL;
+    f->coef = NULL;
+    f->history = NULL;
+    f->stage = NULL;
+}
+
+void rrc_reset(RrcFilter *f) {
+    memset(f->history, 0, 2 * (size_t)f->history_len * sizeof(float));
+    f->skip = 0;
+}
+
+void rrc_interpolate(RrcFilter *f, const float *in, size_t count, float *out) {
+    int hist = f->branch_taps - 1;
+    size_t head = count < (size_t)hist ? count : (size_t)hist;
+
+    ensure_dispatch();
+    memcpy(f->stage, f->history, 2 * hist * sizeof(float));
+    memcpy(f->stage + 2 * hist, in, 2 * head * sizeof(float));
+    interp_fn(f->stage, head, f->bank, f->branch_taps, f->sps, out);
+    if (count > head) {
+        interp_fn(in, count - head, f->bank, f->branch_taps, f->sps, out + 2 * head * f->sps);
+    }
+    update_history(f->history, hist, in, count);
+}
+
+/**
+ * Matched filter keeping every step-th output
+ */
+static size_t matched(RrcFilter *f, const float *in, size_t count, size_t step, float *out) {
+    size_t hist = f->window - 1;
+    size_t skip = f->skip;
+    size_t outputs = count > skip ? (count - 1 - skip) / step + 1 : 0;
+
+    // Output j has its window at skip + j * step in the history-then-input stream
+    size_t early = skip < hist ? (hist - skip + step - 1) / step : 0;
+    if (early > outputs) {
+        early = outputs;
+    }
+
+    ensure_dispatch();
+    if (early > 0) {
+        size_t head = count < hist ? count : hist;
+        memcpy(f->stage, f->history, 2 * hist * sizeof(float));
+        memcpy(f->stage + 2 * hist, in, 2 * head * sizeof(float));
+        decim_fn(f->stage + 2 * skip, early, (int)step, f->coef, f->window, out);
+    }
+    if (outputs > early) {
+        decim_fn(in + 2 * (skip + early * step - hist), outputs - early, (int)step, f->coef, f->window,
+                 out + 2 * early);
+    }
+    update_history(f->history, (int)hist, in, count);
+    f->skip = (int)(skip + outputs * step - count);
+    return outputs;
+}
+
+size_t rrc_decimate(RrcFilter *f, const float *in, size_t count, float *out) {
+    return matched(f, in, count, f->sps, out);
+}
+
+void rrc_filter(RrcFilter *f, const float *in, size_t count, float *out) {
+    matched(f, in, count, 1, out);
+}
+
+QpskIsa rrc_isa(void) {
+    ensure_dispatch();
+    return rrc_isa_used;
+}
+
+QpskIsa rrc_set_isa(QpskIsa isa) {
+    ensure_dispatch();
+    select_isa(qpsk_cpu_clamp_isa(isa));
+    return rrc_isa_used;
+}
@@ -0,0 +1,144 @@
+/**
+ * Root-Raised-Cosine Pulse Shaping
+ *
+ * Turns one complex value per symbol into sps samples per symbol with a
+ * root-raised-cosine pulse, and back again with the matched filter:
+ *
+ *   - rrc_interpolate(): polyphase interpolator. Branch p of the pulse
+ *     computes output phase p of every symbol from the last span + 1
+ *     symbols, so the zeros of the upsampled stream are never multiplied.
+ *   - rrc_decimate(): matched filter evaluated only at the symbol instants,
+ *     which is what a polyphase decimator computes, one output per sps
+ *     input samples.
+ *   - rrc_filter(): the same matched filter at the full sample rate, for
+ *     a receiver that finds the symbol instants itself (see timing.h).
+ *
+ * The pulse has unit energy, so the two filters in a row give a
+ * raised-cosine pulse with a peak of 1 and no intersymbol interference at
+ * the symbol instants, and noise added at the sample rate with the Es/N0
+ * of awgn.h reaches the decisions with that Es/N0. Both filters keep their
+ * history between calls, so a stream can be fed in frames of any length;
+ * a symbol entering the interpolator leaves the matched filter span
+ * symbols later (half a span of delay in each filter).
+ *
+ * The inner loops run on AVX2 or SSE2 when the CPU has them: the
+ * interpolator computes four (AVX2) or two (SSE2) symbols of one phase at
+ * a time with broadcast taps, the matched filter multiplies four or two
+ * complex samples per instruction and adds the lanes up at the end. The
+ * interpolator gives exactly the scalar results; the matched filter adds
+ * in a different order and may differ in the last bits.
+ *
+ * A filter is used in one direction only, and a matched filter either
+ * decimates or filters at the full rate between two resets.
+ */
+
+#ifndef QPSK_RRC_H
+#define QPSK_RRC_H
+
+#include <stddef.h>
+
+#include "cpu.h"
+
+#define RRC_MAX_SPS 16             // Largest number of samples per symbol
+#define RRC_MAX_SPAN 32            // Longest pulse in symbols
+#define RRC_DEFAULT_SPS 4
+#define RRC_DEFAULT_SPAN 8
+#define RRC_DEFAULT_ROLLOFF 0.35
+
+/**
+ * Filter state
+ */
+typedef struct {
+    int sps;                       // Samples per symbol
+    int span;                      // Pulse length in symbols
+    double rolloff;                // Excess bandwidth, 0 to 1
+    int branch_taps;               // Taps per interpolator branch, span + 1
+    float *bank;                   // Interpolator branches, oldest input first
+    int window;                    // Matched filter taps, padded to a multiple of 4
+    float *coef;                   // Matched filter taps, oldest input first, each twice (I and Q)
+    int history_len;               // Complex inputs kept between calls
+    float *history;                // The most recent inputs, interleaved I/Q
+    float *stage;                  // History followed by the first inputs of a call
+    int skip;                      // Matched filter: inputs before the next symbol instant
+} RrcFilter;
+
+/**
+ * Check pulse parameters
+ *
+ * @return 1 if sps is 2..RRC_MAX_SPS, span is even and 2..RRC_MAX_SPAN and
+ *         the roll-off is in (0, 1]
+ */
+int rrc_valid(int sps, int span, double rolloff);
+
+/**
+ * Design the filter and clear its history
+ *
+ * @param f        Filter to initialize
+ * @param sps      Samples per symbol
+ * @param span     Pulse length in symbols (even)
+ * @param rolloff  Excess bandwidth
+ * @return 0 on success, -1 on invalid parameters or allocation failure
+ */
+int rrc_init(RrcFilter *f, int sps, int span, double rolloff);
+
+/**
+ * Release the taps and the history
+ */
+void rrc_free(RrcFilter *f);
+
+/**
+ * Clear the history, as if the stream started again
+ */
+void rrc_reset(RrcFilter *f);
+
+/**
+ * Shape symbols into samples
+ *
+ * @param f        Filter
+ * @param in       count symbols, interleaved I/Q
+ * @param count    Number of symbols
+ * @param out      count * sps samples, interleaved I/Q
+ */
+void rrc_interpolate(RrcFilter *f, const float *in, size_t count, float *out);
+
+/**
+ * Matched-filter samples and keep one output per symbol
+ *
+ * Outputs fall on every sps-th sample of the stream, counted from the
+ * first one after initialization or rrc_reset(), so a frame whose length
+ * is not a multiple of sps leaves the next frame a different offset.
+ *
+ * @param f        Filter
+ * @param in       count samples, interleaved I/Q
+ * @param count    Number of samples
+ * @param out      Room for count / sps + 1 symbols, interleaved I/Q
+ * @return Number of symbols written
+ */
+size_t rrc_decimate(RrcFilter *f, const float *in, size_t count, float *out);
+
+/**
+ * Matched-filter samples and keep every output
+ *
+ * Output n belongs to input n, delayed by half a span (span * sps / 2
+ * samples).
+ *
+ * @param f        Filter
+ * @param in       count samples, interleaved I/Q
+ * @param count    Number of samples
+ * @param out      count samples, interleaved I/Q
+ */
+void rrc_filter(RrcFilter *f, const float *in, size_t count, float *out);
+
+/**
+ * Instruction set used by the filters (detected on first use)
+ */
+QpskIsa rrc_isa(void);
+
+/**
+ * Override the detected instruction set (clamped to what the CPU supports)
+ *
+ * @return The instruction set actually selected
+ */
+QpskIsa rrc_set_isa(QpskIsa isa);
+
+#endif /* QPSK_RRC_H */
@@ -0,0 +1,346 @@
+/**
+ * I/Q Sample Formats
+ *
+ * The integer kernels clamp in float before converting, as the int8 LLR
+ * demapper does, so out-of-range samples saturate instead of wrapping.
+ * Packing with saturation then cannot clip any further. AVX2 packs work
+ * within 128-bit lanes, so the packed results are put back in order with
+ * one cross-lane permute. The x86 kernels store little-endian values
+ * directly; the scalar code writes bytes explicitly and so also runs on
+ * big-endian hosts.
+ */
+
+#include <math.h>
+#include <pthread.h>
+#include <string.h>
+
+#include "sample.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define QPSK_X86 1
+#endif
+
+#define SC16_MAX 32767.0f     // Symmetric int16 saturation limit
+#define SC8_MAX 127.0f        // Symmetric int8 saturation limit
+#define FORMATS 4             // Formats, numbered from FRAME_FORMAT_F32
+
+typedef void (*EncodeFn)(const float *in, size_t count, float scale, uint8_t *out);
+typedef void (*DecodeFn)(const uint8_t *in, size_t count, float inv, float *out);
+
+static const char *const format_names[FORMATS] = { "f32", "sc16", "sc8", "bfp" };
+
+static QpskIsa sample_isa_used = QPSK_ISA_SCALAR;
+static EncodeFn enc16_fn;
+static EncodeFn enc8_fn;
+static DecodeFn dec16_fn;
+static DecodeFn dec8_fn;
+
+/**
+ * Clamp like minps then maxps, which return their second operand when
+ * either one is NaN, so a NaN saturates to +limit in every kernel
+ */
+static inline long clamp_round(float x, float limit) {
+    x = x < limit ? x : limit;
+    x = x > -limit ? x : -limit;
+    return lrintf(x);
+}
+
+/*
+ * Scalar conversions of samples [first, count)
+ */
+
+static void enc16_tail(const float *in, size_t first, size_t count, float scale, uint8_t *out) {
+    for (size_t i = first; i < count; i++) {
+        unsigned v = (unsigned)clamp_round(in[i] * scale, SC16_MAX);
+        out[2*i] = (uint8_t)v;
+        out[2*i + 1] = (uint8_t)(v >> 8);
+    }
+}
+
+static void enc8_tail(const float *in, size_t first, size_t count, float scale, uint8_t *out) {
+    for (size_t i = first; i < count; i++) {
+        out[i] = (uint8_t)clamp_round(in[i] * scale, SC8_MAX);
+    }
+}
+
+static void dec16_tail(const uint8_t *in, size_t first, size_t count, float inv, float *out) {
+    for (size_t i = first; i < count; i++) {
+        int16_t v = (int16_t)(in[2*i] | in[2*i + 1] << 8);
+        out[i] = (float)v * inv;
+    }
+}
+
+static void dec8_tail(const uint8_t *in, size_t first, size_t count, float inv, float *out) {
+    for (size_t i = first; i < count; i++) {
+        out[i] = (float)(int8_t)in[i] * inv;
+    }
+}
+
+static void enc16_scalar(const float *in, size_t count, float scale, uint8_t *out) {
+    enc16_tail(in, 0, count, scale, out);
+}
+
+static void enc8_scalar(const float *in, size_t count, float scale, uint8_t *out) {
+    enc8_tail(in, 0, count, scale, out);
+}
+
+static void dec16_scalar(const uint8_t *in, size_t count, float inv, float *out) {
+    dec16_tail(in, 0, count, inv, out);
+}
+
+static void dec8_scalar(const uint8_t *in, size_t count, float inv, float *out) {
+    dec8_tail(in, 0, count, inv, out);
+}
+
+#ifdef QPSK_X86
+
+__attribute__((target("sse2")))
+static inline __m128i sse2_convert(const float *in, __m128 k, __m128 limit) {
+    __m128 x = _mm_mul_ps(_mm_loadu_ps(in), k);
+    x = _mm_max_ps(_mm_min_ps(x, limit), _mm_sub_ps(_mm_setzero_ps(), limit));
+    return _mm_cvtps_epi32(x);
+}
+
+__attribute__((target("sse2")))
+static void enc16_sse2(const float *in, size_t count, float scale, uint8_t *out) {
+    const __m128 k = _mm_set1_ps(scale);
+    const __m128 limit = _mm_set1_ps(SC16_MAX);
+    size_t i = 0;
+
+    for (; i + 8 <= count; i += 8) {
+        __m128i a = sse2_convert(in + i, k, limit);
+        __m128i b = sse2_convert(in + i + 4, k, limit);
+        _mm_storeu_si128((__m128i *)(out + 2*i), _mm_packs_epi32(a, b));
+    }
+    enc16_tail(in, i, count, scale, out);
+}
+
+__attribute__((target("sse2")))
+static void enc8_sse2(const float *in, size_t count, float scale, uint8_t *out) {
+    const __m128 k = _mm_set1_ps(scale);
+    const __m128 limit = _mm_set1_ps(SC8_MAX);
+    size_t i = 0;
+
+    for (; i + 16 <= count; i += 16) {
+        __m128i a = _mm_packs_epi32(sse2_convert(in + i, k, limit), sse2_convert(in + i + 4, k, limit));
+        __m128i b = _mm_packs_epi32(sse2_convert(in + i + 8, k, limit), sse2_convert(in + i + 12, k, limit));
+        _mm_storeu_si128((__m128i *)(out + i), _mm_packs_epi16(a, b));
+    }
+    enc8_tail(in, i, count, scale, out);
+}
+
+__attribute__((target("sse2")))
+static void dec16_sse2(const uint8_t *in, size_t count, float inv, float *out) {
+    const __m128 k = _mm_set1_ps(inv);
+    size_t i = 0;
+
+    for (; i + 8 <= count; i += 8) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(in + 2*i));
+        // Duplicating each word and shifting right sign-extends it
+        __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16);
+        __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16);
+        _mm_storeu_ps(out + i, _mm_mul_ps(_mm_cvtepi32_ps(lo), k));
+        _mm_storeu_ps(out + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(hi), k));
+    }
+    dec16_tail(in, i, count, inv, out);
+}
+
+__attribute__((target("sse2")))
+static void dec8_sse2(const uint8_t *in, size_t count, float inv, float *out) {
+    const __m128 k = _mm_set1_ps(inv);
+    size_t i = 0;
+
+    for (; i + 16 <= count; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(in + i));
+        __m128i lo = _mm_unpacklo_epi8(v, v);
+        __m128i hi = _mm_unpackhi_epi8(v, v);
+        __m128i w[4] = {
+            _mm_srai_epi32(_mm_unpacklo_epi16(lo, lo), 24),
+            _mm_srai_epi32(_mm_unpackhi_epi16(lo, lo), 24),
+            _mm_srai_epi32(_mm_unpacklo_epi16(hi, hi), 24),
+            _mm_srai_epi32(_mm_unpackhi_epi16(hi, hi), 24)
+        };
+        for (int t = 0; t < 4; t++) {
+            _mm_storeu_ps(out + i + 4*t, _mm_mul_ps(_mm_cvtepi32_ps(w[t]), k));
+        }
+    }
+    dec8_tail(in, i, count, inv, out);
+}
+
+__attribute__((target("avx2")))
+static inline __m256i avx2_convert(const float *in, __m256 k, __m256 limit) {
+    __m256 x = _mm256_mul_ps(_mm256_loadu_ps(in), k);
+    x = _mm256_max_ps(_mm256_min_ps(x, limit), _mm256_sub_ps(_mm256_setzero_ps(), limit));
+    return _mm256_cvtps_epi32(x);
+}
+
+__attribute__((target("avx2")))
+static void enc16_avx2(const float *in, size_t count, float scale, uint8_t *out) {
+    const __m256 k = _mm256_set1_ps(scale);
+    const __m256 limit = _mm256_set1_ps(SC16_MAX);
+    size_t i = 0;
+
+    for (; i + 16 <= count; i += 16) {
+        __m256i v = _mm256_packs_epi32(avx2_convert(in + i, k, limit), avx2_convert(in + i + 8, k, limit));
+        _mm256_storeu_si256((__m256i *)(out + 2*i), _mm256_permute4x64_epi64(v, _MM_SHUFFLE(3, 1, 2, 0)));
+    }
+    enc16_tail(in, i, count, scale, out);
+}
+
+__attribute__((target("avx2")))
+static void enc8_avx2(const float *in, size_t count, float scale, uint8_t *out) {
+    const __m256 k = _mm256_set1_ps(scale);
+    const __m256 limit = _mm256_set1_ps(SC8_MAX);
+    const __m256i order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+    size_t i = 0;
+
+    for (; i + 32 <= count; i += 32) {
+        __m256i a = _mm256_packs_epi32(avx2_convert(in + i, k, limit), avx2_convert(in + i + 8, k, limit));
+        __m256i b = _mm256_packs_epi32(avx2_convert(in + i + 16, k, limit), avx2_convert(in + i + 24, k, limit));
+        __m256i v = _mm256_packs_epi16(a, b);
+        _mm256_storeu_si256((__m256i *)(out + i), _mm256_permutevar8x32_epi32(v, order));
+    }
+    enc8_tail(in, i, count, scale, out);
+}
+
+__attribute__((target("avx2")))
+static void dec16_avx2(const uint8_t *in, size_t count, float inv, float *out) {
+    const __m256 k = _mm256_set1_ps(inv);
+    size_t i = 0;
+
+    for (; i + 16 <= count; i += 16) {
+        __m256i lo = _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i *)(in + 2*i)));
+        __m256i hi = _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i *)(in + 2*i + 16)));
+        _mm256_storeu_ps(out + i, _mm256_mul_ps(_mm256_cvtepi32_ps(lo), k));
+        _mm256_storeu_ps(out + i + 8, _mm256_mul_ps(_mm256_cvtepi32_ps(hi), k));
+    }
+    dec16_tail(in, i, count, inv, out);
+}
+
+__attribute__((target("avx2")))
+static void dec8_avx2(const uint8_t *in, size_t count, float inv, float *out) {
+    const __m256 k = _mm256_set1_ps(inv);
+    size_t i = 0;
+
+    for (; i + 32 <= count; i += 32) {
+        for (int t = 0; t < 4; t++) {
+            __m128i v = _mm_loadl_epi64((const __m128i *)(in + i + 8*t));
+            _mm256_storeu_ps(out + i + 8*t, _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_cvtepi8_epi32(v)), k));
+        }
+    }
+    dec8_tail(in, i, count, inv, out);
+}
+
+#endif /* QPSK_X86 */
+
+/**
+ * Point the dispatch table at the kernels for one instruction set
+ */
+static void select_isa(QpskIsa isa) {
+    enc16_fn = enc16_scalar;
+    enc8_fn = enc8_scalar;
+    dec16_fn = dec16_scalar;
+    dec8_fn = dec8_scalar;
+    sample_isa_used = QPSK_ISA_SCALAR;
+#ifdef QPSK_X86
+    if (isa == QPSK_ISA_AVX2) {
+        enc16_fn = enc16_avx2;
+        enc8_fn = enc8_avx2;
+        dec16_fn = dec16_avx2;
+        dec8_fn = dec8_avx2;
+        sample_isa_used = isa;
+    } else if (isa == QPSK_ISA_SSE2) {
+        enc16_fn = enc16_sse2;
+        enc8_fn = enc8_sse2;
+        dec16_fn = dec16_sse2;
+        dec8_fn = dec8_sse2;
+        sample_isa_used = isa;
+    }
+#endif
+}
+
+static pthread_once_t dispatch_once = PTHREAD_ONCE_INIT;
+
+static void select_cpu(void) {
+    select_isa(qpsk_cpu_isa());
+}
+
+static inline void ensure_dispatch(void) {
+    pthread_once(&dispatch_once, select_cpu);
+}
+
+void sample_encode(FrameFormat format, const float *in, size_t count, float scale, uint8_t *out) {
+    ensure_dispatch();
+    switch (format) {
+    case FRAME_FORMAT_F32:
+        memcpy(out, in, count * sizeof(float));
+        frame_put_f32((float *)out, count);
+        break;
+    case FRAME_FORMAT_SC16:
+        enc16_fn(in, count, scale, out);
+        break;
+    case FRAME_FORMAT_SC8:
+        enc8_fn(in, count, scale, out);
+        break;
+    case FRAME_FORMAT_BFP:
+        break;
+    }
+}
+
+void sample_decode(FrameFormat format, const uint8_t *in, size_t count, float scale, float *out) {
+    ensure_dispatch();
+    switch (format) {
+    case FRAME_FORMAT_F32: {
+        const float *samples = frame_get_f32(in, count, out);
+        if (samples != out) {
+            memcpy(out, samples, count * sizeof(float));
+        }
+        break;
+    }
+    case FRAME_FORMAT_SC16:
+        dec16_fn(in, count, 1.0f / scale, out);
+        break;
+    case FRAME_FORMAT_SC8:
+        dec8_fn(in, count, 1.0f / scale, out);
+        break;
+    case FRAME_FORMAT_BFP:
+        break;
+    }
+}
+
+float sample_scale(FrameFormat format, double full_scale) {
+    switch (format) {
+    case FRAME_FORMAT_F32:
+    case FRAME_FORMAT_BFP:  return 1.0f;
+    case FRAME_FORMAT_SC16: return (float)(SC16_MAX / full_scale);
+    case FRAME_FORMAT_SC8:  return (float)(SC8_MAX / full_scale);
+    }
+    return 1.0f;
+}
+
+int sample_parse_format(const char *name, FrameFormat *format) {
+    for (size_t i = 0; i < FORMATS; i++) {
+        if (strcmp(name, format_names[i]) == 0) {
+            *format = (FrameFormat)(FRAME_FORMAT_F32 + i);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+const char *sample_format_name(FrameFormat format) {
+    size_t i = (size_t)format - FRAME_FORMAT_F32;
+    return i < FORMATS ? format_names[i] : "unknown";
+}
+
+QpskIsa sample_isa(void) {
+    ensure_dispatch();
+    return sample_isa_used;
+}
+
+QpskIsa sample_set_isa(QpskIsa isa) {
+    ensure_dispatch();
+    select_isa(qpsk_cpu_clamp_isa(isa));
+    return sample_isa_used;
+}
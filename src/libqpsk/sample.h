@@ -0,0 +1,85 @@
+/**
+ * I/Q Sample Formats
+ *
+ * Converts float samples to and from the fixed-size payload formats of
+ * frame.h, in little-endian byte order on every host:
+ *
+ *   F32   32-bit IEEE floats, unchanged
+ *   SC16  16-bit signed integers, round(x * scale) saturated to ±32767
+ *   SC8   8-bit signed integers, round(x * scale) saturated to ±127
+ *
+ * The scale is in integer units per 1.0 of sample value and travels in the
+ * frame header; sample_scale() derives it from the largest magnitude that
+ * must still be represented. Rounding is to nearest like lrintf(), and
+ * decoding multiplies by the reciprocal of the scale. The AVX2 and SSE2
+ * kernels give exactly the scalar results. BFP payloads are handled by
+ * bfp.h; frame_encode_payload() picks the right codec for a header.
+ */
+
+#ifndef QPSK_SAMPLE_H
+#define QPSK_SAMPLE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "cpu.h"
+#include "frame.h"
+
+#define SAMPLE_FULL_SCALE 4.0  // Default magnitude mapped to the largest integer
+
+/**
+ * Convert float samples to a payload format
+ *
+ * @param format  Payload format (BFP is left to bfp_encode())
+ * @param in      Float samples (interleaved I/Q)
+ * @param count   Number of samples (twice the number of symbols)
+ * @param scale   Integer units per 1.0 (ignored for F32)
+ * @param out     Payload, count * bytes per sample
+ */
+void sample_encode(FrameFormat format, const float *in, size_t count, float scale, uint8_t *out);
+
+/**
+ * Convert a payload back to float samples
+ *
+ * @param format  Payload format (BFP is left to bfp_decode())
+ * @param in      Payload
+ * @param count   Number of samples
+ * @param scale   Integer units per 1.0, as sent (ignored for F32)
+ * @param out     Float samples
+ */
+void sample_decode(FrameFormat format, const uint8_t *in, size_t count, float scale, float *out);
+
+/**
+ * Scale that maps a given magnitude to the largest integer of a format
+ *
+ * @param format      Payload format
+ * @param full_scale  Largest sample magnitude represented without clipping
+ * @return Integer units per 1.0 (1 for F32)
+ */
+float sample_scale(FrameFormat format, double full_scale);
+
+/**
+ * Look up a format by name ("f32", "sc16", "sc8", "bfp")
+ *
+ * @return 1 if the name is known, 0 otherwise
+ */
+int sample_parse_format(const char *name, FrameFormat *format);
+
+/**
+ * Printable name of a format
+ */
+const char *sample_format_name(FrameFormat format);
+
+/**
+ * Instruction set used by the converters (detected on first use)
+ */
+QpskIsa sample_isa(void);
+
+/**
+ * Override the detected instruction set (clamped to what the CPU supports)
+ *
+ * @return The instruction set actually selected
+ */
+QpskIsa sample_set_isa(QpskIsa isa);
+
+#endif /* QPSK_SAMPLE_H */
@@ -0,0 +1,40 @@
+/**
+ * Complex Arithmetic on SIMD Vectors
+ *
+ * Internal helpers shared by the vectorized kernels that work on
+ * interleaved I/Q (carrier.c, fading.c, equalizer.c). Each helper carries
+ * the target attribute of its instruction set, like the kernels calling
+ * it, so including this header does not raise the ISA of a file.
+ */
+
+#ifndef QPSK_SIMD_COMPLEX_H
+#define QPSK_SIMD_COMPLEX_H
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+
+/**
+ * Complex products of two vectors of interleaved I/Q (SSE2 has no addsub)
+ */
+__attribute__((target("sse2")))
+static inline __m128 cmul_sse2(__m128 a, __m128 b) {
+    const __m128 neg_even = _mm_setr_ps(-0.0f, 0.0f, -0.0f, 0.0f);
+    __m128 br = _mm_shuffle_ps(b, b, _MM_SHUFFLE(2, 2, 0, 0));
+    __m128 bi = _mm_shuffle_ps(b, b, _MM_SHUFFLE(3, 3, 1, 1));
+    __m128 as = _mm_shuffle_ps(a, a, _MM_SHUFFLE(2, 3, 0, 1));
+    return _mm_add_ps(_mm_mul_ps(a, br), _mm_xor_ps(_mm_mul_ps(as, bi), neg_even));
+}
+
+/**
+ * Complex products of two vectors of interleaved I/Q
+ */
+__attribute__((target("avx2")))
+static inline __m256 cmul_avx2(__m256 a, __m256 b) {
+    __m256 as = _mm256_permute_ps(a, _MM_SHUFFLE(2, 3, 0, 1));
+    return _mm256_addsub_ps(_mm256_mul_ps(a, _mm256_moveldup_ps(b)),
+                            _mm256_mul_ps(as, _mm256_movehdup_ps(b)));
+}
+
+#endif
+
+#endif /* QPSK_SIMD_COMPLEX_H */
@@ -0,0 +1,30 @@
+/**
+ * Single-Producer Single-Consumer Ring of Blocks
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "spsc.h"
+
+int spsc_init(SpscRing *ring, size_t depth, size_t block_bytes) {
+    size_t n = 1;
+    while (n < depth) {
+        n <<= 1;
+    }
+
+    memset(ring, 0, sizeof(*ring));
+    atomic_init(&ring->head, 0);
+    atomic_init(&ring->tail, 0);
+    atomic_init(&ring->closed, 0);
+    ring->block_bytes = block_bytes;
+    ring->stride = (block_bytes + SPSC_CACHE_LINE - 1) & ~(size_t)(SPSC_CACHE_LINE - 1);
+    ring->mask = n - 1;
+    ring->blocks = aligned_alloc(SPSC_CACHE_LINE, n * (ring->stride ? ring->stride : SPSC_CACHE_LINE));
+    return ring->blocks != NULL ? 0 : -1;
+}
+
+void spsc_free(SpscRing *ring) {
+    free(ring->blocks);
+    ring->blocks = NULL;
+}
@@ -0,0 +1,140 @@
+/**
+ * Single-Producer Single-Consumer Ring of Blocks
+ *
+ * A bounded queue of fixed-size blocks between exactly two threads. The
+ * producer fills the next free block in place and publishes it; the
+ * consumer reads the oldest block in place and releases it, so blocks are
+ * never copied and no locks are taken.
+ *
+ * The producer owns head and the consumer owns tail. Each side keeps a
+ * cached copy of the other side's index and only reloads it when the
+ * cache says the ring is full (or empty), so in steady state neither side
+ * touches the cache line the other one writes. A release store publishes
+ * the block contents along with the index and the acquire load on the
+ * other side makes them visible.
+ *
+ * A full ring is backpressure: the producer has to wait (see pipeline.h).
+ * The producer closes the ring after its last block; the consumer drains
+ * what is left and then sees spsc_finished().
+ */
+
+#ifndef QPSK_SPSC_H
+#define QPSK_SPSC_H
+
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define SPSC_CACHE_LINE 64
+
+/**
+ * Ring state
+ */
+typedef struct {
+    _Alignas(SPSC_CACHE_LINE) atomic_size_t head;   // Blocks published, written by the producer
+    size_t tail_cache;                              // Producer's last view of tail
+    _Alignas(SPSC_CACHE_LINE) atomic_size_t tail;   // Blocks released, written by the consumer
+    size_t head_cache;                              // Consumer's last view of head
+    _Alignas(SPSC_CACHE_LINE) uint8_t *blocks;      // depth * stride bytes, cache-line aligned
+    size_t block_bytes;                             // Usable size of each block
+    size_t stride;                                  // block_bytes rounded up to whole cache lines
+    size_t mask;                                    // depth - 1
+    atomic_int closed;                              // Set by the producer after its last block
+} SpscRing;
+
+/**
+ * Allocate a ring
+ *
+ * @param ring         Ring to initialize
+ * @param depth        Number of blocks, rounded up to a power of two
+ * @param block_bytes  Size of every block
+ * @return 0 on success, -1 if the memory cannot be allocated
+ */
+int spsc_init(SpscRing *ring, size_t depth, size_t block_bytes);
+
+/**
+ * Release the blocks
+ */
+void spsc_free(SpscRing *ring);
+
+/**
+ * Number of blocks in the ring
+ */
+static inline size_t spsc_depth(const SpscRing *ring) {
+    return ring->mask + 1;
+}
+
+/**
+ * Blocks published and not yet released (a snapshot, callable from any thread)
+ */
+static inline size_t spsc_occupancy(SpscRing *ring) {
+    size_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    size_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    return head - tail;
+}
+
+/**
+ * Producer: next free block, or NULL if the ring is full
+ */
+static inline void *spsc_reserve(SpscRing *ring) {
+    size_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    if (head - ring->tail_cache > ring->mask) {
+        ring->tail_cache = atomic_load_explicit(&ring->tail, memory_order_acquire);
+        if (head - ring->tail_cache > ring->mask) {
+            return NULL;
+        }
+    }
+    return ring->blocks + (head & ring->mask) * ring->stride;
+}
+
+/**
+ * Producer: publish the block returned by spsc_reserve()
+ */
+static inline void spsc_publish(SpscRing *ring) {
+    size_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+}
+
+/**
+ * Producer: no more blocks will be published
+ */
+static inline void spsc_close(SpscRing *ring) {
+    atomic_store_explicit(&ring->closed, 1, memory_order_release);
+}
+
+/**
+ * Consumer: oldest published block, or NULL if the ring is empty
+ */
+static inline void *spsc_front(SpscRing *ring) {
+    size_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    if (tail == ring->head_cache) {
+        ring->head_cache = atomic_load_explicit(&ring->head, memory_order_acquire);
+        if (tail == ring->head_cache) {
+            return NULL;
+        }
+    }
+    return ring->blocks + (tail & ring->mask) * ring->stride;
+}
+
+/**
+ * Consumer: hand the block returned by spsc_front() back to the producer
+ */
+static inline void spsc_release(SpscRing *ring) {
+    size_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    atomic_store_explicit(&ring->tail, tail + 1, memory_order_release);
+}
+
+/**
+ * Consumer: the producer closed the ring and every block was released
+ *
+ * Only meaningful after spsc_front() returned NULL.
+ */
+static inline int spsc_finished(SpscRing *ring) {
+    if (!atomic_load_explicit(&ring->closed, memory_order_acquire)) {
+        return 0;
+    }
+    // Blocks published before the close are visible now
+    return spsc_front(ring) == NULL;
+}
+
+#endif /* QPSK_SPSC_H */
@@ -0,0 +1,195 @@
+/**
+ * Symbol Timing Recovery
+ *
+ * Both the loop and the clock keep the last four input samples in a
+ * register and emit what falls between the second and the third of them.
+ * Between two outputs they only shift in the samples they step over, so
+ * they never read back into the caller's buffer and the loop can write
+ * its symbols over its input.
+ */
+
+#include <math.h>
+#include <string.h>
+
+#include "timing.h"
+
+#define TIMING_DAMPING 0.7071      // Loop damping factor
+#define TIMING_TED_SLOPE 2.8       // Mean Gardner error per symbol of delay, per unit of roll-off
+
+/**
+ * Cubic Lagrange interpolation in Farrow form at mu (0 to 1) between the
+ * second and the third of four complex samples
+ */
+static inline void farrow(const float *r, float mu, float *y) {
+    for (int c = 0; c < 2; c++) {
+        float x0 = r[c], x1 = r[2 + c], x2 = r[4 + c], x3 = r[6 + c];
+        float v3 = (x3 - x0) * (1.0f / 6.0f) + (x1 - x2) * 0.5f;
+        float v2 = (x0 + x2) * 0.5f - x1;
+        float v1 = x2 - x1 * 0.5f - x0 * (1.0f / 3.0f) - x3 * (1.0f / 6.0f);
+        y[c] = ((v3 * mu + v2) * mu + v1) * mu + x1;
+    }
+}
+
+/**
+ * Shift count samples into the register
+ */
+static inline void push(float *reg, const float *x, size_t count) {
+    if (count >= 4) {
+        x += 2 * (count - 4);
+        count = 4;
+    }
+    int keep = 8 - 2 * (int)count;
+    for (int j = 0; j < keep; j++) {
+        reg[j] = reg[j + 2 * count];
+    }
+    for (int j = keep; j < 8; j++) {
+        reg[j] = x[j - keep];
+    }
+}
+
+/**
+ * Shift in the samples up to the next output, or all that are left
+ *
+ * @return 1 when the register holds the samples around *next, 0 when the
+ *         block ended first
+ */
+static inline int advance(float *reg, const float *x, size_t count, size_t *i, double *next) {
+    if (*next < 1.0) {
+        return 1;
+    }
+    size_t step = (size_t)*next;
+    if (step > count - *i) {
+        push(reg, x + 2 * *i, count - *i);
+        *next -= (double)(count - *i);
+        *i = count;
+        return 0;
+    }
+    push(reg, x + 2 * *i, step);
+    *next -= (double)step;
+    *i += step;
+    return 1;
+}
+
+int timing_init(TimingLoop *t, int sps, double rolloff, double bandwidth) {
+    memset(t, 0, sizeof(*t));
+    if (sps < 2 || rolloff <= 0.0 || rolloff > 1.0 || bandwidth <= 0.0 || bandwidth > TIMING_MAX_BANDWIDTH) {
+        return -1;
+    }
+
+    // Standard second-order loop updated once per symbol. Near lock the
+    // mean Gardner error of unit-energy symbols is about 2.8 times the
+    // roll-off times the delay in symbols
+    double kp = TIMING_TED_SLOPE * rolloff / sps;
+    double theta = bandwidth / (TIMING_DAMPING + 0.25 / TIMING_DAMPING);
+    double d = 1.0 + 2.0 * TIMING_DAMPING * theta + theta * theta;
+    t->sps = sps;
+    t->bandwidth = bandwidth;
+    t->k1 = 4.0 * TIMING_DAMPING * theta / d / kp;
+    t->k2 = 4.0 * theta * theta / d / kp;
+    t->period = sps;
+    // The register's second sample is three samples before the first input
+    t->next = 3.0;
+    return 0;
+}
+
+/**
+ * Note where the first strobe of the next block falls and which symbol of
+ * the block it takes
+ *
+ * The strobe moves by about a symbol between blocks only when the grid
+ * drifts across the block boundary, and the symbol it takes moves with it.
+ */
+static int next_block(TimingLoop *t) {
+    double first = t->next - 3.0 + (t->midpoint ? 0.5 * t->period : 0.0);
+
+    t->block_symbol += (int)lround((first - t->block_first) / t->sps);
+    t->block_first = first;
+    return t->block_symbol;
+}
+
+int timing_restart(TimingLoop *t, int hold) {
+    memset(t->reg, 0, sizeof(t->reg));
+    memset(t->last, 0, sizeof(t->last));
+    memset(t->mid, 0, sizeof(t->mid));
+    t->hold = hold;
+    return next_block(t);
+}
+
+size_t timing_process(TimingLoop *t, float *iq, size_t count) {
+    double limit = 0.25 * t->sps;
+    size_t i = 0, n = 0;
+
+    next_block(t);
+    while (advance(t->reg, iq, count, &i, &t->next)) {
+        float y[2];
+        farrow(t->reg, (float)t->next, y);
+        if (t->midpoint) {
+            t->mid[0] = y[0];
+            t->mid[1] = y[1];
+            t->midpoint = 0;
+        } else {
+            // Gardner: the midpoint leans towards the later symbol when
+            // the strobes are late, and the error turns negative
+            double e = t->mid[0] * (t->last[0] - y[0]) + t->mid[1] * (t->last[1] - y[1]);
+            if (t->hold > 0) {
+                t->hold--;
+                e = 0.0;
+            }
+            t->integrator += t->k2 * e;
+            if (fabs(t->integrator) > limit) {
+                t->integrator = copysign(limit, t->integrator);
+            }
+            double adjust = t->k1 * e + t->integrator;
+            if (fabs(adjust) > limit) {
+                adjust = copysign(limit, adjust);
+            }
+            t->period = t->sps + adjust;
+            t->offset += adjust;
+            t->last[0] = y[0];
+            t->last[1] = y[1];
+            iq[2*n] = y[0];
+            iq[2*n + 1] = y[1];
+            n++;
+            t->midpoint = 1;
+        }
+        t->next += 0.5 * t->period;
+    }
+    return n;
+}
+
+double timing_offset(const TimingLoop *t) {
+    return t->offset / t->sps;
+}
+
+double timing_drift_ppm(const TimingLoop *t) {
+    return t->integrator / t->sps * 1e6;
+}
+
+int clock_skew_init(ClockSkew *s, double delay, double ppm) {
+    memset(s, 0, sizeof(*s));
+    if (fabs(ppm) > TIMING_MAX_PPM || fabs(delay) > TIMING_MAX_DELAY) {
+        return -1;
+    }
+    s->step = 1.0 / (1.0 + ppm * 1e-6);
+    s->next = delay + 3.0;
+    return 0;
+}
+
+void clock_skew_restart(ClockSkew *s) {
+    memset(s->reg, 0, sizeof(s->reg));
+}
+
+size_t clock_skew_process(ClockSkew *s, const float *in, size_t count, float *out) {
+    size_t i = 0, n = 0;
+
+    while (advance(s->reg, in, count, &i, &s->next)) {
+        farrow(s->reg, (float)s->next, out + 2*n);
+        n++;
+        s->next += s->step;
+    }
+    return n;
+}
+
+size_t clock_skew_room(size_t count) {
+    return count + count / 512 + (size_t)TIMING_MAX_DELAY + 4;
+}
@@ -0,0 +1,155 @@
+/**
+ * Symbol Timing Recovery
+ *
+ * Finds the symbol instants in a matched-filtered stream of sps samples per
+ * symbol whose sample clock is offset from, or drifts against, the
+ * transmitter's:
+ *
+ *   - A cubic Farrow interpolator computes the signal between two samples
+ *     at any fractional position, from the four samples around it.
+ *   - A Gardner timing error detector compares each symbol with the one
+ *     before it and the interpolated midpoint between them; it needs no
+ *     decisions and no carrier phase.
+ *   - A second-order (proportional plus integral) loop moves the next
+ *     strobe by the filtered error, so a constant offset is pulled in and
+ *     a constant drift is tracked without a standing error.
+ *
+ * When every block holds whole symbols, as frames do, the symbol grid
+ * keeps its place relative to the start of each block, so a block after
+ * a gap (lost frames) continues the grid of the last one: the loop carries
+ * on with the phase and drift it has acquired, and timing_restart() only
+ * clears the samples before the gap and tells which symbol of the new
+ * block the first strobe takes.
+ *
+ * The same interpolator drives a ClockSkew, which resamples a stream as a
+ * receiver whose clock runs off by some parts per million would have
+ * sampled it, to test the loop on loopback.
+ *
+ * The loop is a feedback loop over every sample, so it runs scalar; it
+ * costs a few nanoseconds per input sample.
+ */
+
+#ifndef QPSK_TIMING_H
+#define QPSK_TIMING_H
+
+#include <stddef.h>
+
+#define TIMING_DEFAULT_BANDWIDTH 0.002 // Loop noise bandwidth relative to the symbol rate
+#define TIMING_MAX_BANDWIDTH 0.05
+#define TIMING_MAX_PPM 1000.0          // Largest emulated clock offset
+#define TIMING_MAX_DELAY 32.0          // Largest emulated sampling delay in samples
+
+/**
+ * Timing recovery state
+ */
+typedef struct {
+    int sps;                   // Input samples per symbol
+    double bandwidth;          // Loop noise bandwidth relative to the symbol rate
+    double k1;                 // Proportional gain, samples per unit of error
+    double k2;                 // Integral gain
+    double integrator;         // Samples added to every symbol period (clock drift)
+    double offset;             // Delay of the next strobe behind a grid of sps samples, since timing_init()
+    double next;               // Next interpolant, in samples after the second-oldest in reg
+    double period;             // Samples to the next strobe
+    int midpoint;              // Non-zero when the next interpolant is a midpoint
+    int hold;                  // Strobes still to emit before the loop starts correcting
+    double block_first;        // First strobe of the last block, in samples from its start
+    int block_symbol;          // Symbol of the last block it takes, counted as in the first block
+    float reg[8];              // Last four input samples, interleaved I/Q, oldest first
+    float last[2];             // Previous strobe
+    float mid[2];              // Midpoint after it
+} TimingLoop;
+
+/**
+ * Set up the loop for a stream of sps samples per symbol
+ *
+ * @param t          Loop to initialize
+ * @param sps        Input samples per symbol (2 or more)
+ * @param rolloff    Roll-off of the raised-cosine pulse at the symbol
+ *                   instants, which sets the error detector's gain
+ * @param bandwidth  Loop noise bandwidth relative to the symbol rate
+ *                   (0 < bandwidth <= TIMING_MAX_BANDWIDTH)
+ * The gains assume symbols of unit energy, as the matched filter of rrc.h
+ * gives them.
+ *
+ * @return 0 on success, -1 on invalid parameters
+ */
+int timing_init(TimingLoop *t, int sps, double rolloff, double bandwidth);
+
+/**
+ * Continue after a gap in the stream, keeping the acquired phase and drift
+ *
+ * @param t     Loop
+ * @param hold  Strobes to emit before the loop corrects again, e.g. while
+ *              the matched filter in front of it fills up
+ * @return Symbol of the next block that the first strobe takes, counted
+ *         from the one at the first strobe of the first block (usually 0,
+ *         or -1 or 1 once the grid has drifted across a block boundary)
+ */
+int timing_restart(TimingLoop *t, int hold);
+
+/**
+ * Interpolate the symbols of a block in place
+ *
+ * Symbol k is written over the samples k (an output never overtakes the
+ * input), so the block can be the caller's sample buffer.
+ *
+ * @param t      Loop
+ * @param iq     count samples in, the returned number of symbols out,
+ *               interleaved I/Q
+ * @param count  Number of samples
+ * @return Number of symbols written
+ */
+size_t timing_process(TimingLoop *t, float *iq, size_t count);
+
+/**
+ * Delay of the strobes acquired so far in symbols
+ */
+double timing_offset(const TimingLoop *t);
+
+/**
+ * Estimated sample clock offset in parts per million (positive when the
+ * receiver samples faster than the transmitter sends)
+ */
+double timing_drift_ppm(const TimingLoop *t);
+
+/**
+ * Emulated receiver sample clock
+ */
+typedef struct {
+    double step;               // Input samples per output sample
+    double next;               // Next output, in samples after the second-oldest in reg
+    float reg[8];              // Last four input samples, interleaved I/Q, oldest first
+} ClockSkew;
+
+/**
+ * Set up a clock that samples a stream late by delay input samples and
+ * at 1 + ppm * 1e-6 times the input rate
+ *
+ * @return 0 on success, -1 when |ppm| exceeds TIMING_MAX_PPM or |delay|
+ *         exceeds TIMING_MAX_DELAY
+ */
+int clock_skew_init(ClockSkew *s, double delay, double ppm);
+
+/**
+ * Forget the previous inputs after a gap, keeping the clock's phase
+ */
+void clock_skew_restart(ClockSkew *s);
+
+/**
+ * Resample a block
+ *
+ * @param s      Clock
+ * @param in     count samples, interleaved I/Q
+ * @param count  Number of input samples
+ * @param out    Room for clock_skew_room(count) samples, interleaved I/Q
+ * @return Number of samples written
+ */
+size_t clock_skew_process(ClockSkew *s, const float *in, size_t count, float *out);
+
+/**
+ * Most samples clock_skew_process() can write for count inputs
+ */
+size_t clock_skew_room(size_t count);
+
+#endif /* QPSK_TIMING_H */
@@ -0,0 +1,218 @@
+/**
+ * Leveled Output and Sample Dumps
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "ascii.h"
+#include "frame.h"
+#include "trace.h"
+
+#define LEVELS 4                 // Levels, numbered from TRACE_QUIET
+#define RECORD_HEADER_BYTES 32   // Binary record header
+#define RECORD_NAME_BYTES 16     // Name field of a binary record
+
+#define KIND_BITS 1
+#define KIND_FLOAT32 2
+#define KIND_BYTES 3
+
+static const char *const level_names[LEVELS] = { "quiet", "summary", "frame", "sample" };
+
+static const char hex_digits[16] = "0123456789ABCDEF";
+
+/**
+ * Room for n more bytes in the dump buffer, writing it out first if needed
+ */
+static char *reserve(Trace *trace, size_t n) {
+    if (TRACE_BUFFER_BYTES - trace->used < n) {
+        trace_flush(trace);
+    }
+    return trace->buf + trace->used;
+}
+
+/**
+ * Start a text array or a binary record
+ */
+static void begin(Trace *trace, const char *name, unsigned long long frame, int kind, size_t count) {
+    if (trace->binary) {
+        uint8_t *p = (uint8_t *)reserve(trace, RECORD_HEADER_BYTES);
+        memset(p, 0, RECORD_NAME_BYTES);
+        strncpy((char *)p, name, RECORD_NAME_BYTES);
+        for (int i = 0; i < 8; i++) {
+            p[16 + i] = (uint8_t)(frame >> 8*i);
+        }
+        for (int i = 0; i < 4; i++) {
+            p[24 + i] = (uint8_t)((unsigned)kind >> 8*i);
+            p[28 + i] = (uint8_t)(count >> 8*i);
+        }
+        trace->used += RECORD_HEADER_BYTES;
+    } else {
+        size_t n = strlen(name) + 32;
+        char *p = reserve(trace, n);
+        trace->used += snprintf(p, n, kind == KIND_BYTES ? "%s[%llu]:\n" : "%s[%llu] = {", name, frame);
+    }
+}
+
+/**
+ * End a dump; dumps to stdout are written at once so they stay in order
+ * with the program's other output
+ */
+static void finish(Trace *trace) {
+    if (!trace->close_sink) {
+        trace_flush(trace);
+    }
+}
+
+/**
+ * Copy raw bytes into the dump buffer in buffer-sized pieces
+ */
+static void append(Trace *trace, const void *data, size_t len) {
+    const char *src = data;
+    while (len > 0) {
+        size_t n = TRACE_BUFFER_BYTES - trace->used;
+        if (n == 0) {
+            trace_flush(trace);
+            continue;
+        }
+        n = n < len ? n : len;
+        memcpy(trace->buf + trace->used, src, n);
+        trace->used += n;
+        src += n;
+        len -= n;
+    }
+}
+
+int trace_open(Trace *trace, TraceLevel level, const char *path, int binary) {
+    memset(trace, 0, sizeof(*trace));
+    trace->level = level;
+    trace->binary = binary;
+    if (level < TRACE_SAMPLE) {
+        return 0;
+    }
+
+    if (path == NULL) {
+        path = TRACE_DUMP_FILE;
+    }
+    if (strcmp(path, "-") == 0) {
+        trace->sink = stdout;
+    } else {
+        trace->sink = fopen(path, binary ? "wb" : "w");
+        trace->close_sink = 1;
+    }
+    trace->buf = malloc(TRACE_BUFFER_BYTES);
+    if (trace->sink == NULL || trace->buf == NULL) {
+        trace_close(trace);
+        return -1;
+    }
+    return 0;
+}
+
+void trace_close(Trace *trace) {
+    if (trace->sink != NULL) {
+        trace_flush(trace);
+        if (trace->close_sink) {
+            fclose(trace->sink);
+        } else {
+            fflush(trace->sink);
+        }
+    }
+    free(trace->buf);
+    trace->sink = NULL;
+    trace->buf = NULL;
+}
+
+void trace_flush(Trace *trace) {
+    if (trace->sink != NULL && trace->used > 0) {
+        if (!trace->close_sink) {
+            fflush(trace->sink);
+        }
+        fwrite(trace->buf, 1, trace->used, trace->sink);
+        trace->written += trace->used;
+        trace->used = 0;
+    }
+}
+
+void trace_bits(Trace *trace, const char *name, unsigned long long frame,
+                const uint8_t *packed, size_t bits) {
+    if (trace->sink == NULL) {
+        return;
+    }
+    begin(trace, name, frame, KIND_BITS, bits);
+    for (size_t i = 0; i < bits; i++) {
+        char *p = reserve(trace, 2);
+        int bit = (packed[i / 8] >> (7 - i % 8)) & 1;
+        if (trace->binary) {
+            p[0] = (char)bit;
+            trace->used += 1;
+        } else {
+            p[0] = (char)('0' + bit);
+            p[1] = i + 1 < bits ? ',' : '}';
+            trace->used += 2;
+        }
+    }
+    if (!trace->binary) {
+        append(trace, bits > 0 ? "\n" : "}\n", bits > 0 ? 1 : 2);
+    }
+    finish(trace);
+}
+
+void trace_floats(Trace *trace, const char *name, unsigned long long frame,
+                  const float *values, size_t count) {
+    if (trace->sink == NULL) {
+        return;
+    }
+    begin(trace, name, frame, KIND_FLOAT32, count);
+    for (size_t i = 0; i < count; i++) {
+        if (trace->binary) {
+            float v = values[i];
+            frame_put_f32(&v, 1);
+            memcpy(reserve(trace, sizeof(v)), &v, sizeof(v));
+            trace->used += sizeof(v);
+        } else {
+            char *p = reserve(trace, ASCII_FLOAT_CHARS + 1);
+            size_t n = ascii_format_float(values[i], ASCII_DEFAULT_DECIMALS, p);
+            p[n++] = i + 1 < count ? ',' : '}';
+            trace->used += n;
+        }
+    }
+    if (!trace->binary) {
+        append(trace, count > 0 ? "\n" : "}\n", count > 0 ? 1 : 2);
+    }
+    finish(trace);
+}
+
+void trace_bytes(Trace *trace, const char *name, unsigned long long frame,
+                 const uint8_t *data, size_t len) {
+    if (trace->sink == NULL) {
+        return;
+    }
+    begin(trace, name, frame, KIND_BYTES, len);
+    if (trace->binary) {
+        append(trace, data, len);
+    } else {
+        for (size_t i = 0; i < len; i++) {
+            char *p = reserve(trace, 3);
+            p[0] = hex_digits[data[i] >> 4];
+            p[1] = hex_digits[data[i] & 15];
+            p[2] = (i + 1) % 16 == 0 || i + 1 == len ? '\n' : ' ';
+            trace->used += 3;
+        }
+    }
+    finish(trace);
+}
+
+int trace_parse_level(const char *name, TraceLevel *level) {
+    for (size_t i = 0; i < LEVELS; i++) {
+        if (strcmp(name, level_names[i]) == 0) {
+            *level = (TraceLevel)i;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+const char *trace_level_name(TraceLevel level) {
+    size_t i = (size_t)level;
+    return i < LEVELS ? level_names[i] : "unknown";
+}
@@ -0,0 +1,124 @@
+/**
+ * Leveled Output and Sample Dumps
+ *
+ * Programs choose how much they print at run time:
+ *
+ *   quiet    errors only
+ *   summary  configuration, periodic statistics and totals (default)
+ *   frame    one line per frame as well
+ *   sample   every bit, sample and byte of every frame as well
+ *
+ * Per-sample dumps never go through printf: they are formatted with the
+ * fixed-precision formatter of ascii.h, or copied as binary records, into
+ * a large buffer that is written to the dump file in big chunks. Below
+ * the sample level no sink is opened and nothing is formatted, so
+ * callers only need to test trace_on() before preparing what they dump.
+ *
+ * Binary dumps are a sequence of records, all fields little-endian:
+ *
+ *   offset  size  field
+ *        0    16  name, zero-padded
+ *       16     8  frame index
+ *       24     4  kind (1 bits, one per byte; 2 float32; 3 bytes)
+ *       28     4  number of items
+ *       32        items
+ */
+
+#ifndef QPSK_TRACE_H
+#define QPSK_TRACE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#define TRACE_BUFFER_BYTES (1 << 20)           // Dump bytes collected before each write
+#define TRACE_DUMP_FILE "qpsk_samples.txt"     // Default dump file
+
+/**
+ * How much a program prints
+ */
+typedef enum {
+    TRACE_QUIET = 0,
+    TRACE_SUMMARY = 1,
+    TRACE_FRAME = 2,
+    TRACE_SAMPLE = 3
+} TraceLevel;
+
+/**
+ * Output state
+ */
+typedef struct {
+    TraceLevel level;
+    int binary;                  // Non-zero for binary dump records
+    FILE *sink;                  // Dump file (NULL below TRACE_SAMPLE)
+    int close_sink;              // Non-zero if the sink was opened here
+    char *buf;                   // Dump bytes not yet written
+    size_t used;
+    unsigned long long written;  // Dump bytes written so far
+} Trace;
+
+/**
+ * Set up output at a level, opening the dump file for TRACE_SAMPLE
+ *
+ * @param trace   State to initialize
+ * @param level   Output level
+ * @param path    Dump file ("-" for stdout, NULL for TRACE_DUMP_FILE)
+ * @param binary  Non-zero for binary records instead of text
+ * @return 0 on success, -1 if the dump file cannot be opened (errno set)
+ */
+int trace_open(Trace *trace, TraceLevel level, const char *path, int binary);
+
+/**
+ * Write out buffered dumps and close the dump file
+ */
+void trace_close(Trace *trace);
+
+/**
+ * Whether output of a level is enabled
+ */
+static inline int trace_on(const Trace *trace, TraceLevel level) {
+    return trace->level >= level;
+}
+
+/**
+ * Dump bits, one per item
+ *
+ * @param trace   Output state
+ * @param name    Name of the array
+ * @param frame   Frame index
+ * @param packed  Bits, most significant first
+ * @param bits    Number of bits
+ */
+void trace_bits(Trace *trace, const char *name, unsigned long long frame,
+                const uint8_t *packed, size_t bits);
+
+/**
+ * Dump float samples (six decimals in text dumps)
+ */
+void trace_floats(Trace *trace, const char *name, unsigned long long frame,
+                  const float *values, size_t count);
+
+/**
+ * Dump raw bytes (hexadecimal, 16 per line in text dumps)
+ */
+void trace_bytes(Trace *trace, const char *name, unsigned long long frame,
+                 const uint8_t *data, size_t len);
+
+/**
+ * Write out buffered dumps now
+ */
+void trace_flush(Trace *trace);
+
+/**
+ * Look up a level by name ("quiet", "summary", "frame", "sample")
+ *
+ * @return 1 if the name is known, 0 otherwise
+ */
+int trace_parse_level(const char *name, TraceLevel *level);
+
+/**
+ * Printable name of a level
+ */
+const char *trace_level_name(TraceLevel level);
+
+#endif /* QPSK_TRACE_H */
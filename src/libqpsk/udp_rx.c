@@ -0,0 +1,181 @@
+/**
+ * Batched UDP Reception
+ */
+
+#define _GNU_SOURCE
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <netinet/udp.h>
+
+#include "udp_rx.h"
+
+#ifndef UDP_GRO
+#define UDP_GRO 104
+#endif
+#ifndef SO_RXQ_OVFL
+#define SO_RXQ_OVFL 40
+#endif
+
+#define CONTROL_SPACE (CMSG_SPACE(sizeof(uint32_t)) + CMSG_SPACE(sizeof(int)))
+
+int udp_rx_set_rcvbuf(int fd, int bytes) {
+    // SO_RCVBUFFORCE may exceed rmem_max but needs CAP_NET_ADMIN
+    if (setsockopt(fd, SOL_SOCKET, SO_RCVBUFFORCE, &bytes, sizeof(bytes)) < 0) {
+        setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &bytes, sizeof(bytes));
+    }
+
+    int actual = 0;
+    socklen_t len = sizeof(actual);
+    if (getsockopt(fd, SOL_SOCKET, SO_RCVBUF, &actual, &len) < 0) {
+        return -1;
+    }
+    return actual;
+}
+
+int udp_rx_init(UdpRx *rx, int fd, size_t frame_bytes, int batch, int gro) {
+    memset(rx, 0, sizeof(*rx));
+    if (frame_bytes == 0 || frame_bytes > UDP_RX_GRO_BYTES || batch < 1 || batch > UDP_RX_MAX_BATCH) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    int on = 1;
+    rx->fd = fd;
+    rx->batch = batch;
+    rx->gro = gro && setsockopt(fd, SOL_UDP, UDP_GRO, &on, sizeof(on)) == 0;
+    setsockopt(fd, SOL_SOCKET, SO_RXQ_OVFL, &on, sizeof(on));
+
+    // Coalesced datagrams need room for a full 64 KB in every slot; otherwise
+    // one spare cache line makes an oversized datagram show up as longer
+    // than a frame even when it is cut off at the slot size
+    rx->slot_bytes = rx->gro ? UDP_RX_GRO_BYTES : frame_bytes + 1;
+    rx->slot_bytes = (rx->slot_bytes + 63) & ~(size_t)63;
+
+    rx->slots = aligned_alloc(64, (size_t)batch * rx->slot_bytes);
+    rx->msgs = calloc(batch, sizeof(*rx->msgs));
+    rx->iov = calloc(batch, sizeof(*rx->iov));
+    rx->control = calloc(batch, CONTROL_SPACE);
+    rx->names = calloc(batch, sizeof(*rx->names));
+    if (rx->slots == NULL || rx->msgs == NULL || rx->iov == NULL || rx->control == NULL ||
+        rx->names == NULL) {
+        udp_rx_free(rx);
+        errno = ENOMEM;
+        return -1;
+    }
+
+    for (int k = 0; k < batch; k++) {
+        rx->iov[k].iov_base = rx->slots + (size_t)k * rx->slot_bytes;
+        rx->iov[k].iov_len = rx->slot_bytes;
+        rx->msgs[k].msg_hdr.msg_iov = &rx->iov[k];
+        rx->msgs[k].msg_hdr.msg_iovlen = 1;
+        rx->msgs[k].msg_hdr.msg_control = rx->control + (size_t)k * CONTROL_SPACE;
+        rx->msgs[k].msg_hdr.msg_name = &rx->names[k];
+    }
+    return 0;
+}
+
+void udp_rx_free(UdpRx *rx) {
+    free(rx->slots);
+    free(rx->msgs);
+    free(rx->iov);
+    free(rx->control);
+    free(rx->names);
+    rx->slots = NULL;
+    rx->msgs = NULL;
+    rx->iov = NULL;
+    rx->control = NULL;
+    rx->names = NULL;
+}
+
+/**
+ * Read the control messages of one slot: the kernel drop counter and, for
+ * coalesced datagrams, the size of the original datagrams
+ */
+static size_t parse_control(UdpRx *rx, struct msghdr *msg) {
+    size_t segment = 0;
+
+    for (struct cmsghdr *cm = CMSG_FIRSTHDR(msg); cm != NULL; cm = CMSG_NXTHDR(msg, cm)) {
+        if (cm->cmsg_level == SOL_SOCKET && cm->cmsg_type == SO_RXQ_OVFL) {
+            uint32_t ovfl;
+            memcpy(&ovfl, CMSG_DATA(cm), sizeof(ovfl));
+            if (!rx->ovfl_seen) {
+                rx->ovfl_base = ovfl;
+                rx->ovfl_seen = 1;
+            }
+            rx->kernel_drops = (uint32_t)(ovfl - rx->ovfl_base);
+        } else if (cm->cmsg_level == SOL_UDP && cm->cmsg_type == UDP_GRO) {
+            int size;
+            memcpy(&size, CMSG_DATA(cm), sizeof(size));
+            segment = size > 0 ? (size_t)size : 0;
+        }
+    }
+    return segment;
+}
+
+/**
+ * Start handing out the datagrams of slot k
+ */
+static void select_slot(UdpRx *rx, int k) {
+    struct mmsghdr *m = &rx->msgs[k];
+
+    rx->current = k;
+    rx->offset = 0;
+    rx->length = m->msg_len;
+    rx->segment = parse_control(rx, &m->msg_hdr);
+    if (m->msg_hdr.msg_flags & MSG_TRUNC) {
+        rx->truncated++;
+        rx->segment = 0;
+    }
+    if (rx->segment == 0 || rx->segment >= rx->length) {
+        rx->segment = 0;
+        rx->left = 1;
+    } else {
+        rx->left = (int)((rx->length + rx->segment - 1) / rx->segment);
+    }
+}
+
+/**
+ * Receive the next batch into the slots
+ */
+static int refill(UdpRx *rx) {
+    for (int k = 0; k < rx->batch; k++) {
+        rx->msgs[k].msg_hdr.msg_controllen = CONTROL_SPACE;
+        rx->msgs[k].msg_hdr.msg_flags = 0;
+        rx->msgs[k].msg_hdr.msg_namelen = sizeof(rx->names[k]);
+    }
+
+    rx->syscalls++;
+    int n = recvmmsg(rx->fd, rx->msgs, rx->batch, MSG_WAITFORONE, NULL);
+    if (n <= 0) {
+        return -1;
+    }
+    rx->filled = n;
+    select_slot(rx, 0);
+    return 0;
+}
+
+ssize_t udp_rx_next(UdpRx *rx, const uint8_t **data) {
+    while (rx->left == 0) {
+        if (rx->current + 1 < rx->filled) {
+            select_slot(rx, rx->current + 1);
+        } else if (refill(rx) < 0) {
+            return -1;
+        }
+    }
+
+    size_t size = rx->length - rx->offset;
+    if (rx->segment != 0 && size > rx->segment) {
+        size = rx->segment;
+    }
+    *data = rx->slots + (size_t)rx->current * rx->slot_bytes + rx->offset;
+    rx->offset += size;
+    rx->left--;
+    rx->datagrams++;
+    return (ssize_t)size;
+}
+
+const struct sockaddr_in *udp_rx_source(const UdpRx *rx) {
+    return &rx->names[rx->current];
+}
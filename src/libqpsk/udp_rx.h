@@ -0,0 +1,104 @@
+/**
+ * Batched UDP Reception
+ *
+ * Receive engine for any consumer of the transmitters' frames. Datagrams
+ * are pulled with recvmmsg() into a set of preallocated slots, a batch per
+ * system call, and handed out one at a time by udp_rx_next(); the slots are
+ * refilled once the consumer has walked through all of them, so a frame
+ * stays valid until the next call.
+ *
+ * With GRO enabled (Linux 5.0) the kernel may coalesce consecutive
+ * datagrams of one flow into a single slot, e.g. the segments of a GSO send
+ * on loopback; udp_rx_next() splits them again, so the consumer always sees
+ * the original datagrams. Datagrams the kernel dropped because the socket
+ * buffer was full are counted through SO_RXQ_OVFL; with GRO one count may
+ * stand for a whole coalesced group. The sender of each datagram is kept
+ * as well, so a consumer can tell the flows of several senders apart.
+ */
+
+#ifndef QPSK_UDP_RX_H
+#define QPSK_UDP_RX_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+
+#define UDP_RX_MAX_BATCH 1024      // Largest number of slots
+#define UDP_RX_GRO_BYTES 65535     // Slot size needed for coalesced datagrams
+
+/**
+ * Batched receiver state
+ */
+typedef struct {
+    int fd;                           // Socket, owned by the caller
+    int gro;                          // Non-zero when UDP_GRO is enabled
+    size_t slot_bytes;                // Bytes per slot
+    int batch;                        // Number of slots
+    uint8_t *slots;                   // batch * slot_bytes bytes, 64-byte aligned
+    struct mmsghdr *msgs;
+    struct iovec *iov;
+    struct sockaddr_in *names;        // Sender of each slot
+    uint8_t *control;                 // SO_RXQ_OVFL and UDP_GRO control messages
+    int filled;                       // Slots holding data from the last recvmmsg()
+    int current;                      // Slot being handed out
+    size_t length;                    // Bytes stored in the current slot
+    size_t offset;                    // Position of the next datagram in the slot
+    size_t segment;                   // Datagram size within a coalesced slot (0 = one datagram)
+    int left;                         // Datagrams not yet handed out from the slot
+    uint32_t ovfl_base;               // First SO_RXQ_OVFL value seen
+    int ovfl_seen;
+    unsigned long long datagrams;     // Datagrams handed out
+    unsigned long long syscalls;      // Receive system calls issued
+    unsigned long long kernel_drops;  // Datagrams dropped by the kernel since the first batch
+    unsigned long long truncated;     // Datagrams cut off at the slot size
+} UdpRx;
+
+/**
+ * Size the socket receive buffer, going beyond rmem_max when permitted
+ *
+ * @param fd     UDP socket
+ * @param bytes  Requested size
+ * @return The size the kernel reports afterwards (it doubles the request
+ *         for bookkeeping), or -1 if it cannot be read
+ */
+int udp_rx_set_rcvbuf(int fd, int bytes);
+
+/**
+ * Set up a batched receiver on a bound UDP socket
+ *
+ * @param rx           Receiver to initialize
+ * @param fd           Bound UDP socket
+ * @param frame_bytes  Largest datagram expected
+ * @param batch        Slots, i.e. datagrams per recvmmsg() (1 to UDP_RX_MAX_BATCH)
+ * @param gro          Non-zero to request UDP_GRO; rx->gro tells whether it is on
+ * @return 0 on success, -1 on invalid arguments or allocation failure
+ */
+int udp_rx_init(UdpRx *rx, int fd, size_t frame_bytes, int batch, int gro);
+
+/**
+ * Release the slots (the socket is left open)
+ */
+void udp_rx_free(UdpRx *rx);
+
+/**
+ * Next received datagram, receiving a new batch when needed
+ *
+ * Blocks like recv() on the socket, so a receive timeout (SO_RCVTIMEO) or
+ * a signal ends the wait with -1 and errno EAGAIN or EINTR.
+ *
+ * @param rx    Receiver
+ * @param data  Set to the start of the datagram
+ * @return Length of the datagram, or -1 on error; a datagram larger than
+ *         frame_bytes is cut off at the slot size, which is always larger
+ *         than frame_bytes, so it never looks like a valid frame
+ */
+ssize_t udp_rx_next(UdpRx *rx, const uint8_t **data);
+
+/**
+ * Sender of the datagram last returned by udp_rx_next()
+ */
+const struct sockaddr_in *udp_rx_source(const UdpRx *rx);
+
+#endif /* QPSK_UDP_RX_H */
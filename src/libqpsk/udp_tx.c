@@ -0,0 +1,254 @@
+/**
+ * Batched UDP Transmission
+ */
+
+#define _GNU_SOURCE
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <netinet/udp.h>
+
+#include "udp_tx.h"
+
+#ifndef UDP_SEGMENT
+#define UDP_SEGMENT 103
+#endif
+
+static const char *mode_names[] = {
+    [UDP_TX_SENDTO]   = "sendto",
+    [UDP_TX_SENDMMSG] = "sendmmsg",
+    [UDP_TX_GSO]      = "gso",
+};
+
+#define MODES (sizeof(mode_names) / sizeof(mode_names[0]))
+#define CONTROL_SPACE CMSG_SPACE(sizeof(uint16_t))
+
+/**
+ * Errors that mean the kernel had no room for a frame right now
+ */
+static int is_drop(int err) {
+    return err == ENOBUFS || err == EAGAIN || err == EWOULDBLOCK || err == ECONNREFUSED;
+}
+
+/**
+ * Check that the kernel accepts UDP_SEGMENT on this socket
+ *
+ * The socket option would segment every send, so it is cleared again and
+ * the segment size is passed per message instead.
+ */
+static int gso_supported(int fd, size_t frame_bytes) {
+    int size = (int)frame_bytes;
+    if (setsockopt(fd, SOL_UDP, UDP_SEGMENT, &size, sizeof(size)) < 0) {
+        return 0;
+    }
+    size = 0;
+    setsockopt(fd, SOL_UDP, UDP_SEGMENT, &size, sizeof(size));
+    return 1;
+}
+
+/**
+ * Point the message buffers at tx->frames for the current mode
+ */
+static void point_messages(UdpTx *tx) {
+    int messages = tx->mode == UDP_TX_GSO ? (tx->batch + tx->segments - 1) / tx->segments : tx->batch;
+    int per_msg = tx->mode == UDP_TX_GSO ? tx->segments : 1;
+
+    for (int k = 0; k < messages; k++) {
+        tx->iov[k].iov_base = tx->frames + (size_t)k * per_msg * tx->frame_bytes;
+    }
+}
+
+/**
+ * Point the message headers at the frame buffer for the current mode
+ */
+static void build_messages(UdpTx *tx) {
+    int messages = tx->mode == UDP_TX_GSO ? (tx->batch + tx->segments - 1) / tx->segments : tx->batch;
+    int per_msg = tx->mode == UDP_TX_GSO ? tx->segments : 1;
+
+    memset(tx->msgs, 0, sizeof(*tx->msgs) * tx->batch);
+    point_messages(tx);
+    for (int k = 0; k < messages; k++) {
+        struct msghdr *msg = &tx->msgs[k].msg_hdr;
+        tx->iov[k].iov_len = per_msg * tx->frame_bytes;
+        msg->msg_name = &tx->dest;
+        msg->msg_namelen = sizeof(tx->dest);
+        msg->msg_iov = &tx->iov[k];
+        msg->msg_iovlen = 1;
+
+        if (tx->mode == UDP_TX_GSO) {
+            uint8_t *control = tx->control + (size_t)k * CONTROL_SPACE;
+            msg->msg_control = control;
+            msg->msg_controllen = CONTROL_SPACE;
+            struct cmsghdr *cm = CMSG_FIRSTHDR(msg);
+            cm->cmsg_level = SOL_UDP;
+            cm->cmsg_type = UDP_SEGMENT;
+            cm->cmsg_len = CMSG_LEN(sizeof(uint16_t));
+            uint16_t size = (uint16_t)tx->frame_bytes;
+            memcpy(CMSG_DATA(cm), &size, sizeof(size));
+        }
+    }
+}
+
+int udp_tx_init(UdpTx *tx, int fd, const struct sockaddr_in *dest, size_t frame_bytes,
+                int batch, UdpTxMode mode) {
+    memset(tx, 0, sizeof(*tx));
+    if (frame_bytes == 0 || frame_bytes > UDP_TX_MAX_PAYLOAD ||
+        batch < 1 || batch > UDP_TX_MAX_BATCH || (size_t)mode >= MODES) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    tx->fd = fd;
+    tx->dest = *dest;
+    tx->frame_bytes = frame_bytes;
+    tx->batch = batch;
+    tx->mode = mode;
+    tx->segments = (int)(UDP_TX_MAX_PAYLOAD / frame_bytes);
+    if (tx->segments > UDP_TX_MAX_SEGMENTS) {
+        tx->segments = UDP_TX_MAX_SEGMENTS;
+    }
+    if (mode == UDP_TX_GSO && (tx->segments < 2 || !gso_supported(fd, frame_bytes))) {
+        tx->mode = UDP_TX_SENDMMSG;
+    }
+
+    // Round the frame area up to whole cache lines for aligned_alloc
+    size_t area = ((size_t)batch * frame_bytes + 63) & ~(size_t)63;
+    tx->frames = aligned_alloc(64, area);
+    tx->msgs = calloc(batch, sizeof(*tx->msgs));
+    tx->iov = calloc(batch, sizeof(*tx->iov));
+    tx->control = calloc(batch, CONTROL_SPACE);
+    if (tx->frames == NULL || tx->msgs == NULL || tx->iov == NULL || tx->control == NULL) {
+        udp_tx_free(tx);
+        errno = ENOMEM;
+        return -1;
+    }
+    memset(tx->frames, 0, area);
+    build_messages(tx);
+    return 0;
+}
+
+void udp_tx_free(UdpTx *tx) {
+    free(tx->frames);
+    free(tx->msgs);
+    free(tx->iov);
+    free(tx->control);
+    tx->frames = NULL;
+    tx->msgs = NULL;
+    tx->iov = NULL;
+    tx->control = NULL;
+}
+
+/**
+ * Send frames one sendto() at a time
+ */
+static int flush_sendto(UdpTx *tx) {
+    for (int i = 0; i < tx->queued; i++) {
+        tx->syscalls++;
+        if (sendto(tx->fd, tx->frames + (size_t)i * tx->frame_bytes, tx->frame_bytes, 0,
+                   (struct sockaddr *)&tx->dest, sizeof(tx->dest)) < 0) {
+            if (!is_drop(errno)) {
+                return -1;
+            }
+            tx->dropped++;
+        } else {
+            tx->sent++;
+        }
+    }
+    return 0;
+}
+
+/**
+ * Send the queued frames with sendmmsg(), one message per frame or per
+ * GSO group; on a drop error the message at fault is skipped
+ */
+static int flush_mmsg(UdpTx *tx) {
+    int per_msg = tx->mode == UDP_TX_GSO ? tx->segments : 1;
+    int messages = (tx->queued + per_msg - 1) / per_msg;
+    int last_frames = tx->queued - (messages - 1) * per_msg;
+    int done = 0;
+
+    // The last message may carry fewer frames than the others
+    tx->iov[messages - 1].iov_len = (size_t)last_frames * tx->frame_bytes;
+
+    while (done < messages) {
+        tx->syscalls++;
+        int n = sendmmsg(tx->fd, tx->msgs + done, messages - done, 0);
+        if (n < 0) {
+            if (tx->mode == UDP_TX_GSO && (errno == EIO || errno == EINVAL) && done == 0) {
+                // The device cannot segment: rebuild for plain sendmmsg and retry
+                tx->iov[messages - 1].iov_len = (size_t)per_msg * tx->frame_bytes;
+                tx->mode = UDP_TX_SENDMMSG;
+                build_messages(tx);
+                return flush_mmsg(tx);
+            }
+            if (!is_drop(errno)) {
+                tx->iov[messages - 1].iov_len = (size_t)per_msg * tx->frame_bytes;
+                return -1;
+            }
+            tx->dropped += (done == messages - 1) ? last_frames : per_msg;
+            done++;
+            continue;
+        }
+        for (int k = done; k < done + n; k++) {
+            tx->sent += (k == messages - 1) ? last_frames : per_msg;
+        }
+        done += n;
+    }
+
+    tx->iov[messages - 1].iov_len = (size_t)per_msg * tx->frame_bytes;
+    return 0;
+}
+
+int udp_tx_flush(UdpTx *tx) {
+    if (tx->queued == 0) {
+        return 0;
+    }
+    int status = tx->mode == UDP_TX_SENDTO ? flush_sendto(tx) : flush_mmsg(tx);
+    tx->queued = 0;
+    return status;
+}
+
+int udp_tx_commit(UdpTx *tx) {
+    if (++tx->queued < tx->batch) {
+        return 0;
+    }
+    return udp_tx_flush(tx);
+}
+
+int udp_tx_send(UdpTx *tx, const void *frames, int count) {
+    if (udp_tx_flush(tx) < 0) {
+        return -1;
+    }
+
+    // Send straight from the caller's buffer, one batch at a time
+    uint8_t *own = tx->frames;
+    const uint8_t *next = frames;
+    int status = 0;
+    while (count > 0 && status == 0) {
+        int n = count < tx->batch ? count : tx->batch;
+        tx->frames = (uint8_t *)next;
+        point_messages(tx);
+        tx->queued = n;
+        status = udp_tx_flush(tx);
+        next += (size_t)n * tx->frame_bytes;
+        count -= n;
+    }
+    tx->frames = own;
+    point_messages(tx);
+    return status;
+}
+
+int udp_tx_parse_mode(const char *name, UdpTxMode *mode) {
+    for (size_t i = 0; i < MODES; i++) {
+        if (strcmp(name, mode_names[i]) == 0) {
+            *mode = (UdpTxMode)i;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+const char *udp_tx_mode_name(UdpTxMode mode) {
+    return (size_t)mode < MODES ? mode_names[mode] : "unknown";
+}
@@ -0,0 +1,127 @@
+/**
+ * Batched UDP Transmission
+ *
+ * Queues equally sized frames in a contiguous buffer and hands them to the
+ * kernel in as few system calls as possible:
+ *
+ *   - sendto:   one call per frame (the reference behaviour)
+ *   - sendmmsg: one call per batch, one message per frame
+ *   - gso:      one sendmmsg per batch where every message carries up to
+ *               64 KB of frames with UDP_SEGMENT, so the kernel splits them
+ *               into datagrams after a single pass through the stack
+ *
+ * The receiver sees the same datagrams in every mode. GSO needs Linux 4.18;
+ * when the kernel (or the outgoing device) rejects it the sender falls back
+ * to sendmmsg by itself. Frames that cannot be queued by the kernel
+ * (ENOBUFS, EAGAIN, ECONNREFUSED) are counted as dropped, not retried.
+ */
+
+#ifndef QPSK_UDP_TX_H
+#define QPSK_UDP_TX_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+#define UDP_TX_MAX_BATCH 1024      // Largest number of frames per flush
+#define UDP_TX_MAX_PAYLOAD 65507   // Largest UDP payload over IPv4
+#define UDP_TX_MAX_SEGMENTS 64     // Segments per GSO message accepted by all kernels
+
+/**
+ * Ways of handing frames to the kernel
+ */
+typedef enum {
+    UDP_TX_SENDTO,
+    UDP_TX_SENDMMSG,
+    UDP_TX_GSO
+} UdpTxMode;
+
+/**
+ * Batched sender state
+ */
+typedef struct {
+    int fd;                           // Socket, owned by the caller
+    struct sockaddr_in dest;          // Destination of every frame
+    UdpTxMode mode;                   // Mode in use (may fall back from GSO)
+    size_t frame_bytes;               // Size of every frame
+    int batch;                        // Frames per flush
+    int queued;                       // Frames waiting in the buffer
+    int segments;                     // Frames per GSO message
+    uint8_t *frames;                  // batch * frame_bytes bytes, 64-byte aligned, zeroed
+    struct mmsghdr *msgs;             // One per frame (one per GSO message in gso mode)
+    struct iovec *iov;
+    uint8_t *control;                 // UDP_SEGMENT control messages
+    unsigned long long sent;          // Frames accepted by the kernel
+    unsigned long long dropped;       // Frames the kernel had no room for
+    unsigned long long syscalls;      // Send system calls issued
+} UdpTx;
+
+/**
+ * Set up a batched sender on an existing UDP socket
+ *
+ * @param tx           Sender to initialize
+ * @param fd           UDP socket
+ * @param dest         Destination address
+ * @param frame_bytes  Size of every frame (at most UDP_TX_MAX_PAYLOAD)
+ * @param batch        Frames per flush (1 to UDP_TX_MAX_BATCH)
+ * @param mode         Requested mode; tx->mode holds the mode actually used
+ * @return 0 on success, -1 on invalid arguments or allocation failure
+ */
+int udp_tx_init(UdpTx *tx, int fd, const struct sockaddr_in *dest, size_t frame_bytes,
+                int batch, UdpTxMode mode);
+
+/**
+ * Release the buffers (the socket is left open)
+ */
+void udp_tx_free(UdpTx *tx);
+
+/**
+ * Buffer for the next frame; fill it, then call udp_tx_commit()
+ *
+ * Slots are zeroed once at initialization and reused, so bytes not written
+ * keep whatever the previous frame in the same slot left there.
+ */
+static inline void *udp_tx_slot(UdpTx *tx) {
+    return tx->frames + (size_t)tx->queued * tx->frame_bytes;
+}
+
+/**
+ * Queue the frame written to udp_tx_slot(), flushing when the batch is full
+ *
+ * @return 0 on success, -1 on a send error other than a full buffer (errno set)
+ */
+int udp_tx_commit(UdpTx *tx);
+
+/**
+ * Send all queued frames now
+ *
+ * @return 0 on success, -1 on a send error other than a full buffer (errno set)
+ */
+int udp_tx_flush(UdpTx *tx);
+
+/**
+ * Send frames that are already laid out back to back in the caller's
+ * memory, without copying them into the sender's buffer
+ *
+ * Frames queued with udp_tx_commit() are flushed first, so the order is kept.
+ *
+ * @param frames  count * frame_bytes bytes
+ * @param count   Number of frames
+ * @return 0 on success, -1 on a send error other than a full buffer (errno set)
+ */
+int udp_tx_send(UdpTx *tx, const void *frames, int count);
+
+/**
+ * Look up a mode by name ("sendto", "sendmmsg", "gso")
+ *
+ * @return 1 if the name is known, 0 otherwise
+ */
+int udp_tx_parse_mode(const char *name, UdpTxMode *mode);
+
+/**
+ * Printable name of a mode
+ */
+const char *udp_tx_mode_name(UdpTxMode mode);
+
+#endif /* QPSK_UDP_TX_H */
@@ -4,8 +4,8 @@
  * This program demonstrates Quadrature Phase Shift Keying (QPSK) modulation,
  * a digital modulation technique that encodes two bits per symbol.
  * 
- * Compile with: gcc -o qpsk_demo QPSK.c -lm
- * Run with: ./qpsk_demo
+ * Compile with: make bin/qpsk (links bin/libqpsk.a)
+ * Run with: ./bin/qpsk
  */
 
 #include <stdio.h>
@@ -13,23 +13,28 @@
 #include <time.h>
 #include <math.h>
 
+#include "../libqpsk/bitsrc.h"
+#include "../libqpsk/qpsk_map.h"
+
 #define BITS_COUNT 40        // Total number of random bits to generate
 #define SYMBOLS_COUNT 20     // Number of QPSK symbols (each symbol encodes 2 bits)
 
 int main() {
-    int i, j, bit1, bit2;
-    double symbol_I, symbol_Q, symbol_magnitude, symbol_phase;
+    int i;
     
-    // Initialize random number generator with current time as seed
-    srand(time(0));
+    // Initialize the bit source with current time as seed
+    unsigned long long seed = time(0);
+    BitSource source;
+    bitsrc_init(&source, BITSRC_RANDOM, seed);
 
     // Step 1: Generate random data bits
     printf("Random Generator for %d data bits:\n", BITS_COUNT);
+    uint8_t packed_bits[BITS_COUNT / 8];
     int data_bits[BITS_COUNT];
+    bitsrc_fill_bytes(&source, packed_bits, sizeof(packed_bits));
+    bitsrc_unpack(packed_bits, BITS_COUNT, data_bits);
     printf("data_bit[] = {");
     for (i = 0; i < BITS_COUNT; i++) {
-        // Generate a random binary data bit (0 or 1)
-        data_bits[i] = rand() % 2; 
         printf("%d", data_bits[i]);
         if (i < BITS_COUNT - 1) {
             printf(",");
@@ -41,37 +46,17 @@ int main() {
     // Each QPSK symbol represents 2 bits of data
     printf("QPSK modulation for %d symbols:\n", SYMBOLS_COUNT);
     double symbols_I[SYMBOLS_COUNT], symbols_Q[SYMBOLS_COUNT];
-    for (i = 0, j = 0; i < BITS_COUNT; i += 2, j++) {
-        bit1 = data_bits[i];         // First bit
-        bit2 = data_bits[i+1];       // Second bit
-
-        // Map the two bits to a QPSK symbol
-        // The mapping follows Gray code to minimize bit errors:
-        // 00 -> (+1/√2, +1/√2)  | First quadrant
-        // 01 -> (-1/√2, +1/√2)  | Second quadrant
-        // 10 -> (+1/√2, -1/√2)  | Fourth quadrant
-        // 11 -> (-1/√2, -1/√2)  | Third quadrant
-        if (bit1 == 0 && bit2 == 0) {
-            symbol_I = 1 / sqrt(2);   // Real part (I)
-            symbol_Q = 1 / sqrt(2);   // Imaginary part (Q)
-        } else if (bit1 == 0 && bit2 == 1) {
-            symbol_I = -1 / sqrt(2);
-            symbol_Q = 1 / sqrt(2);
-        } else if (bit1 == 1 && bit2 == 0) {
-            symbol_I = 1 / sqrt(2);
-            symbol_Q = -1 / sqrt(2);
-        } else if (bit1 == 1 && bit2 == 1) {
-            symbol_I = -1 / sqrt(2);
-            symbol_Q = -1 / sqrt(2);
-        }
 
-        // Store the I and Q components of the symbol
-        symbols_I[j] = symbol_I;
-        symbols_Q[j] = symbol_Q;
+    // Map each pair of bits to a QPSK symbol
+    // The mapping follows Gray code to minimize bit errors:
+    // 00 -> (+1/√2, +1/√2)  | First quadrant
+    // 01 -> (-1/√2, +1/√2)  | Second quadrant
+    // 10 -> (+1/√2, -1/√2)  | Fourth quadrant
+    // 11 -> (-1/√2, -1/√2)  | Third quadrant
+    qpsk_modulate(data_bits, SYMBOLS_COUNT, symbols_I, symbols_Q);
 
-        // Uncomment to print each symbol
-        // printf("Symbol %d: (%f,%f)\n", j+1, symbol_I, symbol_Q);
-    }
+    // Uncomment to print each symbol
+    // for (i = 0; i < SYMBOLS_COUNT; i++) printf("Symbol %d: (%f,%f)\n", i+1, symbols_I[i], symbols_Q[i]);
 
     // Step 3: Output the QPSK symbols in arrays of real and imaginary parts
     printf("QPSK modulation for %d symbols:\n", SYMBOLS_COUNT);
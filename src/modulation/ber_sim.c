@@ -0,0 +1,296 @@
+/**
+ * QPSK Bit Error Rate Simulation
+ *
+ * This program measures the bit and symbol error rates of QPSK over an
+ * AWGN channel across a sweep of Eb/N0 values, with the same mapping,
+ * noise and demapping code the transmitters and the receiver use.
+ *
+ * Each point runs random trials on all cores until it has seen the target
+ * number of bit errors (or the bit limit), so low Eb/N0 points finish
+ * quickly and high ones run as long as they need to. The results are
+ * written as CSV with Wilson confidence intervals next to the theoretical
+ * curve, one line per point:
+ *
+ *   ebn0_db,esn0_db,bits,bit_errors,ber,ber_lo,ber_hi,ber_theory,
+ *   symbols,symbol_errors,ser,ser_lo,ser_hi,ser_theory,seconds
+ *
+ * --code runs the bits through the convolutional code of conv.h and its
+ * soft-decision Viterbi decoder, so the bit error rate is the one after
+ * decoding against the uncoded theory, while the symbol error rate stays
+ * that of the channel at its Es/N0. The progress lines then also give the
+ * decoder's throughput in data Mbit/s per thread, which makes ber_sim the
+ * benchmark of the decoder's instruction sets (see --isa).
+ *
+ * Compile with: make bin/ber_sim (links bin/libqpsk.a)
+ * Run with: ./bin/ber_sim [options]
+ *
+ * Options:
+ *   -e, --ebn0 LIST       Eb/N0 points in dB: values and start:step:stop ranges,
+ *                         separated by commas (default 0:1:10)
+ *   -E, --errors N        Bit errors after which a point stops (default 1000)
+ *   -b, --max-bits N      Bits after which a point stops anyway (default 1e10)
+ *   -t, --threads N       Worker threads (default: one per CPU)
+ *   -c, --confidence P    Confidence level of the intervals (default 0.95)
+ *   -S, --seed N          Seed of the random streams (default: current time)
+ *   -o, --output FILE     Write the CSV to FILE instead of stdout
+ *   -v, --verbosity LEVEL quiet or summary: progress on stderr (default summary)
+ *   -C, --code RATE       Convolutional code: none, 1/2, 2/3 or 3/4 (default none)
+ *   -I, --isa NAME        Decoder instruction set: scalar, sse2 or avx2 (default: best available)
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <math.h>
+#include <getopt.h>
+
+#include "../libqpsk/awgn.h"
+#include "../libqpsk/bersim.h"
+#include "../libqpsk/conv.h"
+#include "../libqpsk/cpu.h"
+#include "../libqpsk/trace.h"
+
+#define MAX_POINTS 256            // Longest Eb/N0 sweep
+#define DEFAULT_SWEEP "0:1:10"    // Eb/N0 points in dB
+#define CONFIDENCE 0.95           // Default confidence level
+
+/**
+ * Print command line usage
+ */
+static void usage(const char *prog) {
+    printf("Usage: %s [options]\n", prog);
+    printf("  -e, --ebn0 LIST       Eb/N0 points in dB: values and start:step:stop ranges,\n");
+    printf("                        separated by commas (default %s)\n", DEFAULT_SWEEP);
+    printf("  -E, --errors N        Bit errors after which a point stops (default 1000)\n");
+    printf("  -b, --max-bits N      Bits after which a point stops anyway (default 1e10)\n");
+    printf("  -t, --threads N       Worker threads (default: one per CPU)\n");
+    printf("  -c, --confidence P    Confidence level of the intervals (default %.2f)\n", CONFIDENCE);
+    printf("  -S, --seed N          Seed of the random streams (default: current time)\n");
+    printf("  -o, --output FILE     Write the CSV to FILE instead of stdout\n");
+    printf("  -v, --verbosity LEVEL quiet or summary: progress on stderr (default summary)\n");
+    printf("  -C, --code RATE       Convolutional code: none, 1/2, 2/3 or 3/4 (default none)\n");
+    printf("  -I, --isa NAME        Decoder instruction set: scalar, sse2 or avx2 (default: best available)\n");
+}
+
+/**
+ * Expand a list like "0:0.5:4,6,8" into Eb/N0 points
+ *
+ * @return Number of points, or -1 if the list is malformed or too long
+ */
+static int parse_sweep(const char *list, double *points, int max_points) {
+    int n = 0;
+    const char *p = list;
+
+    while (*p != '\0') {
+        char *end;
+        double start = strtod(p, &end);
+        if (end == p) {
+            return -1;
+        }
+        p = end;
+        if (*p == ':') {
+            double step = strtod(p + 1, &end);
+            if (end == p + 1 || *end != ':' || !(step > 0)) {
+                return -1;
+            }
+            p = end + 1;
+            double stop = strtod(p, &end);
+            if (end == p) {
+                return -1;
+            }
+            p = end;
+            // Index the range instead of accumulating the step, so 0:0.1:1 ends at 1
+            for (long i = 0; start + i * step <= stop + 1e-9 * step; i++) {
+                if (n == max_points) {
+                    return -1;
+                }
+                points[n++] = start + i * step;
+            }
+        } else {
+            if (n == max_points) {
+                return -1;
+            }
+            points[n++] = start;
+        }
+        if (*p == ',') {
+            p++;
+        } else if (*p != '\0') {
+            return -1;
+        }
+    }
+    return n;
+}
+
+/**
+ * Standard normal quantile z with P(|Z| <= z) = level, by bisection
+ */
+static double two_sided_z(double level) {
+    double lo = 0.0, hi = 40.0;
+    for (int i = 0; i < 100; i++) {
+        double mid = 0.5 * (lo + hi);
+        if (erf(mid / sqrt(2.0)) < level) {
+            lo = mid;
+        } else {
+            hi = mid;
+        }
+    }
+    return 0.5 * (lo + hi);
+}
+
+/**
+ * Write one point as a CSV line
+ *
+ * The symbol error theory is that of the channel's Es/N0, which only
+ * differs from the bits' with a code.
+ */
+static void write_point(FILE *out, const BerSimPoint *pt, ConvRate code, double z) {
+    double esn0_db = bersim_esn0_db(code, pt->ebn0_db);
+    double channel_ebn0_db = esn0_db - 10.0 * log10((double)QPSK_BITS_PER_SYMBOL);
+    double ber = pt->bits ? (double)pt->bit_errors / pt->bits : 0.0;
+    double ser = pt->symbols ? (double)pt->symbol_errors / pt->symbols : 0.0;
+    double ber_lo, ber_hi, ser_lo, ser_hi;
+
+    bersim_interval(pt->bit_errors, pt->bits, z, &ber_lo, &ber_hi);
+    bersim_interval(pt->symbol_errors, pt->symbols, z, &ser_lo, &ser_hi);
+    fprintf(out, "%.2f,%.2f,%llu,%llu,%.6e,%.6e,%.6e,%.6e,%llu,%llu,%.6e,%.6e,%.6e,%.6e,%.3f\n",
+            pt->ebn0_db, esn0_db,
+            pt->bits, pt->bit_errors, ber, ber_lo, ber_hi, bersim_qpsk_ber(pt->ebn0_db),
+            pt->symbols, pt->symbol_errors, ser, ser_lo, ser_hi, bersim_qpsk_ser(channel_ebn0_db),
+            pt->seconds);
+    fflush(out);
+}
+
+int main(int argc, char *argv[]) {
+    BerSimConfig config;
+    bersim_defaults(&config);
+    const char *sweep = DEFAULT_SWEEP;
+    const char *output = NULL;
+    double confidence = CONFIDENCE;
+    TraceLevel verbosity = TRACE_SUMMARY;
+    unsigned long long seed = 0;
+    int seed_given = 0;
+    static const struct option long_opts[] = {
+        { "ebn0",       required_argument, NULL, 'e' },
+        { "errors",     required_argument, NULL, 'E' },
+        { "max-bits",   required_argument, NULL, 'b' },
+        { "threads",    required_argument, NULL, 't' },
+        { "confidence", required_argument, NULL, 'c' },
+        { "seed",       required_argument, NULL, 'S' },
+        { "output",     required_argument, NULL, 'o' },
+        { "verbosity",  required_argument, NULL, 'v' },
+        { "code",       required_argument, NULL, 'C' },
+        { "isa",        required_argument, NULL, 'I' },
+        { "help",       no_argument,       NULL, 'h' },
+        { NULL, 0, NULL, 0 }
+    };
+    int opt;
+
+    while ((opt = getopt_long(argc, argv, "e:E:b:t:c:S:o:v:C:I:h", long_opts, NULL)) != -1) {
+        switch (opt) {
+        case 'e': sweep = optarg; break;
+        case 'E': config.target_errors = (unsigned long long)strtod(optarg, NULL); break;
+        case 'b': config.max_bits = (unsigned long long)strtod(optarg, NULL); break;
+        case 't': config.threads = atoi(optarg); break;
+        case 'c': confidence = atof(optarg); break;
+        case 'S': seed = strtoull(optarg, NULL, 0); seed_given = 1; break;
+        case 'o': output = optarg; break;
+        case 'v':
+            if (!trace_parse_level(optarg, &verbosity)) {
+                fprintf(stderr, "Unknown verbosity: %s\n", optarg);
+                return 1;
+            }
+            break;
+        case 'C':
+            if (!conv_parse_rate(optarg, &config.code)) {
+                fprintf(stderr, "Unknown code rate: %s\n", optarg);
+                return 1;
+            }
+            break;
+        case 'I': {
+            QpskIsa isa;
+            if (!qpsk_parse_isa(optarg, &isa)) {
+                fprintf(stderr, "Unknown instruction set: %s\n", optarg);
+                return 1;
+            }
+            if (conv_set_isa(isa) != isa) {
+                fprintf(stderr, "Instruction set %s not available, using %s\n",
+                        optarg, qpsk_isa_name(conv_isa()));
+            }
+            break;
+        }
+        case 'h': usage(argv[0]); return 0;
+        default:  usage(argv[0]); return 1;
+        }
+    }
+
+    double points[MAX_POINTS];
+    int count = parse_sweep(sweep, points, MAX_POINTS);
+    if (count <= 0) {
+        fprintf(stderr, "Invalid Eb/N0 list: %s\n", sweep);
+        return 1;
+    }
+    if (config.target_errors < 1 || config.max_bits < 1) {
+        fprintf(stderr, "Error target and bit limit must be positive\n");
+        return 1;
+    }
+    if (!(confidence > 0.0 && confidence < 1.0)) {
+        fprintf(stderr, "Confidence level must be between 0 and 1\n");
+        return 1;
+    }
+    if (!seed_given) {
+        seed = time(0);
+    }
+    double z = two_sided_z(confidence);
+
+    FILE *out = stdout;
+    if (output != NULL && (out = fopen(output, "w")) == NULL) {
+        perror(output);
+        return 1;
+    }
+
+    if (verbosity >= TRACE_SUMMARY) {
+        fprintf(stderr, "Simulating %d Eb/N0 points, %llu bit errors or %.3g bits each, seed %llu\n",
+                count, config.target_errors, (double)config.max_bits, seed);
+        if (config.code != CONV_NONE) {
+            fprintf(stderr, "Convolutional code: rate %s, K=%d, soft-decision Viterbi decoder (%s)\n",
+                    conv_rate_name(config.code), CONV_K, qpsk_isa_name(conv_isa()));
+        }
+    }
+    fprintf(out, "ebn0_db,esn0_db,bits,bit_errors,ber,ber_lo,ber_hi,ber_theory,"
+                 "symbols,symbol_errors,ser,ser_lo,ser_hi,ser_theory,seconds\n");
+
+    // Steps 1-3: Map, add noise and demap random bits at every point
+    int status = 0;
+    for (int i = 0; i < count; i++) {
+        BerSimPoint pt;
+        config.seed = seed + i;  // Independent streams for every point
+        if (bersim_run(&config, points[i], &pt) < 0) {
+            fprintf(stderr, "Cannot start the worker threads\n");
+            status = 1;
+            break;
+        }
+
+        // Step 4: Report the rates with their confidence intervals
+        write_point(out, &pt, config.code, z);
+        if (verbosity >= TRACE_SUMMARY) {
+            double ber = pt.bits ? (double)pt.bit_errors / pt.bits : 0.0;
+            double lo, hi;
+            bersim_interval(pt.bit_errors, pt.bits, z, &lo, &hi);
+            fprintf(stderr, "Eb/N0 %5.2f dB: BER %.3e [%.3e, %.3e] (theory %.3e), "
+                            "%llu errors in %.3g bits, %.2f s, %.0f Mbit/s",
+                    pt.ebn0_db, ber, lo, hi, bersim_qpsk_ber(pt.ebn0_db),
+                    pt.bit_errors, (double)pt.bits, pt.seconds,
+                    pt.seconds > 0 ? pt.bits / pt.seconds * 1e-6 : 0.0);
+            if (pt.decode_seconds > 0) {
+                fprintf(stderr, ", decoder %.1f Mbit/s per thread", pt.bits / pt.decode_seconds * 1e-6);
+            }
+            fprintf(stderr, "\n");
+        }
+    }
+
+    if (out != stdout) {
+        fclose(out);
+    }
+    return status;
+}
@@ -4,8 +4,8 @@
  * This program demonstrates QPSK modulation using complex numbers and 
  * adds random noise to simulate a realistic communication channel.
  * 
- * Compile with: gcc -o noise_combo noise_combo.c -lm
- * Run with: ./noise_combo
+ * Compile with: make bin/noise_combo (links bin/libqpsk.a)
+ * Run with: ./bin/noise_combo
  */
 
 #include <stdio.h>
@@ -13,61 +13,36 @@
 #include <time.h>
 #include <math.h>
 
+#include "../libqpsk/awgn.h"
+#include "../libqpsk/bitsrc.h"
+#include "../libqpsk/qpsk_map.h"
+
 #define BITS_COUNT 40        // Total number of random bits to generate
 #define SYMBOLS_COUNT 20     // Number of QPSK symbols (each symbol encodes 2 bits)
-#define NOISE_STD_DEV 0.05   // Standard deviation of noise to be added to symbols
-
-/**
- * Structure to represent a complex number with real and imaginary parts
- */
-typedef struct {
-    double real;
-    double imag;
-} Complex;
+#define ES_N0_DB 23.0        // Channel Es/N0 in dB (noise std dev of about 0.05)
 
 int main() {
-    int i, j, bit1, bit2;
+    int i;
 
-    // Initialize random number generator with current time as seed
-    srand(time(0));
+    // Initialize the bit source with current time as seed
+    unsigned long long seed = time(0);
+    BitSource source;
+    bitsrc_init(&source, BITSRC_RANDOM, seed);
 
     // Step 1: Generate random data bits
+    uint8_t packed_bits[BITS_COUNT / 8];
     int data_bits[BITS_COUNT];
-    for (i = 0; i < BITS_COUNT; i++) {
-        // Generate a random binary data bit (0 or 1)
-        data_bits[i] = rand() % 2;
-    }
+    bitsrc_fill_bytes(&source, packed_bits, sizeof(packed_bits));
+    bitsrc_unpack(packed_bits, BITS_COUNT, data_bits);
 
     // Step 2: Perform QPSK modulation and add noise to create symbols
     Complex symbols[SYMBOLS_COUNT];
-    for (i = 0, j = 0; i < BITS_COUNT; i += 2, j++) {
-        bit1 = data_bits[i];
-        bit2 = data_bits[i + 1];
+    qpsk_modulate_complex(data_bits, SYMBOLS_COUNT, symbols);
 
-        // Map the two bits to a symbol using QPSK modulation
-        Complex symbol;
-        if (bit1 == 0 && bit2 == 0) {
-            symbol.real = 1 / sqrt(2);
-            symbol.imag = 1 / sqrt(2);
-        } else if (bit1 == 0 && bit2 == 1) {
-            symbol.real = -1 / sqrt(2);
-            symbol.imag = 1 / sqrt(2);
-        } else if (bit1 == 1 && bit2 == 0) {
-            symbol.real = 1 / sqrt(2);
-            symbol.imag = -1 / sqrt(2);
-        } else if (bit1 == 1 && bit2 == 1) {
-            symbol.real = -1 / sqrt(2);
-            symbol.imag = -1 / sqrt(2);
-        }
-
-        // Add noise to the symbols
-        double noise_real = NOISE_STD_DEV * (2 * ((double)rand() / RAND_MAX) - 1);
-        double noise_imag = NOISE_STD_DEV * (2 * ((double)rand() / RAND_MAX) - 1);
-        symbol.real += noise_real;
-        symbol.imag += noise_imag;
-
-        symbols[j] = symbol;
-    }
+    // Add Gaussian noise to the symbols
+    Awgn channel;
+    awgn_init(&channel, seed + 1, ES_N0_DB);  // Independent stream from the bits
+    awgn_add_complex(&channel, symbols, SYMBOLS_COUNT);
 
     // Step 3: Output the combined array of symbols
     printf("Combined array of symbols:\n");
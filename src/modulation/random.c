@@ -1,41 +1,171 @@
 /**
  * Random Bit Generator
- * 
+ *
  * This program generates random binary data bits that can be used
  * as input for digital modulation schemes like QPSK.
- * 
- * Compile with: gcc -o random random.c
- * Run with: ./random
+ *
+ * Bits come from the library's packed bit source: uniform random bits or
+ * a PRBS-7/15/23/31 test sequence. By default a short array is printed as
+ * text; with --binary the packed bytes (most significant bit first) are
+ * streamed to stdout or a file in large blocks.
+ *
+ * Compile with: make bin/random (links bin/libqpsk.a)
+ * Run with: ./bin/random [options]
+ *
+ * Options:
+ *   -n, --bits N          Number of bits to generate (default 40, 0 = endless with --binary)
+ *   -p, --pattern NAME    random, prbs7, prbs15, prbs23 or prbs31 (default random)
+ *   -s, --seed N          Random seed, or PRBS start state (default: current time / all ones)
+ *   -b, --binary          Write packed bytes instead of a text array
+ *   -o, --output FILE     Write to FILE instead of stdout
  */
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <time.h>
+#include <getopt.h>
 
-#define BITS_COUNT 40  // Total number of random bits to generate
+#include "../libqpsk/bitsrc.h"
 
-int main() {
-    int i;
-    
-    // Initialize random number generator with current time as seed
-    srand(time(0));  
+#define BITS_COUNT 40          // Default number of random bits to generate
+#define CHUNK_BYTES (1 << 20)  // Block size for binary output
+
+/**
+ * Current value of the monotonic clock in seconds
+ */
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/**
+ * Print bits as the original comma-separated array
+ */
+static void write_text(FILE *out, BitSource *source, unsigned long long bits) {
+    uint8_t byte = 0;
+
+    fprintf(out, "data_bit[] = {");
+    for (unsigned long long i = 0; i < bits; i++) {
+        if ((i & 7) == 0) {
+            bitsrc_fill_bytes(source, &byte, 1);
+        }
 
-    // Generate and output the random data bits
-    printf("Random Generator:\n");
-    int data_bits[BITS_COUNT];
-    printf("data_bit[] = {");
-    
-    for (i = 0; i < BITS_COUNT; i++) {
-        // Generate a random binary data bit (0 or 1)
-        data_bits[i] = rand() % 2;  
-        
         // Print the bit with appropriate formatting
-        printf("%d", data_bits[i]);
-        if (i < BITS_COUNT - 1) {
-            printf(",");
+        fprintf(out, "%d", (byte >> (7 - (i & 7))) & 1);
+        if (i < bits - 1) {
+            fprintf(out, ",");
+        }
+    }
+    fprintf(out, "}\n");
+}
+
+/**
+ * Stream packed bytes in large blocks; bits == 0 runs until the output closes
+ */
+static int write_binary(FILE *out, BitSource *source, unsigned long long bits) {
+    static uint8_t chunk[CHUNK_BYTES];
+    unsigned long long remaining = (bits + 7) / 8;
+    unsigned long long written = 0;
+    double start = now_seconds();
+
+    while (bits == 0 || remaining > 0) {
+        size_t n = (bits == 0 || remaining > CHUNK_BYTES) ? CHUNK_BYTES : (size_t)remaining;
+        bitsrc_fill_bytes(source, chunk, n);
+
+        // Clear unused low bits of the final byte
+        if (bits != 0 && n == remaining && (bits & 7) != 0) {
+            chunk[n - 1] &= (uint8_t)(0xFF << (8 - (bits & 7)));
+        }
+        if (fwrite(chunk, 1, n, out) != n) {
+            break;
         }
+        written += n;
+        remaining -= (bits == 0) ? 0 : n;
+    }
+    fflush(out);
+
+    double elapsed = now_seconds() - start;
+    if (elapsed > 0) {
+        fprintf(stderr, "Wrote %llu bytes in %.3f s (%.2f GB/s)\n",
+                written, elapsed, written / elapsed / 1e9);
+    }
+    return bits != 0 && remaining > 0;
+}
+
+static void usage(const char *prog) {
+    printf("Usage: %s [options]\n", prog);
+    printf("  -n, --bits N          Number of bits (default %d, 0 = endless with --binary)\n", BITS_COUNT);
+    printf("  -p, --pattern NAME    random, prbs7, prbs15, prbs23 or prbs31 (default random)\n");
+    printf("  -s, --seed N          Random seed, or PRBS start state (default: current time / all ones)\n");
+    printf("  -b, --binary          Write packed bytes instead of a text array\n");
+    printf("  -o, --output FILE     Write to FILE instead of stdout\n");
+}
+
+int main(int argc, char *argv[]) {
+    unsigned long long bits = BITS_COUNT;
+    BitSourceType pattern = BITSRC_RANDOM;
+    unsigned long long seed = 0;
+    int seed_given = 0;
+    int binary = 0;
+    const char *output = NULL;
+    static const struct option long_opts[] = {
+        { "bits",    required_argument, NULL, 'n' },
+        { "pattern", required_argument, NULL, 'p' },
+        { "seed",    required_argument, NULL, 's' },
+        { "binary",  no_argument,       NULL, 'b' },
+        { "output",  required_argument, NULL, 'o' },
+        { "help",    no_argument,       NULL, 'h' },
+        { NULL, 0, NULL, 0 }
+    };
+    int opt;
+
+    while ((opt = getopt_long(argc, argv, "n:p:s:bo:h", long_opts, NULL)) != -1) {
+        switch (opt) {
+        case 'n': bits = strtoull(optarg, NULL, 10); break;
+        case 's': seed = strtoull(optarg, NULL, 0); seed_given = 1; break;
+        case 'b': binary = 1; break;
+        case 'o': output = optarg; break;
+        case 'p':
+            if (!bitsrc_parse_type(optarg, &pattern)) {
+                fprintf(stderr, "Unknown pattern: %s\n", optarg);
+                return 1;
+            }
+            break;
+        case 'h': usage(argv[0]); return 0;
+        default:  usage(argv[0]); return 1;
+        }
+    }
+    if (bits == 0 && !binary) {
+        fprintf(stderr, "Endless output (-n 0) requires --binary\n");
+        return 1;
+    }
+
+    FILE *out = stdout;
+    if (output != NULL && (out = fopen(output, "wb")) == NULL) {
+        perror(output);
+        return 1;
+    }
+
+    // Initialize the bit source with current time as seed unless one was given
+    if (!seed_given && pattern == BITSRC_RANDOM) {
+        seed = time(0);
+    }
+    BitSource source;
+    bitsrc_init(&source, pattern, seed);
+
+    // Generate and output the random data bits
+    int status = 0;
+    if (binary) {
+        status = write_binary(out, &source, bits);
+    } else {
+        fprintf(out, "Random Generator:\n");
+        write_text(out, &source, bits);
+    }
+
+    if (out != stdout) {
+        fclose(out);
     }
-    printf("}\n");
-    
-    return 0;
+    return status;
 }
@@ -1,13 +1,27 @@
 /**
  * UDP ASCII Transmission of QPSK Symbols
- * 
+ *
  * This program demonstrates generating QPSK modulated symbols with noise,
  * converting them to ASCII text representation, and sending them via UDP.
- * 
- * Compile with: gcc -o udp_ascii UDP_ASCII.c -lm
- * Run with: ./udp_ascii
- * 
- * Note: Configure the IP address and port before running.
+ *
+ * The text is "(re,im),(re,im),..." with a fixed number of decimals, as
+ * printf("%f") would write it but produced by the library's formatter
+ * (see ascii.h). Streams longer than one datagram are split at symbol
+ * boundaries into datagrams that fit the path MTU, each of them valid
+ * text on its own. Every datagram but the last carries a multiple of four
+ * symbols, so udp_receiver can check the bits of each one against the
+ * transmitter's bit source.
+ *
+ * Compile with: make bin/udp_ascii (links bin/libqpsk.a)
+ * Run with: ./bin/udp_ascii [options] [config_file]
+ *
+ * Options:
+ *   -m, --symbols N       Symbols to send (default 20)
+ *   -d, --decimals D      Digits after the decimal point, 0-9 (default 6)
+ *   -M, --mtu BYTES       Path MTU each datagram must fit in (default 1500)
+ *   -e, --esn0 DB         Channel Es/N0 in dB (default 17)
+ *   -p, --pattern NAME    Data bits: random, prbs7, prbs15, prbs23 or prbs31 (default random)
+ *   -S, --seed N          Bit source seed, or PRBS start state (default: current time / all ones)
  */
 
 #include <stdio.h>
@@ -20,89 +34,135 @@
 #include <arpa/inet.h>
 #include <time.h>
 #include <math.h>
+#include <getopt.h>
 
-#define BITS_COUNT 40          // Total number of random bits to generate
-#define SYMBOLS_COUNT 20       // Number of QPSK symbols (each symbol encodes 2 bits)
-#define NOISE_STD_DEV 0.1      // Standard deviation of noise to be added to symbols
-#define BUFFER_SIZE 256        // Size of the buffer for data transmission
+#include "../../config/config.h"
+#include "../libqpsk/ascii.h"
+#include "../libqpsk/awgn.h"
+#include "../libqpsk/bitsrc.h"
+#include "../libqpsk/frame.h"
+#include "../libqpsk/qpsk_map.h"
+
+#define SYMBOLS_COUNT 20       // Default number of QPSK symbols (each symbol encodes 2 bits)
+#define DISPLAY_SYMBOLS 256    // Longest stream that is also printed
+#define ES_N0_DB 17.0          // Channel Es/N0 in dB (noise std dev of about 0.1)
+#define SYMBOL_ALIGN 4         // Symbols per bit-source byte
+
+#define CONFIG_FILE "config/udp_config.txt"  // Default configuration file path
 
 /**
- * Structure to represent a complex number with real and imaginary parts
+ * Print command line usage
  */
-typedef struct {
-    double real;
-    double imag;
-} Complex;
+static void usage(const char *prog) {
+    printf("Usage: %s [options] [config_file]\n", prog);
+    printf("  -m, --symbols N       Symbols to send (default %d)\n", SYMBOLS_COUNT);
+    printf("  -d, --decimals D      Digits after the decimal point, 0-%d (default %d)\n",
+           ASCII_MAX_DECIMALS, ASCII_DEFAULT_DECIMALS);
+    printf("  -M, --mtu BYTES       Path MTU each datagram must fit in (default %d)\n", FRAME_DEFAULT_MTU);
+    printf("  -e, --esn0 DB         Channel Es/N0 in dB (default %.0f)\n", ES_N0_DB);
+    printf("  -p, --pattern NAME    random, prbs7, prbs15, prbs23 or prbs31 (default random)\n");
+    printf("  -S, --seed N          Bit source seed, or PRBS start state (default: current time / all ones)\n");
+}
 
-int main() {
-    int i, j, bit1, bit2;
+int main(int argc, char *argv[]) {
+    long symbols = SYMBOLS_COUNT;
+    int decimals = ASCII_DEFAULT_DECIMALS;
+    int mtu = FRAME_DEFAULT_MTU;
+    double esn0_db = ES_N0_DB;
+    BitSourceType pattern = BITSRC_RANDOM;
+    unsigned long long seed = 0;
+    int seed_given = 0;
+    static const struct option long_opts[] = {
+        { "symbols",  required_argument, NULL, 'm' },
+        { "decimals", required_argument, NULL, 'd' },
+        { "mtu",      required_argument, NULL, 'M' },
+        { "esn0",     required_argument, NULL, 'e' },
+        { "pattern",  required_argument, NULL, 'p' },
+        { "seed",     required_argument, NULL, 'S' },
+        { "help",     no_argument,       NULL, 'h' },
+        { NULL, 0, NULL, 0 }
+    };
+    int opt;
+
+    while ((opt = getopt_long(argc, argv, "m:d:M:e:p:S:h", long_opts, NULL)) != -1) {
+        switch (opt) {
+        case 'm': symbols = atol(optarg); break;
+        case 'd': decimals = atoi(optarg); break;
+        case 'M': mtu = atoi(optarg); break;
+        case 'e': esn0_db = atof(optarg); break;
+        case 'S': seed = strtoull(optarg, NULL, 0); seed_given = 1; break;
+        case 'p':
+            if (!bitsrc_parse_type(optarg, &pattern)) {
+                fprintf(stderr, "Unknown pattern: %s\n", optarg);
+                return 1;
+            }
+            break;
+        case 'h': usage(argv[0]); return 0;
+        default:  usage(argv[0]); return 1;
+        }
+    }
+    if (symbols < 1) {
+        fprintf(stderr, "Symbols must be positive\n");
+        return 1;
+    }
+    if (decimals < 0 || decimals > ASCII_MAX_DECIMALS) {
+        fprintf(stderr, "Decimals must be between 0 and %d\n", ASCII_MAX_DECIMALS);
+        return 1;
+    }
+    size_t payload_max = mtu > FRAME_IP_UDP_OVERHEAD ? (size_t)(mtu - FRAME_IP_UDP_OVERHEAD) : 0;
+    if (payload_max > FRAME_MAX_BYTES) {
+        payload_max = FRAME_MAX_BYTES;
+    }
+    if (!seed_given && pattern == BITSRC_RANDOM) {
+        seed = time(0);
+    }
 
-    // Initialize random number generator with current time as seed
-    srand(time(0));
+    // Initialize UDP configuration with default values (localhost)
+    UDPConfig config;
+    init_udp_config(&config);
 
-    // Step 1: Generate random data bits
-    int data_bits[BITS_COUNT];
-    for (i = 0; i < BITS_COUNT; i++) {
-        data_bits[i] = rand() % 2;
+    // Load configuration from file if specified
+    const char *config_file = (optind < argc) ? argv[optind] : CONFIG_FILE;
+    if (load_udp_config(&config, config_file)) {
+        printf("Loaded configuration from %s\n", config_file);
+    } else {
+        printf("Using default configuration (localhost:9090)\n");
     }
+    print_udp_config(&config);
 
-    // Step 2: Perform QPSK modulation to create symbols
-    Complex symbols[SYMBOLS_COUNT];
-    for (i = 0, j = 0; i < BITS_COUNT; i += 2, j++) {
-        bit1 = data_bits[i];
-        bit2 = data_bits[i + 1];
-
-        // Map the two bits to a symbol using QPSK modulation
-        Complex symbol;
-        if (bit1 == 0 && bit2 == 0) {
-            symbol.real = 1 / sqrt(2);
-            symbol.imag = 1 / sqrt(2);
-        } else if (bit1 == 0 && bit2 == 1) {
-            symbol.real = -1 / sqrt(2);
-            symbol.imag = 1 / sqrt(2);
-        } else if (bit1 == 1 && bit2 == 0) {
-            symbol.real = 1 / sqrt(2);
-            symbol.imag = -1 / sqrt(2);
-        } else if (bit1 == 1 && bit2 == 1) {
-            symbol.real = -1 / sqrt(2);
-            symbol.imag = -1 / sqrt(2);
-        }
+    uint8_t *packed_bits = malloc((symbols + 3) / 4);
+    float *iq = malloc(2 * symbols * sizeof(float));
+    if (packed_bits == NULL || iq == NULL) {
+        perror("malloc failed");
+        return 1;
+    }
 
-        // Add noise to the symbols
-        double noise_real = NOISE_STD_DEV * (2 * ((double)rand() / RAND_MAX) - 1);
-        double noise_imag = NOISE_STD_DEV * (2 * ((double)rand() / RAND_MAX) - 1);
-        symbol.real += noise_real;
-        symbol.imag += noise_imag;
+    // Step 1: Generate the data bits
+    BitSource source;
+    bitsrc_init(&source, pattern, seed);
+    bitsrc_fill_bytes(&source, packed_bits, (symbols + 3) / 4);
 
-        symbols[j] = symbol;
-    }
+    // Step 2: Perform QPSK modulation to create symbols
+    qpsk_map_packed(packed_bits, symbols, iq);
+
+    // Add Gaussian noise to the symbols
+    Awgn channel;
+    awgn_init(&channel, seed + 1, esn0_db);  // Independent stream from the bits
+    awgn_add(&channel, iq, 2 * symbols);
 
     // Step 3: Output the combined array of symbols
-    printf("Combined array of symbols:\n");
-    Complex qpsk_symbols[SYMBOLS_COUNT];
-    printf("qpsk_symbols[] = {");
-    for (i = 0; i < SYMBOLS_COUNT; i++) {
-        qpsk_symbols[i] = symbols[i];
-        printf("(%f,%f)", qpsk_symbols[i].real, qpsk_symbols[i].imag);
-        if (i < SYMBOLS_COUNT - 1) {
-            printf(",");
-        }
-    }
-    printf("}\n");
-    
-    // Step 4: Convert the combined symbols to a string buffer
-    char buff[BUFFER_SIZE];
-    memset(buff, 0, sizeof(buff));
-    int offset = 0;
-    for (i = 0; i < SYMBOLS_COUNT; i++) {
-        offset += snprintf(buff + offset, BUFFER_SIZE - offset, "(%f,%f)", 
-                         qpsk_symbols[i].real, qpsk_symbols[i].imag);
-        if (i < SYMBOLS_COUNT - 1) {
-            offset += snprintf(buff + offset, BUFFER_SIZE - offset, ",");
+    if (symbols <= DISPLAY_SYMBOLS) {
+        printf("Combined array of symbols:\n");
+        printf("qpsk_symbols[] = {");
+        for (long i = 0; i < symbols; i++) {
+            printf("(%f,%f)", iq[2*i], iq[2*i + 1]);
+            if (i < symbols - 1) {
+                printf(",");
+            }
         }
+        printf("}\n");
     }
 
-    // Step 5: Send the buffer over UDP
     int sockfd = socket(AF_INET, SOCK_DGRAM, 0);
     if (sockfd == -1) {
         perror("socket creation failed");
@@ -112,16 +172,38 @@ int main() {
     struct sockaddr_in saddr;
     memset(&saddr, 0, sizeof(saddr));
     saddr.sin_family = AF_INET;
-    
-    // Configure port number and IP address
-    saddr.sin_port = htons(9091); 
-    saddr.sin_addr.s_addr = inet_addr("192.168.188.29");
-
-    sendto(sockfd, buff, strlen(buff), 0, (struct sockaddr *)&saddr, sizeof(saddr));
+    saddr.sin_port = htons(config.port);
+    saddr.sin_addr.s_addr = inet_addr(config.ip_address);
+
+    // Steps 4-5: Convert the symbols to text one datagram at a time and send it
+    static char buff[FRAME_MAX_BYTES];
+    size_t sent = 0, datagrams = 0, bytes = 0;
+    int status = 0;
+    while (sent < (size_t)symbols) {
+        size_t len;
+        size_t n = ascii_format_symbols(iq + 2*sent, symbols - sent, decimals, SYMBOL_ALIGN,
+                                        buff, payload_max, &len);
+        if (n == 0) {
+            fprintf(stderr, "A symbol does not fit in a %d-byte MTU\n", mtu);
+            status = 1;
+            break;
+        }
+        if (sendto(sockfd, buff, len, 0, (struct sockaddr *)&saddr, sizeof(saddr)) < 0) {
+            perror("send failed");
+            status = 1;
+            break;
+        }
+        sent += n;
+        datagrams++;
+        bytes += len;
+    }
 
     close(sockfd);
+    free(packed_bits);
+    free(iq);
 
-    printf("Message has been sent.\n");
+    printf("Sent %zu symbols as %zu bytes of text in %zu datagrams to %s:%d.\n",
+           sent, bytes, datagrams, config.ip_address, config.port);
 
-    return 0;
+    return status;
 }
@@ -1,15 +1,110 @@
 /**
  * Final UDP Transmission Implementation with QPSK
- * 
+ *
  * This program demonstrates the complete pipeline:
  * 1. Generate random bits
  * 2. QPSK modulation
  * 3. Add noise
- * 4. Format data with padding
+ * 4. Format the frame (compact header and samples, or the legacy padding)
  * 5. Send over UDP
- * 
- * Compile with: gcc -o udp_final UDP_final.c -lm
- * Run with: ./udp_final [config_file]
+ *
+ * By default a single frame is built and sent. In streaming mode
+ * (--stream) the pipeline runs continuously, reusing the socket and all
+ * buffers, and sends frames back-to-back at a target symbol rate (or as fast
+ * as possible) while periodically reporting the achieved throughput.
+ * Streamed frames are built in place in a batch buffer and flushed with one
+ * sendmmsg() per batch, optionally with UDP GSO (see udp_tx.h).
+ *
+ * With --pipeline the stream runs as stages instead, the bit source,
+ * mapper, pulse shaper (with --sps), channel, packetizer and socket
+ * writer, spread over up to six threads (optionally pinned with --cpus)
+ * and connected by lock-free rings (see pipeline.h). Batches are built and
+ * sent in place in a pool of preallocated blocks that only change hands
+ * between the stages, so no frame is allocated or copied. A full ring
+ * holds back the stages before it, and every report shows how busy each
+ * stage was and how full the ring in front of it is, so the stage that
+ * limits the throughput stands out.
+ *
+ * --verbosity sets how much is printed (see trace.h): quiet, summary (the
+ * default: configuration, periodic reports and totals), frame (a line per
+ * frame) or sample (every bit and sample as well, dumped to --dump as text
+ * or binary records rather than printed to the terminal).
+ *
+ * --sps shapes the streamed symbols with a root-raised-cosine pulse (see
+ * rrc.h) before the channel, so compact frames carry N samples per symbol
+ * of one continuously filtered signal and the noise is added at the
+ * sample rate; udp_receiver applies the matched filter.
+ *
+ * --fading passes the streamed samples through the multipath fading
+ * channel of fading.h (a power-delay profile, Rayleigh or with --rician a
+ * line of sight on the first path, fading at --doppler), and
+ * --phase-offset and --freq-offset turn them by a carrier phase and
+ * frequency offset, both before the noise is added.
+ *
+ * --differential codes the bits differentially, so a receiver that
+ * recovers the carrier with udp_receiver --carrier does not need to know
+ * which quarter turn its loop settled at.
+ *
+ * --code protects the streamed bits with the convolutional code of conv.h
+ * at rate 1/2, 2/3 or 3/4: every frame carries one codeword of the most
+ * whole data bytes its symbols can hold, and the rate goes in the frame
+ * flags so udp_receiver decodes it without being told.
+ *
+ * Compact frames end in a CRC32C of their header and payload (see
+ * crc32c.h), computed with the SSE4.2 crc32 instruction where available at
+ * a fraction of a cycle per byte; --no-crc leaves it out.
+ *
+ * Frames use the compact format of frame.h by default: a 28-byte header
+ * with a sequence number and send time, then interleaved I/Q as float32,
+ * SC16 or SC8 (see sample.h), so a 20-symbol frame is 188, 108 or 68 bytes
+ * instead of 3072, or as block floating point (see bfp.h), which keeps the
+ * precision of noisy samples at close to SC8 size. For the lossy formats
+ * the transmitter decodes every 64th frame again and reports the
+ * compression ratio and the error the quantization adds to the channel.
+ * --framing legacy sends the original padded layout (256 zeros, 256 real
+ * parts, 256 imaginary parts) for consumers that expect it.
+ *
+ * Compile with: make bin/udp_final (links bin/libqpsk.a)
+ * Run with: ./bin/udp_final [options] [config_file]
+ *
+ * Options:
+ *   -s, --stream          Send frames continuously until interrupted (Ctrl-C)
+ *   -r, --rate SYM/S      Target symbol rate in streaming mode (0 = as fast as possible)
+ *   -m, --symbols N       Symbols per frame (default 20; at most 256 legacy, or what fits the MTU)
+ *   -n, --frames N        Stop streaming after N frames (0 = unlimited)
+ *   -i, --interval SEC    Statistics report interval in seconds (default 1)
+ *   -e, --esn0 DB         Channel Es/N0 in dB (default 3)
+ *   -p, --pattern NAME    Data bits: random, prbs7, prbs15, prbs23 or prbs31 (default random)
+ *   -S, --seed N          Bit source seed, or PRBS start state (default: current time / all ones)
+ *   -t, --tx MODE         Streaming send path: sendto, sendmmsg or gso (default sendmmsg)
+ *   -b, --batch N         Frames per send batch when streaming (default 32)
+ *   -f, --framing NAME    Frame layout: compact or legacy (default compact)
+ *   -M, --mtu BYTES       Path MTU compact frames must fit in (default 1500)
+ *   -F, --format NAME     Compact frame samples: f32, sc16, sc8 or bfp (default f32)
+ *   -A, --full-scale A    Sample magnitude mapped to the largest SC16/SC8 value (default 4)
+ *   -W, --mantissa-bits W BFP mantissa width, 2-16 bits (default 8)
+ *   -N, --bfp-block N     BFP samples per shared exponent, a multiple of 8 up to 64 (default 16)
+ *   -v, --verbosity LEVEL Output: quiet, summary, frame or sample (default summary)
+ *   -D, --dump FILE       Sample dump file, "-" for stdout (default qpsk_samples.txt)
+ *   -T, --dump-format F   Sample dump format: text or binary (default text)
+ *   -P, --pipeline N      Stream through the staged transmitter on N threads, 1-6 (implies --stream)
+ *   -C, --cpus LIST       CPUs to pin the pipeline threads to, in order, e.g. 0,2,4
+ *   -d, --depth N         Blocks of one batch per pipeline ring (default 8)
+ *   -H, --hugepages       Back the pipeline's blocks with huge pages if available
+ *   -k, --sps N           Root-raised-cosine pulse shaping with N samples per symbol, 2-16 (default 1: off)
+ *   -a, --rolloff B       Pulse roll-off, 0-1 (default 0.35)
+ *   -L, --span N          Pulse length in symbols, even, 2-32 (default 8)
+ *   -o, --phase-offset DEG Carrier phase offset of the channel in degrees
+ *   -y, --freq-offset F   Carrier frequency offset in cycles per symbol (up to +-0.01)
+ *   -Z, --differential    Code the bits differentially
+ *   -R, --fading PROFILE  Multipath fading: flat, two-ray, urban or delay:dB,... (delays in samples)
+ *   -j, --doppler F       Largest Doppler shift of the fading in cycles per symbol (default 0.001)
+ *   -K, --rician DB       Rician K-factor of the first path in dB (default: Rayleigh)
+ *   -c, --code RATE       Convolutional code: none, 1/2, 2/3 or 3/4 (default none)
+ *   -x, --no-crc          Send compact frames without the CRC32C trailer
+ *
+ * A receiver that knows the pattern (and for random bits the seed) can
+ * rebuild the transmitted bits and measure the error rate; see udp_receiver.
  */
 
 #include <stdio.h>
@@ -22,20 +117,107 @@
 #include <arpa/inet.h>
 #include <time.h>
 #include <math.h>
+#include <errno.h>
+#include <signal.h>
+#include <getopt.h>
 
-#include "../utils/udp_config.h"
+#include "../../config/config.h"
+#include "../libqpsk/awgn.h"
+#include "../libqpsk/bfp.h"
+#include "../libqpsk/bitsrc.h"
+#include "../libqpsk/carrier.h"
+#include "../libqpsk/conv.h"
+#include "../libqpsk/crc32c.h"
+#include "../libqpsk/fading.h"
+#include "../libqpsk/frame.h"
+#include "../libqpsk/pipeline.h"
+#include "../libqpsk/qpsk_map.h"
+#include "../libqpsk/rrc.h"
+#include "../libqpsk/sample.h"
+#include "../libqpsk/trace.h"
+#include "../libqpsk/udp_tx.h"
 
 #define BITS_COUNT 40            // Total number of random bits to generate
 #define SYMBOLS_COUNT 20         // Number of QPSK symbols (each symbol encodes 2 bits)
+#define MAX_SYMBOLS 256          // Symbols that fit in one block of the padded layout
+#define MAX_PACKED (FRAME_MAX_SYMBOLS / 4 + 1) // Packed data bytes of the largest frame
+#define BLOCK_LENGTH 256         // Length of each block (zeros, real parts, imaginary parts)
 #define COMBINATION_LENGTH 256*3 // Length of combined data array
-#define BUFFER_LENGTH 256*3*4    // Length of final buffer (4 copies of combined data)
-#define NOISE_STD_DEV 0.5        // Standard deviation of noise to be added to symbols
+#define BUFFER_LENGTH 256*3*4    // Length of final buffer (4 bytes per combined float)
+#define ES_N0_DB 3.0             // Channel Es/N0 in dB (noise std dev of about 0.5)
+#define DOPPLER 0.001            // Default Doppler shift of the fading in cycles per symbol
 
 #define CONFIG_FILE "config/udp_config.txt"  // Default configuration file path
+#define REPORT_INTERVAL 1.0                  // Default statistics interval in seconds
+#define TX_BATCH 32                          // Default frames per send batch
+#define QUANT_CHECK_MASK 63                  // Decode every 64th lossy frame to measure quantization
+#define TX_STAGES 6                          // Stages of the staged transmitter with pulse shaping
+#define TX_MAX_DEPTH 1024                    // Largest pipeline ring
+
+/**
+ * Options controlling how frames are generated and sent
+ */
+typedef struct {
+    int stream;               // Non-zero for continuous streaming mode
+    int symbols;              // Symbols carried by each frame
+    double symbol_rate;       // Target symbols per second (0 = unpaced)
+    unsigned long max_frames; // Frames to send before stopping (0 = unlimited)
+    double report_interval;   // Seconds between statistics reports
+    double esn0_db;           // Channel Es/N0 in dB
+    BitSourceType pattern;    // Source of the data bits
+    unsigned long long seed;  // Bit source seed (noise uses seed + 1)
+    UdpTxMode tx_mode;        // How streamed frames are handed to the kernel
+    int batch;                // Frames per send batch
+    int legacy;               // Non-zero for the padded 3072-byte layout
+    int mtu;                  // Path MTU for compact frames
+    FrameFormat format;       // Sample format of compact frames
+    double full_scale;        // Magnitude mapped to the largest integer sample
+    int bfp_bits;             // BFP mantissa width
+    int bfp_block;            // BFP samples per shared exponent
+    TraceLevel verbosity;     // How much is printed
+    const char *dump_path;    // Sample dump file (NULL for the default)
+    int dump_binary;          // Non-zero for binary sample dumps
+    int threads;              // Pipeline threads (0 for the single-threaded stream)
+    int depth;                // Blocks per pipeline ring, a power of two
+    int cpus[PIPELINE_MAX_STAGES]; // CPU of each pipeline thread
+    int ncpus;                // Entries in cpus
+    int huge;                 // Non-zero to put the pipeline's blocks on huge pages
+    int sps;                  // Samples per symbol (1 = no pulse shaping)
+    int span;                 // Pulse length in symbols
+    double rolloff;           // Pulse roll-off
+    double phase_offset;      // Carrier phase offset in degrees
+    double freq_offset;       // Carrier frequency offset in cycles per symbol
+    int differential;         // Non-zero to code the bits differentially
+    const char *fading;       // Power-delay profile of the fading, NULL for none
+    FadingProfile profile;    // The profile, parsed
+    double doppler;           // Largest Doppler shift in cycles per symbol
+    double rician_k;          // Line of sight over fading power on the first path, 0 for Rayleigh
+    ConvRate code;            // Convolutional code of the bits, CONV_NONE for none
+    int crc;                  // Non-zero to end compact frames in a CRC32C
+} TxOptions;
+
+/**
+ * Error added by a lossy sample format, accumulated over checked frames
+ */
+typedef struct {
+    double signal;            // Sum of squared sent samples
+    double error;             // Sum of squared decoding errors
+    unsigned long long samples;
+} QuantStats;
+
+static volatile sig_atomic_t keep_running = 1;
+
+/**
+ * Signal handler that asks the streaming loop to stop after the current frame
+ */
+static void handle_stop(int sig) {
+    (void)sig;
+    keep_running = 0;
+}
 
 /**
  * Function to convert a float value to a byte array
- * 
+ *
  * @param value  The float value to convert
  * @param bytes  Pointer to the byte array where the result will be stored
  */
@@ -43,169 +225,1431 @@ void floatToBytes(float value, unsigned char *bytes) {
     memcpy(bytes, &value, sizeof(float));
 }
 
-int main(int argc, char *argv[]) {
-    int i, j, bit1, bit2;
-    double symbol_I, symbol_Q, symbol_magnitude, symbol_phase, noise_I, noise_Q;
-    
-    // Initialize UDP configuration with default values (localhost)
-    UDPConfig config;
-    init_udp_config(&config);
-    
-    // Load configuration from file if specified
-    const char *config_file = (argc > 1) ? argv[1] : CONFIG_FILE;
-    if (load_udp_config(&config, config_file)) {
-        printf("Loaded configuration from %s\n", config_file);
-    } else {
-        printf("Using default configuration (localhost:9090)\n");
+/**
+ * Current value of the monotonic clock in seconds
+ */
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/**
+ * Modulate packed bits straight into the padded frame layout and add noise
+ *
+ * The layout is three blocks of BLOCK_LENGTH floats: zeros, real parts,
+ * imaginary parts. Only the symbol slots are written, so the caller must
+ * zero the frame once and may then reuse it for every subsequent frame.
+ *
+ * @param comb     Frame of COMBINATION_LENGTH floats
+ * @param packed   Data bits, four symbols per byte
+ * @param symbols  Number of symbols (at most MAX_SYMBOLS)
+ * @param channel  Noise generator
+ */
+static void fill_frame(float *comb, const uint8_t *packed, int symbols, Awgn *channel) {
+    float *real = comb + BLOCK_LENGTH;
+    float *imag = comb + BLOCK_LENGTH*2;
+
+    qpsk_map_packed_planar(packed, symbols, real, imag);
+    awgn_add(channel, real, symbols);
+    awgn_add(channel, imag, symbols);
+}
+
+/**
+ * Whether the channel turns the samples by a carrier offset
+ */
+static int carrier_offset(const TxOptions *opts) {
+    return opts->phase_offset != 0.0 || opts->freq_offset != 0.0;
+}
+
+/**
+ * Set up the channel's oscillator, stepping per sample
+ */
+static void init_carrier(Nco *nco, const TxOptions *opts) {
+    nco_init(nco, opts->phase_offset, opts->freq_offset / opts->sps);
+}
+
+/**
+ * Set up the fading channel, fading per sample
+ */
+static void init_fading(Fading *fading, const TxOptions *opts) {
+    if (opts->fading != NULL) {
+        fading_init(fading, &opts->profile, opts->doppler / opts->sps, opts->rician_k, opts->seed + 2);
     }
-    
-    // Display current configuration
-    print_udp_config(&config);
-    
-    // Initialize random number generator with current time as seed
-    srand(time(0));  
+}
 
-    // Step 1: Generate random data bits
-    printf("Random Generator for %d data bits:\n", BITS_COUNT);
-    int data_bits[BITS_COUNT];
-    printf("data_bit[] = {");
-    for (i = 0; i < BITS_COUNT; i++) {
-        // Generate a random binary data bit (0 or 1)
-        data_bits[i] = rand() % 2; 
-        printf("%d", data_bits[i]);
-        if (i < BITS_COUNT - 1) {
-            printf(",");
-        }
+/**
+ * Data bits drawn for each frame: two per symbol, or those of one codeword
+ */
+static size_t frame_info_bits(const TxOptions *opts, int symbols) {
+    if (opts->code == CONV_NONE) {
+        return 8 * (size_t)((symbols + 3) / 4);
     }
-    printf("}\n");
+    return conv_info_bits(opts->code, 2 * (size_t)symbols);
+}
+
+/**
+ * Header of the first compact frame for the given options
+ */
+static void init_header(FrameHeader *hdr, const TxOptions *opts, int symbols) {
+    memset(hdr, 0, sizeof(*hdr));
+    hdr->version = FRAME_VERSION;
+    hdr->format = opts->format;
+    hdr->flags = FRAME_FLAG_START | (opts->differential ? FRAME_FLAG_DIFFERENTIAL : 0) |
+                 (unsigned)opts->code << FRAME_CODE_SHIFT | (opts->crc ? FRAME_FLAG_CRC : 0);
+    hdr->symbols = symbols;
+    hdr->timestamp_ns = frame_timestamp_ns();
+    hdr->scale = sample_scale(opts->format, opts->full_scale);
+    hdr->bfp_bits = opts->bfp_bits;
+    hdr->bfp_block = opts->bfp_block;
+    hdr->samples_per_symbol = opts->sps;
+    hdr->pulse_span = opts->span;
+    hdr->rolloff = (float)opts->rolloff;
+    hdr->header_bytes = frame_header_bytes(hdr);
+}
+
+/**
+ * Modulate packed bits into a compact frame and add noise
+ *
+ * Float frames are modulated in place; other frames are modulated into a
+ * scratch buffer and converted into the payload. With a pulse shaper the
+ * symbols are shaped into the samples and the noise is added to those.
+ *
+ * @param frame    Frame of frame_bytes(hdr) bytes
+ * @param packed   Data bits, four symbols per byte
+ * @param symbols  Number of symbols
+ * @param channel  Noise generator
+ * @param fading   Multipath fading of the channel, or NULL for none
+ * @param nco      Carrier offset of the channel, or NULL for none
+ * @param shaper   Pulse-shaping filter, or NULL for one sample per symbol
+ * @param hdr      Header to write; the send time is filled in here, and
+ *                 the CRC is appended last
+ * @param scratch  Room for 2 * frame_samples(hdr) floats
+ * @param mapped   Room for 2 * symbols floats, used only with a shaper
+ */
+static void fill_compact(uint8_t *frame, const uint8_t *packed, int symbols, Awgn *channel, Fading *fading,
+                         Nco *nco, RrcFilter *shaper, FrameHeader *hdr, float *scratch, float *mapped) {
+    uint8_t *payload = frame + hdr->header_bytes;
+    float *iq = hdr->format == FRAME_FORMAT_F32 ? (float *)payload : scratch;
+    size_t samples = 2 * frame_samples(hdr);
 
-    // Step 2: Perform QPSK modulation to create symbols
-    double symbols_I[SYMBOLS_COUNT], symbols_Q[SYMBOLS_COUNT];
-    for (i = 0, j = 0; i < BITS_COUNT; i += 2, j++) {
-        bit1 = data_bits[i];
-        bit2 = data_bits[i+1];
-
-        // Map the two bits to a symbol using QPSK modulation
-        if (bit1 == 0 && bit2 == 0) {
-            symbol_I = 1 / sqrt(2);
-            symbol_Q = 1 / sqrt(2);
-        } else if (bit1 == 0 && bit2 == 1) {
-            symbol_I = -1 / sqrt(2);
-            symbol_Q = 1 / sqrt(2);
-        } else if (bit1 == 1 && bit2 == 0) {
-            symbol_I = 1 / sqrt(2);
-            symbol_Q = -1 / sqrt(2);
-        } else if (bit1 == 1 && bit2 == 1) {
-            symbol_I = -1 / sqrt(2);
-            symbol_Q = -1 / sqrt(2);
-        }
-
-        symbols_I[j] = symbol_I;
-        symbols_Q[j] = symbol_Q;
-    }
-        
-    // Step 3: Add noise to the symbols
-    for (i = 0; i < SYMBOLS_COUNT; i++) {
-        // Generate noise with zero mean and standard deviation of NOISE_STD_DEV
-        noise_I = NOISE_STD_DEV * ((double) rand() / RAND_MAX) * sqrt(-2 * log((double) rand() / RAND_MAX));
-        noise_Q = NOISE_STD_DEV * ((double) rand() / RAND_MAX) * sqrt(-2 * log((double) rand() / RAND_MAX));
-        symbols_I[i] += noise_I;
-        symbols_Q[i] += noise_Q;
-    }
-
-    // Step 4: Display the noisy QPSK symbols
-    printf("QPSK modulation for %d symbols with noise:\n", SYMBOLS_COUNT);
-    double qpsk_symbol_real[SYMBOLS_COUNT], qpsk_symbol_imag[SYMBOLS_COUNT];
-    
-    printf("qpsk_symbol_real[] = {");
-    for (i = 0; i < SYMBOLS_COUNT; i++) {
-        qpsk_symbol_real[i] = symbols_I[i];
-        printf("%f", qpsk_symbol_real[i]);
-        if (i < SYMBOLS_COUNT - 1) {
-            printf(",");
-        }
-    }
-    printf("}\n");
-
-    printf("qpsk_symbol_imag[] = {");
-    for (i = 0; i < SYMBOLS_COUNT; i++) {
-        qpsk_symbol_imag[i] = symbols_Q[i];
-        printf("%f", qpsk_symbol_imag[i]);
-        if (i < SYMBOLS_COUNT - 1) {
-            printf(",");
-        }
-    }
-    printf("}\n");
-    
-    // Step 5: Prepare data for UDP transmission
-    float comb[COMBINATION_LENGTH], buffer[BUFFER_LENGTH];
-    printf("The Array : {");
-
-    // Fill first 256 elements with zeros
-    for (i = 0; i < 256; i++) {
-        comb[i] = 0;
-        printf("%d , ", (int)comb[i]);
-    }
-
-    // Fill next 20 elements with real parts of symbols
-    for (i = 256; i < 276; i++) {
-        comb[i] = qpsk_symbol_real[i-256];
-        printf("%f , ", comb[i]);
-    }
-
-    // Fill next portion with zeros
-    for(i = 276; i < 256*2; i++) {
-        comb[i] = 0;
-        printf("%d , ", (int)comb[i]);
-    }
-
-    // Fill next 20 elements with imaginary parts of symbols
-    for(i = 256*2; i < 256*2+20; i++) {
-        comb[i] = qpsk_symbol_imag[i-256*2];
-        printf("%f , ", comb[i]);
-    }
-
-    // Fill remainder with zeros
-    for(i = 256*2+20; i < COMBINATION_LENGTH; i++) {
-        comb[i] = 0;
-        printf("%d , ", (int)comb[i]);
+    hdr->timestamp_ns = frame_timestamp_ns();
+    frame_write_header(frame, hdr);
+    if (shaper != NULL) {
+        qpsk_map_packed(packed, symbols, mapped);
+        rrc_interpolate(shaper, mapped, symbols, iq);
+    } else {
+        qpsk_map_packed(packed, symbols, iq);
+    }
+    if (fading != NULL) {
+        fading_process(fading, iq, samples / 2);
     }
+    if (nco != NULL) {
+        nco_rotate(nco, iq, samples / 2);
+    }
+    awgn_add(channel, iq, samples);
+    if (hdr->format == FRAME_FORMAT_F32) {
+        frame_put_f32(iq, samples);
+    } else {
+        frame_encode_payload(hdr, iq, payload);
+    }
+    frame_seal(frame, hdr);
+}
 
-    // Print array values for debugging
-    for(i = 0; i < 768; i++) {
-        printf("%d,%f\n", i, comb[i]);
+/**
+ * Decode an encoded payload again and accumulate its error
+ *
+ * @param stats    Statistics to update
+ * @param hdr      Header the payload was encoded with
+ * @param payload  Encoded payload
+ * @param iq       The samples that were encoded
+ */
+static void quant_check(QuantStats *stats, const FrameHeader *hdr, const uint8_t *payload,
+                        const float *iq) {
+    static float decoded[2 * FRAME_MAX_SAMPLES];
+    size_t count = 2 * frame_samples(hdr);
+
+    frame_decode_payload(hdr, payload, decoded);
+    for (size_t i = 0; i < count; i++) {
+        double e = (double)decoded[i] - iq[i];
+        stats->signal += (double)iq[i] * iq[i];
+        stats->error += e * e;
     }
+    stats->samples += count;
+}
 
-    printf("}\n");
+/**
+ * Print the size and quantization error of a lossy sample format
+ *
+ * The error is given against the sent samples (SQNR), as EVM against the
+ * unit-energy constellation, and as the Es/N0 lost on top of the channel.
+ */
+static void report_quant(const QuantStats *stats, const FrameHeader *hdr, double esn0_db) {
+    double f32_bytes = (double)frame_samples(hdr) * frame_symbol_bytes(FRAME_FORMAT_F32);
+    printf("Compression: %s, %.2fx smaller payload than f32", sample_format_name(hdr->format),
+           f32_bytes / frame_payload_bytes(hdr));
+    if (stats->samples > 0) {
+        double error = stats->error / stats->samples * 2;   // Per symbol, Es = 1
+        double channel = pow(10.0, -esn0_db / 10.0);
+        printf(", SQNR %.1f dB, EVM %.3f%%, Es/N0 penalty %.4f dB",
+               10.0 * log10(stats->signal / stats->error), 100.0 * sqrt(error),
+               10.0 * log10(1.0 + error / channel));
+    }
+    printf("\n");
+}
 
-    // Step 6: Convert symbols to byte arrays for UDP transmission
-    unsigned char byteBuffer[SYMBOLS_COUNT * sizeof(float) * 2];
-    for (i = 0; i < 768; i++) {
-        floatToBytes(comb[i], byteBuffer + 4*i);
-    }   
-    
-    // Step 7: Setup UDP socket for transmission
+/**
+ * Create the UDP socket and destination address from the configuration
+ *
+ * @return Socket descriptor, or -1 on failure
+ */
+static int open_socket(const UDPConfig *config, struct sockaddr_in *saddr) {
     int sockfd = socket(AF_INET, SOCK_DGRAM, 0);
     if (sockfd == -1) {
         perror("socket creation failed");
-        return 1;
+        return -1;
     }
 
     // Configure server address using loaded configuration
+    memset(saddr, 0, sizeof(*saddr));
+    saddr->sin_family = AF_INET;
+    saddr->sin_port = htons(config->port);
+    saddr->sin_addr.s_addr = inet_addr(config->ip_address);
+    return sockfd;
+}
+
+/**
+ * Build, display and send a single frame (the original one-shot behaviour)
+ *
+ * The bits, symbols and frame are dumped at the sample level.
+ */
+static int run_single(const UDPConfig *config, const TxOptions *opts, Trace *trace) {
+    int i;
+
+    // Seed the bit source and the noise channel
+    BitSource source;
+    Awgn channel;
+    bitsrc_init(&source, opts->pattern, opts->seed);
+    awgn_init(&channel, opts->seed + 1, opts->esn0_db);
+
+    // Step 1: Generate random data bits
+    uint8_t packed_bits[BITS_COUNT / 8];
+    bitsrc_fill_bytes(&source, packed_bits, sizeof(packed_bits));
+    trace_bits(trace, "data_bit", 0, packed_bits, BITS_COUNT);
+
+    // Steps 2-3: Perform QPSK modulation into the frame and add noise
+    float comb[COMBINATION_LENGTH];
+    memset(comb, 0, sizeof(comb));
+    fill_frame(comb, packed_bits, SYMBOLS_COUNT, &channel);
+
+    // Step 4: Dump the noisy QPSK symbols
+    const float *qpsk_symbol_real = comb + BLOCK_LENGTH;
+    const float *qpsk_symbol_imag = comb + BLOCK_LENGTH*2;
+    trace_floats(trace, "qpsk_symbol_real", 0, qpsk_symbol_real, SYMBOLS_COUNT);
+    trace_floats(trace, "qpsk_symbol_imag", 0, qpsk_symbol_imag, SYMBOLS_COUNT);
+
+    unsigned char byteBuffer[BUFFER_LENGTH];
+    size_t length;
+    if (opts->legacy) {
+        // Steps 5-6: Convert the padded array to bytes for UDP transmission
+        for (i = 0; i < COMBINATION_LENGTH; i++) {
+            floatToBytes(comb[i], byteBuffer + 4*i);
+        }
+        length = BUFFER_LENGTH;
+        if (trace_on(trace, TRACE_SUMMARY)) {
+            printf("Legacy frame: %d symbols, %zu bytes\n", SYMBOLS_COUNT, length);
+        }
+    } else {
+        // Steps 5-6: Interleave the symbols behind a compact frame header
+        FrameHeader hdr;
+        init_header(&hdr, opts, SYMBOLS_COUNT);
+        float iq[2 * SYMBOLS_COUNT];
+        for (i = 0; i < SYMBOLS_COUNT; i++) {
+            iq[2*i] = qpsk_symbol_real[i];
+            iq[2*i + 1] = qpsk_symbol_imag[i];
+        }
+        frame_write_header(byteBuffer, &hdr);
+        frame_encode_payload(&hdr, iq, byteBuffer + FRAME_HEADER_BYTES);
+        frame_seal(byteBuffer, &hdr);
+        length = frame_bytes(&hdr);
+        if (trace_on(trace, TRACE_SUMMARY)) {
+            printf("Compact frame: sequence %u, %d %s symbols, %zu bytes\n", hdr.sequence, SYMBOLS_COUNT,
+                   sample_format_name(opts->format), length);
+            if (opts->format != FRAME_FORMAT_F32) {
+                QuantStats quant = { 0, 0, 0 };
+                quant_check(&quant, &hdr, byteBuffer + FRAME_HEADER_BYTES, iq);
+                report_quant(&quant, &hdr, opts->esn0_db);
+            }
+        }
+    }
+    trace_bytes(trace, "frame", 0, byteBuffer, length);
+
+    // Step 7: Setup UDP socket for transmission
     struct sockaddr_in saddr;
-    memset(&saddr, 0, sizeof(saddr));
-    saddr.sin_family = AF_INET;
-    saddr.sin_port = htons(config.port);
-    saddr.sin_addr.s_addr = inet_addr(config.ip_address);
+    int sockfd = open_socket(config, &saddr);
+    if (sockfd == -1) {
+        return 1;
+    }
 
     // Send the data
-    sendto(sockfd, comb, (COMBINATION_LENGTH)*4, 0, (struct sockaddr *)&saddr, sizeof(saddr));
+    sendto(sockfd, byteBuffer, length, 0, (struct sockaddr *)&saddr, sizeof(saddr));
 
     // Close the socket
     close(sockfd);
 
-    printf("Message has been sent to %s:%d.\n", config.ip_address, config.port);
+    if (trace_on(trace, TRACE_SUMMARY)) {
+        printf("Message has been sent to %s:%d.\n", config->ip_address, config->port);
+        printf("\n");
+    }
+
+    return 0;
+}
+
+/**
+ * Print throughput achieved over an interval
+ *
+ * @param label     Prefix for the report line
+ * @param frames    Frames sent in the interval
+ * @param symbols   Symbols sent in the interval
+ * @param bytes     Payload bytes sent in the interval
+ * @param dropped   Frames the kernel refused in the interval
+ * @param syscalls  Send system calls in the interval
+ * @param elapsed   Length of the interval in seconds
+ */
+static void report_rate(const char *label, unsigned long frames, unsigned long symbols,
+                        unsigned long bytes, unsigned long dropped, unsigned long syscalls,
+                        double elapsed) {
+    if (elapsed <= 0) {
+        return;
+    }
+    printf("%s %.2f s: %.0f frames/s, %.3f Msym/s, %.3f Mbit/s data, %.3f Mbit/s payload",
+           label, elapsed, frames / elapsed, symbols / elapsed / 1e6,
+           symbols * 2.0 / elapsed / 1e6, bytes * 8.0 / elapsed / 1e6);
+    if (frames + dropped > 0) {
+        printf(", %.3f syscalls/frame", (double)syscalls / (frames + dropped));
+    }
+    if (dropped > 0) {
+        printf(", %lu dropped", dropped);
+    }
+    printf("\n");
+    fflush(stdout);
+}
+
+/**
+ * Dump the bits and samples of a streamed frame
+ *
+ * Compact frames in a lossy format are dumped as modulated, before
+ * quantization. Pulse-shaped frames dump their samples.
+ *
+ * @param hdr      Header of compact frames
+ * @param scratch  Samples of the frame for lossy formats, room for them otherwise
+ */
+static void dump_frame(Trace *trace, unsigned long long index, const TxOptions *opts,
+                       const FrameHeader *hdr, const uint8_t *frame, const uint8_t *packed,
+                       int symbols, float *scratch) {
+    trace_bits(trace, "data_bit", index, packed, 2 * symbols);
+    if (opts->legacy) {
+        const float *comb = (const float *)frame;
+        trace_floats(trace, "qpsk_symbol_real", index, comb + BLOCK_LENGTH, symbols);
+        trace_floats(trace, "qpsk_symbol_imag", index, comb + BLOCK_LENGTH*2, symbols);
+        return;
+    }
+    const char *name = opts->sps > 1 ? "qpsk_sample_iq" : "qpsk_symbol_iq";
+    size_t count = 2 * frame_samples(hdr);
+    if (opts->format == FRAME_FORMAT_F32) {
+        const float *iq = frame_get_f32(frame + hdr->header_bytes, count, scratch);
+        trace_floats(trace, name, index, iq, count);
+    } else {
+        trace_floats(trace, name, index, scratch, count);
+    }
+}
+
+/**
+ * Print the settings of a stream before it starts
+ */
+static void print_stream_setup(const UDPConfig *config, const TxOptions *opts, size_t frame_size,
+                               const UdpTx *tx) {
+    printf("Streaming %d symbols per frame to %s:%d", opts->symbols, config->ip_address, config->port);
+    if (opts->symbol_rate > 0) {
+        printf(" at %.0f symbols/s (%.0f frames/s)\n", opts->symbol_rate, opts->symbol_rate / opts->symbols);
+    } else {
+        printf(" as fast as possible\n");
+    }
+    printf("Data bits: %s, seed %llu\n", bitsrc_type_name(opts->pattern), opts->seed);
+    if (opts->legacy) {
+        printf("Framing: legacy, %zu bytes per frame\n", frame_size);
+    } else {
+        printf("Framing: compact %s, %zu bytes per frame", sample_format_name(opts->format), frame_size);
+        if (opts->crc) {
+            printf(", CRC32C (%s)", crc32c_impl_name(crc32c_impl()));
+        }
+        printf("\n");
+    }
+    if (opts->format == FRAME_FORMAT_BFP) {
+        printf("BFP: %d-bit mantissas, %d samples per exponent\n", opts->bfp_bits, opts->bfp_block);
+    }
+    if (opts->sps > 1) {
+        printf("Pulse shaping: root-raised cosine, %d samples per symbol, roll-off %.2f, span %d symbols (%s)\n",
+               opts->sps, opts->rolloff, opts->span, qpsk_isa_name(rrc_isa()));
+    }
+    if (opts->fading != NULL) {
+        printf("Fading: %s, %d paths, Doppler %g cycles per symbol, ", opts->fading, opts->profile.paths,
+               opts->doppler);
+        if (opts->rician_k > 0.0) {
+            printf("Rician K %.1f dB", 10.0 * log10(opts->rician_k));
+        } else {
+            printf("Rayleigh");
+        }
+        printf(" (%s)\n", qpsk_isa_name(fading_isa()));
+    }
+    if (carrier_offset(opts)) {
+        printf("Carrier offset: %+.1f degrees, %+.5f cycles per symbol (%s)\n",
+               opts->phase_offset, opts->freq_offset, qpsk_isa_name(carrier_isa()));
+    }
+    if (opts->differential) {
+        printf("Differential coding\n");
+    }
+    if (opts->code != CONV_NONE) {
+        size_t info_bits = frame_info_bits(opts, opts->symbols);
+        printf("Convolutional code: rate %s, K=%d, %zu data bits per frame (%.3f per symbol)\n",
+               conv_rate_name(opts->code), CONV_K, info_bits, (double)info_bits / opts->symbols);
+    }
+    printf("Send path: %s, %d frames per batch", udp_tx_mode_name(tx->mode), opts->batch);
+    if (tx->mode != opts->tx_mode) {
+        printf(" (%s not available)", udp_tx_mode_name(opts->tx_mode));
+    }
     printf("\n");
-    
+}
+
+/**
+ * Advance the send time to the next frame when pacing
+ *
+ * Deadlines are absolute on the monotonic clock, so sleep overshoot does
+ * not accumulate; a sender more than 100 ms behind resynchronises instead
+ * of bursting.
+ *
+ * @param deadline      Send time of the previous frame, advanced here
+ * @param frame_period  Seconds per frame
+ * @return 1 if the new deadline is still ahead, so the sender has to sleep
+ */
+static int next_deadline(double *deadline, double frame_period) {
+    *deadline += frame_period;
+    double now = now_seconds();
+    if (*deadline > now) {
+        return 1;
+    }
+    if (now - *deadline > 0.1) {
+        *deadline = now;
+    }
+    return 0;
+}
+
+static void sleep_until(double deadline) {
+    struct timespec ts;
+    ts.tv_sec = (time_t)deadline;
+    ts.tv_nsec = (long)((deadline - ts.tv_sec) * 1e9);
+    clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL);
+}
+
+/**
+ * Wait for the send time of the next frame when pacing
+ *
+ * Queued frames are flushed before every sleep so pacing never holds
+ * them back.
+ *
+ * @return 0 on success, -1 on a send error
+ */
+static int pace(UdpTx *tx, double *deadline, double frame_period) {
+    if (next_deadline(deadline, frame_period)) {
+        if (udp_tx_flush(tx) < 0) {
+            return -1;
+        }
+        sleep_until(*deadline);
+    }
     return 0;
-}
\ No newline at end of file
+}
+
+/**
+ * Generate, modulate and send frames continuously
+ *
+ * The socket and every buffer are set up once and reused for each frame.
+ * Frames are modulated straight into the sender's batch slots. When a
+ * symbol rate is given, frames are paced against absolute deadlines on the
+ * monotonic clock so that sleep overshoot does not accumulate, and queued
+ * frames are flushed before every sleep so pacing never holds them back.
+ * Nothing is formatted per frame below the frame level.
+ */
+static int run_stream(const UDPConfig *config, const TxOptions *opts, Trace *trace) {
+    int symbols = opts->symbols;
+    uint8_t packed_bits[MAX_PACKED];
+    uint8_t info[MAX_PACKED];
+    size_t info_bits = frame_info_bits(opts, symbols);
+    static float scratch[2 * FRAME_MAX_SAMPLES];
+    static float mapped[2 * FRAME_MAX_SYMBOLS];
+    FrameHeader hdr;
+    init_header(&hdr, opts, symbols);
+    size_t frame_size = opts->legacy ? COMBINATION_LENGTH * sizeof(float) : frame_bytes(&hdr);
+    int lossy = !opts->legacy && opts->format != FRAME_FORMAT_F32;
+    QuantStats quant = { 0, 0, 0 };
+    BitSource source;
+    DiffCoder coder;
+    Awgn channel;
+    Fading fading;
+    Nco nco;
+    RrcFilter shaper;
+    UdpTx tx;
+
+    bitsrc_init(&source, opts->pattern, opts->seed);
+    diff_init(&coder);
+    awgn_init(&channel, opts->seed + 1, opts->esn0_db);
+    init_fading(&fading, opts);
+    init_carrier(&nco, opts);
+    if (opts->sps > 1 && rrc_init(&shaper, opts->sps, opts->span, opts->rolloff) < 0) {
+        perror("rrc_init failed");
+        return 1;
+    }
+
+    struct sockaddr_in saddr;
+    int sockfd = open_socket(config, &saddr);
+    if (sockfd == -1) {
+        if (opts->sps > 1) {
+            rrc_free(&shaper);
+        }
+        return 1;
+    }
+
+    // Slots start zeroed and only the symbol positions are rewritten, so
+    // the legacy padding stays in place for every frame
+    if (udp_tx_init(&tx, sockfd, &saddr, frame_size, opts->batch, opts->tx_mode) < 0) {
+        perror("udp_tx_init failed");
+        close(sockfd);
+        if (opts->sps > 1) {
+            rrc_free(&shaper);
+        }
+        return 1;
+    }
+
+    signal(SIGINT, handle_stop);
+    signal(SIGTERM, handle_stop);
+
+    double frame_period = opts->symbol_rate > 0 ? symbols / opts->symbol_rate : 0;
+    int summary = trace_on(trace, TRACE_SUMMARY);
+    int per_frame = trace_on(trace, TRACE_FRAME);
+    int per_sample = trace_on(trace, TRACE_SAMPLE);
+    if (summary) {
+        print_stream_setup(config, opts, frame_size, &tx);
+        fflush(stdout);
+    }
+
+    unsigned long total_frames = 0;
+    unsigned long long last_sent = 0, last_dropped = 0, last_syscalls = 0;
+    int status = 0;
+    double start = now_seconds();
+    double last_report = start;
+    double deadline = start;
+
+    while (keep_running && (opts->max_frames == 0 || total_frames < opts->max_frames)) {
+        if (frame_period > 0 && pace(&tx, &deadline, frame_period) < 0) {
+            perror("send failed");
+            status = 1;
+            break;
+        }
+
+        if (opts->code != CONV_NONE) {
+            bitsrc_fill_bytes(&source, info, info_bits / 8);
+            conv_encode(opts->code, info, info_bits, packed_bits, 2 * (size_t)symbols);
+        } else {
+            bitsrc_fill_bytes(&source, packed_bits, (symbols + 3) / 4);
+        }
+        if (opts->differential) {
+            diff_encode(&coder, packed_bits, symbols);
+        }
+        uint8_t *slot = udp_tx_slot(&tx);
+        if (opts->legacy) {
+            fill_frame((float *)slot, packed_bits, symbols, &channel);
+        } else {
+            fill_compact(slot, packed_bits, symbols, &channel, opts->fading != NULL ? &fading : NULL,
+                         carrier_offset(opts) ? &nco : NULL, opts->sps > 1 ? &shaper : NULL, &hdr, scratch,
+                         mapped);
+            if (lossy && (total_frames & QUANT_CHECK_MASK) == 0) {
+                quant_check(&quant, &hdr, slot + hdr.header_bytes, scratch);
+            }
+        }
+        if (per_frame) {
+            if (opts->legacy) {
+                printf("frame %lu: %d symbols, %zu bytes\n", total_frames, symbols, frame_size);
+            } else {
+                printf("frame %lu: sequence %u, %d symbols, %zu bytes\n", total_frames, hdr.sequence,
+                       symbols, frame_size);
+            }
+            if (per_sample) {
+                dump_frame(trace, total_frames, opts, &hdr, slot, packed_bits, symbols, scratch);
+            }
+        }
+        if (!opts->legacy) {
+            hdr.flags &= ~FRAME_FLAG_START;
+            hdr.sequence++;
+        }
+        if (udp_tx_commit(&tx) < 0) {
+            perror("send failed");
+            status = 1;
+            break;
+        }
+        total_frames++;
+
+        // Check the clock only every few frames to keep it off the hot path
+        if ((total_frames & 63) == 0 || frame_period > 0) {
+            double now = now_seconds();
+            if (summary && now - last_report >= opts->report_interval) {
+                unsigned long frames = tx.sent - last_sent;
+                report_rate("[stream]", frames, frames * symbols, frames * tx.frame_bytes,
+                            tx.dropped - last_dropped, tx.syscalls - last_syscalls, now - last_report);
+                last_sent = tx.sent;
+                last_dropped = tx.dropped;
+                last_syscalls = tx.syscalls;
+                last_report = now;
+            }
+        }
+    }
+    if (status == 0 && udp_tx_flush(&tx) < 0) {
+        perror("send failed");
+        status = 1;
+    }
+
+    close(sockfd);
+
+    if (summary) {
+        printf("Sent %llu frames (%llu dropped) to %s:%d.\n",
+               tx.sent, tx.dropped, config->ip_address, config->port);
+        report_rate("[total]", tx.sent, tx.sent * symbols, tx.sent * tx.frame_bytes,
+                    tx.dropped, tx.syscalls, now_seconds() - start);
+        if (lossy) {
+            report_quant(&quant, &hdr, opts->esn0_db);
+        }
+    }
+    udp_tx_free(&tx);
+    if (opts->sps > 1) {
+        rrc_free(&shaper);
+    }
+    return status;
+}
+
+/**
+ * Header of the blocks passed between the stages of the staged transmitter
+ *
+ * A block is a pool slot holding up to one send batch of frames, and every
+ * stage works on it in place:
+ *
+ *   header | data bits | symbols (shaped only) | samples (lossy only) | frames
+ *
+ * The mapper writes the samples where the frames will carry them: into the
+ * payload of f32 frames, into the real and imaginary blocks of legacy
+ * frames (the pool is zero-filled, so the padding is already there), and
+ * into the samples area for the lossy formats, which the packetizer
+ * encodes into the payloads. With pulse shaping the mapper writes symbols
+ * into their own area instead and the shaper turns them into the samples.
+ *
+ * Noise is added frame by frame in the same order as run_stream(), so
+ * both paths send the same frames for the same seed. The bits stay in the
+ * block so the packetizer can dump them at the sample level, and the
+ * writer sends the frames straight from the slot.
+ */
+typedef struct {
+    int frames;                 // Frames in the block (the last one may be short)
+    unsigned long first;        // Index of its first frame
+} TxBlock;
+
+#define TX_BLOCK_HEADER 64      // Bytes before the data of a block, one cache line
+
+/**
+ * State of the staged transmitter; each part is used by one stage only
+ */
+typedef struct {
+    const TxOptions *opts;
+    Trace *trace;
+    size_t packed_bytes;        // Coded bytes per frame
+    size_t info_bits;           // Data bits drawn per frame
+    size_t samples;             // Floats per frame
+    size_t frame_size;          // Bytes per frame
+    size_t symbols_offset;      // Offset of the symbols area in a block
+    size_t samples_offset;      // Offset of the samples area in a block
+    size_t frames_offset;       // Offset of the frames in a block
+    unsigned long made;         // Source: frames generated
+    BitSource source;
+    DiffCoder coder;            // Mapper
+    RrcFilter shaper;           // Shaper
+    Awgn channel;               // Channel
+    Fading fading;
+    Nco nco;
+    FrameHeader hdr;            // Packetizer
+    QuantStats quant;
+    UdpTx tx;                   // Writer
+    double frame_period;
+    double deadline;
+    int send_errno;
+    atomic_ullong sent;         // Copies of the sender's counters for the reports
+    atomic_ullong dropped;
+    atomic_ullong syscalls;
+} TxPipeline;
+
+static inline uint8_t *block_bits(void *block) {
+    return (uint8_t *)block + TX_BLOCK_HEADER;
+}
+
+static inline uint8_t *block_frame(const TxPipeline *tp, void *block, int f) {
+    return (uint8_t *)block + tp->frames_offset + f * tp->frame_size;
+}
+
+/**
+ * Samples of frame f of a block: interleaved I/Q, or for legacy frames the
+ * real parts with the imaginary parts BLOCK_LENGTH floats further on
+ */
+static inline float *block_samples(const TxPipeline *tp, void *block, int f) {
+    if (tp->opts->legacy) {
+        return (float *)block_frame(tp, block, f) + BLOCK_LENGTH;
+    }
+    if (tp->opts->format == FRAME_FORMAT_F32) {
+        return (float *)(block_frame(tp, block, f) + tp->hdr.header_bytes);
+    }
+    return (float *)((uint8_t *)block + tp->samples_offset) + f * tp->samples;
+}
+
+/**
+ * Symbols of frame f of a block before pulse shaping, interleaved I/Q
+ */
+static inline float *block_symbols(const TxPipeline *tp, void *block, int f) {
+    return (float *)((uint8_t *)block + tp->symbols_offset) + 2 * f * tp->opts->symbols;
+}
+
+/**
+ * Source stage: draw the data bits of the next batch of frames
+ */
+static int stage_source(void *ctx, void *block) {
+    TxPipeline *tp = ctx;
+    TxBlock *b = block;
+    unsigned long max = tp->opts->max_frames;
+
+    if (!keep_running || (max != 0 && tp->made >= max)) {
+        return 0;
+    }
+    int frames = tp->opts->batch;
+    if (max != 0 && max - tp->made < (unsigned long)frames) {
+        frames = (int)(max - tp->made);
+    }
+    b->frames = frames;
+    b->first = tp->made;
+    if (tp->opts->code != CONV_NONE) {
+        for (int f = 0; f < frames; f++) {
+            bitsrc_fill_bytes(&tp->source, block_bits(block) + f * tp->packed_bytes, tp->info_bits / 8);
+        }
+    } else {
+        bitsrc_fill_bytes(&tp->source, block_bits(block), frames * tp->packed_bytes);
+    }
+    tp->made += frames;
+    return 1;
+}
+
+/**
+ * Mapper stage: QPSK symbols of every frame, coded and differentially
+ * coded on request
+ */
+static int stage_map(void *ctx, void *block) {
+    TxPipeline *tp = ctx;
+    const TxBlock *b = block;
+    int symbols = tp->opts->symbols;
+    uint8_t *bits = block_bits(block);
+    uint8_t coded[MAX_PACKED];
+
+    for (int f = 0; f < b->frames; f++) {
+        if (tp->opts->code != CONV_NONE) {
+            conv_encode(tp->opts->code, bits + f * tp->packed_bytes, tp->info_bits, coded, 2 * (size_t)symbols);
+            memcpy(bits + f * tp->packed_bytes, coded, tp->packed_bytes);
+        }
+        if (tp->opts->differential) {
+            diff_encode(&tp->coder, bits + f * tp->packed_bytes, symbols);
+        }
+        if (tp->opts->legacy) {
+            float *iq = block_samples(tp, block, f);
+            qpsk_map_packed_planar(bits + f * tp->packed_bytes, symbols, iq, iq + BLOCK_LENGTH);
+        } else if (tp->opts->sps > 1) {
+            qpsk_map_packed(bits + f * tp->packed_bytes, symbols, block_symbols(tp, block, f));
+        } else {
+            qpsk_map_packed(bits + f * tp->packed_bytes, symbols, block_samples(tp, block, f));
+        }
+    }
+    return 1;
+}
+
+/**
+ * Shaper stage: root-raised-cosine samples of every frame
+ */
+static int stage_shape(void *ctx, void *block) {
+    TxPipeline *tp = ctx;
+    const TxBlock *b = block;
+
+    for (int f = 0; f < b->frames; f++) {
+        rrc_interpolate(&tp->shaper, block_symbols(tp, block, f), tp->opts->symbols,
+                        block_samples(tp, block, f));
+    }
+    return 1;
+}
+
+/**
+ * Channel stage: fade the samples of every frame, turn them by the
+ * carrier offset and add noise
+ */
+static int stage_channel(void *ctx, void *block) {
+    TxPipeline *tp = ctx;
+    const TxBlock *b = block;
+    int symbols = tp->opts->symbols;
+
+    for (int f = 0; f < b->frames; f++) {
+        float *iq = block_samples(tp, block, f);
+        if (tp->opts->legacy) {
+            awgn_add(&tp->channel, iq, symbols);
+            awgn_add(&tp->channel, iq + BLOCK_LENGTH, symbols);
+        } else {
+            if (tp->opts->fading != NULL) {
+                fading_process(&tp->fading, iq, tp->samples / 2);
+            }
+            if (carrier_offset(tp->opts)) {
+                nco_rotate(&tp->nco, iq, tp->samples / 2);
+            }
+            awgn_add(&tp->channel, iq, tp->samples);
+        }
+    }
+    return 1;
+}
+
+/**
+ * Packetizer stage: frame headers and payloads
+ *
+ * Compact frames are stamped with the time they are built, which trails
+ * the time they are sent by at most the rings between this stage and the
+ * writer.
+ */
+static int stage_packetize(void *ctx, void *block) {
+    static float scratch[2 * FRAME_MAX_SAMPLES];
+    TxPipeline *tp = ctx;
+    const TxBlock *b = block;
+    const TxOptions *opts = tp->opts;
+    int symbols = opts->symbols;
+    int lossy = !opts->legacy && opts->format != FRAME_FORMAT_F32;
+
+    for (int f = 0; f < b->frames; f++) {
+        unsigned long index = b->first + f;
+        uint8_t *frame = block_frame(tp, block, f);
+        float *iq = block_samples(tp, block, f);
+
+        if (!opts->legacy) {
+            uint8_t *payload = frame + tp->hdr.header_bytes;
+            tp->hdr.timestamp_ns = frame_timestamp_ns();
+            frame_write_header(frame, &tp->hdr);
+            if (opts->format == FRAME_FORMAT_F32) {
+                frame_put_f32(iq, tp->samples);
+            } else {
+                frame_encode_payload(&tp->hdr, iq, payload);
+                if (lossy && (index & QUANT_CHECK_MASK) == 0) {
+                    quant_check(&tp->quant, &tp->hdr, payload, iq);
+                }
+            }
+            frame_seal(frame, &tp->hdr);
+        }
+        if (trace_on(tp->trace, TRACE_FRAME)) {
+            if (opts->legacy) {
+                printf("frame %lu: %d symbols, %zu bytes\n", index, symbols, tp->frame_size);
+            } else {
+                printf("frame %lu: sequence %u, %d symbols, %zu bytes\n", index, tp->hdr.sequence,
+                       symbols, tp->frame_size);
+            }
+            if (trace_on(tp->trace, TRACE_SAMPLE)) {
+                dump_frame(tp->trace, index, opts, &tp->hdr, frame,
+                           block_bits(block) + f * tp->packed_bytes, symbols, lossy ? iq : scratch);
+            }
+        }
+        if (!opts->legacy) {
+            tp->hdr.flags &= ~FRAME_FLAG_START;
+            tp->hdr.sequence++;
+        }
+    }
+    return 1;
+}
+
+/**
+ * Writer stage: send the frames straight from the block, pacing them if
+ * asked to
+ *
+ * When pacing, the frames due so far are sent before every sleep.
+ */
+static int stage_write(void *ctx, void *block) {
+    TxPipeline *tp = ctx;
+    const TxBlock *b = block;
+    int from = 0;
+    int status = 1;
+
+    if (tp->frame_period > 0) {
+        for (int f = 0; f < b->frames && status > 0; f++) {
+            if (next_deadline(&tp->deadline, tp->frame_period)) {
+                if (udp_tx_send(&tp->tx, block_frame(tp, block, from), f - from) < 0) {
+                    status = -1;
+                }
+                from = f;
+                sleep_until(tp->deadline);
+            }
+        }
+    }
+    if (status > 0 && udp_tx_send(&tp->tx, block_frame(tp, block, from), b->frames - from) < 0) {
+        status = -1;
+    }
+    if (status < 0) {
+        tp->send_errno = errno;
+    }
+    atomic_store_explicit(&tp->sent, tp->tx.sent, memory_order_relaxed);
+    atomic_store_explicit(&tp->dropped, tp->tx.dropped, memory_order_relaxed);
+    atomic_store_explicit(&tp->syscalls, tp->tx.syscalls, memory_order_relaxed);
+    return status;
+}
+
+/**
+ * Print how busy every stage was over an interval and how full its input ring is now
+ */
+static void report_stage_load(Pipeline *pipe, PipelineStageStats *last, double elapsed) {
+    printf("[stages] busy, input ring:");
+    for (int s = 0; s < pipe->stages; s++) {
+        PipelineStageStats st;
+        pipeline_stats(pipe, s, &st);
+        printf("%s %s %.0f%%", s > 0 ? "," : "", pipe->stage[s].name,
+               100.0 * (st.busy - last[s].busy) / elapsed);
+        if (st.depth > 0) {
+            printf(" %zu/%zu", pipeline_occupancy(pipe, s), st.depth);
+        }
+        last[s] = st;
+    }
+    printf("\n");
+    fflush(stdout);
+}
+
+/**
+ * Print the counters of every stage over the whole run
+ */
+static void report_stage_totals(Pipeline *pipe, double elapsed) {
+    printf("Stage      Thread  CPU   Blocks   Busy  Input stalls (wait)  Output stalls (wait)  Ring fill\n");
+    for (int s = 0; s < pipe->stages; s++) {
+        PipelineStageStats st;
+        pipeline_stats(pipe, s, &st);
+        int t = pipeline_thread_of(pipe, s);
+        char cpu[16], fill[32];
+        snprintf(cpu, sizeof(cpu), pipe->cpu[t] >= 0 ? "%d" : "-", pipe->cpu[t]);
+        if (st.depth > 0) {
+            snprintf(fill, sizeof(fill), "%.1f/%zu", st.occupancy, st.depth);
+        } else {
+            snprintf(fill, sizeof(fill), "-");
+        }
+        printf("%-10s %6d %4s %8llu %5.1f%% %12llu (%6.2f s) %13llu (%6.2f s) %10s\n",
+               pipe->stage[s].name, t, cpu, st.blocks, elapsed > 0 ? 100.0 * st.busy / elapsed : 0.0,
+               st.input_stalls, st.input_wait, st.output_stalls, st.output_wait, fill);
+    }
+}
+
+/**
+ * Stream frames through the staged transmitter
+ *
+ * The bit source, mapper, pulse shaper (if shaping), channel, packetizer
+ * and socket writer run as pipeline stages (see pipeline.h) spread over
+ * opts->threads threads, each optionally pinned to a CPU. Blocks of one
+ * send batch each come from a pool set up before the threads start and
+ * pass between the threads by handle through rings of opts->depth, so the
+ * stream neither allocates nor copies frames. The calling thread only
+ * prints reports.
+ */
+static int run_pipeline(const UDPConfig *config, const TxOptions *opts, Trace *trace) {
+    TxPipeline tp;
+    int symbols = opts->symbols;
+
+    memset(&tp, 0, sizeof(tp));
+    tp.opts = opts;
+    tp.trace = trace;
+    init_header(&tp.hdr, opts, symbols);
+    tp.packed_bytes = (symbols + 3) / 4;
+    tp.info_bits = frame_info_bits(opts, symbols);
+    tp.samples = 2 * frame_samples(&tp.hdr);
+    tp.frame_size = opts->legacy ? COMBINATION_LENGTH * sizeof(float) : frame_bytes(&tp.hdr);
+    tp.symbols_offset = TX_BLOCK_HEADER + ((opts->batch * tp.packed_bytes + 63) & ~(size_t)63);
+    tp.samples_offset = tp.symbols_offset;
+    if (opts->sps > 1) {
+        tp.samples_offset += (opts->batch * 2 * symbols * sizeof(float) + 63) & ~(size_t)63;
+    }
+    tp.frames_offset = tp.samples_offset;
+    if (!opts->legacy && opts->format != FRAME_FORMAT_F32) {
+        tp.frames_offset += (opts->batch * tp.samples * sizeof(float) + 63) & ~(size_t)63;
+    }
+    tp.frame_period = opts->symbol_rate > 0 ? symbols / opts->symbol_rate : 0;
+    atomic_init(&tp.sent, 0);
+    atomic_init(&tp.dropped, 0);
+    atomic_init(&tp.syscalls, 0);
+    bitsrc_init(&tp.source, opts->pattern, opts->seed);
+    diff_init(&tp.coder);
+    awgn_init(&tp.channel, opts->seed + 1, opts->esn0_db);
+    init_fading(&tp.fading, opts);
+    init_carrier(&tp.nco, opts);
+    if (opts->sps > 1 && rrc_init(&tp.shaper, opts->sps, opts->span, opts->rolloff) < 0) {
+        perror("rrc_init failed");
+        return 1;
+    }
+
+    struct sockaddr_in saddr;
+    int sockfd = open_socket(config, &saddr);
+    if (sockfd == -1) {
+        rrc_free(&tp.shaper);
+        return 1;
+    }
+    if (udp_tx_init(&tp.tx, sockfd, &saddr, tp.frame_size, opts->batch, opts->tx_mode) < 0) {
+        perror("udp_tx_init failed");
+        close(sockfd);
+        rrc_free(&tp.shaper);
+        return 1;
+    }
+
+    PipelineStage stages[TX_STAGES] = {
+        { "source",    stage_source,    &tp },
+        { "map",       stage_map,       &tp },
+        { "shape",     stage_shape,     &tp },
+        { "channel",   stage_channel,   &tp },
+        { "packetize", stage_packetize, &tp },
+        { "write",     stage_write,     &tp },
+    };
+    int count = TX_STAGES;
+    if (opts->sps == 1) {
+        // Without pulse shaping the mapper writes the samples itself
+        memmove(&stages[2], &stages[3], (count - 3) * sizeof(stages[0]));
+        count--;
+    }
+    Pipeline pipe;
+    if (pipeline_init(&pipe, stages, count, opts->threads, opts->depth,
+                      tp.frames_offset + opts->batch * tp.frame_size, opts->huge) < 0) {
+        perror("pipeline_init failed");
+        udp_tx_free(&tp.tx);
+        close(sockfd);
+        rrc_free(&tp.shaper);
+        return 1;
+    }
+
+    signal(SIGINT, handle_stop);
+    signal(SIGTERM, handle_stop);
+
+    int summary = trace_on(trace, TRACE_SUMMARY);
+    if (summary) {
+        print_stream_setup(config, opts, tp.frame_size, &tp.tx);
+        printf("Pipeline: %d stages on %d threads (", pipe.stages, pipe.threads);
+        for (int s = 0; s < pipe.stages; s++) {
+            int same = s > 0 && pipeline_thread_of(&pipe, s) == pipeline_thread_of(&pipe, s - 1);
+            printf("%s%s", s == 0 ? "" : same ? " + " : " | ", pipe.stage[s].name);
+        }
+        printf("), rings of %d blocks\n", opts->depth);
+        printf("Frame pool: %u blocks of %zu bytes, %s\n", pipe.pool.slots, pipe.pool.slot_bytes,
+               pool_backing_name(pipe.pool.backing));
+        fflush(stdout);
+    }
+
+    int status = 0;
+    double start = now_seconds();
+    double last_report = start;
+    unsigned long long last_sent = 0, last_dropped = 0, last_syscalls = 0;
+    PipelineStageStats last[PIPELINE_MAX_STAGES];
+    memset(last, 0, sizeof(last));
+    tp.deadline = start;
+    if (pipeline_start(&pipe, opts->cpus, opts->ncpus) < 0) {
+        perror("cannot start the pipeline threads");
+        status = 1;
+    }
+
+    while (status == 0 && pipeline_running(&pipe)) {
+        struct timespec ts = { 0, 10000000 };
+        nanosleep(&ts, NULL);
+        double now = now_seconds();
+        if (summary && now - last_report >= opts->report_interval) {
+            unsigned long long sent = atomic_load(&tp.sent);
+            unsigned long long dropped = atomic_load(&tp.dropped);
+            unsigned long long syscalls = atomic_load(&tp.syscalls);
+            unsigned long frames = sent - last_sent;
+            report_rate("[stream]", frames, frames * symbols, frames * tp.frame_size,
+                        dropped - last_dropped, syscalls - last_syscalls, now - last_report);
+            report_stage_load(&pipe, last, now - last_report);
+            last_sent = sent;
+            last_dropped = dropped;
+            last_syscalls = syscalls;
+            last_report = now;
+        }
+    }
+    if (pipeline_join(&pipe) < 0 && status == 0) {
+        errno = tp.send_errno;
+        perror("send failed");
+        status = 1;
+    }
+    if (status == 0 && udp_tx_flush(&tp.tx) < 0) {
+        perror("send failed");
+        status = 1;
+    }
+    double elapsed = now_seconds() - start;
+
+    close(sockfd);
+
+    if (summary) {
+        printf("Sent %llu frames (%llu dropped) to %s:%d.\n",
+               tp.tx.sent, tp.tx.dropped, config->ip_address, config->port);
+        report_rate("[total]", tp.tx.sent, tp.tx.sent * symbols, tp.tx.sent * tp.frame_size,
+                    tp.tx.dropped, tp.tx.syscalls, elapsed);
+        report_stage_totals(&pipe, elapsed);
+        if (!opts->legacy && opts->format != FRAME_FORMAT_F32) {
+            report_quant(&tp.quant, &tp.hdr, opts->esn0_db);
+        }
+    }
+    pipeline_free(&pipe);
+    udp_tx_free(&tp.tx);
+    rrc_free(&tp.shaper);
+    return status;
+}
+
+/**
+ * Print command line usage
+ */
+static void usage(const char *prog) {
+    printf("Usage: %s [options] [config_file]\n", prog);
+    printf("  -s, --stream          Send frames continuously until interrupted\n");
+    printf("  -r, --rate SYM/S      Target symbol rate when streaming (0 = as fast as possible)\n");
+    printf("  -m, --symbols N       Symbols per frame (default %d; at most %d legacy, or what fits the MTU)\n",
+           SYMBOLS_COUNT, MAX_SYMBOLS);
+    printf("  -n, --frames N        Stop streaming after N frames (0 = unlimited)\n");
+    printf("  -i, --interval SEC    Statistics report interval (default %.0f s)\n", REPORT_INTERVAL);
+    printf("  -e, --esn0 DB         Channel Es/N0 in dB (default %.0f)\n", ES_N0_DB);
+    printf("  -p, --pattern NAME    random, prbs7, prbs15, prbs23 or prbs31 (default random)\n");
+    printf("  -S, --seed N          Bit source seed, or PRBS start state (default: current time / all ones)\n");
+    printf("  -t, --tx MODE         Streaming send path: sendto, sendmmsg or gso (default sendmmsg)\n");
+    printf("  -b, --batch N         Frames per send batch when streaming (1-%d, default %d)\n", UDP_TX_MAX_BATCH, TX_BATCH);
+    printf("  -f, --framing NAME    Frame layout: compact or legacy (default compact)\n");
+    printf("  -M, --mtu BYTES       Path MTU compact frames must fit in (default %d)\n", FRAME_DEFAULT_MTU);
+    printf("  -F, --format NAME     Compact frame samples: f32, sc16, sc8 or bfp (default f32)\n");
+    printf("  -A, --full-scale A    Sample magnitude mapped to the largest SC16/SC8 value (default %.0f)\n",
+           SAMPLE_FULL_SCALE);
+    printf("  -W, --mantissa-bits W BFP mantissa width, %d-%d bits (default %d)\n",
+           BFP_MIN_BITS, BFP_MAX_BITS, BFP_DEFAULT_BITS);
+    printf("  -N, --bfp-block N     BFP samples per shared exponent, a multiple of 8 up to %d (default %d)\n",
+           BFP_MAX_BLOCK, BFP_DEFAULT_BLOCK);
+    printf("  -v, --verbosity LEVEL Output: quiet, summary, frame or sample (default summary)\n");
+    printf("  -D, --dump FILE       Sample dump file, \"-\" for stdout (default %s)\n", TRACE_DUMP_FILE);
+    printf("  -T, --dump-format F   Sample dump format: text or binary (default text)\n");
+    printf("  -P, --pipeline N      Stream through the staged transmitter on N threads, 1-%d (implies --stream)\n",
+           TX_STAGES);
+    printf("  -C, --cpus LIST       CPUs to pin the pipeline threads to, in order, e.g. 0,2,4\n");
+    printf("  -d, --depth N         Blocks of one batch per pipeline ring (default %d)\n", PIPELINE_DEFAULT_DEPTH);
+    printf("  -H, --hugepages       Back the pipeline's blocks with huge pages if available\n");
+    printf("  -k, --sps N           Root-raised-cosine pulse shaping with N samples per symbol, 2-%d (default 1: off)\n",
+           RRC_MAX_SPS);
+    printf("  -a, --rolloff B       Pulse roll-off, 0-1 (default %.2f)\n", RRC_DEFAULT_ROLLOFF);
+    printf("  -L, --span N          Pulse length in symbols, even, 2-%d (default %d)\n", RRC_MAX_SPAN, RRC_DEFAULT_SPAN);
+    printf("  -o, --phase-offset DEG Carrier phase offset of the channel in degrees\n");
+    printf("  -y, --freq-offset F   Carrier frequency offset in cycles per symbol (up to +-%g)\n",
+           CARRIER_MAX_FREQUENCY);
+    printf("  -Z, --differential    Code the bits differentially\n");
+    printf("  -R, --fading PROFILE  Multipath fading: flat, two-ray, urban or delay:dB,... (delays in samples)\n");
+    printf("  -j, --doppler F       Largest Doppler shift of the fading in cycles per symbol (default %g)\n",
+           DOPPLER);
+    printf("  -K, --rician DB       Rician K-factor of the first path in dB (default: Rayleigh)\n");
+    printf("  -c, --code RATE       Convolutional code: none, 1/2, 2/3 or 3/4 (default none)\n");
+    printf("  -x, --no-crc          Send compact frames without the CRC32C trailer\n");
+}
+
+/**
+ * Read a comma-separated list of CPU numbers
+ *
+ * @return Number of CPUs, or -1 if the list is malformed or too long
+ */
+static int parse_cpus(const char *list, int *cpus, int max) {
+    int n = 0;
+    const char *p = list;
+
+    while (*p != '\0') {
+        char *end;
+        long cpu = strtol(p, &end, 10);
+        if (end == p || cpu < 0 || n == max) {
+            return -1;
+        }
+        cpus[n++] = (int)cpu;
+        p = *end == ',' ? end + 1 : end;
+        if (*end != ',' && *end != '\0') {
+            return -1;
+        }
+    }
+    return n;
+}
+
+int main(int argc, char *argv[]) {
+    TxOptions opts = { 0, SYMBOLS_COUNT, 0, 0, REPORT_INTERVAL, ES_N0_DB, BITSRC_RANDOM, 0,
+                       UDP_TX_SENDMMSG, TX_BATCH, 0, FRAME_DEFAULT_MTU,
+                       FRAME_FORMAT_F32, SAMPLE_FULL_SCALE, BFP_DEFAULT_BITS, BFP_DEFAULT_BLOCK,
+                       TRACE_SUMMARY, NULL, 0, 0, PIPELINE_DEFAULT_DEPTH, { 0 }, 0, 0,
+                       1, RRC_DEFAULT_SPAN, RRC_DEFAULT_ROLLOFF, 0.0, 0.0, 0, NULL, { 0 }, DOPPLER, 0.0,
+                       CONV_NONE, 1 };
+    int seed_given = 0;
+    int pipeline_given = 0;
+    static const struct option long_opts[] = {
+        { "stream",   no_argument,       NULL, 's' },
+        { "rate",     required_argument, NULL, 'r' },
+        { "symbols",  required_argument, NULL, 'm' },
+        { "frames",   required_argument, NULL, 'n' },
+        { "interval", required_argument, NULL, 'i' },
+        { "esn0",     required_argument, NULL, 'e' },
+        { "pattern",  required_argument, NULL, 'p' },
+        { "seed",     required_argument, NULL, 'S' },
+        { "tx",       required_argument, NULL, 't' },
+        { "batch",    required_argument, NULL, 'b' },
+        { "framing",  required_argument, NULL, 'f' },
+        { "mtu",      required_argument, NULL, 'M' },
+        { "format",   required_argument, NULL, 'F' },
+        { "full-scale", required_argument, NULL, 'A' },
+        { "mantissa-bits", required_argument, NULL, 'W' },
+        { "bfp-block", required_argument, NULL, 'N' },
+        { "verbosity", required_argument, NULL, 'v' },
+        { "dump",     required_argument, NULL, 'D' },
+        { "dump-format", required_argument, NULL, 'T' },
+        { "pipeline", required_argument, NULL, 'P' },
+        { "cpus",     required_argument, NULL, 'C' },
+        { "depth",    required_argument, NULL, 'd' },
+        { "hugepages", no_argument,      NULL, 'H' },
+        { "sps",      required_argument, NULL, 'k' },
+        { "rolloff",  required_argument, NULL, 'a' },
+        { "span",     required_argument, NULL, 'L' },
+        { "phase-offset", required_argument, NULL, 'o' },
+        { "freq-offset", required_argument, NULL, 'y' },
+        { "differential", no_argument,   NULL, 'Z' },
+        { "fading",   required_argument, NULL, 'R' },
+        { "doppler",  required_argument, NULL, 'j' },
+        { "rician",   required_argument, NULL, 'K' },
+        { "code",     required_argument, NULL, 'c' },
+        { "no-crc",   no_argument,       NULL, 'x' },
+        { "help",     no_argument,       NULL, 'h' },
+        { NULL, 0, NULL, 0 }
+    };
+    int opt;
+
+    while ((opt = getopt_long(argc, argv, "sr:m:n:i:e:p:S:t:b:f:M:F:A:W:N:v:D:T:P:C:d:Hk:a:L:o:y:ZR:j:K:c:xh", long_opts, NULL)) != -1) {
+        switch (opt) {
+        case 's': opts.stream = 1; break;
+        case 'r': opts.symbol_rate = atof(optarg); break;
+        case 'm': opts.symbols = atoi(optarg); break;
+        case 'n': opts.max_frames = strtoul(optarg, NULL, 10); break;
+        case 'i': opts.report_interval = atof(optarg); break;
+        case 'e': opts.esn0_db = atof(optarg); break;
+        case 'S': opts.seed = strtoull(optarg, NULL, 0); seed_given = 1; break;
+        case 'b': opts.batch = atoi(optarg); break;
+        case 'M': opts.mtu = atoi(optarg); break;
+        case 'A': opts.full_scale = atof(optarg); break;
+        case 'W': opts.bfp_bits = atoi(optarg); break;
+        case 'N': opts.bfp_block = atoi(optarg); break;
+        case 'D': opts.dump_path = optarg; break;
+        case 'P': opts.threads = atoi(optarg); opts.stream = 1; pipeline_given = 1; break;
+        case 'd': opts.depth = atoi(optarg); break;
+        case 'H': opts.huge = 1; break;
+        case 'k': opts.sps = atoi(optarg); break;
+        case 'a': opts.rolloff = atof(optarg); break;
+        case 'L': opts.span = atoi(optarg); break;
+        case 'o': opts.phase_offset = atof(optarg); break;
+        case 'y': opts.freq_offset = atof(optarg); break;
+        case 'Z': opts.differential = 1; break;
+        case 'x': opts.crc = 0; break;
+        case 'R':
+            if (!fading_parse_profile(optarg, &opts.profile)) {
+                fprintf(stderr, "Invalid fading profile: %s\n", optarg);
+                return 1;
+            }
+            opts.fading = optarg;
+            break;
+        case 'j': opts.doppler = atof(optarg); break;
+        case 'K': opts.rician_k = pow(10.0, atof(optarg) / 10.0); break;
+        case 'C':
+            opts.ncpus = parse_cpus(optarg, opts.cpus, PIPELINE_MAX_STAGES);
+            if (opts.ncpus < 0) {
+                fprintf(stderr, "Invalid CPU list: %s\n", optarg);
+                return 1;
+            }
+            break;
+        case 'v':
+            if (!trace_parse_level(optarg, &opts.verbosity)) {
+                fprintf(stderr, "Unknown verbosity: %s\n", optarg);
+                return 1;
+            }
+            break;
+        case 'T':
+            if (strcmp(optarg, "binary") == 0) {
+                opts.dump_binary = 1;
+            } else if (strcmp(optarg, "text") == 0) {
+                opts.dump_binary = 0;
+            } else {
+                fprintf(stderr, "Unknown dump format: %s\n", optarg);
+                return 1;
+            }
+            break;
+        case 'F':
+            if (!sample_parse_format(optarg, &opts.format)) {
+                fprintf(stderr, "Unknown sample format: %s\n", optarg);
+                return 1;
+            }
+            break;
+        case 'f':
+            if (strcmp(optarg, "legacy") == 0) {
+                opts.legacy = 1;
+            } else if (strcmp(optarg, "compact") == 0) {
+                opts.legacy = 0;
+            } else {
+                fprintf(stderr, "Unknown framing: %s\n", optarg);
+                return 1;
+            }
+            break;
+        case 't':
+            if (!udp_tx_parse_mode(optarg, &opts.tx_mode)) {
+                fprintf(stderr, "Unknown send path: %s\n", optarg);
+                return 1;
+            }
+            break;
+        case 'c':
+            if (!conv_parse_rate(optarg, &opts.code)) {
+                fprintf(stderr, "Unknown code rate: %s\n", optarg);
+                return 1;
+            }
+            break;
+        case 'p':
+            if (!bitsrc_parse_type(optarg, &opts.pattern)) {
+                fprintf(stderr, "Unknown pattern: %s\n", optarg);
+                return 1;
+            }
+            break;
+        case 'h': usage(argv[0]); return 0;
+        default:  usage(argv[0]); return 1;
+        }
+    }
+    if (opts.legacy && opts.format != FRAME_FORMAT_F32) {
+        fprintf(stderr, "The legacy layout only carries f32 samples\n");
+        return 1;
+    }
+    if (opts.full_scale <= 0) {
+        fprintf(stderr, "Full scale must be positive\n");
+        return 1;
+    }
+    if (!bfp_valid(opts.bfp_bits, opts.bfp_block)) {
+        fprintf(stderr, "BFP needs %d-%d mantissa bits and a block of 8-%d samples in steps of 8\n",
+                BFP_MIN_BITS, BFP_MAX_BITS, BFP_MAX_BLOCK);
+        return 1;
+    }
+    if (opts.sps != 1) {
+        if (!rrc_valid(opts.sps, opts.span, opts.rolloff)) {
+            fprintf(stderr, "Pulse shaping needs 2-%d samples per symbol, an even span of 2-%d symbols "
+                    "and a roll-off above 0 and up to 1\n", RRC_MAX_SPS, RRC_MAX_SPAN);
+            return 1;
+        }
+        if (opts.legacy || !opts.stream) {
+            fprintf(stderr, "Pulse shaping needs compact frames and --stream\n");
+            return 1;
+        }
+    }
+    if (opts.fading != NULL) {
+        if (opts.doppler < 0.0 || opts.doppler > FADING_MAX_DOPPLER) {
+            fprintf(stderr, "The Doppler shift must be 0 to %g cycles per symbol\n", FADING_MAX_DOPPLER);
+            return 1;
+        }
+        if (opts.legacy || !opts.stream) {
+            fprintf(stderr, "Fading needs compact frames and --stream\n");
+            return 1;
+        }
+    }
+    if (carrier_offset(&opts) || opts.differential) {
+        if (fabs(opts.freq_offset) > CARRIER_MAX_FREQUENCY) {
+            fprintf(stderr, "The frequency offset must be within +-%g cycles per symbol\n", CARRIER_MAX_FREQUENCY);
+            return 1;
+        }
+        if (opts.legacy || !opts.stream) {
+            fprintf(stderr, "Carrier offsets and differential coding need compact frames and --stream\n");
+            return 1;
+        }
+    }
+    if (opts.code != CONV_NONE) {
+        if (opts.legacy || !opts.stream) {
+            fprintf(stderr, "Coding needs compact frames and --stream\n");
+            return 1;
+        }
+        if (opts.differential) {
+            fprintf(stderr, "Coding and differential coding cannot be combined\n");
+            return 1;
+        }
+    }
+    FrameHeader limits;
+    init_header(&limits, &opts, 0);
+    int max_symbols = opts.legacy ? MAX_SYMBOLS : (int)frame_max_symbols(&limits, opts.mtu);
+    if (opts.symbols < 1 || opts.symbols > max_symbols) {
+        fprintf(stderr, "Symbols per frame must be between 1 and %d", max_symbols);
+        if (!opts.legacy) {
+            fprintf(stderr, " (compact frames in a %d-byte MTU)", opts.mtu);
+        }
+        fprintf(stderr, "\n");
+        return 1;
+    }
+    if (opts.code != CONV_NONE && frame_info_bits(&opts, opts.symbols) == 0) {
+        fprintf(stderr, "Frames of %d symbols cannot carry a byte at code rate %s\n", opts.symbols,
+                conv_rate_name(opts.code));
+        return 1;
+    }
+    if (opts.batch < 1 || opts.batch > UDP_TX_MAX_BATCH) {
+        fprintf(stderr, "Batch size must be between 1 and %d\n", UDP_TX_MAX_BATCH);
+        return 1;
+    }
+    if ((pipeline_given && opts.threads < 1) || opts.threads > TX_STAGES) {
+        fprintf(stderr, "Pipeline threads must be between 1 and %d\n", TX_STAGES);
+        return 1;
+    }
+    if (opts.depth < 2 || opts.depth > TX_MAX_DEPTH) {
+        fprintf(stderr, "Pipeline depth must be between 2 and %d blocks\n", TX_MAX_DEPTH);
+        return 1;
+    }
+    while (opts.depth & (opts.depth - 1)) {
+        opts.depth++;                   // Rings hold a power of two blocks
+    }
+    if (opts.report_interval <= 0) {
+        opts.report_interval = REPORT_INTERVAL;
+    }
+    if (!seed_given && opts.pattern == BITSRC_RANDOM) {
+        opts.seed = time(0);
+    }
+
+    // Initialize UDP configuration with default values (localhost)
+    UDPConfig config;
+    init_udp_config(&config);
+
+    // Load configuration from file if specified
+    const char *config_file = (optind < argc) ? argv[optind] : CONFIG_FILE;
+    int loaded = load_udp_config(&config, config_file);
+
+    // Display current configuration
+    if (opts.verbosity >= TRACE_SUMMARY) {
+        if (loaded) {
+            printf("Loaded configuration from %s\n", config_file);
+        } else {
+            printf("Using default configuration (localhost:9090)\n");
+        }
+        print_udp_config(&config);
+    }
+
+    Trace trace;
+    if (trace_open(&trace, opts.verbosity, opts.dump_path, opts.dump_binary) < 0) {
+        perror("cannot open the sample dump");
+        return 1;
+    }
+    int status;
+    if (opts.threads > 0) {
+        status = run_pipeline(&config, &opts, &trace);
+    } else if (opts.stream) {
+        status = run_stream(&config, &opts, &trace);
+    } else {
+        status = run_single(&config, &opts, &trace);
+    }
+    trace_close(&trace);
+    return status;
+}
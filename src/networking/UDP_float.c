@@ -2,11 +2,16 @@
  * UDP Float Transmission
  * 
  * This program demonstrates sending QPSK modulated symbols over UDP.
- * The float values (real and imaginary parts) are converted to byte arrays
- * before transmission.
+ * The real and imaginary parts are sent interleaved as little-endian
+ * float32 by default, or as SC16 / SC8 fixed-point samples (see sample.h).
  * 
- * Compile with: gcc -o udp_float UDP_float.c -lm
- * Run with: ./udp_float [config_file]
+ * Compile with: make bin/udp_float (links bin/libqpsk.a)
+ * Run with: ./bin/udp_float [options] [config_file]
+ *
+ * Options:
+ *   -F, --format NAME     Samples: f32, sc16 or sc8 (default f32)
+ *   -A, --full-scale A    Sample magnitude mapped to the largest SC16/SC8 value (default 4)
+ *   -C, --crc             Append a little-endian CRC32C of the samples (see crc32c.h)
  */
 
 #include <stdio.h>
@@ -19,43 +24,69 @@
 #include <arpa/inet.h>
 #include <time.h>
 #include <math.h>
+#include <getopt.h>
 
-#include "../utils/udp_config.h"
+#include "../../config/config.h"
+#include "../libqpsk/awgn.h"
+#include "../libqpsk/bitsrc.h"
+#include "../libqpsk/crc32c.h"
+#include "../libqpsk/qpsk_map.h"
+#include "../libqpsk/sample.h"
 
 #define BITS_COUNT 40        // Total number of random bits to generate
 #define SYMBOLS_COUNT 20     // Number of QPSK symbols (each symbol encodes 2 bits)
-#define NOISE_STD_DEV 0.05   // Standard deviation of noise to be added to symbols
+#define ES_N0_DB 23.0        // Channel Es/N0 in dB (noise std dev of about 0.05)
 #define BUFFER_SIZE 256      // Size of the buffer for data transmission
 
 #define CONFIG_FILE "config/udp_config.txt"  // Default configuration file path
 
-/**
- * Structure to represent a complex number with real and imaginary parts
- */
-typedef struct {
-    double real;
-    double imag;
-} Complex;
-
-/**
- * Function to convert a float value to a byte array
- * 
- * @param value  The float value to convert
- * @param bytes  Pointer to the byte array where the result will be stored
- */
-void floatToBytes(float value, unsigned char *bytes) {
-    memcpy(bytes, &value, sizeof(float));
+static void usage(const char *prog) {
+    printf("Usage: %s [options] [config_file]\n", prog);
+    printf("  -F, --format NAME     Samples: f32, sc16 or sc8 (default f32)\n");
+    printf("  -A, --full-scale A    Sample magnitude mapped to the largest SC16/SC8 value (default %.0f)\n",
+           SAMPLE_FULL_SCALE);
+    printf("  -C, --crc             Append a little-endian CRC32C of the samples\n");
 }
 
 int main(int argc, char *argv[]) {
-    int i, j, bit1, bit2;
+    int i;
+    FrameFormat format = FRAME_FORMAT_F32;
+    double full_scale = SAMPLE_FULL_SCALE;
+    int crc = 0;
+    static const struct option long_opts[] = {
+        { "format",     required_argument, NULL, 'F' },
+        { "full-scale", required_argument, NULL, 'A' },
+        { "crc",        no_argument,       NULL, 'C' },
+        { "help",       no_argument,       NULL, 'h' },
+        { NULL, 0, NULL, 0 }
+    };
+    int opt;
+
+    while ((opt = getopt_long(argc, argv, "F:A:Ch", long_opts, NULL)) != -1) {
+        switch (opt) {
+        case 'A': full_scale = atof(optarg); break;
+        case 'C': crc = 1; break;
+        case 'F':
+            if (!sample_parse_format(optarg, &format) || frame_symbol_bytes(format) == 0) {
+                fprintf(stderr, "Unknown sample format: %s\n", optarg);
+                return 1;
+            }
+            break;
+        case 'h': usage(argv[0]); return 0;
+        default:  usage(argv[0]); return 1;
+        }
+    }
+    if (full_scale <= 0) {
+        fprintf(stderr, "Full scale must be positive\n");
+        return 1;
+    }
 
     // Initialize UDP configuration with default values (localhost)
     UDPConfig config;
     init_udp_config(&config);
     
     // Load configuration from file if specified
-    const char *config_file = (argc > 1) ? argv[1] : CONFIG_FILE;
+    const char *config_file = (optind < argc) ? argv[optind] : CONFIG_FILE;
     if (load_udp_config(&config, config_file)) {
         printf("Loaded configuration from %s\n", config_file);
     } else {
@@ -65,45 +96,25 @@ int main(int argc, char *argv[]) {
     // Display current configuration
     print_udp_config(&config);
 
-    // Initialize random number generator with current time as seed
-    srand(time(0));
+    // Initialize the bit source with current time as seed
+    unsigned long long seed = time(0);
+    BitSource source;
+    bitsrc_init(&source, BITSRC_RANDOM, seed);
 
     // Step 1: Generate random data bits
+    uint8_t packed_bits[BITS_COUNT / 8];
     int data_bits[BITS_COUNT];
-    for (i = 0; i < BITS_COUNT; i++) {
-        data_bits[i] = rand() % 2;
-    }
+    bitsrc_fill_bytes(&source, packed_bits, sizeof(packed_bits));
+    bitsrc_unpack(packed_bits, BITS_COUNT, data_bits);
 
     // Step 2: Perform QPSK modulation to create symbols
     Complex symbols[SYMBOLS_COUNT];
-    for (i = 0, j = 0; i < BITS_COUNT; i += 2, j++) {
-        bit1 = data_bits[i];         // First bit
-        bit2 = data_bits[i + 1];     // Second bit
-
-        // Map the two bits to a symbol using QPSK modulation
-        Complex symbol;
-        if (bit1 == 0 && bit2 == 0) {
-            symbol.real = 1 / sqrt(2);
-            symbol.imag = 1 / sqrt(2);
-        } else if (bit1 == 0 && bit2 == 1) {
-            symbol.real = -1 / sqrt(2);
-            symbol.imag = 1 / sqrt(2);
-        } else if (bit1 == 1 && bit2 == 0) {
-            symbol.real = 1 / sqrt(2);
-            symbol.imag = -1 / sqrt(2);
-        } else if (bit1 == 1 && bit2 == 1) {
-            symbol.real = -1 / sqrt(2);
-            symbol.imag = -1 / sqrt(2);
-        }
-
-        // Step 3: Add noise to the symbols
-        double noise_real = NOISE_STD_DEV * (2 * ((double)rand() / RAND_MAX) - 1);
-        double noise_imag = NOISE_STD_DEV * (2 * ((double)rand() / RAND_MAX) - 1);
-        symbol.real += noise_real;
-        symbol.imag += noise_imag;
+    qpsk_modulate_complex(data_bits, SYMBOLS_COUNT, symbols);
 
-        symbols[j] = symbol;
-    }
+    // Step 3: Add Gaussian noise to the symbols
+    Awgn channel;
+    awgn_init(&channel, seed + 1, ES_N0_DB);  // Independent stream from the bits
+    awgn_add_complex(&channel, symbols, SYMBOLS_COUNT);
 
     // Step 4: Display the modulated symbols
     Complex qpsk_symbols[SYMBOLS_COUNT];
@@ -117,12 +128,23 @@ int main(int argc, char *argv[]) {
     }
     printf("}\n");
     
-    // Step 5: Convert symbols to byte arrays for UDP transmission
-    unsigned char byteBuffer[SYMBOLS_COUNT * sizeof(float) * 2];
-    for (i = 0, j = 0; i < SYMBOLS_COUNT; i++, j += sizeof(float) * 2) {
-        floatToBytes(symbols[i].real, byteBuffer + j);
-        floatToBytes(symbols[i].imag, byteBuffer + j + sizeof(float));
+    // Step 5: Convert symbols to little-endian samples for UDP transmission
+    float iq[SYMBOLS_COUNT * 2];
+    for (i = 0; i < SYMBOLS_COUNT; i++) {
+        iq[2*i] = (float)symbols[i].real;
+        iq[2*i + 1] = (float)symbols[i].imag;
+    }
+    unsigned char byteBuffer[SYMBOLS_COUNT * sizeof(float) * 2 + CRC32C_BYTES];
+    size_t length = SYMBOLS_COUNT * frame_symbol_bytes(format);
+    sample_encode(format, iq, SYMBOLS_COUNT * 2, sample_scale(format, full_scale), byteBuffer);
+    if (crc) {
+        uint32_t check = crc32c(byteBuffer, length);
+        for (i = 0; i < CRC32C_BYTES; i++) {
+            byteBuffer[length++] = (unsigned char)(check >> (8 * i));
+        }
     }
+    printf("Sending %d symbols as %s%s, %zu bytes\n", SYMBOLS_COUNT, sample_format_name(format),
+           crc ? " with a CRC32C" : "", length);
 
     // Step 6: Set up UDP socket for transmission
     int sockfd = socket(AF_INET, SOCK_DGRAM, 0);
@@ -139,7 +161,7 @@ int main(int argc, char *argv[]) {
     saddr.sin_addr.s_addr = inet_addr(config.ip_address);
 
     // Step 7: Send the data
-    sendto(sockfd, byteBuffer, sizeof(byteBuffer), 0, (struct sockaddr *)&saddr, sizeof(saddr));
+    sendto(sockfd, byteBuffer, length, 0, (struct sockaddr *)&saddr, sizeof(saddr));
 
     // Close the socket
     close(sockfd);
@@ -0,0 +1,185 @@
+/**
+ * UDP Transmission with Data Padding
+ * 
+ * This program demonstrates QPSK modulation with noise and sends the data
+ * over UDP with padding to meet specific data format requirements.
+ * 
+ * The symbols and the hex dump of the buffer are written only at the
+ * sample verbosity level, to a dump file rather than the terminal.
+ * 
+ * Compile with: make bin/udp_padding (links bin/libqpsk.a)
+ * Run with: ./bin/udp_padding [options]
+ *
+ * Options:
+ *   -v, --verbosity LEVEL Output: quiet, summary, frame or sample (default summary)
+ *   -D, --dump FILE       Sample dump file, "-" for stdout (default qpsk_samples.txt)
+ *   -T, --dump-format F   Sample dump format: text or binary (default text)
+ * 
+ * Note: Configure the IP address and port before running.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <assert.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <time.h>
+#include <math.h>
+#include <getopt.h>
+
+#include "../libqpsk/awgn.h"
+#include "../libqpsk/bitsrc.h"
+#include "../libqpsk/qpsk_map.h"
+#include "../libqpsk/trace.h"
+
+#define BITS_COUNT 40         // Total number of random bits to generate
+#define SYMBOLS_COUNT 20      // Number of QPSK symbols (each symbol encodes 2 bits)
+#define ES_N0_DB 23.0         // Channel Es/N0 in dB (noise std dev of about 0.05)
+#define BUFFER_SIZE 256       // Size of the buffer for data transmission
+#define PADDING 256           // Initial padding size in bytes
+#define MIDDLE_PADDING 216    // Padding between real and imaginary data
+
+/**
+ * Function to convert a float value to a byte array
+ * 
+ * @param value  The float value to convert
+ * @param bytes  Pointer to the byte array where the result will be stored
+ */
+void floatToBytes(float value, unsigned char *bytes) {
+    memcpy(bytes, &value, sizeof(float));
+}
+
+/**
+ * Print command line usage
+ */
+static void usage(const char *prog) {
+    printf("Usage: %s [options]\n", prog);
+    printf("  -v, --verbosity LEVEL Output: quiet, summary, frame or sample (default summary)\n");
+    printf("  -D, --dump FILE       Sample dump file, \"-\" for stdout (default %s)\n", TRACE_DUMP_FILE);
+    printf("  -T, --dump-format F   Sample dump format: text or binary (default text)\n");
+}
+
+int main(int argc, char *argv[]) {
+    int i, j;
+    TraceLevel verbosity = TRACE_SUMMARY;
+    const char *dump_path = NULL;
+    int dump_binary = 0;
+    static const struct option long_opts[] = {
+        { "verbosity",   required_argument, NULL, 'v' },
+        { "dump",        required_argument, NULL, 'D' },
+        { "dump-format", required_argument, NULL, 'T' },
+        { "help",        no_argument,       NULL, 'h' },
+        { NULL, 0, NULL, 0 }
+    };
+    int opt;
+
+    while ((opt = getopt_long(argc, argv, "v:D:T:h", long_opts, NULL)) != -1) {
+        switch (opt) {
+        case 'D': dump_path = optarg; break;
+        case 'v':
+            if (!trace_parse_level(optarg, &verbosity)) {
+                fprintf(stderr, "Unknown verbosity: %s\n", optarg);
+                return 1;
+            }
+            break;
+        case 'T':
+            if (strcmp(optarg, "binary") == 0) {
+                dump_binary = 1;
+            } else if (strcmp(optarg, "text") == 0) {
+                dump_binary = 0;
+            } else {
+                fprintf(stderr, "Unknown dump format: %s\n", optarg);
+                return 1;
+            }
+            break;
+        case 'h': usage(argv[0]); return 0;
+        default:  usage(argv[0]); return 1;
+        }
+    }
+
+    Trace trace;
+    if (trace_open(&trace, verbosity, dump_path, dump_binary) < 0) {
+        perror("cannot open the sample dump");
+        return 1;
+    }
+
+    // Initialize the bit source with current time as seed
+    unsigned long long seed = time(0);
+    BitSource source;
+    bitsrc_init(&source, BITSRC_RANDOM, seed);
+
+    // Step 1: Generate random data bits
+    uint8_t packed_bits[BITS_COUNT / 8];
+    int data_bits[BITS_COUNT];
+    bitsrc_fill_bytes(&source, packed_bits, sizeof(packed_bits));
+    bitsrc_unpack(packed_bits, BITS_COUNT, data_bits);
+
+    // Step 2: Perform QPSK modulation and add noise
+    Complex symbols[SYMBOLS_COUNT];
+    qpsk_modulate_complex(data_bits, SYMBOLS_COUNT, symbols);
+
+    // Add Gaussian noise to the symbols
+    Awgn channel;
+    awgn_init(&channel, seed + 1, ES_N0_DB);  // Independent stream from the bits
+    awgn_add_complex(&channel, symbols, SYMBOLS_COUNT);
+
+    // Step 3: Dump the modulated symbols
+    if (trace_on(&trace, TRACE_SAMPLE)) {
+        float iq[2 * SYMBOLS_COUNT];
+        for (i = 0; i < SYMBOLS_COUNT; i++) {
+            iq[2*i] = (float)symbols[i].real;
+            iq[2*i + 1] = (float)symbols[i].imag;
+        }
+        trace_floats(&trace, "qpsk_symbols", 0, iq, 2 * SYMBOLS_COUNT);
+    }
+
+    // Step 4: Prepare buffer with padding for UDP transmission
+    // Calculate the total buffer size needed
+    int total_buffer_size = (PADDING * 2) + (SYMBOLS_COUNT * sizeof(float) * 2) + (MIDDLE_PADDING * 2);
+    unsigned char byteBuffer[total_buffer_size];
+
+    // Initialize all bytes in the buffer to zero
+    memset(byteBuffer, 0, total_buffer_size);
+
+    // Add real parts after initial padding
+    int offset = PADDING;
+    for (i = 0, j = offset; i < SYMBOLS_COUNT; i++, j += sizeof(float)) {
+        floatToBytes(symbols[i].real, byteBuffer + j);
+    }
+
+    // Add imaginary parts after middle padding
+    offset += SYMBOLS_COUNT * sizeof(float) + MIDDLE_PADDING;
+    for (i = 0, j = offset; i < SYMBOLS_COUNT; i++, j += sizeof(float)) {
+        floatToBytes(symbols[i].imag, byteBuffer + j);
+    }
+
+    // Debug: Dump buffer content as hex values
+    trace_bytes(&trace, "buffer", 0, byteBuffer, total_buffer_size);
+
+    // Step 5: Send buffer over UDP
+    int sockfd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (sockfd == -1) {
+        perror("socket creation failed");
+        return 1;
+    }
+
+    struct sockaddr_in saddr;
+    memset(&saddr, 0, sizeof(saddr));
+    saddr.sin_family = AF_INET;
+    saddr.sin_port = htons(49884);
+    saddr.sin_addr.s_addr = inet_addr("127.0.0.1");
+
+    sendto(sockfd, byteBuffer, total_buffer_size, 0, (struct sockaddr *)&saddr, sizeof(saddr));
+
+    close(sockfd);
+    trace_close(&trace);
+
+    if (trace_on(&trace, TRACE_SUMMARY)) {
+        printf("Message has been sent (%d bytes).\n", total_buffer_size);
+    }
+
+    return 0;
+}
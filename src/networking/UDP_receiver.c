@@ -0,0 +1,1150 @@
+/**
+ * UDP Receiver and QPSK Demodulator
+ *
+ * Counterpart of udp_final: binds the configured port, takes the noisy
+ * I/Q floats out of each frame, makes hard QPSK decisions and, when the
+ * transmitted bits can be rebuilt, keeps running bit and symbol error
+ * rates. The pipeline per datagram is:
+ * 1. Receive the frame and recognise its layout
+ * 2. Demap the symbols to packed bits (sign of I and Q)
+ * 3. Compare against the reference bit stream
+ * 4. Report throughput, error rates and the estimated Es/N0 periodically
+ *
+ * Datagrams are received in batches with recvmmsg() (optionally with UDP
+ * GRO) through the library's receive engine, which also counts datagrams
+ * the kernel dropped because the socket buffer was full.
+ *
+ * Compact frames (see frame.h) describe themselves, including the sample
+ * format (float32, SC16, SC8 or block floating point) and its parameters;
+ * their timestamps give the one-way latency when both ends share a clock.
+ * Frames ending in a CRC32C (see crc32c.h) are checked before anything
+ * else, and corrupt ones are counted and dropped. Datagrams of exactly
+ * 3072 bytes are taken as the legacy padded layout (zeros, real parts,
+ * imaginary parts) carrying --symbols symbols, and datagrams starting
+ * with "(" as the symbol text of udp_ascii (see ascii.h).
+ *
+ * The sequence numbers of each sender (address and port) are tracked by
+ * flow.h, which tells lost, reordered and duplicated frames apart; only
+ * frames in order are demodulated, since late ones no longer fit the
+ * reference or the filters. --jitter puts the frames through the reorder
+ * buffer of jitter.h first, so reordered frames are demodulated in their
+ * place as long as they arrive within the window. A frame the buffer
+ * gives up on is skipped like a lost one, or with --fill zero, for shaped
+ * frames, replaced by zero samples that the matched filter, timing loop
+ * and equalizer run through, which keeps the frame before it that a
+ * filter restart would cost. The reference bits and the filters assume a
+ * single sender.
+ *
+ * Pulse-shaped frames (udp_final --sps) go through the matched
+ * root-raised-cosine filter of rrc.h, which runs across frame boundaries:
+ * the decisions for the last symbols of a frame come out with the next
+ * frame, so they are collected and checked in groups of one frame, and a
+ * lost frame restarts the filter. By default the decisions fall on every
+ * sps-th sample, where the transmitter put the symbols; --timing runs the
+ * matched filter at the full rate instead and finds the symbol instants
+ * with the Gardner loop of timing.h. --delay and --clock-ppm emulate a
+ * receiver whose sample clock is late or off by some parts per million by
+ * resampling shaped frames on arrival, to test the loop on loopback.
+ * --equalize puts the adaptive equalizer of equalizer.h between the
+ * matched filter and the decisions of shaped frames, to undo multipath
+ * (udp_final --fading); it is fed two samples per symbol when sps is
+ * even, or the symbols of the timing loop when --timing is on.
+ *
+ * --carrier takes the carrier phase and frequency offset off the symbols
+ * of compact frames with the Costas loop of carrier.h before the
+ * decisions, and reports whether it is locked and the phase error left.
+ * Frames whose bits were coded differentially (udp_final --differential)
+ * are decoded whether the loop runs or not, which costs the first symbol
+ * after every gap. Frames protected by the convolutional code of conv.h
+ * (udp_final --code) are decoded with the soft-decision Viterbi decoder
+ * from LLRs of the symbols, and the report adds the bit error rate of the
+ * channel before decoding, found by encoding the decoded bits again.
+ *
+ * The reference stream needs the transmitter's --pattern, and for random
+ * bits also its --seed. A PRBS locks by itself. With compact frames the
+ * reference skips lost frames, so random bits stay aligned too; legacy
+ * frames and text of random bits must arrive from the first frame on
+ * without loss.
+ *
+ * Compile with: make bin/udp_receiver (links bin/libqpsk.a)
+ * Run with: ./bin/udp_receiver [options] [config_file]
+ *
+ * Options:
+ *   -m, --symbols N       Symbols per legacy frame, as sent (1-256, default 20)
+ *   -p, --pattern NAME    Transmitted bits: random, prbs7, prbs15, prbs23 or prbs31
+ *   -S, --seed N          Transmitter seed (needed for random bits)
+ *   -n, --frames N        Stop after N frames (0 = unlimited)
+ *   -i, --interval SEC    Statistics report interval in seconds (default 1)
+ *   -b, --rcvbuf BYTES    Socket receive buffer size (default 8 MiB)
+ *   -B, --batch N         Datagrams per receive call (default 64)
+ *   -g, --gro             Let the kernel coalesce datagrams (UDP_GRO)
+ *   -t, --timing          Recover the symbol timing of shaped frames (Gardner loop)
+ *   -w, --loop-bandwidth B Timing loop bandwidth relative to the symbol rate (default 0.002)
+ *   -d, --delay SYM       Emulate sampling shaped frames late by SYM symbols (-0.5 to 0.5)
+ *   -c, --clock-ppm PPM   Emulate a sample clock off by PPM parts per million (up to +-1000)
+ *   -C, --carrier         Recover the carrier phase and frequency of compact frames (Costas loop)
+ *   -W, --carrier-bandwidth B Carrier loop bandwidth relative to the symbol rate (default 0.005)
+ *   -e, --equalize        Equalize shaped frames (fractionally spaced CMA/LMS)
+ *   -T, --eq-taps N       Equalizer length in inputs (2-64, default 12)
+ *   -u, --eq-step MU      Equalizer adaptation step (up to 0.05, default 0.004)
+ *   -j, --jitter N        Reorder compact frames, letting a missing one hold back up to N (0 = off)
+ *   -J, --jitter-delay MS Longest wait for a missing frame (default 10 ms)
+ *   -z, --fill MODE       Stand-in for frames given up on: erase or zero (default erase)
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <time.h>
+#include <errno.h>
+#include <signal.h>
+#include <getopt.h>
+
+#include "../../config/config.h"
+#include "../libqpsk/ascii.h"
+#include "../libqpsk/ber.h"
+#include "../libqpsk/bitsrc.h"
+#include "../libqpsk/carrier.h"
+#include "../libqpsk/conv.h"
+#include "../libqpsk/crc32c.h"
+#include "../libqpsk/equalizer.h"
+#include "../libqpsk/flow.h"
+#include "../libqpsk/frame.h"
+#include "../libqpsk/jitter.h"
+#include "../libqpsk/qpsk_demap.h"
+#include "../libqpsk/rrc.h"
+#include "../libqpsk/timing.h"
+#include "../libqpsk/udp_rx.h"
+
+#define SYMBOLS_COUNT 20         // Default number of QPSK symbols per frame
+#define MAX_SYMBOLS 256          // Symbols that fit in one block of the padded layout
+#define BLOCK_LENGTH 256         // Length of each block (zeros, real parts, imaginary parts)
+#define COMBINATION_LENGTH 256*3 // Length of combined data array
+#define MAX_PACKED (FRAME_MAX_SYMBOLS / 4 + 1) // Packed data bytes of the largest frame
+#define RCVBUF_BYTES (8 << 20)   // Default socket receive buffer
+#define RX_BATCH 64              // Default datagrams per receive call
+#define JITTER_DELAY_MS 10.0     // Default longest wait for a missing frame in the jitter buffer
+
+#define CONFIG_FILE "config/udp_config.txt"  // Default configuration file path
+#define REPORT_INTERVAL 1.0                  // Default statistics interval in seconds
+#define IDLE_TIMEOUT_US 200000               // Longest blocking receive, so reports keep coming
+
+/**
+ * What stands in for a frame the jitter buffer gave up on
+ */
+typedef enum {
+    FILL_ERASE,               // Nothing: the reference and loops skip it, the filter restarts
+    FILL_ZERO                 // Zero samples, which the filter and loops run through
+} FillMode;
+
+/**
+ * Options controlling how frames are received and checked
+ */
+typedef struct {
+    int symbols;              // Symbols carried by each legacy frame
+    int check;                // Non-zero when the reference bits are known
+    BitSourceType pattern;    // Transmitter bit source
+    unsigned long long seed;  // Transmitter seed
+    unsigned long max_frames; // Frames to receive before stopping (0 = unlimited)
+    double report_interval;   // Seconds between statistics reports
+    int rcvbuf;               // Requested socket receive buffer in bytes
+    int batch;                // Datagrams per receive call
+    int gro;                  // Non-zero to request UDP_GRO
+    int timing;               // Non-zero to recover the symbol timing of shaped frames
+    double loop_bandwidth;    // Timing loop bandwidth relative to the symbol rate
+    double delay;             // Emulated sampling delay in symbols
+    double clock_ppm;         // Emulated sample clock offset
+    int carrier;              // Non-zero to recover the carrier of compact frames
+    double carrier_bandwidth; // Carrier loop bandwidth relative to the symbol rate
+    int equalize;             // Non-zero to equalize shaped frames
+    int eq_taps;              // Equalizer length in inputs
+    double eq_step;           // Equalizer adaptation step
+    int jitter;               // Frames a missing one may hold back in the jitter buffer, 0 for none
+    double jitter_delay;      // Longest wait for a missing frame in seconds
+    FillMode fill;            // Stand-in for frames given up on
+} RxOptions;
+
+/**
+ * Matched filter of pulse-shaped compact frames
+ *
+ * The filter delays the symbols by the pulse span, so after a restart its
+ * first span outputs belong to no received frame and are dropped; the
+ * outputs after them are the symbols of the frames since the restart, in
+ * order, and each full frame of them is demodulated at once. The
+ * equalizer delays them by its own delay on top.
+ */
+typedef struct {
+    RrcFilter filter;         // Matched filter (valid when sps > 1)
+    int recover;              // Non-zero to filter at the full rate and recover the timing
+    TimingLoop timing;        // Symbol timing loop, when recovering
+    int skewed;               // Non-zero to resample on arrival
+    ClockSkew clock;          // Emulated sample clock, when skewed
+    float *resampled;         // Room for clock_skew_room(FRAME_MAX_SAMPLES) samples
+    int equalize;             // Non-zero to equalize the symbols
+    Equalizer eq;             // Adaptive equalizer, when equalizing
+    int pick;                 // Full-rate outputs to pass over before the next equalizer input
+    int sps;                  // Parameters the filter was designed for, 0 before the first frame
+    int span;
+    float rolloff;
+    size_t symbols;           // Symbols per frame
+    ConvRate code;            // Code of the frames
+    float *decided;           // Filter outputs not yet demodulated, interleaved I/Q
+    size_t held;              // Symbols in decided
+    int discard;              // Outputs still to drop after a restart
+    unsigned long frames_in;  // Frames filtered since the restart
+    unsigned long frames_out; // Frames demodulated since the restart
+    uint64_t filled;          // Bit n % 64 set if frame n since the restart was filled in with zeros
+} ShapedRx;
+
+/**
+ * Counters for one reporting interval
+ */
+typedef struct {
+    unsigned long frames;     // Frames demodulated
+    unsigned long symbols;    // Symbols in the demodulated frames
+    unsigned long malformed;  // Datagrams that are not a valid frame
+    unsigned long bytes;      // Payload bytes of the demodulated frames
+    unsigned long syscalls;   // Receive system calls
+    unsigned long drops;      // Datagrams dropped by the kernel
+    FlowCounts flow;          // Sequence accounting of compact frames
+    unsigned long late;       // Frames the jitter buffer dropped as late
+    unsigned long gaps;       // Frames the jitter buffer gave up on
+    unsigned long filled;     // Of those, frames filled in with zeros
+    double latency_sum;       // Summed one-way latency of compact frames in seconds
+    unsigned long timed;      // Compact frames in latency_sum
+    QpskMoments moments;      // Signal moments for the Es/N0 estimate
+    CarrierStats carrier;     // Output of the carrier loop
+    EqStats equalizer;        // Output of the equalizer
+    unsigned long long coded_bits;   // Channel bits of decoded frames
+    unsigned long long coded_errors; // Of those, hard decisions the decoder corrected
+} RxCounts;
+
+static volatile sig_atomic_t keep_running = 1;
+
+/**
+ * Signal handler that stops the receive loop
+ */
+static void handle_stop(int sig) {
+    (void)sig;
+    keep_running = 0;
+}
+
+/**
+ * Current value of the monotonic clock in seconds
+ */
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/**
+ * Create the UDP socket bound to the configured port on all interfaces
+ *
+ * @return Socket descriptor, or -1 on failure
+ */
+static int open_socket(const UDPConfig *config) {
+    int sockfd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (sockfd == -1) {
+        perror("socket creation failed");
+        return -1;
+    }
+
+    struct timeval tv = { 0, IDLE_TIMEOUT_US };
+    setsockopt(sockfd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+
+    struct sockaddr_in saddr;
+    memset(&saddr, 0, sizeof(saddr));
+    saddr.sin_family = AF_INET;
+    saddr.sin_port = htons(config->port);
+    saddr.sin_addr.s_addr = htonl(INADDR_ANY);
+    if (bind(sockfd, (struct sockaddr *)&saddr, sizeof(saddr)) < 0) {
+        perror("bind failed");
+        close(sockfd);
+        return -1;
+    }
+    return sockfd;
+}
+
+/**
+ * Flow key of a sender: its IPv4 address and port
+ */
+static uint64_t source_key(const struct sockaddr_in *addr) {
+    return (uint64_t)ntohl(addr->sin_addr.s_addr) << 16 | ntohs(addr->sin_port);
+}
+
+/**
+ * Start filtering afresh, as if the next frame were the first one
+ */
+static void shaped_restart(ShapedRx *shaped) {
+    rrc_reset(&shaped->filter);
+    shaped->discard = shaped->span;
+    // The loop waits for the matched filter to fill before it corrects, and
+    // its first strobe may take a symbol either side of the frame's first
+    if (shaped->recover) {
+        shaped->discard -= timing_restart(&shaped->timing, shaped->span);
+    }
+    if (shaped->skewed) {
+        clock_skew_restart(&shaped->clock);
+    }
+    // The adapted weights still fit the channel; the symbols come out the
+    // equalizer's delay later
+    if (shaped->equalize) {
+        eq_restart(&shaped->eq);
+        shaped->discard += shaped->eq.delay;
+        shaped->pick = 0;
+    }
+    shaped->held = 0;
+    shaped->frames_in = 0;
+    shaped->frames_out = 0;
+}
+
+/**
+ * Frames filtered since the restart whose symbols are not all out yet
+ */
+static unsigned long shaped_pending(const ShapedRx *shaped) {
+    return shaped->frames_in - shaped->frames_out;
+}
+
+/**
+ * Code rate of a compact frame
+ */
+static ConvRate frame_code(const FrameHeader *hdr) {
+    return (ConvRate)((hdr->flags & FRAME_FLAG_CODE) >> FRAME_CODE_SHIFT);
+}
+
+/**
+ * Symbols' worth of reference bits a frame carries: all of its symbols,
+ * or the data bits of its codeword
+ */
+static size_t data_symbols(ConvRate code, size_t symbols) {
+    return code == CONV_NONE ? symbols : conv_info_bits(code, 2 * symbols) / 2;
+}
+
+/**
+ * Whether the filter was designed for the pulse, frame size and code of hdr
+ */
+static int shaped_matches(const ShapedRx *shaped, const FrameHeader *hdr) {
+    return shaped->sps == hdr->samples_per_symbol && shaped->span == hdr->pulse_span &&
+           shaped->rolloff == hdr->rolloff && shaped->symbols == hdr->symbols && shaped->code == frame_code(hdr);
+}
+
+/**
+ * Design the filter for the pulse and frame size of hdr and restart it
+ *
+ * @return 0 on success, -1 when the header describes no valid pulse or no symbols
+ */
+static int shaped_configure(ShapedRx *shaped, const FrameHeader *hdr, const RxOptions *opts) {
+    rrc_free(&shaped->filter);
+    shaped->sps = 0;
+    if (hdr->symbols == 0 || rrc_init(&shaped->filter, hdr->samples_per_symbol, hdr->pulse_span, hdr->rolloff) < 0) {
+        return -1;
+    }
+    shaped->recover = opts->timing;
+    if (shaped->recover) {
+        timing_init(&shaped->timing, hdr->samples_per_symbol, hdr->rolloff, opts->loop_bandwidth);
+    }
+    shaped->skewed = opts->delay != 0.0 || opts->clock_ppm != 0.0;
+    if (shaped->skewed) {
+        clock_skew_init(&shaped->clock, opts->delay * hdr->samples_per_symbol, opts->clock_ppm);
+    }
+    // Two inputs per symbol unless the timing loop or an odd sps only
+    // gives the symbol instants
+    shaped->equalize = opts->equalize;
+    if (shaped->equalize) {
+        int fractional = !shaped->recover && hdr->samples_per_symbol % 2 == 0;
+        if (eq_init(&shaped->eq, opts->eq_taps, fractional ? 2 : 1, opts->eq_step) < 0) {
+            return -1;
+        }
+    }
+    shaped->sps = hdr->samples_per_symbol;
+    shaped->span = hdr->pulse_span;
+    shaped->rolloff = hdr->rolloff;
+    shaped->symbols = hdr->symbols;
+    shaped->code = frame_code(hdr);
+    shaped_restart(shaped);
+    return 0;
+}
+
+/**
+ * Matched-filter (and equalize) the samples of a frame
+ *
+ * @param fill   Non-zero if the samples are zeros standing in for a lost frame
+ * @param stats  Equalizer statistics to add to
+ * @return Number of whole frames of symbols now waiting in decided
+ */
+static size_t shaped_filter(ShapedRx *shaped, const float *samples, size_t count, int fill, EqStats *stats) {
+    float *out = shaped->decided + 2 * shaped->held;
+    size_t n;
+
+    if (shaped->skewed) {
+        count = clock_skew_process(&shaped->clock, samples, count, shaped->resampled);
+        samples = shaped->resampled;
+    }
+    if (shaped->recover) {
+        // Filter every sample, then interpolate the symbols over them
+        rrc_filter(&shaped->filter, samples, count, out);
+        n = timing_process(&shaped->timing, out, count);
+    } else if (shaped->equalize && shaped->eq.sps == 2) {
+        // Filter every sample and keep the symbol instants and the
+        // midpoints between them
+        size_t half = (size_t)shaped->sps / 2;
+        rrc_filter(&shaped->filter, samples, count, out);
+        n = 0;
+        for (size_t i = (size_t)shaped->pick; i < count; i += half, n++) {
+            out[2 * n] = out[2 * i];
+            out[2 * n + 1] = out[2 * i + 1];
+        }
+        shaped->pick = (int)(shaped->pick + n * half - count);
+    } else {
+        n = rrc_decimate(&shaped->filter, samples, count, out);
+    }
+    if (shaped->equalize) {
+        n = eq_process(&shaped->eq, out, n, out, stats);
+    }
+
+    if (shaped->discard > 0) {
+        size_t drop = n < (size_t)shaped->discard ? n : (size_t)shaped->discard;
+        memmove(out, out + 2 * drop, 2 * (n - drop) * sizeof(float));
+        n -= drop;
+        shaped->discard -= (int)drop;
+    }
+    shaped->held += n;
+    shaped->filled &= ~(1ULL << (shaped->frames_in % 64));
+    shaped->filled |= (uint64_t)(fill != 0) << (shaped->frames_in % 64);
+    shaped->frames_in++;
+    return shaped->held / shaped->symbols;
+}
+
+/**
+ * Whether the f-th frame of symbols waiting in decided was filled in
+ */
+static int shaped_filled(const ShapedRx *shaped, size_t f) {
+    return (shaped->filled >> ((shaped->frames_out + f) % 64)) & 1;
+}
+
+/**
+ * Drop the first frames of symbols, which were demodulated
+ */
+static void shaped_consume(ShapedRx *shaped, size_t frames) {
+    size_t used = frames * shaped->symbols;
+    memmove(shaped->decided, shaped->decided + 2 * used, 2 * (shaped->held - used) * sizeof(float));
+    shaped->held -= used;
+    shaped->frames_out += frames;
+}
+
+/**
+ * Soft-decode the codeword carried by the symbols of a frame
+ *
+ * The decoded bits are encoded again and compared with the hard decisions
+ * to count the channel bit errors the code corrected.
+ *
+ * @param hard    Hard decisions of the symbols, four per byte
+ * @param info    Output, the data bits
+ * @param counts  Counters to add the channel bits and errors to
+ * @return Number of data bits
+ */
+static size_t decode_frame(ConvDecoder *decoder, ConvRate code, const float *iq, size_t symbols,
+                           const uint8_t *hard, uint8_t *info, RxCounts *counts) {
+    static int8_t llr[2 * FRAME_MAX_SYMBOLS];
+    uint8_t recoded[MAX_PACKED];
+    size_t info_bits = conv_info_bits(code, 2 * symbols);
+    size_t bits = 2 * symbols;
+
+    qpsk_demap_llr_int8(iq, symbols, CONV_LLR_SCALE, llr);
+    conv_decode(decoder, code, llr, info_bits, info);
+    conv_encode(code, info, info_bits, recoded, bits);
+    for (size_t i = 0; i < bits / 8; i++) {
+        counts->coded_errors += __builtin_popcount(hard[i] ^ recoded[i]);
+    }
+    if (bits % 8 != 0) {
+        counts->coded_errors += __builtin_popcount((hard[bits / 8] ^ recoded[bits / 8]) & (0xff00 >> (bits % 8)));
+    }
+    counts->coded_bits += bits;
+    return info_bits;
+}
+
+/**
+ * Add the counters of an interval to the running totals (except the flow
+ * counts, whose totals come from the flow table)
+ */
+static void add_counts(RxCounts *total, const RxCounts *interval) {
+    total->frames += interval->frames;
+    total->symbols += interval->symbols;
+    total->malformed += interval->malformed;
+    total->bytes += interval->bytes;
+    total->syscalls += interval->syscalls;
+    total->drops += interval->drops;
+    total->late += interval->late;
+    total->gaps += interval->gaps;
+    total->filled += interval->filled;
+    total->latency_sum += interval->latency_sum;
+    total->timed += interval->timed;
+    total->moments.m2 += interval->moments.m2;
+    total->moments.m4 += interval->moments.m4;
+    total->moments.symbols += interval->moments.symbols;
+    carrier_stats_add(&total->carrier, &interval->carrier);
+    eq_stats_add(&total->equalizer, &interval->equalizer);
+    total->coded_bits += interval->coded_bits;
+    total->coded_errors += interval->coded_errors;
+}
+
+/**
+ * Print throughput and error rates
+ *
+ * @param label    Prefix for the report line
+ * @param counts   Frames and signal moments received in the interval
+ * @param ber      Error counter, or NULL when not checking
+ * @param timing   Symbol timing loop, or NULL when not recovering
+ * @param carrier  Carrier loop, or NULL when not recovering
+ * @param eq       Equalizer, or NULL when not equalizing
+ * @param jitter   Jitter buffer whose depth percentiles to show, or NULL
+ * @param elapsed  Length of the interval in seconds
+ */
+static void report(const char *label, const RxCounts *counts, const BerCounter *ber, const TimingLoop *timing,
+                   const CostasLoop *carrier, const Equalizer *eq, const JitterBuffer *jitter, double elapsed) {
+    if (elapsed <= 0) {
+        return;
+    }
+    double frame_symbols = (double)counts->symbols;
+    printf("%s %.2f s: %.0f frames/s, %.3f Msym/s, %.3f Mbit/s data, %.3f Mbit/s payload",
+           label, elapsed, counts->frames / elapsed, frame_symbols / elapsed / 1e6,
+           frame_symbols * 2.0 / elapsed / 1e6, counts->bytes * 8.0 / elapsed / 1e6);
+    if (counts->frames + counts->malformed > 0) {
+        printf(", %.3f syscalls/frame", (double)counts->syscalls / (counts->frames + counts->malformed));
+    }
+    if (counts->malformed > 0) {
+        printf(", %lu malformed", counts->malformed);
+    }
+    if (counts->drops > 0) {
+        printf(", %lu kernel drops", counts->drops);
+    }
+    if (counts->flow.lost > 0 || counts->flow.reordered > 0 || counts->flow.duplicated > 0) {
+        printf(", %llu lost, %llu reordered, %llu duplicated", counts->flow.lost, counts->flow.reordered,
+               counts->flow.duplicated);
+    }
+    if (counts->flow.corrupt > 0) {
+        printf(", %llu corrupt", counts->flow.corrupt);
+    }
+    if (counts->timed > 0) {
+        printf(", latency %.1f us", counts->latency_sum / counts->timed * 1e6);
+    }
+    if (jitter != NULL) {
+        printf(" | jitter depth p50 %u, p90 %u, p99 %u, max %u, %lu late, %lu gaps",
+               jitter_depth_percentile(jitter, 0.5), jitter_depth_percentile(jitter, 0.9),
+               jitter_depth_percentile(jitter, 0.99), jitter_depth_percentile(jitter, 1.0),
+               counts->late, counts->gaps);
+        if (counts->filled > 0) {
+            printf(" (%lu filled)", counts->filled);
+        }
+    }
+    if (counts->moments.symbols > 0) {
+        printf(" | Es/N0 %.1f dB", qpsk_snr_from_moments(&counts->moments).esn0_db);
+    }
+    if (timing != NULL) {
+        printf(" | timing %+.3f sym, %+.0f ppm", timing_offset(timing), timing_drift_ppm(timing));
+    }
+    if (carrier != NULL) {
+        printf(" | carrier %s, %+.5f cyc/sym", carrier->locked ? "locked" : "unlocked", costas_frequency(carrier));
+        if (counts->carrier.symbols > 0) {
+            printf(", %.1f deg rms, lock %.2f", carrier_phase_error(&counts->carrier),
+                   carrier_lock_metric(&counts->carrier));
+        }
+        if (carrier->unlocks > 0) {
+            printf(", %llu unlocks", carrier->unlocks);
+        }
+    }
+    if (eq != NULL) {
+        printf(" | eq %s", eq_mode_name(eq->mode));
+        if (counts->equalizer.symbols > 0) {
+            printf(", MER %.1f dB, EVM %.1f%%", eq_mer_db(&counts->equalizer), eq_evm_percent(&counts->equalizer));
+        }
+        if (eq->switches > 0) {
+            printf(", %llu switches", eq->switches);
+        }
+    }
+    if (counts->coded_bits > 0) {
+        printf(" | FEC raw BER %.3e", (double)counts->coded_errors / counts->coded_bits);
+    }
+    if (ber != NULL) {
+        if (ber->bits > 0) {
+            printf(" | BER %.3e (%llu/%llu) SER %.3e", ber_bit_rate(ber),
+                   ber->bit_errors, ber->bits, ber_symbol_rate(ber));
+        } else {
+            printf(" | BER -");
+        }
+        if (ber->self_sync) {
+            printf(" %s, %llu resyncs", ber->locked ? "locked" : "searching", ber->resyncs);
+        }
+    }
+    printf("\n");
+    fflush(stdout);
+}
+
+/**
+ * Receive, demodulate and check frames until stopped
+ */
+static int run_receiver(const UDPConfig *config, const RxOptions *opts) {
+    size_t legacy_bytes = COMBINATION_LENGTH * sizeof(float);
+    static float scratch[2 * FRAME_MAX_SAMPLES];   // Decoded samples of the largest frame
+    static float decided[2 * (2 * FRAME_MAX_SYMBOLS + 1)]; // Matched filter outputs of up to two frames
+    static float resampled[2 * (FRAME_MAX_SAMPLES + FRAME_MAX_SAMPLES / 256)]; // Emulated clock's samples
+    uint8_t packed_bits[MAX_PACKED];
+    uint8_t info[MAX_PACKED];
+    FlowTable flows;
+    JitterBuffer jitter;
+    FrameHeader last_hdr;                          // Last compact frame demodulated, the model for fill frames
+    uint32_t jitter_gap = 0;                       // Frames given up on since the last one out of the buffer
+    int jitter_started = 0;
+    ShapedRx shaped;
+    CostasLoop costas;
+    DiffCoder coder;
+    ConvDecoder decoder;
+    BerCounter ber;
+    UdpRx rx;
+
+    if (conv_decoder_init(&decoder, 2 * FRAME_MAX_SYMBOLS) < 0) {
+        perror("conv_decoder_init failed");
+        return 1;
+    }
+    memset(&jitter, 0, sizeof(jitter));
+    memset(&last_hdr, 0, sizeof(last_hdr));
+    if (opts->jitter > 0 && jitter_init(&jitter, opts->jitter, opts->jitter_delay) < 0) {
+        fprintf(stderr, "jitter_init failed\n");
+        conv_decoder_free(&decoder);
+        return 1;
+    }
+    int sockfd = open_socket(config);
+    if (sockfd == -1) {
+        jitter_free(&jitter);
+        conv_decoder_free(&decoder);
+        return 1;
+    }
+
+    // A large buffer absorbs bursts while the receiver is descheduled, and
+    // slots of the largest UDP payload take compact frames of any size
+    int rcvbuf = udp_rx_set_rcvbuf(sockfd, opts->rcvbuf);
+    if (udp_rx_init(&rx, sockfd, FRAME_MAX_BYTES, opts->batch, opts->gro) < 0) {
+        perror("udp_rx_init failed");
+        close(sockfd);
+        jitter_free(&jitter);
+        conv_decoder_free(&decoder);
+        return 1;
+    }
+
+    if (opts->check) {
+        ber_init(&ber, opts->pattern, opts->seed);
+    }
+    memset(&shaped, 0, sizeof(shaped));
+    shaped.decided = decided;
+    shaped.resampled = resampled;
+    costas_init(&costas, opts->carrier_bandwidth);
+    diff_init(&coder);
+    flow_table_init(&flows);
+
+    // No SA_RESTART, so Ctrl-C also ends a blocking receive
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = handle_stop;
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+
+    printf("Receiving on port %d (receive buffer %d bytes, %d per batch%s, %d symbols per legacy frame)\n",
+           config->port, rcvbuf, opts->batch, rx.gro ? ", GRO" : "", opts->symbols);
+    if (opts->gro && !rx.gro) {
+        printf("UDP_GRO not available, receiving datagrams individually\n");
+    }
+    if (opts->check) {
+        printf("Checking against %s bits", bitsrc_type_name(opts->pattern));
+        if (opts->pattern == BITSRC_RANDOM) {
+            printf(", seed %llu", opts->seed);
+        }
+        printf("\n");
+    } else {
+        printf("Not checking bits (give --pattern, and --seed for random bits)\n");
+    }
+    if (opts->timing) {
+        printf("Timing recovery on shaped frames: Gardner, loop bandwidth %g of the symbol rate\n",
+               opts->loop_bandwidth);
+    }
+    if (opts->delay != 0.0 || opts->clock_ppm != 0.0) {
+        printf("Emulated sample clock on shaped frames: %+.3f symbols late, %+.1f ppm\n",
+               opts->delay, opts->clock_ppm);
+    }
+    if (opts->carrier) {
+        printf("Carrier recovery on compact frames: Costas loop, bandwidth %g of the symbol rate (%s)\n",
+               opts->carrier_bandwidth, qpsk_isa_name(carrier_isa()));
+    }
+    if (opts->equalize) {
+        printf("Equalizer on shaped frames: %d taps, step %g, T/2-spaced for even sps without timing recovery (%s)\n",
+               opts->eq_taps, opts->eq_step, qpsk_isa_name(eq_isa()));
+    }
+    printf("Coded frames: soft-decision Viterbi decoder (%s)\n", qpsk_isa_name(conv_isa()));
+    printf("Frame CRC32C checked when present (%s)\n", crc32c_impl_name(crc32c_impl()));
+    if (opts->jitter > 0) {
+        printf("Jitter buffer: up to %d frames or %.1f ms behind a missing frame, ring of %u, %s\n",
+               opts->jitter, opts->jitter_delay * 1e3, jitter.mask + 1,
+               opts->fill == FILL_ZERO ? "lost shaped frames filled with zeros" : "lost frames erased");
+    }
+    fflush(stdout);
+
+    RxCounts interval, total;
+    unsigned long received = 0;
+    unsigned long long last_syscalls = 0, last_drops = 0, last_late = 0, last_gaps = 0;
+    FlowCounts flow_now, flow_last;
+
+    memset(&interval, 0, sizeof(interval));
+    memset(&total, 0, sizeof(total));
+    memset(&flow_last, 0, sizeof(flow_last));
+    double start = 0, last_frame = 0, last_report = 0;
+
+    while (keep_running && (opts->max_frames == 0 || received < opts->max_frames)) {
+        // Step 1: Take the next frame out of the jitter buffer, or the next
+        // datagram, receiving a new batch when needed
+        JitterOut out;
+        int buffered = opts->jitter > 0 && jitter_next(&jitter, now_seconds(), &out) != JITTER_NONE;
+        const uint8_t *data = out.data;
+        ssize_t len = buffered ? (ssize_t)out.length : udp_rx_next(&rx, &data);
+        double now = now_seconds();
+        const float *real = NULL, *imag = NULL, *iq = NULL;
+        size_t symbols = 0, ready = 0;
+        int shaped_frame = 0, differential = 0, compact = 0, fill = 0;
+        ConvRate code = CONV_NONE;
+        FrameHeader hdr;
+
+        if (buffered && out.kind == JITTER_GAP) {
+            // Given up on: a lone shaped frame may be filled with zeros, which
+            // the filter and loops run through; otherwise the reference and
+            // the loops skip it along with the next frame
+            if (opts->fill == FILL_ZERO && out.count == 1 && jitter_started && last_hdr.samples_per_symbol > 1 &&
+                shaped_matches(&shaped, &last_hdr)) {
+                hdr = last_hdr;
+                hdr.sequence = out.sequence;
+                fill = 1;
+            } else {
+                jitter_gap += out.count;
+            }
+        } else if (len < 0) {
+            if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+                perror("recv failed");
+                break;
+            }
+        } else if (frame_parse_header(data, len, &hdr)) {
+            compact = 1;
+        } else if ((size_t)len == legacy_bytes) {
+            const float *frame = (const float *)data;
+            symbols = opts->symbols;
+            real = frame + BLOCK_LENGTH;
+            imag = frame + BLOCK_LENGTH*2;
+        } else if (len > 0 && data[0] == '(') {
+            // Symbol text from udp_ascii
+            long n = ascii_parse_symbols((const char *)data, len, scratch, FRAME_MAX_SYMBOLS);
+            if (n > 0) {
+                symbols = n;
+                iq = scratch;
+            } else {
+                interval.malformed++;
+            }
+        } else {
+            interval.malformed++;
+        }
+
+        if (compact || fill) {
+            // Frames ahead of the expected sequence number follow lost ones,
+            // whose bits the reference skips; corrupt, late and repeated
+            // frames are only counted
+            uint32_t gap = 0;
+            int in_order = 0, restart = 0;
+            if (fill) {
+                in_order = 1;
+            } else if (buffered) {
+                // In order by now; the numbers given up on before it are the gap
+                gap = jitter_gap;
+                jitter_gap = 0;
+                restart = !jitter_started || (hdr.flags & FRAME_FLAG_START);
+                jitter_started = 1;
+                in_order = 1;
+            } else {
+                Flow *flow = flow_lookup(&flows, source_key(udp_rx_source(&rx)));
+                FlowVerdict verdict = FLOW_DUPLICATE;
+                restart = !flow->started || (hdr.flags & FRAME_FLAG_START);
+                if (!frame_check(data, &hdr)) {
+                    flow_corrupt(flow);
+                } else {
+                    verdict = flow_track(flow, hdr.sequence, (hdr.flags & FRAME_FLAG_START) != 0, &gap);
+                }
+                if (opts->jitter == 0) {
+                    in_order = verdict == FLOW_NEXT;
+                } else if (verdict != FLOW_DUPLICATE) {
+                    // Demodulated once it comes out of the jitter buffer
+                    if (hdr.flags & FRAME_FLAG_START) {
+                        jitter_restart(&jitter);
+                        jitter_started = 0;
+                        jitter_gap = 0;
+                    }
+                    if (jitter_insert(&jitter, hdr.sequence, data, len) == JITTER_ERROR) {
+                        interval.malformed++;
+                    }
+                }
+            }
+            if (in_order && restart) {
+                // Bits sent before the receiver started are skipped, not lost
+                if (opts->check && !(hdr.flags & FRAME_FLAG_START)) {
+                    ber_skip(&ber, hdr.sequence, data_symbols(frame_code(&hdr), hdr.symbols));
+                }
+                if (hdr.flags & FRAME_FLAG_START) {
+                    // The transmitter restarted its bits as well
+                    if (opts->check) {
+                        ber_restart(&ber, opts->pattern, opts->seed);
+                    }
+                    diff_init(&coder);
+                }
+            }
+            if (in_order) {
+                // A gap or a different pulse breaks the filtered signal; the
+                // frames whose last symbols are still in the filter are lost
+                if (shaped.sps > 0 && (gap > 0 || restart || !shaped_matches(&shaped, &hdr))) {
+                    if (opts->check && !(hdr.flags & FRAME_FLAG_START)) {
+                        ber_skip(&ber, shaped_pending(&shaped), data_symbols(shaped.code, shaped.symbols));
+                    }
+                    costas_skip(&costas, (unsigned long long)shaped_pending(&shaped) * shaped.symbols);
+                    shaped_restart(&shaped);
+                }
+                if (gap > 0) {
+                    if (opts->check) {
+                        ber_skip(&ber, (unsigned long long)gap, data_symbols(frame_code(&hdr), hdr.symbols));
+                    }
+                    // The carrier kept turning while the lost frames were on the way
+                    costas_skip(&costas, (unsigned long long)gap * hdr.symbols);
+                }
+                shaped_frame = hdr.samples_per_symbol > 1;
+                if (shaped_frame && !shaped_matches(&shaped, &hdr) && shaped_configure(&shaped, &hdr, opts) < 0) {
+                    interval.malformed++;
+                } else {
+                    symbols = hdr.symbols;
+                    if (fill) {
+                        memset(scratch, 0, 2 * frame_samples(&hdr) * sizeof(float));
+                        iq = scratch;
+                    } else if (hdr.format == FRAME_FORMAT_F32) {
+                        iq = frame_get_f32(data + hdr.header_bytes, 2 * frame_samples(&hdr), scratch);
+                    } else {
+                        frame_decode_payload(&hdr, data + hdr.header_bytes, scratch);
+                        iq = scratch;
+                    }
+                    if (shaped_frame) {
+                        ready = shaped_filter(&shaped, iq, frame_samples(&hdr), fill, &interval.equalizer);
+                    } else if (opts->carrier) {
+                        // The loop turns the symbols in place, so not in the datagram
+                        if (iq != scratch) {
+                            memcpy(scratch, iq, 2 * symbols * sizeof(float));
+                            iq = scratch;
+                        }
+                        costas_process(&costas, scratch, symbols, &interval.carrier);
+                    }
+                    differential = (hdr.flags & FRAME_FLAG_DIFFERENTIAL) != 0;
+                    code = frame_code(&hdr);
+                    if (!fill) {
+                        interval.latency_sum += (double)(int64_t)(frame_timestamp_ns() - hdr.timestamp_ns) * 1e-9;
+                        interval.timed++;
+                        last_hdr = hdr;
+                    }
+                }
+            }
+        }
+
+        if (symbols > 0) {
+            // Steps 2-3: Demap the symbols and count errors
+            if (shaped_frame) {
+                // Whole frames of matched filter outputs, usually one
+                for (size_t f = 0; f < ready; f++) {
+                    float *frame_iq = shaped.decided + 2 * f * shaped.symbols;
+                    if (opts->carrier) {
+                        costas_process(&costas, frame_iq, shaped.symbols, &interval.carrier);
+                    }
+                    if (shaped_filled(&shaped, f)) {
+                        // Symbols of a frame filled in with zeros carry no bits
+                        if (opts->check) {
+                            ber_skip(&ber, 1, data_symbols(code, shaped.symbols));
+                        }
+                        continue;
+                    }
+                    qpsk_demap_hard(frame_iq, shaped.symbols, packed_bits);
+                    qpsk_moments_add_iq(&interval.moments, frame_iq, shaped.symbols);
+                    if (code != CONV_NONE) {
+                        size_t bits = decode_frame(&decoder, code, frame_iq, shaped.symbols, packed_bits, info,
+                                                   &interval);
+                        if (opts->check) {
+                            ber_update(&ber, info, bits / 2);
+                        }
+                    } else {
+                        if (differential) {
+                            diff_decode(&coder, packed_bits, shaped.symbols);
+                        }
+                        if (opts->check) {
+                            ber_update(&ber, packed_bits, shaped.symbols);
+                        }
+                    }
+                }
+                shaped_consume(&shaped, ready);
+            } else {
+                if (iq != NULL) {
+                    qpsk_demap_hard(iq, symbols, packed_bits);
+                    qpsk_moments_add_iq(&interval.moments, iq, symbols);
+                } else {
+                    qpsk_demap_hard_planar(real, imag, symbols, packed_bits);
+                    qpsk_moments_add(&interval.moments, real, imag, symbols);
+                }
+                if (code != CONV_NONE) {
+                    size_t bits = decode_frame(&decoder, code, iq, symbols, packed_bits, info, &interval);
+                    if (opts->check) {
+                        ber_update(&ber, info, bits / 2);
+                    }
+                } else {
+                    if (differential) {
+                        diff_decode(&coder, packed_bits, symbols);
+                    }
+                    if (opts->check) {
+                        ber_update(&ber, packed_bits, symbols);
+                    }
+                }
+            }
+            if (fill) {
+                interval.filled++;
+            } else {
+                if (received++ == 0) {
+                    start = now;
+                    last_report = now;
+                }
+                last_frame = now;
+                interval.frames++;
+                interval.symbols += symbols;
+                interval.bytes += len;
+            }
+        }
+
+        // Step 4: Report once per interval while datagrams are arriving
+        if (received > 0 && now - last_report >= opts->report_interval) {
+            interval.syscalls = rx.syscalls - last_syscalls;
+            interval.drops = rx.kernel_drops - last_drops;
+            last_syscalls = rx.syscalls;
+            last_drops = rx.kernel_drops;
+            flow_table_counts(&flows, &flow_now);
+            flow_counts_diff(&flow_now, &flow_last, &interval.flow);
+            flow_last = flow_now;
+            interval.late = jitter.late - last_late;
+            interval.gaps = jitter.gaps - last_gaps;
+            last_late = jitter.late;
+            last_gaps = jitter.gaps;
+            if (interval.frames + interval.malformed + interval.drops + interval.flow.reordered +
+                interval.flow.duplicated + interval.flow.corrupt + interval.late + interval.gaps > 0) {
+                report("[recv]", &interval, opts->check ? &ber : NULL, shaped.recover ? &shaped.timing : NULL,
+                       opts->carrier ? &costas : NULL, shaped.equalize ? &shaped.eq : NULL,
+                       opts->jitter > 0 ? &jitter : NULL, now - last_report);
+            }
+            add_counts(&total, &interval);
+            memset(&interval, 0, sizeof(interval));
+            last_report = now;
+        }
+    }
+    interval.syscalls = rx.syscalls - last_syscalls;
+    interval.drops = rx.kernel_drops - last_drops;
+    interval.late = jitter.late - last_late;
+    interval.gaps = jitter.gaps - last_gaps;
+    add_counts(&total, &interval);
+    flow_table_counts(&flows, &total.flow);
+
+    rrc_free(&shaped.filter);
+    conv_decoder_free(&decoder);
+    udp_rx_free(&rx);
+    close(sockfd);
+
+    printf("Received %lu frames (%lu malformed, %lu dropped by the kernel, %llu lost, %llu reordered, "
+           "%llu duplicated, %llu corrupt) on port %d",
+           total.frames, total.malformed, total.drops, total.flow.lost, total.flow.reordered,
+           total.flow.duplicated, total.flow.corrupt, config->port);
+    if (flows.count > 1 || flows.evicted > 0) {
+        printf(" from %d senders", flows.count);
+        if (flows.evicted > 0) {
+            printf(" (%llu more forgotten)", flows.evicted);
+        }
+    }
+    printf(".\n");
+    if (jitter.held > 0) {
+        printf("%u frames were still in the jitter buffer.\n", jitter.held);
+    }
+    if (total.frames > 0) {
+        report("[total]", &total, opts->check ? &ber : NULL, shaped.recover ? &shaped.timing : NULL,
+               opts->carrier ? &costas : NULL, shaped.equalize ? &shaped.eq : NULL,
+               opts->jitter > 0 ? &jitter : NULL, last_frame - start);
+    }
+    jitter_free(&jitter);
+    return 0;
+}
+
+/**
+ * Print command line usage
+ */
+static void usage(const char *prog) {
+    printf("Usage: %s [options] [config_file]\n", prog);
+    printf("  -m, --symbols N       Symbols per legacy frame, as sent (1-%d, default %d)\n", MAX_SYMBOLS, SYMBOLS_COUNT);
+    printf("  -p, --pattern NAME    Transmitted bits: random, prbs7, prbs15, prbs23 or prbs31\n");
+    printf("  -S, --seed N          Transmitter seed (needed for random bits)\n");
+    printf("  -n, --frames N        Stop after N frames (0 = unlimited)\n");
+    printf("  -i, --interval SEC    Statistics report interval (default %.0f s)\n", REPORT_INTERVAL);
+    printf("  -b, --rcvbuf BYTES    Socket receive buffer size (default %d)\n", RCVBUF_BYTES);
+    printf("  -B, --batch N         Datagrams per receive call (1-%d, default %d)\n", UDP_RX_MAX_BATCH, RX_BATCH);
+    printf("  -g, --gro             Let the kernel coalesce datagrams (UDP_GRO)\n");
+    printf("  -t, --timing          Recover the symbol timing of shaped frames (Gardner loop)\n");
+    printf("  -w, --loop-bandwidth B Timing loop bandwidth relative to the symbol rate (default %g)\n",
+           TIMING_DEFAULT_BANDWIDTH);
+    printf("  -d, --delay SYM       Emulate sampling shaped frames late by SYM symbols (-0.5 to 0.5)\n");
+    printf("  -c, --clock-ppm PPM   Emulate a sample clock off by PPM parts per million (up to +-%.0f)\n",
+           TIMING_MAX_PPM);
+    printf("  -C, --carrier         Recover the carrier phase and frequency of compact frames (Costas loop)\n");
+    printf("  -W, --carrier-bandwidth B Carrier loop bandwidth relative to the symbol rate (default %g)\n",
+           COSTAS_DEFAULT_BANDWIDTH);
+    printf("  -e, --equalize        Equalize shaped frames (fractionally spaced CMA/LMS)\n");
+    printf("  -T, --eq-taps N       Equalizer length in inputs (2-%d, default %d)\n", EQ_MAX_TAPS, EQ_DEFAULT_TAPS);
+    printf("  -u, --eq-step MU      Equalizer adaptation step (up to %g, default %g)\n", EQ_MAX_STEP, EQ_DEFAULT_STEP);
+    printf("  -j, --jitter N        Reorder compact frames, letting a missing one hold back up to N (0 = off, max %d)\n",
+           JITTER_MAX_WINDOW);
+    printf("  -J, --jitter-delay MS Longest wait for a missing frame (default %g ms)\n", JITTER_DELAY_MS);
+    printf("  -z, --fill MODE       Stand-in for frames given up on: erase or zero (default erase)\n");
+}
+
+int main(int argc, char *argv[]) {
+    RxOptions opts = { SYMBOLS_COUNT, 0, BITSRC_RANDOM, 0, 0, REPORT_INTERVAL, RCVBUF_BYTES,
+                       RX_BATCH, 0, 0, TIMING_DEFAULT_BANDWIDTH, 0.0, 0.0, 0, COSTAS_DEFAULT_BANDWIDTH,
+                       0, EQ_DEFAULT_TAPS, EQ_DEFAULT_STEP, 0, JITTER_DELAY_MS / 1e3, FILL_ERASE };
+    int pattern_given = 0, seed_given = 0;
+    static const struct option long_opts[] = {
+        { "symbols",  required_argument, NULL, 'm' },
+        { "pattern",  required_argument, NULL, 'p' },
+        { "seed",     required_argument, NULL, 'S' },
+        { "frames",   required_argument, NULL, 'n' },
+        { "interval", required_argument, NULL, 'i' },
+        { "rcvbuf",   required_argument, NULL, 'b' },
+        { "batch",    required_argument, NULL, 'B' },
+        { "gro",      no_argument,       NULL, 'g' },
+        { "timing",   no_argument,       NULL, 't' },
+        { "loop-bandwidth", required_argument, NULL, 'w' },
+        { "delay",    required_argument, NULL, 'd' },
+        { "clock-ppm", required_argument, NULL, 'c' },
+        { "carrier",  no_argument,       NULL, 'C' },
+        { "carrier-bandwidth", required_argument, NULL, 'W' },
+        { "equalize", no_argument,       NULL, 'e' },
+        { "eq-taps",  required_argument, NULL, 'T' },
+        { "eq-step",  required_argument, NULL, 'u' },
+        { "jitter",   required_argument, NULL, 'j' },
+        { "jitter-delay", required_argument, NULL, 'J' },
+        { "fill",     required_argument, NULL, 'z' },
+        { "help",     no_argument,       NULL, 'h' },
+        { NULL, 0, NULL, 0 }
+    };
+    int opt;
+
+    while ((opt = getopt_long(argc, argv, "m:p:S:n:i:b:B:gtw:d:c:CW:eT:u:j:J:z:h", long_opts, NULL)) != -1) {
+        switch (opt) {
+        case 'm': opts.symbols = atoi(optarg); break;
+        case 'S': opts.seed = strtoull(optarg, NULL, 0); seed_given = 1; break;
+        case 'n': opts.max_frames = strtoul(optarg, NULL, 10); break;
+        case 'i': opts.report_interval = atof(optarg); break;
+        case 'b': opts.rcvbuf = atoi(optarg); break;
+        case 'B': opts.batch = atoi(optarg); break;
+        case 'g': opts.gro = 1; break;
+        case 't': opts.timing = 1; break;
+        case 'w': opts.loop_bandwidth = atof(optarg); break;
+        case 'd': opts.delay = atof(optarg); break;
+        case 'c': opts.clock_ppm = atof(optarg); break;
+        case 'C': opts.carrier = 1; break;
+        case 'W': opts.carrier_bandwidth = atof(optarg); break;
+        case 'e': opts.equalize = 1; break;
+        case 'T': opts.eq_taps = atoi(optarg); break;
+        case 'u': opts.eq_step = atof(optarg); break;
+        case 'j': opts.jitter = atoi(optarg); break;
+        case 'J': opts.jitter_delay = atof(optarg) / 1e3; break;
+        case 'z':
+            if (strcmp(optarg, "zero") == 0) {
+                opts.fill = FILL_ZERO;
+            } else if (strcmp(optarg, "erase") == 0) {
+                opts.fill = FILL_ERASE;
+            } else {
+                fprintf(stderr, "Unknown fill mode: %s\n", optarg);
+                return 1;
+            }
+            break;
+        case 'p':
+            if (!bitsrc_parse_type(optarg, &opts.pattern)) {
+                fprintf(stderr, "Unknown pattern: %s\n", optarg);
+                return 1;
+            }
+            pattern_given = 1;
+            break;
+        case 'h': usage(argv[0]); return 0;
+        default:  usage(argv[0]); return 1;
+        }
+    }
+    if (opts.symbols < 1 || opts.symbols > MAX_SYMBOLS) {
+        fprintf(stderr, "Symbols per frame must be between 1 and %d\n", MAX_SYMBOLS);
+        return 1;
+    }
+    if (opts.batch < 1 || opts.batch > UDP_RX_MAX_BATCH) {
+        fprintf(stderr, "Batch size must be between 1 and %d\n", UDP_RX_MAX_BATCH);
+        return 1;
+    }
+    if (opts.loop_bandwidth <= 0 || opts.loop_bandwidth > TIMING_MAX_BANDWIDTH) {
+        fprintf(stderr, "Loop bandwidth must be above 0 and up to %g\n", TIMING_MAX_BANDWIDTH);
+        return 1;
+    }
+    if (opts.delay < -0.5 || opts.delay > 0.5 || opts.clock_ppm < -TIMING_MAX_PPM || opts.clock_ppm > TIMING_MAX_PPM) {
+        fprintf(stderr, "The emulated clock must be -0.5 to 0.5 symbols late and within %.0f ppm\n",
+                TIMING_MAX_PPM);
+        return 1;
+    }
+    if (opts.carrier_bandwidth <= 0 || opts.carrier_bandwidth > COSTAS_MAX_BANDWIDTH) {
+        fprintf(stderr, "Carrier loop bandwidth must be above 0 and up to %g\n", COSTAS_MAX_BANDWIDTH);
+        return 1;
+    }
+    if (opts.eq_taps < 2 || opts.eq_taps > EQ_MAX_TAPS || opts.eq_step <= 0 || opts.eq_step > EQ_MAX_STEP) {
+        fprintf(stderr, "The equalizer needs 2 to %d taps and a step above 0 and up to %g\n",
+                EQ_MAX_TAPS, EQ_MAX_STEP);
+        return 1;
+    }
+    if (opts.jitter < 0 || opts.jitter > JITTER_MAX_WINDOW || !(opts.jitter_delay >= 0)) {
+        fprintf(stderr, "The jitter buffer holds 0 to %d frames for a non-negative delay\n", JITTER_MAX_WINDOW);
+        return 1;
+    }
+    if (opts.report_interval <= 0) {
+        opts.report_interval = REPORT_INTERVAL;
+    }
+
+    // Random bits can only be rebuilt from the seed; a PRBS locks by itself
+    opts.check = (opts.pattern == BITSRC_RANDOM) ? seed_given : pattern_given;
+    BitSource probe;
+    bitsrc_init(&probe, opts.pattern, 0);
+    if (opts.symbols % 4 != 0 && 2 * opts.symbols < bitsrc_sync_bits(&probe)) {
+        fprintf(stderr, "Warning: frames of %d symbols are too short to lock onto %s\n",
+                opts.symbols, bitsrc_type_name(opts.pattern));
+    }
+
+    // Initialize UDP configuration with default values (localhost)
+    UDPConfig config;
+    init_udp_config(&config);
+
+    // Load configuration from file if specified
+    const char *config_file = (optind < argc) ? argv[optind] : CONFIG_FILE;
+    if (load_udp_config(&config, config_file)) {
+        printf("Loaded configuration from %s\n", config_file);
+    } else {
+        printf("Using default configuration (localhost:9090)\n");
+    }
+
+    // Display current configuration
+    print_udp_config(&config);
+
+    return run_receiver(&config, &opts);
+}